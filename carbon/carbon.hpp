@@ -10,23 +10,51 @@
 #include "setup.hpp"
 #include "paths.hpp"
 
+#include "common/allocation_tracker.hpp"
 #include "common/debug.hpp"
 #include "common/logger.hpp"
+#include "common/mapped_file.hpp"
 #include "common/template_types.hpp"
+#include "common/tlsf.hpp"
 #include "common/utils.hpp"
 
+#include "core/command_pool.hpp"
+#include "core/command_recorder.hpp"
+#include "core/deletion_queue.hpp"
+#include "core/descriptor_allocator.hpp"
+#include "core/frame_arena.hpp"
+#include "core/host_allocator.hpp"
 #include "core/instance.hpp"
+#include "core/job_system.hpp"
 #include "core/logical_device.hpp"
+#include "core/memory_allocator.hpp"
 #include "core/physical_device.hpp"
 #include "core/time.hpp"
 
 #include "display/input.hpp"
+#include "display/offscreen.hpp"
 #include "display/surface.hpp"
 #include "display/swapchain.hpp"
 #include "display/window/window_glfw.hpp"
 
 #include "engine/engine.hpp"
 
+#include "pipeline/bindless_table.hpp"
+#include "pipeline/descriptor_layout_cache.hpp"
+#include "pipeline/pipeline.hpp"
+#include "pipeline/pipeline_cache.hpp"
+#include "pipeline/pipeline_library.hpp"
+#include "pipeline/pipeline_state.hpp"
+#include "pipeline/render_graph.hpp"
 #include "pipeline/render_pass.hpp"
+#include "pipeline/render_pass_cache.hpp"
+#include "pipeline/sampler_cache.hpp"
+#include "pipeline/shader_cache.hpp"
+
+#include "resources/buffer.hpp"
+#include "resources/defragmenter.hpp"
+#include "resources/image.hpp"
+#include "resources/uniform_ring.hpp"
+#include "resources/upload_manager.hpp"
 
 #endif // CARBON_HPP
@@ -0,0 +1,454 @@
+// file      : carbon/common/allocation_tracker.cpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#include "allocation_tracker.hpp"
+
+#include "carbon/platform.hpp"
+#include "carbon/common/logger.hpp"
+#include "carbon/engine/config.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#if CARBON_USE_ALLOCATION_TRACKING
+#	if CARBON_PLATFORM == CARBON_PLATFORM_WINDOWS
+#		ifndef WIN32_LEAN_AND_MEAN
+#			define WIN32_LEAN_AND_MEAN
+#		endif
+#		ifndef NOMINMAX
+#			define NOMINMAX
+#		endif
+#		include <windows.h>
+#		include <dbghelp.h>
+#		pragma comment(lib, "dbghelp.lib")
+#		ifdef _DEBUG
+#			include <crtdbg.h>
+#			define CARBON_HOOK_CRT 1
+#		endif
+#	elif CARBON_PLATFORM == CARBON_PLATFORM_LINUX || CARBON_PLATFORM == CARBON_PLATFORM_APPLE
+#		include <execinfo.h>
+#		define CARBON_HAS_BACKTRACE 1
+#	endif
+#endif // CARBON_USE_ALLOCATION_TRACKING
+
+namespace carbon {
+
+	namespace {
+
+		/**
+		 * @brief Allocations of a single thread during the current frame.
+		 */
+		struct ThreadCounter {
+			std::atomic<u64> count{ 0 };
+			std::atomic<u64> bytes{ 0 };
+		};
+
+		/**
+		 * @brief Where an allocation was made from.
+		 */
+		struct Stack {
+			std::array<void*, AllocationTracker::MAX_STACK_DEPTH> frames{};
+			u32 depth{ 0 };
+			u32 thread{ 0 };
+			u64 size{ 0 };
+
+			/**
+			 * @brief Set once the stack has been filled in.
+			 */
+			std::atomic<bool> ready{ false };
+		};
+
+		// plain globals rather than function-local statics, since those could allocate in the hook
+		std::array<ThreadCounter, AllocationTracker::MAX_THREADS> g_threads;
+		std::atomic<u32> g_thread_count{ 0 };
+
+		std::array<Stack, AllocationTracker::MAX_STACKS> g_stacks;
+		std::atomic<u32> g_stack_count{ 0 };
+
+		/**
+		 * @brief `true` while a frame is running.
+		 */
+		std::atomic<bool> g_counting{ false };
+
+		/**
+		 * @brief `true` while a frame after the warm-up is running.
+		 */
+		std::atomic<bool> g_armed{ false };
+
+		u32 g_warmup{ config::ALLOCATION_WARMUP_FRAMES };
+		u64 g_frame{ 0 };
+		u64 g_violations{ 0 };
+		u64 g_violating_frames{ 0 };
+
+		/**
+		 * @brief Index of the counter of the calling thread.
+		 */
+		thread_local u32 t_slot{ u32_max };
+
+		/**
+		 * @brief Allocations of the calling thread are not counted while above 0.
+		 */
+		thread_local u32 t_ignore{ 0 };
+
+#if CARBON_USE_ALLOCATION_TRACKING
+		/**
+		 * @brief Fills in the return addresses of the calling thread.
+		 * @returns Number of addresses filled in.
+		 */
+		u32 captureStack(std::array<void*, AllocationTracker::MAX_STACK_DEPTH> &frames) {
+#if CARBON_PLATFORM == CARBON_PLATFORM_WINDOWS
+			return CaptureStackBackTrace(0, AllocationTracker::MAX_STACK_DEPTH, frames.data(), nullptr);
+#elif defined(CARBON_HAS_BACKTRACE)
+			return static_cast<u32>(backtrace(frames.data(), static_cast<int>(AllocationTracker::MAX_STACK_DEPTH)));
+#else
+			return 0;
+#endif
+		}
+#endif // CARBON_USE_ALLOCATION_TRACKING
+
+		/**
+		 * @returns The return addresses of a stack, with function names where they can be found.
+		 */
+		std::string symbolizeStack(const Stack &stack) {
+			std::string str;
+
+#if CARBON_USE_ALLOCATION_TRACKING && CARBON_PLATFORM == CARBON_PLATFORM_WINDOWS
+			static const bool initialized = [] {
+				SymSetOptions(SYMOPT_UNDNAME | SYMOPT_DEFERRED_LOADS);
+				return SymInitialize(GetCurrentProcess(), nullptr, TRUE) == TRUE;
+			}();
+
+			alignas(SYMBOL_INFO) char buffer[sizeof(SYMBOL_INFO) + 256];
+			SYMBOL_INFO *symbol = reinterpret_cast<SYMBOL_INFO*>(buffer);
+
+			for (u32 i = 0; i < stack.depth; i++) {
+				const DWORD64 address = reinterpret_cast<DWORD64>(stack.frames[i]);
+				DWORD64 offset{ 0 };
+
+				symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
+				symbol->MaxNameLen = 255;
+
+				if (initialized && SymFromAddr(GetCurrentProcess(), address, &offset, symbol)) {
+					str.append(fmt::format("\n    {} + 0x{:x}", symbol->Name, offset));
+				} else {
+					str.append(fmt::format("\n    0x{:x}", address));
+				}
+			}
+#elif defined(CARBON_HAS_BACKTRACE)
+			char **symbols = backtrace_symbols(stack.frames.data(), static_cast<int>(stack.depth));
+
+			for (u32 i = 0; i < stack.depth; i++) {
+				if (symbols != nullptr) {
+					str.append(fmt::format("\n    {}", symbols[i]));
+				} else {
+					str.append(fmt::format("\n    {}", stack.frames[i]));
+				}
+			}
+
+			std::free(symbols);
+#else
+			for (u32 i = 0; i < stack.depth; i++) {
+				str.append(fmt::format("\n    {}", stack.frames[i]));
+			}
+#endif
+
+			return str;
+		}
+
+	} // namespace
+
+
+#if CARBON_USE_ALLOCATION_TRACKING
+	/**
+	 * @brief Counts a heap allocation against the calling thread. Must not
+	 * allocate, since it is called from inside the allocator.
+	 * @param size Size (in bytes) of the allocation.
+	 */
+	static void onAllocate(size_t size) {
+		if (t_ignore > 0 || !g_counting.load(std::memory_order_relaxed)) {
+			return;
+		}
+
+		// threads past the limit share the last counter
+		if (t_slot == u32_max) {
+			t_slot = std::min(g_thread_count.fetch_add(1, std::memory_order_relaxed), AllocationTracker::MAX_THREADS - 1);
+		}
+
+		ThreadCounter &counter = g_threads[t_slot];
+		counter.count.fetch_add(1, std::memory_order_relaxed);
+		counter.bytes.fetch_add(size, std::memory_order_relaxed);
+
+		if (!g_armed.load(std::memory_order_relaxed)) {
+			return;
+		}
+
+		const u32 index = g_stack_count.fetch_add(1, std::memory_order_relaxed);
+
+		if (index >= AllocationTracker::MAX_STACKS) {
+			return;
+		}
+
+		Stack &stack = g_stacks[index];
+
+		// unwinding may allocate the first time it is used
+		t_ignore++;
+		stack.depth = captureStack(stack.frames);
+		t_ignore--;
+
+		stack.thread = t_slot;
+		stack.size = size;
+		stack.ready.store(true, std::memory_order_release);
+	}
+#endif // CARBON_USE_ALLOCATION_TRACKING
+
+
+#ifdef CARBON_HOOK_CRT
+	/**
+	 * @brief Sees every allocation of the debug CRT, including `malloc`.
+	 */
+	static int crtAllocHook(int allocType, void*, size_t size, int blockType, long, const unsigned char*, int) {
+		// the CRT's own bookkeeping is not the program's doing
+		if (allocType != _HOOK_FREE && blockType != _CRT_BLOCK) {
+			onAllocate(size);
+		}
+
+		return TRUE;
+	}
+#endif
+
+
+	void AllocationTracker::beginFrame() {
+#ifdef CARBON_HOOK_CRT
+		static const bool installed = [] {
+			_CrtSetAllocHook(crtAllocHook);
+			return true;
+		}();
+		(void)installed;
+#endif
+
+		g_armed.store(g_frame >= g_warmup, std::memory_order_relaxed);
+		g_counting.store(isEnabled(), std::memory_order_relaxed);
+	}
+
+
+	u64 AllocationTracker::endFrame() {
+		g_counting.store(false, std::memory_order_relaxed);
+		g_armed.store(false, std::memory_order_relaxed);
+		g_frame++;
+
+		u64 total{ 0 };
+		u64 bytes{ 0 };
+		u32 threads{ 0 };
+
+		const u32 threadCount = std::min(g_thread_count.load(std::memory_order_relaxed), MAX_THREADS);
+
+		for (u32 i = 0; i < threadCount; i++) {
+			const u64 count = g_threads[i].count.exchange(0, std::memory_order_relaxed);
+			bytes += g_threads[i].bytes.exchange(0, std::memory_order_relaxed);
+
+			if (count > 0) {
+				total += count;
+				threads++;
+			}
+		}
+
+		const u32 stackCount = std::min(g_stack_count.exchange(0, std::memory_order_relaxed), MAX_STACKS);
+
+		if (g_frame <= g_warmup || total == 0) {
+			return 0;
+		}
+
+		g_violations += total;
+		g_violating_frames++;
+
+		// reporting is allowed to allocate
+		t_ignore++;
+
+		CARBON_LOG_WARN(carbon::log::To::File, fmt::format("Frame {} made {} heap allocations ({} bytes) on {} threads.", g_frame, total, bytes, threads));
+
+		for (u32 i = 0; i < stackCount; i++) {
+			Stack &stack = g_stacks[i];
+
+			// a thread may still be unwinding
+			if (!stack.ready.exchange(false, std::memory_order_acquire)) {
+				continue;
+			}
+
+			CARBON_LOG_WARN(carbon::log::To::File, fmt::format("Allocation of {} bytes on thread {}:{}", stack.size, stack.thread, symbolizeStack(stack)));
+		}
+
+		t_ignore--;
+
+		return total;
+	}
+
+
+	void AllocationTracker::setWarmupFrames(u32 frames) {
+		g_warmup = frames;
+	}
+
+
+	u64 AllocationTracker::getViolationCount() {
+		return g_violations;
+	}
+
+
+	u64 AllocationTracker::getViolatingFrameCount() {
+		return g_violating_frames;
+	}
+
+} // namespace carbon
+
+#if CARBON_USE_ALLOCATION_TRACKING && !defined(CARBON_HOOK_CRT)
+
+/**
+ * -----------------------------------
+ * -- Replacement global allocators --
+ * -----------------------------------
+ */
+
+static void* allocateTracked(size_t size) {
+	carbon::onAllocate(size);
+	return std::malloc(size > 0 ? size : 1);
+}
+
+
+static void* allocateTracked(size_t size, std::align_val_t align) {
+	carbon::onAllocate(size);
+	const size_t alignment = std::max(static_cast<size_t>(align), sizeof(void*));
+
+#if CARBON_PLATFORM == CARBON_PLATFORM_WINDOWS
+	return _aligned_malloc(size > 0 ? size : 1, alignment);
+#else
+	void *memory{ nullptr };
+	return posix_memalign(&memory, alignment, size > 0 ? size : 1) == 0 ? memory : nullptr;
+#endif
+}
+
+
+static void freeTracked(void *memory, std::align_val_t) {
+#if CARBON_PLATFORM == CARBON_PLATFORM_WINDOWS
+	_aligned_free(memory);
+#else
+	std::free(memory);
+#endif
+}
+
+
+void* operator new(size_t size) {
+	void *memory = allocateTracked(size);
+
+	if (memory == nullptr) {
+		throw std::bad_alloc();
+	}
+
+	return memory;
+}
+
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+	return allocateTracked(size);
+}
+
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+	return allocateTracked(size);
+}
+
+
+void* operator new(size_t size, std::align_val_t align) {
+	void *memory = allocateTracked(size, align);
+
+	if (memory == nullptr) {
+		throw std::bad_alloc();
+	}
+
+	return memory;
+}
+
+
+void* operator new[](size_t size, std::align_val_t align) {
+	return operator new(size, align);
+}
+
+
+void* operator new(size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+	return allocateTracked(size, align);
+}
+
+
+void* operator new[](size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+	return allocateTracked(size, align);
+}
+
+
+void operator delete(void *memory) noexcept {
+	std::free(memory);
+}
+
+
+void operator delete[](void *memory) noexcept {
+	std::free(memory);
+}
+
+
+void operator delete(void *memory, size_t) noexcept {
+	std::free(memory);
+}
+
+
+void operator delete[](void *memory, size_t) noexcept {
+	std::free(memory);
+}
+
+
+void operator delete(void *memory, const std::nothrow_t&) noexcept {
+	std::free(memory);
+}
+
+
+void operator delete[](void *memory, const std::nothrow_t&) noexcept {
+	std::free(memory);
+}
+
+
+void operator delete(void *memory, std::align_val_t align) noexcept {
+	freeTracked(memory, align);
+}
+
+
+void operator delete[](void *memory, std::align_val_t align) noexcept {
+	freeTracked(memory, align);
+}
+
+
+void operator delete(void *memory, size_t, std::align_val_t align) noexcept {
+	freeTracked(memory, align);
+}
+
+
+void operator delete[](void *memory, size_t, std::align_val_t align) noexcept {
+	freeTracked(memory, align);
+}
+
+
+void operator delete(void *memory, std::align_val_t align, const std::nothrow_t&) noexcept {
+	freeTracked(memory, align);
+}
+
+
+void operator delete[](void *memory, std::align_val_t align, const std::nothrow_t&) noexcept {
+	freeTracked(memory, align);
+}
+
+#endif // CARBON_USE_ALLOCATION_TRACKING && !CARBON_HOOK_CRT
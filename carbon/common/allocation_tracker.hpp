@@ -0,0 +1,87 @@
+// file      : carbon/common/allocation_tracker.hpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#pragma once
+
+#ifndef COMMON_ALLOCATION_TRACKER_HPP
+#define COMMON_ALLOCATION_TRACKER_HPP
+
+#include "carbon/macros.hpp"
+#include "carbon/types.hpp"
+
+namespace carbon {
+
+	/**
+	 * @brief Checks that running frames do not touch the global heap. Built
+	 * only when `CARBON_TRACK_ALLOCATIONS` is defined, in which case every
+	 * heap allocation is counted against the thread that made it: through the
+	 * CRT allocation hook (which also sees `malloc`) in debug builds with
+	 * MSVC, and by replacing the global `operator new` elsewhere. Once the
+	 * warm-up frames are over, the call stacks of the first allocations of
+	 * each frame are logged. Otherwise every call does nothing.
+	 */
+	class AllocationTracker {
+
+	public:
+
+		/**
+		 * @brief Most call stacks kept from a single frame.
+		 */
+		static constexpr u32 MAX_STACKS = 8;
+
+		/**
+		 * @brief Most return addresses kept of each call stack.
+		 */
+		static constexpr u32 MAX_STACK_DEPTH = 24;
+
+		/**
+		 * @brief Most threads that allocations are counted separately for.
+		 */
+		static constexpr u32 MAX_THREADS = 64;
+
+		AllocationTracker() = delete;
+
+		/**
+		 * @returns `true` if allocations are being tracked, `false` otherwise.
+		 */
+		static constexpr bool isEnabled() {
+			return CARBON_USE_ALLOCATION_TRACKING;
+		}
+
+		/**
+		 * @brief Starts counting the allocations of a frame.
+		 */
+		static void beginFrame();
+
+		/**
+		 * @brief Stops counting the allocations of the frame, logging them
+		 * and where they came from if the warm-up is over.
+		 * @returns The number of allocations made during the frame after the
+		 * warm-up, on any thread.
+		 */
+		static u64 endFrame();
+
+		/**
+		 * @brief Sets how many frames may allocate while caches and pools fill
+		 * up, before allocations are reported.
+		 * @param frames Number of frames.
+		 */
+		static void setWarmupFrames(u32 frames);
+
+		/**
+		 * @returns Allocations made during frames after the warm-up, since
+		 * tracking began. A check passes if this stays 0.
+		 */
+		static u64 getViolationCount();
+
+		/**
+		 * @returns Number of frames that made allocations after the warm-up.
+		 */
+		static u64 getViolatingFrameCount();
+
+	};
+
+} // namespace carbon
+
+#endif // COMMON_ALLOCATION_TRACKER_HPP
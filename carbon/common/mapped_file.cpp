@@ -0,0 +1,101 @@
+// file      : carbon/common/mapped_file.cpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#include "mapped_file.hpp"
+
+#include "carbon/platform.hpp"
+
+#if CARBON_PLATFORM == CARBON_PLATFORM_WINDOWS
+#	ifndef WIN32_LEAN_AND_MEAN
+#		define WIN32_LEAN_AND_MEAN
+#	endif
+#	ifndef NOMINMAX
+#		define NOMINMAX
+#	endif
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+namespace carbon {
+
+	MappedFile::MappedFile(const std::string &path) {
+#if CARBON_PLATFORM == CARBON_PLATFORM_WINDOWS
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) {
+			return;
+		}
+
+		m_file = file;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+			close();
+			return;
+		}
+
+		m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (m_mapping == nullptr) {
+			close();
+			return;
+		}
+
+		m_data = static_cast<const u8*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+		m_size = m_data ? static_cast<size_t>(size.QuadPart) : 0;
+#else
+		const int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			return;
+		}
+
+		// the mapping keeps the file alive on its own
+		struct stat info;
+		if (fstat(fd, &info) == 0 && info.st_size > 0) {
+			void *data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+			if (data != MAP_FAILED) {
+				m_data = static_cast<const u8*>(data);
+				m_size = static_cast<size_t>(info.st_size);
+			}
+		}
+
+		::close(fd);
+#endif
+	}
+
+
+	MappedFile::~MappedFile() {
+		close();
+	}
+
+
+	void MappedFile::close() {
+#if CARBON_PLATFORM == CARBON_PLATFORM_WINDOWS
+		if (m_data) {
+			UnmapViewOfFile(m_data);
+		}
+
+		if (m_mapping) {
+			CloseHandle(m_mapping);
+		}
+
+		if (m_file) {
+			CloseHandle(m_file);
+		}
+#else
+		if (m_data) {
+			munmap(const_cast<u8*>(m_data), m_size);
+		}
+#endif
+
+		m_data = nullptr;
+		m_size = 0;
+		m_file = nullptr;
+		m_mapping = nullptr;
+	}
+
+} // namespace carbon
@@ -0,0 +1,91 @@
+// file      : carbon/common/mapped_file.hpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#pragma once
+
+#ifndef COMMON_MAPPED_FILE_HPP
+#define COMMON_MAPPED_FILE_HPP
+
+#include "carbon/types.hpp"
+
+#include <string>
+
+namespace carbon {
+
+	/**
+	 * @brief A file mapped read-only into memory, so its contents can be
+	 * used in place without being read into a buffer first.
+	 */
+	class MappedFile {
+
+	private:
+
+		/**
+		 * @brief Start of the mapped contents, or `nullptr` if nothing is mapped.
+		 */
+		const u8 *m_data{ nullptr };
+
+		/**
+		 * @brief Size (in bytes) of the mapped contents.
+		 */
+		size_t m_size{ 0 };
+
+		/**
+		 * @brief Handle on the open file. Only kept on Windows.
+		 */
+		void *m_file{ nullptr };
+
+		/**
+		 * @brief Handle on the file mapping. Only kept on Windows.
+		 */
+		void *m_mapping{ nullptr };
+
+	public:
+
+		/**
+		 * @brief Maps the whole file into memory. Check `isOpen()` to see if it succeeded.
+		 * @param path The file to map.
+		 */
+		explicit MappedFile(const std::string &path);
+
+		MappedFile(const MappedFile&) = delete;
+
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		/**
+		 * @brief Destructor for the mapped file.
+		 */
+		~MappedFile();
+
+		/**
+		 * @brief Unmaps and closes the file. Pointers into it are no longer valid.
+		 */
+		void close();
+
+		/**
+		 * @returns `true` if the file is mapped, `false` otherwise.
+		 */
+		const bool isOpen() const {
+			return m_data != nullptr;
+		}
+
+		/**
+		 * @returns The start of the file contents.
+		 */
+		const u8* getData() const {
+			return m_data;
+		}
+
+		/**
+		 * @returns The size (in bytes) of the file.
+		 */
+		const size_t getSize() const {
+			return m_size;
+		}
+
+	};
+
+} // namespace carbon
+
+#endif // COMMON_MAPPED_FILE_HPP
@@ -0,0 +1,282 @@
+// file      : carbon/common/tlsf.cpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#include "tlsf.hpp"
+
+#include "carbon/platform.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#if CARBON_COMPILER & CARBON_COMPILER_VC
+#	include <intrin.h>
+#endif
+
+namespace carbon {
+
+	/**
+	 * @param x A non-zero value.
+	 * @returns The index of the lowest set bit.
+	 */
+	static u32 findLowestSet(u64 x) {
+#if CARBON_COMPILER & CARBON_COMPILER_VC
+		unsigned long idx;
+		_BitScanForward64(&idx, x);
+		return static_cast<u32>(idx);
+#else
+		return static_cast<u32>(__builtin_ctzll(x));
+#endif
+	}
+
+
+	/**
+	 * @param x A non-zero value.
+	 * @returns The index of the highest set bit.
+	 */
+	static u32 findHighestSet(u64 x) {
+#if CARBON_COMPILER & CARBON_COMPILER_VC
+		unsigned long idx;
+		_BitScanReverse64(&idx, x);
+		return static_cast<u32>(idx);
+#else
+		return static_cast<u32>(63 - __builtin_clzll(x));
+#endif
+	}
+
+
+	void Tlsf::mapping(u64 size, u32 &fl, u32 &sl) {
+		// small sizes get one list each
+		if (size < SL_COUNT) {
+			fl = 0;
+			sl = static_cast<u32>(size);
+			return;
+		}
+
+		const u32 log2 = findHighestSet(size);
+		fl = log2 - SL_LOG2 + 1;
+		sl = static_cast<u32>(size >> (log2 - SL_LOG2)) - SL_COUNT;
+	}
+
+
+	u32 Tlsf::newRange() {
+		if (!m_unused.empty()) {
+			const u32 idx = m_unused.back();
+			m_unused.pop_back();
+			return idx;
+		}
+
+		m_ranges.emplace_back();
+		return static_cast<u32>(m_ranges.size() - 1);
+	}
+
+
+	void Tlsf::insertFree(u32 idx) {
+		u32 fl, sl;
+		mapping(m_ranges[idx].size, fl, sl);
+
+		const u32 head = m_heads[fl][sl];
+
+		m_ranges[idx].free = true;
+		m_ranges[idx].prevFree = NONE;
+		m_ranges[idx].nextFree = head;
+
+		if (head != NONE) {
+			m_ranges[head].prevFree = idx;
+		}
+
+		m_heads[fl][sl] = idx;
+		m_sl_bitmaps[fl] |= 1U << sl;
+		m_fl_bitmap |= 1ULL << fl;
+		m_free_count++;
+	}
+
+
+	void Tlsf::removeFree(u32 idx) {
+		u32 fl, sl;
+		mapping(m_ranges[idx].size, fl, sl);
+
+		Range &range = m_ranges[idx];
+
+		if (range.prevFree != NONE) {
+			m_ranges[range.prevFree].nextFree = range.nextFree;
+		} else {
+			m_heads[fl][sl] = range.nextFree;
+		}
+
+		if (range.nextFree != NONE) {
+			m_ranges[range.nextFree].prevFree = range.prevFree;
+		}
+
+		// keep the bitmaps in step with the lists
+		if (m_heads[fl][sl] == NONE) {
+			m_sl_bitmaps[fl] &= ~(1U << sl);
+
+			if (m_sl_bitmaps[fl] == 0) {
+				m_fl_bitmap &= ~(1ULL << fl);
+			}
+		}
+
+		range.free = false;
+		range.prevFree = NONE;
+		range.nextFree = NONE;
+		m_free_count--;
+	}
+
+
+	u32 Tlsf::split(u32 idx, u64 size) {
+		// may grow the vector, so no references are held across it
+		const u32 rest = newRange();
+
+		Range &range = m_ranges[idx];
+		Range &tail = m_ranges[rest];
+
+		tail = {};
+		tail.offset = range.offset + size;
+		tail.size = range.size - size;
+		tail.prevPhys = idx;
+		tail.nextPhys = range.nextPhys;
+
+		if (range.nextPhys != NONE) {
+			m_ranges[range.nextPhys].prevPhys = rest;
+		}
+
+		range.size = size;
+		range.nextPhys = rest;
+
+		return rest;
+	}
+
+
+	void Tlsf::absorbNext(u32 idx) {
+		Range &range = m_ranges[idx];
+		const u32 next = range.nextPhys;
+
+		range.size += m_ranges[next].size;
+		range.nextPhys = m_ranges[next].nextPhys;
+
+		if (range.nextPhys != NONE) {
+			m_ranges[range.nextPhys].prevPhys = idx;
+		}
+
+		m_ranges[next] = {};
+		m_unused.push_back(next);
+	}
+
+
+	Tlsf::Tlsf(u64 size)
+		: m_size(size)
+	{
+		assert(size > 0 && "Range to allocate from must not be empty.");
+
+		for (auto &heads : m_heads) {
+			heads.fill(NONE);
+		}
+
+		const u32 idx = newRange();
+		m_ranges[idx].size = size;
+		insertFree(idx);
+	}
+
+
+	u32 Tlsf::allocate(u64 size, u64 alignment, u64 &offset) {
+		assert(size > 0 && "Allocation must not be empty.");
+		assert(alignment > 0 && (alignment & (alignment - 1)) == 0 && "Alignment must be a power of two.");
+
+		// any free range this large fits the allocation, wherever it starts
+		u64 search = size + alignment - 1;
+
+		// round up to the next list, so every range in the list found is large enough
+		if (search >= SL_COUNT) {
+			search += (1ULL << (findHighestSet(search) - SL_LOG2)) - 1;
+		}
+
+		if (search < size || search > m_size) {
+			return NONE;
+		}
+
+		u32 fl, sl;
+		mapping(search, fl, sl);
+
+		u32 slMap = m_sl_bitmaps[fl] & (~0U << sl);
+
+		// nothing left in this power of two, so take the smallest larger one
+		if (slMap == 0) {
+			const u64 flMap = fl + 1 < 64 ? m_fl_bitmap & (~0ULL << (fl + 1)) : 0;
+
+			if (flMap == 0) {
+				return NONE;
+			}
+
+			fl = findLowestSet(flMap);
+			slMap = m_sl_bitmaps[fl];
+		}
+
+		sl = findLowestSet(slMap);
+
+		u32 idx = m_heads[fl][sl];
+		removeFree(idx);
+
+		// the padding before the aligned offset goes back on a list
+		const u64 start = m_ranges[idx].offset;
+		const u64 pad = ((start + alignment - 1) & ~(alignment - 1)) - start;
+
+		if (pad > 0) {
+			const u32 rest = split(idx, pad);
+			insertFree(idx);
+			idx = rest;
+		}
+
+		if (m_ranges[idx].size > size) {
+			insertFree(split(idx, size));
+		}
+
+		m_used += size;
+		offset = m_ranges[idx].offset;
+
+		return idx;
+	}
+
+
+	void Tlsf::free(u32 handle) {
+		assert(handle < m_ranges.size() && !m_ranges[handle].free && m_ranges[handle].size > 0 && "Range is not allocated.");
+
+		u32 idx = handle;
+		m_used -= m_ranges[idx].size;
+
+		const u32 next = m_ranges[idx].nextPhys;
+		if (next != NONE && m_ranges[next].free) {
+			removeFree(next);
+			absorbNext(idx);
+		}
+
+		const u32 prev = m_ranges[idx].prevPhys;
+		if (prev != NONE && m_ranges[prev].free) {
+			removeFree(prev);
+			absorbNext(prev);
+			idx = prev;
+		}
+
+		insertFree(idx);
+	}
+
+
+	const u64 Tlsf::getLargestFree() const {
+		if (m_fl_bitmap == 0) {
+			return 0;
+		}
+
+		// the largest range is in the highest non-empty list, which is not sorted
+		const u32 fl = findHighestSet(m_fl_bitmap);
+		const u32 sl = findHighestSet(m_sl_bitmaps[fl]);
+
+		u64 largest{ 0 };
+
+		for (u32 idx = m_heads[fl][sl]; idx != NONE; idx = m_ranges[idx].nextFree) {
+			largest = std::max(largest, m_ranges[idx].size);
+		}
+
+		return largest;
+	}
+
+} // namespace carbon
@@ -0,0 +1,196 @@
+// file      : carbon/common/tlsf.hpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#pragma once
+
+#ifndef COMMON_TLSF_HPP
+#define COMMON_TLSF_HPP
+
+#include "carbon/types.hpp"
+
+#include <array>
+#include <vector>
+
+namespace carbon {
+
+	/**
+	 * @brief Two-level segregated fit allocator over a range of offsets. It
+	 * does not own any memory, it only decides where in the range each
+	 * allocation goes, so it can manage GPU memory that the CPU cannot
+	 * touch. Free ranges are kept in lists by size class, with bitmaps
+	 * saying which lists are non-empty, so allocating and freeing take a
+	 * constant number of steps regardless of how many ranges exist.
+	 * Neighbouring free ranges are merged straight away.
+	 */
+	class Tlsf {
+
+	public:
+
+		/**
+		 * @brief Returned instead of a range when nothing fits.
+		 */
+		static constexpr u32 NONE = u32_max;
+
+	private:
+
+		/**
+		 * @brief Each power of two is split into `2^SL_LOG2` lists.
+		 */
+		static constexpr u32 SL_LOG2 = 5;
+
+		/**
+		 * @brief Number of lists per power of two.
+		 */
+		static constexpr u32 SL_COUNT = 1U << SL_LOG2;
+
+		/**
+		 * @brief Number of powers of two, enough for any 64-bit size.
+		 */
+		static constexpr u32 FL_COUNT = 64 - SL_LOG2 + 1;
+
+		/**
+		 * @brief A range of offsets, either free or handed out.
+		 */
+		struct Range {
+			u64 offset{ 0 };
+			u64 size{ 0 };
+			u32 prevPhys{ NONE };
+			u32 nextPhys{ NONE };
+			u32 prevFree{ NONE };
+			u32 nextFree{ NONE };
+			bool free{ false };
+		};
+
+		/**
+		 * @brief Every range, indexed by the handles given out.
+		 */
+		std::vector<Range> m_ranges;
+
+		/**
+		 * @brief Slots in `m_ranges` that can be reused.
+		 */
+		std::vector<u32> m_unused;
+
+		/**
+		 * @brief Bit `f` is set if any list of first level `f` is non-empty.
+		 */
+		u64 m_fl_bitmap{ 0 };
+
+		/**
+		 * @brief Bit `s` of entry `f` is set if list `(f, s)` is non-empty.
+		 */
+		std::array<u32, FL_COUNT> m_sl_bitmaps{};
+
+		/**
+		 * @brief First free range in each list.
+		 */
+		std::array<std::array<u32, SL_COUNT>, FL_COUNT> m_heads;
+
+		/**
+		 * @brief Size of the whole range.
+		 */
+		u64 m_size;
+
+		/**
+		 * @brief Bytes handed out.
+		 */
+		u64 m_used{ 0 };
+
+		/**
+		 * @brief Number of free ranges.
+		 */
+		u32 m_free_count{ 0 };
+
+		/**
+		 * @brief Finds the list that a free range of the given size belongs in.
+		 */
+		static void mapping(u64 size, u32 &fl, u32 &sl);
+
+		/**
+		 * @returns A slot for a new range.
+		 */
+		u32 newRange();
+
+		/**
+		 * @brief Adds a range to the list for its size.
+		 */
+		void insertFree(u32 idx);
+
+		/**
+		 * @brief Removes a range from the list for its size.
+		 */
+		void removeFree(u32 idx);
+
+		/**
+		 * @brief Splits the end off a range, leaving the range `size` long.
+		 * @returns The new range holding the end.
+		 */
+		u32 split(u32 idx, u64 size);
+
+		/**
+		 * @brief Merges the next physical range into this one.
+		 */
+		void absorbNext(u32 idx);
+
+	public:
+
+		/**
+		 * @brief Starts with the whole range free.
+		 * @param size Size of the range to allocate from.
+		 */
+		explicit Tlsf(u64 size);
+
+		/**
+		 * @brief Finds room for an allocation.
+		 * @param size Size of the allocation.
+		 * @param alignment Alignment of the offset, a power of two.
+		 * @param offset Set to the offset of the allocation.
+		 * @returns A handle to free the allocation with, or `NONE` if nothing fits.
+		 */
+		u32 allocate(u64 size, u64 alignment, u64 &offset);
+
+		/**
+		 * @brief Frees an allocation, merging it with free neighbours.
+		 * @param handle The handle returned by `allocate()`.
+		 */
+		void free(u32 handle);
+
+		/**
+		 * @returns Size of the whole range.
+		 */
+		const u64 getSize() const {
+			return m_size;
+		}
+
+		/**
+		 * @returns Bytes handed out.
+		 */
+		const u64 getUsed() const {
+			return m_used;
+		}
+
+		/**
+		 * @returns Number of separate free ranges.
+		 */
+		const u32 getFreeCount() const {
+			return m_free_count;
+		}
+
+		/**
+		 * @returns Size of the largest free range.
+		 */
+		const u64 getLargestFree() const;
+
+		/**
+		 * @returns `true` if nothing is handed out, `false` otherwise.
+		 */
+		const bool isEmpty() const {
+			return m_used == 0;
+		}
+
+	};
+
+} // namespace carbon
+
+#endif // COMMON_TLSF_HPP
@@ -80,6 +80,32 @@ namespace carbon {
 			return std::to_string(x) + ":" + std::to_string(y);
 		}
 
+
+		u64 hashBytes(const void *data, size_t size) {
+			const u8 *bytes = static_cast<const u8*>(data);
+			u64 hash{ 14695981039346656037ULL };
+
+			for (size_t i = 0; i < size; i++) {
+				hash ^= bytes[i];
+				hash *= 1099511628211ULL;
+			}
+
+			return hash;
+		}
+
+
+		size_t WordHash::operator()(const std::vector<u64> &words) const {
+			// 64-bit FNV-1a over each word
+			u64 hash{ 14695981039346656037ULL };
+
+			for (const u64 word : words) {
+				hash ^= word;
+				hash *= 1099511628211ULL;
+			}
+
+			return static_cast<size_t>(hash);
+		}
+
 	} // namespace utils
 
 } // namespace carbon
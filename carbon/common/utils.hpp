@@ -75,6 +75,33 @@ namespace carbon {
 		 */
 		std::string getEstimatedAspectRatio(i32 width, i32 height);
 
+		/**
+		 * @brief Hashes raw bytes using 64-bit FNV-1a.
+		 * @param data The bytes to hash.
+		 * @param size The number of bytes.
+		 * @returns The hash of the bytes.
+		 */
+		u64 hashBytes(const void *data, size_t size);
+
+		/**
+		 * @brief Hashes a description that has been flattened into 64-bit words,
+		 * so it can be used as the key of an `std::unordered_map`.
+		 */
+		struct WordHash {
+			size_t operator()(const std::vector<u64> &words) const;
+		};
+
+		/**
+		 * @brief Converts a Vulkan handle so it can be stored in a flattened description.
+		 * @param handle The handle to convert.
+		 * @returns The handle as an integer (non-dispatchable handles are
+		 * pointers on 64-bit platforms and integers otherwise).
+		 */
+		template<class T>
+		u64 handleToWord(T handle) {
+			return (u64)(handle);
+		}
+
 		/**
 		 * @brief Converts the given vector into a string representation of
 		 * the vector.
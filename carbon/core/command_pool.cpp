@@ -0,0 +1,92 @@
+// file      : carbon/core/command_pool.cpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#include "command_pool.hpp"
+
+#include "host_allocator.hpp"
+#include "logical_device.hpp"
+#include "carbon/common/logger.hpp"
+
+#include <cassert>
+
+namespace carbon {
+
+	VkCommandBuffer CommandPool::allocateBuffer(VkCommandBufferLevel level) {
+		VkCommandBufferAllocateInfo allocInfo;
+		initStruct(allocInfo, VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO);
+
+		allocInfo.commandPool = m_pool;
+		allocInfo.level = level;
+		allocInfo.commandBufferCount = 1;
+
+		VkCommandBuffer buffer{ VK_NULL_HANDLE };
+
+		if (vkAllocateCommandBuffers(m_logical_device->getHandle(), &allocInfo, &buffer) != VK_SUCCESS) {
+			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to allocate command buffer.");
+		}
+
+		return buffer;
+	}
+
+
+	CommandPool::CommandPool(LogicalDevice *logiDevice, u32 queueFamily, VkCommandPoolCreateFlags flags)
+		: m_logical_device(logiDevice)
+	{
+		assert(m_logical_device && "Logical device must not be null.");
+
+		VkCommandPoolCreateInfo poolInfo;
+		initStruct(poolInfo, VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO);
+
+		poolInfo.flags = flags;
+		poolInfo.queueFamilyIndex = queueFamily;
+
+		if (vkCreateCommandPool(m_logical_device->getHandle(), &poolInfo, HostAllocator::get(VK_OBJECT_TYPE_COMMAND_POOL), &m_pool) != VK_SUCCESS) {
+			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to create command pool.");
+		}
+	}
+
+
+	CommandPool::~CommandPool() {
+		destroy();
+	}
+
+
+	void CommandPool::destroy() {
+		// destroying the pool frees all command buffers allocated from it
+		if (m_pool != VK_NULL_HANDLE) {
+			vkDestroyCommandPool(m_logical_device->getHandle(), m_pool, HostAllocator::get(VK_OBJECT_TYPE_COMMAND_POOL));
+			m_pool = VK_NULL_HANDLE;
+		}
+
+		m_primary_buffers.clear();
+		m_secondary_buffers.clear();
+		m_primary_used = 0;
+		m_secondary_used = 0;
+	}
+
+
+	void CommandPool::reset() {
+		// much cheaper than resetting or freeing each command buffer
+		vkResetCommandPool(m_logical_device->getHandle(), m_pool, 0);
+
+		m_primary_used = 0;
+		m_secondary_used = 0;
+	}
+
+
+	VkCommandBuffer CommandPool::requestBuffer(VkCommandBufferLevel level) {
+		bool primary = level == VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+
+		std::vector<VkCommandBuffer> &buffers = primary ? m_primary_buffers : m_secondary_buffers;
+		u32 &used = primary ? m_primary_used : m_secondary_used;
+
+		// only allocate once every recycled buffer has been handed out
+		if (used == buffers.size()) {
+			buffers.push_back(allocateBuffer(level));
+		}
+
+		return buffers[used++];
+	}
+
+} // namespace carbon
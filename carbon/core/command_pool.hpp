@@ -0,0 +1,120 @@
+// file      : carbon/core/command_pool.hpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#pragma once
+
+#ifndef CORE_COMMAND_POOL_HPP
+#define CORE_COMMAND_POOL_HPP
+
+#include "carbon/backend.hpp"
+
+#include <vector>
+
+namespace carbon {
+
+	// forward-declare classes that would result in circular dependency
+	class LogicalDevice;
+
+	/**
+	 * @brief A wrapper for a Vulkan command pool that hands out command buffers
+	 * and recycles all of them at once when the pool is reset. A command pool
+	 * must only ever be used by one thread at a time.
+	 */
+	class CommandPool {
+
+	private:
+
+		/**
+		 * @brief The logical device that the pool is created on.
+		 */
+		const class LogicalDevice *m_logical_device;
+
+		/**
+		 * @brief Handle on the underlying command pool.
+		 */
+		VkCommandPool m_pool{ VK_NULL_HANDLE };
+
+		/**
+		 * @brief Primary command buffers allocated from the pool.
+		 */
+		std::vector<VkCommandBuffer> m_primary_buffers;
+
+		/**
+		 * @brief Secondary command buffers allocated from the pool.
+		 */
+		std::vector<VkCommandBuffer> m_secondary_buffers;
+
+		/**
+		 * @brief Number of primary command buffers handed out since the last reset.
+		 */
+		u32 m_primary_used{ 0 };
+
+		/**
+		 * @brief Number of secondary command buffers handed out since the last reset.
+		 */
+		u32 m_secondary_used{ 0 };
+
+		/**
+		 * @brief Allocates a new command buffer from the pool.
+		 * @param level Whether the command buffer is primary or secondary.
+		 * @returns The new command buffer.
+		 */
+		VkCommandBuffer allocateBuffer(VkCommandBufferLevel level);
+
+	public:
+
+		/**
+		 * @brief Creates a command pool.
+		 * @param logiDevice The logical device to use.
+		 * @param queueFamily The queue family that the command buffers will be submitted to.
+		 * @param flags [Optional] Flags to create the pool with. Buffers are short-lived
+		 * and recycled through `reset()` by default.
+		 */
+		explicit CommandPool(
+			class LogicalDevice *logiDevice,
+			u32 queueFamily,
+			VkCommandPoolCreateFlags flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT
+		);
+
+		CommandPool(const CommandPool&) = delete;
+
+		CommandPool& operator=(const CommandPool&) = delete;
+
+		/**
+		 * @brief Destructor for the command pool.
+		 */
+		~CommandPool();
+
+		/**
+		 * @brief Destroys the command pool, freeing all of its command buffers.
+		 */
+		void destroy();
+
+		/**
+		 * @brief Resets every command buffer from the pool back to the initial
+		 * state in a single call, so they can be handed out again. None of the
+		 * command buffers may still be in use by the GPU.
+		 */
+		void reset();
+
+		/**
+		 * @brief Hands out a command buffer that is ready to be recorded,
+		 * allocating a new one only if all existing ones are in use.
+		 * @param level [Optional] Whether the command buffer is primary or secondary.
+		 * @returns A command buffer in the initial state.
+		 */
+		VkCommandBuffer requestBuffer(VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+
+		/**
+		 * @returns The handle of the underlying command pool.
+		 */
+		const VkCommandPool& getHandle() const {
+			return m_pool;
+		}
+
+	};
+
+} // namespace carbon
+
+#endif // CORE_COMMAND_POOL_HPP
@@ -0,0 +1,151 @@
+// file      : carbon/core/command_recorder.cpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#include "command_recorder.hpp"
+
+#include "command_pool.hpp"
+#include "job_system.hpp"
+#include "logical_device.hpp"
+#include "carbon/common/logger.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace carbon {
+
+	void CommandRecorder::beginSecondary(VkCommandBuffer commandBuffer, const VkCommandBufferInheritanceInfo &inheritance) {
+		VkCommandBufferBeginInfo beginInfo;
+		initStruct(beginInfo, VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO);
+
+		// recorded entirely inside the render pass begun by the primary command buffer
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+		beginInfo.pInheritanceInfo = &inheritance;
+
+		if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to begin recording secondary command buffer.");
+		}
+	}
+
+
+	void CommandRecorder::recordRange(u32 first, u32 last) {
+		const u32 rangeIdx = first / m_range_size;
+
+		// any worker may run this range, so take the command buffer from its own pool
+		const u32 workerIdx = JobSystem::getWorkerIndex();
+		assert(workerIdx < m_thread_count && "Commands must be recorded on a worker of the job system.");
+
+		VkCommandBuffer commandBuffer = m_pools[m_frame_idx][workerIdx]->requestBuffer(VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+		beginSecondary(commandBuffer, m_inheritance);
+
+		(*m_record)(commandBuffer, first, last);
+
+		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to record secondary command buffer.");
+		}
+
+		m_secondary_buffers[rangeIdx] = commandBuffer;
+	}
+
+
+	CommandRecorder::CommandRecorder(LogicalDevice *logiDevice, JobSystem *jobSystem)
+		: m_logical_device(logiDevice)
+		, m_job_system(jobSystem)
+	{
+		assert(m_logical_device && m_job_system && "Logical device and job system must not be null.");
+		m_thread_count = m_job_system->getWorkerCount();
+
+		for (auto &framePools : m_pools) {
+			framePools.reserve(m_thread_count);
+
+			for (u32 i = 0; i < m_thread_count; i++) {
+				framePools.push_back(new CommandPool(logiDevice, m_logical_device->getGraphicsFamily()));
+			}
+		}
+
+		m_secondary_buffers.reserve(m_thread_count);
+
+		m_record_range = [this](u32 first, u32 last) {
+			recordRange(first, last);
+		};
+	}
+
+
+	CommandRecorder::~CommandRecorder() {
+		destroy();
+	}
+
+
+	void CommandRecorder::destroy() {
+		for (auto &framePools : m_pools) {
+			for (auto *pool : framePools) {
+				delete pool;
+			}
+
+			framePools.clear();
+		}
+
+		m_secondary_buffers.clear();
+	}
+
+
+	void CommandRecorder::beginFrame(u32 frameIdx) {
+		assert(frameIdx < m_pools.size() && "Frame index out of range.");
+		m_frame_idx = frameIdx;
+
+		// one reset per thread recycles every command buffer of the frame
+		for (auto *pool : m_pools[m_frame_idx]) {
+			pool->reset();
+		}
+	}
+
+
+	VkCommandBuffer CommandRecorder::requestPrimary() {
+		return m_pools[m_frame_idx][0]->requestBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+	}
+
+
+	const std::vector<VkCommandBuffer>& CommandRecorder::recordParallel(
+		VkRenderPass renderPass,
+		VkFramebuffer framebuffer,
+		u32 count,
+		const RecordFn &record
+	) {
+		m_secondary_buffers.clear();
+
+		if (count == 0) {
+			return m_secondary_buffers;
+		}
+
+		initStruct(m_inheritance, VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO);
+
+		m_inheritance.renderPass = renderPass;
+		m_inheritance.subpass = 0;
+		m_inheritance.framebuffer = framebuffer;
+		m_record = &record;
+
+		// no point making more ranges than there are items
+		const u32 threadCount = std::min(count, m_thread_count);
+		m_range_size = (count + threadCount - 1) / threadCount;
+
+		// rounding the size up can leave fewer ranges than threads, so size the slots by the ranges made
+		const u32 rangeCount = (count + m_range_size - 1) / m_range_size;
+
+		m_secondary_buffers.assign(rangeCount, VK_NULL_HANDLE);
+
+		JobCounter counter;
+		m_job_system->parallelFor(count, m_range_size, m_record_range, counter);
+
+		// worker 0 records ranges too while it waits
+		m_job_system->wait(counter);
+
+		assert(std::none_of(m_secondary_buffers.begin(), m_secondary_buffers.end(), [](VkCommandBuffer cb) {
+			return cb == VK_NULL_HANDLE;
+		}) && "Every range must record a secondary command buffer.");
+
+		m_record = nullptr;
+
+		return m_secondary_buffers;
+	}
+
+} // namespace carbon
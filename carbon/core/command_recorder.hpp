@@ -0,0 +1,175 @@
+// file      : carbon/core/command_recorder.hpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#pragma once
+
+#ifndef CORE_COMMAND_RECORDER_HPP
+#define CORE_COMMAND_RECORDER_HPP
+
+#include "carbon/backend.hpp"
+#include "carbon/engine/config.hpp"
+
+#include <array>
+#include <functional>
+#include <vector>
+
+namespace carbon {
+
+	// forward-declare classes that would result in circular dependency
+	class LogicalDevice;
+	class CommandPool;
+	class JobSystem;
+
+	/**
+	 * @brief Records the commands of each frame across the workers of the
+	 * job system. Every worker has its own command pool for every frame in
+	 * flight, so no locking is needed while recording and the command
+	 * buffers of a frame are recycled with one pool reset per worker.
+	 */
+	class CommandRecorder {
+
+	public:
+
+		/**
+		 * @brief Function that records the commands for the items in the
+		 * range [first, last) into the given secondary command buffer.
+		 */
+		using RecordFn = std::function<void(VkCommandBuffer, u32, u32)>;
+
+	private:
+
+		/**
+		 * @brief The logical device that the command pools are created on.
+		 */
+		const class LogicalDevice *m_logical_device;
+
+		/**
+		 * @brief The job system whose workers record the commands.
+		 */
+		class JobSystem *m_job_system;
+
+		/**
+		 * @brief Number of threads that record commands, which is the
+		 * number of workers in the job system.
+		 */
+		u32 m_thread_count;
+
+		/**
+		 * @brief Index of the frame in flight currently being recorded.
+		 */
+		u32 m_frame_idx{ 0 };
+
+		/**
+		 * @brief Command pool of every worker for each frame in flight.
+		 * The pool of worker 0 also provides the primary command buffers.
+		 */
+		std::array<std::vector<class CommandPool*>, config::MAX_FRAMES_IN_FLIGHT> m_pools;
+
+		/**
+		 * @brief Secondary command buffers recorded by the last call to
+		 * `recordParallel()`, in submission order.
+		 */
+		std::vector<VkCommandBuffer> m_secondary_buffers;
+
+		/**
+		 * @brief Render pass and framebuffer that the current `recordParallel()` continues.
+		 */
+		VkCommandBufferInheritanceInfo m_inheritance{};
+
+		/**
+		 * @brief The function of the current `recordParallel()`.
+		 */
+		const RecordFn *m_record{ nullptr };
+
+		/**
+		 * @brief Number of items in each range of the current `recordParallel()`.
+		 */
+		u32 m_range_size{ 1 };
+
+		/**
+		 * @brief Runs `recordRange()`, made once so that recording never
+		 * copies a function into the job system.
+		 */
+		std::function<void(u32, u32)> m_record_range;
+
+		/**
+		 * @brief Begins a secondary command buffer that continues the given render pass.
+		 * @param commandBuffer The secondary command buffer to begin.
+		 * @param inheritance Information about the render pass being continued.
+		 */
+		void beginSecondary(VkCommandBuffer commandBuffer, const VkCommandBufferInheritanceInfo &inheritance);
+
+		/**
+		 * @brief Records the items in the range [first, last) into a secondary
+		 * command buffer from the pool of the calling worker.
+		 * @param first The first item of the range.
+		 * @param last One past the last item of the range.
+		 */
+		void recordRange(u32 first, u32 last);
+
+	public:
+
+		/**
+		 * @brief Creates the command pools for every worker and frame in flight.
+		 * @param logiDevice The logical device to use.
+		 * @param jobSystem The job system to record commands on.
+		 */
+		explicit CommandRecorder(class LogicalDevice *logiDevice, class JobSystem *jobSystem);
+
+		CommandRecorder(const CommandRecorder&) = delete;
+
+		CommandRecorder& operator=(const CommandRecorder&) = delete;
+
+		/**
+		 * @brief Destructor for the command recorder.
+		 */
+		~CommandRecorder();
+
+		/**
+		 * @brief Destroys all command pools.
+		 */
+		void destroy();
+
+		/**
+		 * @brief Starts recording the given frame in flight, resetting its
+		 * command pools. The GPU must have finished with the frame.
+		 * @param frameIdx The index of the frame in flight.
+		 */
+		void beginFrame(u32 frameIdx);
+
+		/**
+		 * @returns A primary command buffer for the current frame.
+		 */
+		VkCommandBuffer requestPrimary();
+
+		/**
+		 * @brief Splits `count` items into contiguous ranges, one per worker,
+		 * and records each range into its own secondary command buffer as a job.
+		 * Must be called from worker 0, which helps record while it waits.
+		 * @param renderPass The render pass that the command buffers continue.
+		 * @param framebuffer The framebuffer being rendered to.
+		 * @param count The number of items to record.
+		 * @param record The function that records a range of items.
+		 * @returns The recorded secondary command buffers, in the order that
+		 * they must be executed.
+		 */
+		const std::vector<VkCommandBuffer>& recordParallel(
+			VkRenderPass renderPass,
+			VkFramebuffer framebuffer,
+			u32 count,
+			const RecordFn &record
+		);
+
+		/**
+		 * @returns The number of threads that record commands.
+		 */
+		const u32 getThreadCount() const {
+			return m_thread_count;
+		}
+
+	};
+
+} // namespace carbon
+
+#endif // CORE_COMMAND_RECORDER_HPP
@@ -0,0 +1,109 @@
+// file      : carbon/core/deletion_queue.cpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#include "deletion_queue.hpp"
+
+#include "host_allocator.hpp"
+#include "logical_device.hpp"
+#include "carbon/common/logger.hpp"
+
+#include <cassert>
+
+namespace carbon {
+
+	void DeletionQueue::destroyEntry(const Entry &entry) {
+		VkDevice device = m_logical_device->getHandle();
+
+		switch (entry.type) {
+			case VK_OBJECT_TYPE_UNKNOWN:
+				break;
+			case VK_OBJECT_TYPE_BUFFER:
+				vkDestroyBuffer(device, (VkBuffer)(entry.handle), HostAllocator::get(VK_OBJECT_TYPE_BUFFER));
+				break;
+			case VK_OBJECT_TYPE_IMAGE:
+				vkDestroyImage(device, (VkImage)(entry.handle), HostAllocator::get(VK_OBJECT_TYPE_IMAGE));
+				break;
+			case VK_OBJECT_TYPE_IMAGE_VIEW:
+				vkDestroyImageView(device, (VkImageView)(entry.handle), HostAllocator::get(VK_OBJECT_TYPE_IMAGE_VIEW));
+				break;
+			case VK_OBJECT_TYPE_FRAMEBUFFER:
+				vkDestroyFramebuffer(device, (VkFramebuffer)(entry.handle), HostAllocator::get(VK_OBJECT_TYPE_FRAMEBUFFER));
+				break;
+			case VK_OBJECT_TYPE_SAMPLER:
+				vkDestroySampler(device, (VkSampler)(entry.handle), HostAllocator::get(VK_OBJECT_TYPE_SAMPLER));
+				break;
+			case VK_OBJECT_TYPE_SWAPCHAIN_KHR:
+				vkDestroySwapchainKHR(device, (VkSwapchainKHR)(entry.handle), HostAllocator::get(VK_OBJECT_TYPE_SWAPCHAIN_KHR));
+				break;
+			case VK_OBJECT_TYPE_DEVICE_MEMORY:
+				vkFreeMemory(device, (VkDeviceMemory)(entry.handle), HostAllocator::get(VK_OBJECT_TYPE_DEVICE_MEMORY));
+				break;
+			case VK_OBJECT_TYPE_DESCRIPTOR_SET: {
+				const VkDescriptorSet set{ (VkDescriptorSet)(entry.handle) };
+				vkFreeDescriptorSets(device, (VkDescriptorPool)(entry.pool), 1, &set);
+				break;
+			}
+			default:
+				CARBON_LOG_ERROR(carbon::log::To::File, fmt::format("Cannot defer destroying objects of type {}.", static_cast<int>(entry.type)));
+				break;
+		}
+
+		// the object goes first, since it may not outlive its memory
+		if (entry.allocation.isValid()) {
+			MemoryAllocation allocation{ entry.allocation };
+			m_logical_device->getMemoryAllocator().free(allocation);
+		}
+	}
+
+
+	void DeletionQueue::pushEntry(const Entry &entry) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_frames[m_frame].push_back(entry);
+	}
+
+
+	DeletionQueue::DeletionQueue(LogicalDevice *logiDevice)
+		: m_logical_device(logiDevice)
+	{
+		assert(m_logical_device && "Logical device must not be null.");
+	}
+
+
+	DeletionQueue::~DeletionQueue() {
+		destroy();
+	}
+
+
+	void DeletionQueue::destroy() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		for (auto &entries : m_frames) {
+			for (const auto &entry : entries) {
+				destroyEntry(entry);
+			}
+
+			entries.clear();
+		}
+	}
+
+
+	void DeletionQueue::beginFrame(u32 frameIdx) {
+		assert(frameIdx < config::MAX_FRAMES_IN_FLIGHT && "Frame index out of range.");
+
+		// objects are destroyed outside the lock, so other threads can keep queueing
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			m_destroying.swap(m_frames[frameIdx]);
+			m_frame = frameIdx;
+		}
+
+		for (const auto &entry : m_destroying) {
+			destroyEntry(entry);
+		}
+
+		m_destroying.clear();
+	}
+
+} // namespace carbon
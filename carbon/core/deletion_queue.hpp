@@ -0,0 +1,150 @@
+// file      : carbon/core/deletion_queue.hpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#pragma once
+
+#ifndef CORE_DELETION_QUEUE_HPP
+#define CORE_DELETION_QUEUE_HPP
+
+#include "carbon/backend.hpp"
+#include "carbon/common/utils.hpp"
+#include "carbon/core/memory_allocator.hpp"
+#include "carbon/engine/config.hpp"
+
+#include <array>
+#include <mutex>
+#include <vector>
+
+namespace carbon {
+
+	// forward-declare classes that would result in circular dependency
+	class LogicalDevice;
+
+	/**
+	 * @brief Holds on to GPU objects that are no longer needed until no frame
+	 * in flight can still be using them. Objects handed over while a frame is
+	 * being recorded are destroyed when that frame in flight comes round
+	 * again, after its fence has signalled, so nothing has to wait for the
+	 * device to go idle. Safe to use from any thread.
+	 */
+	class DeletionQueue {
+
+	private:
+
+		/**
+		 * @brief An object to destroy, and the memory to give back with it.
+		 */
+		struct Entry {
+			VkObjectType type{ VK_OBJECT_TYPE_UNKNOWN };
+			u64 handle{ 0 };
+
+			/**
+			 * @brief Pool that a descriptor set is freed back to.
+			 */
+			u64 pool{ 0 };
+
+			MemoryAllocation allocation;
+		};
+
+		/**
+		 * @brief The logical device the objects belong to.
+		 */
+		const class LogicalDevice *m_logical_device;
+
+		/**
+		 * @brief Guards the queued objects.
+		 */
+		std::mutex m_mutex;
+
+		/**
+		 * @brief Objects queued during each frame in flight.
+		 */
+		std::array<std::vector<Entry>, config::MAX_FRAMES_IN_FLIGHT> m_frames;
+
+		/**
+		 * @brief Objects of the frame being destroyed, kept so their capacity is reused.
+		 */
+		std::vector<Entry> m_destroying;
+
+		/**
+		 * @brief The current frame in flight.
+		 */
+		u32 m_frame{ 0 };
+
+		/**
+		 * @brief Destroys an object and gives back its memory.
+		 */
+		void destroyEntry(const Entry &entry);
+
+		/**
+		 * @brief Queues an object for the current frame.
+		 */
+		void pushEntry(const Entry &entry);
+
+	public:
+
+		/**
+		 * @brief Creates an empty queue.
+		 * @param logiDevice The logical device the objects belong to.
+		 */
+		explicit DeletionQueue(class LogicalDevice *logiDevice);
+
+		DeletionQueue(const DeletionQueue&) = delete;
+
+		DeletionQueue& operator=(const DeletionQueue&) = delete;
+
+		/**
+		 * @brief Destructor for the deletion queue.
+		 */
+		~DeletionQueue();
+
+		/**
+		 * @brief Destroys every queued object. The device must be idle.
+		 */
+		void destroy();
+
+		/**
+		 * @brief Moves on to the given frame in flight, destroying the objects
+		 * queued the last time it was current. The GPU must have finished
+		 * with the frame.
+		 * @param frameIdx The index of the frame in flight.
+		 */
+		void beginFrame(u32 frameIdx);
+
+		/**
+		 * @brief Queues an object to be destroyed once no frame in flight can be using it.
+		 * @param type The type of the object, which must be a buffer, image, image view,
+		 * framebuffer, sampler, swapchain or device memory.
+		 * @param handle The object to destroy.
+		 * @param allocation [Optional] Memory to give back to the allocator with the object.
+		 */
+		template<class T>
+		void push(VkObjectType type, T handle, const MemoryAllocation &allocation = {}) {
+			pushEntry({ type, utils::handleToWord(handle), 0, allocation });
+		}
+
+		/**
+		 * @brief Queues memory to be given back to the allocator once no frame
+		 * in flight can be using it.
+		 * @param allocation The memory to give back.
+		 */
+		void push(const MemoryAllocation &allocation) {
+			pushEntry({ VK_OBJECT_TYPE_UNKNOWN, 0, 0, allocation });
+		}
+
+		/**
+		 * @brief Queues a descriptor set to be freed once no frame in flight can be using it.
+		 * @param pool The pool the set was allocated from, which must have been
+		 * created with `VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT`.
+		 * @param set The set to free.
+		 */
+		void pushDescriptorSet(VkDescriptorPool pool, VkDescriptorSet set) {
+			pushEntry({ VK_OBJECT_TYPE_DESCRIPTOR_SET, utils::handleToWord(set), utils::handleToWord(pool), {} });
+		}
+
+	};
+
+} // namespace carbon
+
+#endif // CORE_DELETION_QUEUE_HPP
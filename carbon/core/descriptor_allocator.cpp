@@ -0,0 +1,173 @@
+// file      : carbon/core/descriptor_allocator.cpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#include "descriptor_allocator.hpp"
+
+#include "host_allocator.hpp"
+#include "job_system.hpp"
+#include "logical_device.hpp"
+#include "carbon/common/logger.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+namespace carbon {
+
+	/**
+	 * @brief Share of the bindings in a set expected to be of each type,
+	 * used to size the pools from the limits in the config.
+	 */
+	static constexpr std::array<std::pair<VkDescriptorType, f32>, 9> POOL_RATIOS{ {
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0.2f },
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 0.1f },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0.1f },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 0.05f },
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0.3f },
+		{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 0.1f },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 0.05f },
+		{ VK_DESCRIPTOR_TYPE_SAMPLER, 0.05f },
+		{ VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 0.05f }
+	} };
+
+
+	VkDescriptorPool DescriptorAllocator::createPool() const {
+		VkDescriptorPoolCreateInfo info;
+		initStruct(info, VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO);
+
+		// no free flag, since sets are only ever released by resetting the pool
+		info.maxSets = config::DESCRIPTOR_SETS_PER_POOL;
+		info.poolSizeCount = to_u32(m_pool_sizes.size());
+		info.pPoolSizes = m_pool_sizes.data();
+
+		VkDescriptorPool pool{ VK_NULL_HANDLE };
+
+		if (vkCreateDescriptorPool(m_logical_device->getHandle(), &info, HostAllocator::get(VK_OBJECT_TYPE_DESCRIPTOR_POOL), &pool) != VK_SUCCESS) {
+			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to create descriptor pool.");
+		}
+
+		return pool;
+	}
+
+
+	DescriptorAllocator::DescriptorAllocator(LogicalDevice *logiDevice, JobSystem *jobSystem)
+		: m_logical_device(logiDevice)
+	{
+		assert(m_logical_device && jobSystem && "Logical device and job system must not be null.");
+		m_thread_count = jobSystem->getWorkerCount();
+
+		m_pool_sizes = getPoolSizes(config::DESCRIPTOR_SETS_PER_POOL);
+
+		for (auto &framePools : m_pools) {
+			framePools.resize(m_thread_count);
+
+			for (auto &list : framePools) {
+				list.pools.push_back(createPool());
+			}
+		}
+	}
+
+
+	DescriptorAllocator::~DescriptorAllocator() {
+		destroy();
+	}
+
+
+	void DescriptorAllocator::destroy() {
+		VkDevice device = m_logical_device->getHandle();
+
+		for (auto &framePools : m_pools) {
+			for (auto &list : framePools) {
+				for (auto pool : list.pools) {
+					vkDestroyDescriptorPool(device, pool, HostAllocator::get(VK_OBJECT_TYPE_DESCRIPTOR_POOL));
+				}
+			}
+
+			framePools.clear();
+		}
+	}
+
+
+	const std::vector<VkDescriptorPoolSize> DescriptorAllocator::getPoolSizes(u32 maxSets) {
+		// enough descriptors for every set in the pool to use all of its bindings
+		const f32 descriptorCount = static_cast<f32>(maxSets * config::NUM_BINDINGS);
+		std::vector<VkDescriptorPoolSize> sizes;
+
+		for (const auto &ratio : POOL_RATIOS) {
+			sizes.push_back({ ratio.first, std::max(1U, static_cast<u32>(ratio.second * descriptorCount)) });
+		}
+
+		return sizes;
+	}
+
+
+	void DescriptorAllocator::beginFrame(u32 frameIdx) {
+		assert(frameIdx < m_pools.size() && "Frame index out of range.");
+		m_frame_idx = frameIdx;
+
+		VkDevice device = m_logical_device->getHandle();
+
+		// only pools that were used need resetting, and they are kept for next time
+		for (auto &list : m_pools[m_frame_idx]) {
+			for (size_t i = 0; i <= list.current; i++) {
+				vkResetDescriptorPool(device, list.pools[i], 0);
+			}
+
+			list.current = 0;
+		}
+	}
+
+
+	VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout) {
+		const u32 workerIdx = JobSystem::getWorkerIndex();
+		assert(workerIdx < m_thread_count && "Descriptor sets must be allocated from a worker of the job system.");
+
+		PoolList &list = m_pools[m_frame_idx][workerIdx];
+
+		VkDescriptorSetAllocateInfo info;
+		initStruct(info, VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO);
+
+		info.descriptorSetCount = 1;
+		info.pSetLayouts = &layout;
+
+		VkDescriptorSet set{ VK_NULL_HANDLE };
+
+		// pools after the current one are empty, so at most one move is needed
+		for (u32 attempt = 0; attempt < 2; attempt++) {
+			info.descriptorPool = list.pools[list.current];
+			const VkResult result = vkAllocateDescriptorSets(m_logical_device->getHandle(), &info, &set);
+
+			if (result == VK_SUCCESS) {
+				return set;
+			}
+
+			if (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL) {
+				break;
+			}
+
+			// move on to the next pool, growing the list if this was the last one
+			list.current++;
+			if (list.current == list.pools.size()) {
+				list.pools.push_back(createPool());
+			}
+		}
+
+		CARBON_LOG_FATAL(carbon::log::To::File, "Failed to allocate descriptor set.");
+		return VK_NULL_HANDLE;
+	}
+
+
+	const size_t DescriptorAllocator::getPoolCount() const {
+		size_t count{ 0 };
+
+		for (const auto &framePools : m_pools) {
+			for (const auto &list : framePools) {
+				count += list.pools.size();
+			}
+		}
+
+		return count;
+	}
+
+} // namespace carbon
@@ -0,0 +1,127 @@
+// file      : carbon/core/descriptor_allocator.hpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#pragma once
+
+#ifndef CORE_DESCRIPTOR_ALLOCATOR_HPP
+#define CORE_DESCRIPTOR_ALLOCATOR_HPP
+
+#include "carbon/backend.hpp"
+#include "carbon/engine/config.hpp"
+
+#include <array>
+#include <vector>
+
+namespace carbon {
+
+	// forward-declare classes that would result in circular dependency
+	class LogicalDevice;
+	class JobSystem;
+
+	/**
+	 * @brief Allocates descriptor sets that only live for one frame. Every
+	 * worker of the job system has its own list of descriptor pools for
+	 * every frame in flight, so allocating needs no locking, and a new pool
+	 * is added to the list whenever the current one runs out. Sets are never
+	 * freed one at a time; all pools of a frame are reset when it begins again.
+	 */
+	class DescriptorAllocator {
+
+	private:
+
+		/**
+		 * @brief The descriptor pools of one worker for one frame, kept on
+		 * its own cache line so workers do not slow each other down.
+		 */
+		struct alignas(64) PoolList {
+			std::vector<VkDescriptorPool> pools;
+			size_t current{ 0 };
+		};
+
+		/**
+		 * @brief The logical device that the descriptor pools are created on.
+		 */
+		const class LogicalDevice *m_logical_device;
+
+		/**
+		 * @brief Number of workers that allocate descriptor sets.
+		 */
+		u32 m_thread_count;
+
+		/**
+		 * @brief Index of the frame in flight that sets are allocated for.
+		 */
+		u32 m_frame_idx{ 0 };
+
+		/**
+		 * @brief Pools of every worker for each frame in flight.
+		 */
+		std::array<std::vector<PoolList>, config::MAX_FRAMES_IN_FLIGHT> m_pools;
+
+		/**
+		 * @brief Number of descriptors of each type in a pool.
+		 */
+		std::vector<VkDescriptorPoolSize> m_pool_sizes;
+
+		/**
+		 * @returns A new descriptor pool.
+		 */
+		VkDescriptorPool createPool() const;
+
+	public:
+
+		/**
+		 * @brief Creates the first descriptor pool of every worker and frame in flight.
+		 * @param logiDevice The logical device to use.
+		 * @param jobSystem The job system whose workers allocate sets.
+		 */
+		explicit DescriptorAllocator(class LogicalDevice *logiDevice, class JobSystem *jobSystem);
+
+		DescriptorAllocator(const DescriptorAllocator&) = delete;
+
+		DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+
+		/**
+		 * @brief Destructor for the descriptor allocator.
+		 */
+		~DescriptorAllocator();
+
+		/**
+		 * @brief Destroys all descriptor pools.
+		 */
+		void destroy();
+
+		/**
+		 * @brief Splits the descriptors of a pool across the common descriptor
+		 * types, so every set in the pool can use all of its bindings.
+		 * @param maxSets The number of sets the pool holds.
+		 * @returns The number of descriptors of each type.
+		 */
+		static const std::vector<VkDescriptorPoolSize> getPoolSizes(u32 maxSets);
+
+		/**
+		 * @brief Starts allocating for the given frame in flight, resetting its
+		 * pools. The GPU must have finished with the frame.
+		 * @param frameIdx The index of the frame in flight.
+		 */
+		void beginFrame(u32 frameIdx);
+
+		/**
+		 * @brief Allocates a descriptor set that is valid until this frame in
+		 * flight begins again. Must be called from a worker of the job system.
+		 * @param layout The layout of the set.
+		 * @returns The descriptor set.
+		 */
+		VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+
+		/**
+		 * @returns The number of descriptor pools across all workers and frames.
+		 */
+		const size_t getPoolCount() const;
+
+	};
+
+} // namespace carbon
+
+#endif // CORE_DESCRIPTOR_ALLOCATOR_HPP
@@ -0,0 +1,121 @@
+// file      : carbon/core/frame_arena.cpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#include "frame_arena.hpp"
+
+#include "carbon/common/logger.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+
+namespace carbon {
+
+	void* FrameArena::allocateOverflow(size_t size, size_t alignment) {
+		// room to move forward to the alignment
+		u8 *memory = static_cast<u8*>(std::malloc(size + alignment));
+
+		if (memory == nullptr) {
+			return nullptr;
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		Frame &frame = m_frames[m_frame];
+
+		frame.overflow.push_back(memory);
+		frame.overflowBytes += size + alignment;
+
+		const uintptr_t start = reinterpret_cast<uintptr_t>(memory);
+		return reinterpret_cast<void*>((start + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1));
+	}
+
+
+	FrameArena::FrameArena(size_t frameSize) {
+		assert(frameSize > 0 && "Frame arena must not be empty.");
+
+		for (auto &frame : m_frames) {
+			frame.base = static_cast<u8*>(std::malloc(frameSize));
+			frame.capacity = frame.base ? frameSize : 0;
+		}
+
+		if (m_frames[0].base == nullptr) {
+			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to allocate frame arena.");
+		}
+	}
+
+
+	FrameArena::~FrameArena() {
+		destroy();
+	}
+
+
+	void FrameArena::destroy() {
+		for (auto &frame : m_frames) {
+			for (void *memory : frame.overflow) {
+				std::free(memory);
+			}
+
+			std::free(frame.base);
+			frame = {};
+		}
+
+		m_head.store(0, std::memory_order_relaxed);
+	}
+
+
+	void FrameArena::beginFrame(u32 frameIdx) {
+		assert(frameIdx < config::MAX_FRAMES_IN_FLIGHT && "Frame index out of range.");
+
+		Frame &last = m_frames[m_frame];
+		last.used = m_head.load(std::memory_order_relaxed) + last.overflowBytes;
+		m_peak = std::max(m_peak, last.used);
+
+		m_frame = frameIdx;
+		Frame &frame = m_frames[m_frame];
+
+		// the region grows only when the frame outgrew it, so steady frames do not touch the heap
+		if (!frame.overflow.empty()) {
+			for (void *memory : frame.overflow) {
+				std::free(memory);
+			}
+
+			frame.overflow.clear();
+			frame.overflowBytes = 0;
+
+			const size_t capacity = std::max(frame.capacity * 2, frame.used);
+			u8 *base = static_cast<u8*>(std::malloc(capacity));
+
+			if (base != nullptr) {
+				std::free(frame.base);
+				frame.base = base;
+				frame.capacity = capacity;
+			}
+		}
+
+		m_head.store(0, std::memory_order_relaxed);
+	}
+
+
+	void* FrameArena::allocate(size_t size, size_t alignment) {
+		assert(alignment > 0 && (alignment & (alignment - 1)) == 0 && "Alignment must be a power of 2.");
+
+		const Frame &frame = m_frames[m_frame];
+		const uintptr_t base = reinterpret_cast<uintptr_t>(frame.base);
+
+		size_t head = m_head.load(std::memory_order_relaxed);
+		size_t start{ 0 };
+
+		// another thread may claim the same space first, in which case try again after it
+		do {
+			start = ((base + head + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1)) - base;
+
+			if (start + size > frame.capacity) {
+				return allocateOverflow(size, alignment);
+			}
+		} while (!m_head.compare_exchange_weak(head, start + size, std::memory_order_relaxed));
+
+		return frame.base + start;
+	}
+
+} // namespace carbon
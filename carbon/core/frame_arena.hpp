@@ -0,0 +1,253 @@
+// file      : carbon/core/frame_arena.hpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#pragma once
+
+#ifndef CORE_FRAME_ARENA_HPP
+#define CORE_FRAME_ARENA_HPP
+
+#include "carbon/backend.hpp"
+#include "carbon/engine/config.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace carbon {
+
+	/**
+	 * @brief Scratch memory for data that only lives for a frame, such as draw
+	 * lists, barriers and descriptor writes. Each frame in flight has its own
+	 * region, which allocations bump a pointer through and which is released
+	 * all at once when the frame in flight comes round again, so nothing is
+	 * ever freed on its own. A frame that outgrows its region falls back to
+	 * the heap, and the region grows to fit the next time it is reused, so
+	 * steady frames never touch the heap. Allocating is lock-free, so any
+	 * thread may allocate.
+	 */
+	class FrameArena {
+
+	private:
+
+		/**
+		 * @brief The memory of a frame in flight.
+		 */
+		struct Frame {
+			u8 *base{ nullptr };
+			size_t capacity{ 0 };
+
+			/**
+			 * @brief Bytes the frame used the last time it was current, including overflow.
+			 */
+			size_t used{ 0 };
+
+			/**
+			 * @brief Heap allocations made once the region was full.
+			 */
+			std::vector<void*> overflow;
+
+			/**
+			 * @brief Bytes allocated from the heap once the region was full.
+			 */
+			size_t overflowBytes{ 0 };
+		};
+
+		/**
+		 * @brief Memory of each frame in flight.
+		 */
+		std::array<Frame, config::MAX_FRAMES_IN_FLIGHT> m_frames;
+
+		/**
+		 * @brief Bytes handed out so far from the region of the current frame.
+		 */
+		std::atomic<size_t> m_head{ 0 };
+
+		/**
+		 * @brief Guards the overflow of the current frame.
+		 */
+		std::mutex m_mutex;
+
+		/**
+		 * @brief The current frame in flight.
+		 */
+		u32 m_frame{ 0 };
+
+		/**
+		 * @brief Most bytes that any frame has used.
+		 */
+		size_t m_peak{ 0 };
+
+		/**
+		 * @brief Allocates from the heap once the region of the current frame is full.
+		 */
+		void* allocateOverflow(size_t size, size_t alignment);
+
+	public:
+
+		/**
+		 * @brief Creates the region of every frame in flight.
+		 * @param frameSize [Optional] Size (in bytes) of the region of each frame in flight.
+		 */
+		explicit FrameArena(size_t frameSize = config::FRAME_ARENA_SIZE);
+
+		FrameArena(const FrameArena&) = delete;
+
+		FrameArena& operator=(const FrameArena&) = delete;
+
+		/**
+		 * @brief Destructor for the frame arena.
+		 */
+		~FrameArena();
+
+		/**
+		 * @brief Frees the memory of every frame in flight.
+		 */
+		void destroy();
+
+		/**
+		 * @brief Moves on to the given frame in flight, releasing everything
+		 * allocated the last time it was current. Nothing may be allocating
+		 * while the frame changes.
+		 * @param frameIdx The index of the frame in flight.
+		 */
+		void beginFrame(u32 frameIdx);
+
+		/**
+		 * @brief Hands out memory that stays valid until the current frame in
+		 * flight comes round again.
+		 * @param size Size (in bytes) of the memory.
+		 * @param alignment [Optional] Alignment of the memory, which must be a power of 2.
+		 * @returns The memory, or `nullptr` if the heap is out of memory.
+		 */
+		void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+		/**
+		 * @brief Hands out uninitialized memory for an array.
+		 * @param count Number of elements in the array.
+		 * @returns The first element of the array.
+		 */
+		template<class T>
+		T* allocateArray(size_t count) {
+			return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+		}
+
+		/**
+		 * @brief Constructs an object in the current frame. Its destructor is
+		 * never called, so it must not own anything.
+		 * @param args Arguments to construct the object with.
+		 * @returns The object, or `nullptr` if the heap is out of memory.
+		 */
+		template<class T, class... Args>
+		T* create(Args&&... args) {
+			static_assert(std::is_trivially_destructible<T>::value, "Objects in the frame arena are never destroyed.");
+			void *memory = allocate(sizeof(T), alignof(T));
+
+			return memory ? new (memory) T(std::forward<Args>(args)...) : nullptr;
+		}
+
+		/**
+		 * @returns Size (in bytes) of the region of the current frame.
+		 */
+		const size_t getCapacity() const {
+			return m_frames[m_frame].capacity;
+		}
+
+		/**
+		 * @returns Bytes used by the current frame so far, not counting overflow.
+		 */
+		const size_t getUsed() const {
+			return m_head.load(std::memory_order_relaxed);
+		}
+
+		/**
+		 * @returns Most bytes that any frame has used.
+		 */
+		const size_t getPeakUsage() const {
+			return m_peak;
+		}
+
+	};
+
+	/**
+	 * @brief Allocator that lets standard containers live in the frame
+	 * arena. Freeing does nothing, since the arena releases everything when
+	 * the frame in flight comes round again, so a container must not outlive
+	 * the frame it was filled in.
+	 */
+	template<class T>
+	class FrameAllocator {
+
+	private:
+
+		/**
+		 * @brief The arena to allocate from.
+		 */
+		class FrameArena *m_arena;
+
+	public:
+
+		using value_type = T;
+
+		/**
+		 * @brief Creates an allocator that allocates from the given arena.
+		 * @param arena The arena to allocate from.
+		 */
+		explicit FrameAllocator(class FrameArena *arena) noexcept
+			: m_arena(arena)
+		{}
+
+		template<class U>
+		FrameAllocator(const FrameAllocator<U> &other) noexcept
+			: m_arena(other.getArena())
+		{}
+
+		/**
+		 * @param count Number of elements to allocate.
+		 * @returns Uninitialized memory for the elements.
+		 */
+		T* allocate(size_t count) {
+			T *memory = m_arena->allocateArray<T>(count);
+
+			if (memory == nullptr) {
+				throw std::bad_alloc();
+			}
+
+			return memory;
+		}
+
+		void deallocate(T*, size_t) noexcept {}
+
+		/**
+		 * @returns The arena that is allocated from.
+		 */
+		class FrameArena* getArena() const noexcept {
+			return m_arena;
+		}
+
+		template<class U>
+		bool operator==(const FrameAllocator<U> &other) const noexcept {
+			return m_arena == other.getArena();
+		}
+
+		template<class U>
+		bool operator!=(const FrameAllocator<U> &other) const noexcept {
+			return m_arena != other.getArena();
+		}
+
+	};
+
+	/**
+	 * @brief A vector that lives in the frame arena.
+	 */
+	template<class T>
+	using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+} // namespace carbon
+
+#endif // CORE_FRAME_ARENA_HPP
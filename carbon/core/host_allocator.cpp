@@ -0,0 +1,500 @@
+// file      : carbon/core/host_allocator.cpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#include "host_allocator.hpp"
+
+#include "carbon/common/logger.hpp"
+#include "carbon/engine/config.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+namespace carbon {
+
+	namespace {
+
+		/**
+		 * @brief Size of the header in front of every allocation, which keeps
+		 * what is handed out aligned to `MIN_ALIGNMENT`.
+		 */
+		constexpr size_t HEADER_SIZE = 16;
+
+		/**
+		 * @brief Alignment of every pooled block.
+		 */
+		constexpr size_t MIN_ALIGNMENT = 16;
+
+		/**
+		 * @brief Size of the smallest pooled block.
+		 */
+		constexpr size_t MIN_POOLED_SIZE = 32;
+
+		/**
+		 * @brief Number of block sizes, which double from `MIN_POOLED_SIZE` up to `MAX_POOLED_SIZE`.
+		 */
+		constexpr u32 CLASS_COUNT = 8;
+
+		/**
+		 * @brief Size of the memory that blocks are carved out of.
+		 */
+		constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+		/**
+		 * @brief Most free blocks of a size a thread keeps before giving half back.
+		 */
+		constexpr u32 LOCAL_LIMIT = 128;
+
+		/**
+		 * @brief Size class of allocations that are not pooled.
+		 */
+		constexpr u8 UNPOOLED = 0xFF;
+
+		static_assert((MIN_POOLED_SIZE << (CLASS_COUNT - 1)) == HostAllocator::MAX_POOLED_SIZE, "Block sizes must end at the largest pooled size.");
+
+		/**
+		 * @brief Sits in front of every allocation.
+		 */
+		struct Header {
+			u64 size;
+
+			/**
+			 * @brief Distance from the start of the block to the allocation.
+			 */
+			u32 offset;
+
+			u8 sizeClass;
+			u8 scope;
+			u8 padding[2];
+		};
+
+		static_assert(sizeof(Header) == HEADER_SIZE, "Header must keep allocations aligned.");
+
+		/**
+		 * @brief A free block, linked to the next free block of the same size.
+		 */
+		struct FreeBlock {
+			FreeBlock *next;
+		};
+
+		struct Counters {
+			std::atomic<u64> liveBytes{ 0 };
+			std::atomic<u64> liveCount{ 0 };
+			std::atomic<u64> totalCount{ 0 };
+
+			void add(u64 size) {
+				liveBytes.fetch_add(size, std::memory_order_relaxed);
+				liveCount.fetch_add(1, std::memory_order_relaxed);
+				totalCount.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			void remove(u64 size) {
+				liveBytes.fetch_sub(size, std::memory_order_relaxed);
+				liveCount.fetch_sub(1, std::memory_order_relaxed);
+			}
+
+			HostAllocationStats load() const {
+				HostAllocationStats stats;
+				stats.liveBytes = liveBytes.load(std::memory_order_relaxed);
+				stats.liveCount = liveCount.load(std::memory_order_relaxed);
+				stats.totalCount = totalCount.load(std::memory_order_relaxed);
+
+				return stats;
+			}
+		};
+
+		/**
+		 * @brief Free blocks shared between threads, and the counters of every
+		 * type and scope.
+		 */
+		struct Pools {
+			std::mutex mutex;
+			std::array<FreeBlock*, CLASS_COUNT> free{};
+
+			std::array<Counters, HostAllocator::TYPE_SLOTS> types;
+			std::array<Counters, HostAllocator::SCOPE_COUNT> scopes;
+			std::array<Counters, HostAllocator::SCOPE_COUNT> internal;
+		};
+
+		/**
+		 * @returns The shared pools, created on first use so the driver can
+		 * allocate during static initialization.
+		 */
+		Pools& getPools() {
+			// never destroyed, since the driver may free after static destructors have run
+			static Pools *pools = new Pools();
+			return *pools;
+		}
+
+		/**
+		 * @brief Free blocks of a single thread, taken without locking.
+		 */
+		struct LocalCache {
+			std::array<FreeBlock*, CLASS_COUNT> free{};
+			std::array<u32, CLASS_COUNT> count{};
+
+			/**
+			 * @brief Moves free blocks of a size to the shared pool.
+			 * @param sizeClass The size of the blocks.
+			 * @param keep Number of blocks to keep.
+			 */
+			void release(u32 sizeClass, u32 keep) {
+				if (count[sizeClass] <= keep) {
+					return;
+				}
+
+				FreeBlock *first = free[sizeClass];
+				FreeBlock *last = first;
+
+				for (u32 i = keep + 1; i < count[sizeClass]; i++) {
+					last = last->next;
+				}
+
+				free[sizeClass] = last->next;
+				count[sizeClass] = keep;
+
+				Pools &pools = getPools();
+				std::lock_guard<std::mutex> lock(pools.mutex);
+
+				last->next = pools.free[sizeClass];
+				pools.free[sizeClass] = first;
+			}
+
+			~LocalCache() {
+				// blocks of finished threads are picked up by the others
+				for (u32 i = 0; i < CLASS_COUNT; i++) {
+					release(i, 0);
+				}
+			}
+		};
+
+		thread_local LocalCache t_cache;
+
+		/**
+		 * @returns Size of the blocks of the class.
+		 */
+		constexpr size_t getClassSize(u32 sizeClass) {
+			return MIN_POOLED_SIZE << sizeClass;
+		}
+
+		/**
+		 * @returns The smallest class whose blocks hold the given bytes.
+		 */
+		u32 getSizeClass(size_t bytes) {
+			u32 sizeClass{ 0 };
+
+			while (getClassSize(sizeClass) < bytes) {
+				sizeClass++;
+			}
+
+			return sizeClass;
+		}
+
+		/**
+		 * @returns A free block of the class, or `nullptr` if there is no memory left.
+		 */
+		void* popBlock(u32 sizeClass) {
+			LocalCache &cache = t_cache;
+
+			if (cache.free[sizeClass] == nullptr) {
+				Pools &pools = getPools();
+				std::lock_guard<std::mutex> lock(pools.mutex);
+
+				// take a batch, so the lock is not taken on every allocation
+				while (pools.free[sizeClass] != nullptr && cache.count[sizeClass] < LOCAL_LIMIT / 2) {
+					FreeBlock *block = pools.free[sizeClass];
+					pools.free[sizeClass] = block->next;
+
+					block->next = cache.free[sizeClass];
+					cache.free[sizeClass] = block;
+					cache.count[sizeClass]++;
+				}
+			}
+
+			if (cache.free[sizeClass] == nullptr) {
+				// chunks are kept for the life of the process and only ever split into blocks
+				u8 *chunk = static_cast<u8*>(std::malloc(CHUNK_SIZE));
+
+				if (chunk == nullptr) {
+					return nullptr;
+				}
+
+				const size_t blockSize = getClassSize(sizeClass);
+
+				for (size_t offset = 0; offset + blockSize <= CHUNK_SIZE; offset += blockSize) {
+					FreeBlock *block = reinterpret_cast<FreeBlock*>(chunk + offset);
+
+					block->next = cache.free[sizeClass];
+					cache.free[sizeClass] = block;
+					cache.count[sizeClass]++;
+				}
+			}
+
+			FreeBlock *block = cache.free[sizeClass];
+			cache.free[sizeClass] = block->next;
+			cache.count[sizeClass]--;
+
+			return block;
+		}
+
+		/**
+		 * @brief Gives a block back to the pool of the calling thread.
+		 */
+		void pushBlock(u32 sizeClass, void *memory) {
+			LocalCache &cache = t_cache;
+
+			FreeBlock *block = static_cast<FreeBlock*>(memory);
+			block->next = cache.free[sizeClass];
+
+			cache.free[sizeClass] = block;
+			cache.count[sizeClass]++;
+
+			// threads that only free (such as driver worker threads) would otherwise hoard blocks
+			if (cache.count[sizeClass] > LOCAL_LIMIT) {
+				cache.release(sizeClass, LOCAL_LIMIT / 2);
+			}
+		}
+
+		/**
+		 * @returns The header in front of an allocation.
+		 */
+		Header* getHeader(void *memory) {
+			return reinterpret_cast<Header*>(static_cast<u8*>(memory) - HEADER_SIZE);
+		}
+
+		/**
+		 * @returns The slot that objects of the type are counted in.
+		 */
+		u32 getTypeSlot(VkObjectType type) {
+			if (type <= VK_OBJECT_TYPE_COMMAND_POOL) {
+				return static_cast<u32>(type);
+			}
+
+			switch (type) {
+				case VK_OBJECT_TYPE_SURFACE_KHR:
+					return VK_OBJECT_TYPE_COMMAND_POOL + 1;
+				case VK_OBJECT_TYPE_SWAPCHAIN_KHR:
+					return VK_OBJECT_TYPE_COMMAND_POOL + 2;
+				case VK_OBJECT_TYPE_DEBUG_UTILS_MESSENGER_EXT:
+					return VK_OBJECT_TYPE_COMMAND_POOL + 3;
+				default:
+					return VK_OBJECT_TYPE_UNKNOWN;
+			}
+		}
+
+		/**
+		 * @brief Names of the object types of each slot.
+		 */
+		constexpr std::array<const char*, HostAllocator::TYPE_SLOTS> TYPE_NAMES{
+			"Unknown", "Instance", "Physical device", "Device", "Queue", "Semaphore",
+			"Command buffer", "Fence", "Device memory", "Buffer", "Image", "Event",
+			"Query pool", "Buffer view", "Image view", "Shader module", "Pipeline cache",
+			"Pipeline layout", "Render pass", "Pipeline", "Descriptor set layout", "Sampler",
+			"Descriptor pool", "Descriptor set", "Framebuffer", "Command pool",
+			"Surface", "Swapchain", "Debug messenger"
+		};
+
+		/**
+		 * @brief Names of each scope.
+		 */
+		constexpr std::array<const char*, HostAllocator::SCOPE_COUNT> SCOPE_NAMES{
+			"Command", "Object", "Cache", "Device", "Instance"
+		};
+
+		void* VKAPI_PTR hostAllocate(void *pUserData, size_t size, size_t alignment, VkSystemAllocationScope scope) {
+			if (size == 0) {
+				return nullptr;
+			}
+
+			alignment = std::max(alignment, MIN_ALIGNMENT);
+
+			u8 *block{ nullptr };
+			u8 *memory{ nullptr };
+			u8 sizeClass{ UNPOOLED };
+
+			if (alignment == MIN_ALIGNMENT && size + HEADER_SIZE <= HostAllocator::MAX_POOLED_SIZE) {
+				sizeClass = static_cast<u8>(getSizeClass(size + HEADER_SIZE));
+				block = static_cast<u8*>(popBlock(sizeClass));
+
+				if (block == nullptr) {
+					return nullptr;
+				}
+
+				memory = block + HEADER_SIZE;
+			} else {
+				// room to move forward to the alignment, with the header still in front
+				block = static_cast<u8*>(std::malloc(size + HEADER_SIZE + alignment));
+
+				if (block == nullptr) {
+					return nullptr;
+				}
+
+				const uintptr_t start = reinterpret_cast<uintptr_t>(block) + HEADER_SIZE;
+				memory = reinterpret_cast<u8*>((start + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1));
+			}
+
+			Header *header = getHeader(memory);
+			header->size = size;
+			header->offset = static_cast<u32>(memory - block);
+			header->sizeClass = sizeClass;
+			header->scope = static_cast<u8>(scope);
+
+			static_cast<Counters*>(pUserData)->add(size);
+			getPools().scopes[scope].add(size);
+
+			return memory;
+		}
+
+		void VKAPI_PTR hostFree(void *pUserData, void *pMemory) {
+			if (pMemory == nullptr) {
+				return;
+			}
+
+			const Header *header = getHeader(pMemory);
+			u8 *block = static_cast<u8*>(pMemory) - header->offset;
+
+			static_cast<Counters*>(pUserData)->remove(header->size);
+			getPools().scopes[header->scope].remove(header->size);
+
+			if (header->sizeClass == UNPOOLED) {
+				std::free(block);
+			} else {
+				pushBlock(header->sizeClass, block);
+			}
+		}
+
+		void* VKAPI_PTR hostReallocate(void *pUserData, void *pOriginal, size_t size, size_t alignment, VkSystemAllocationScope scope) {
+			if (pOriginal == nullptr) {
+				return hostAllocate(pUserData, size, alignment, scope);
+			}
+
+			if (size == 0) {
+				hostFree(pUserData, pOriginal);
+				return nullptr;
+			}
+
+			Header *header = getHeader(pOriginal);
+
+			// growing within the block needs no copy
+			if (header->sizeClass != UNPOOLED && alignment <= MIN_ALIGNMENT && size + HEADER_SIZE <= getClassSize(header->sizeClass)) {
+				static_cast<Counters*>(pUserData)->remove(header->size);
+				getPools().scopes[header->scope].remove(header->size);
+
+				header->size = size;
+
+				static_cast<Counters*>(pUserData)->add(size);
+				getPools().scopes[header->scope].add(size);
+
+				return pOriginal;
+			}
+
+			void *memory = hostAllocate(pUserData, size, alignment, scope);
+
+			// the original must be left alone if the new memory cannot be allocated
+			if (memory == nullptr) {
+				return nullptr;
+			}
+
+			std::memcpy(memory, pOriginal, static_cast<size_t>(std::min<u64>(header->size, size)));
+			hostFree(pUserData, pOriginal);
+
+			return memory;
+		}
+
+		void VKAPI_PTR notifyInternalAllocation(void*, size_t size, VkInternalAllocationType, VkSystemAllocationScope scope) {
+			getPools().internal[scope].add(size);
+		}
+
+		void VKAPI_PTR notifyInternalFree(void*, size_t size, VkInternalAllocationType, VkSystemAllocationScope scope) {
+			getPools().internal[scope].remove(size);
+		}
+
+	} // namespace
+
+
+	const VkAllocationCallbacks* HostAllocator::get(VkObjectType type) {
+		if (!config::ENABLE_HOST_ALLOCATOR) {
+			return nullptr;
+		}
+
+		// the counters of each type are the user data of its callbacks
+		static const std::array<VkAllocationCallbacks, TYPE_SLOTS> callbacks = [] {
+			std::array<VkAllocationCallbacks, TYPE_SLOTS> all{};
+
+			for (u32 i = 0; i < TYPE_SLOTS; i++) {
+				all[i].pUserData = &getPools().types[i];
+				all[i].pfnAllocation = hostAllocate;
+				all[i].pfnReallocation = hostReallocate;
+				all[i].pfnFree = hostFree;
+				all[i].pfnInternalAllocation = notifyInternalAllocation;
+				all[i].pfnInternalFree = notifyInternalFree;
+			}
+
+			return all;
+		}();
+
+		return &callbacks[getTypeSlot(type)];
+	}
+
+
+	HostAllocationStats HostAllocator::getStats(VkObjectType type) {
+		return getPools().types[getTypeSlot(type)].load();
+	}
+
+
+	HostAllocationStats HostAllocator::getScopeStats(VkSystemAllocationScope scope) {
+		return getPools().scopes[scope].load();
+	}
+
+
+	HostAllocationStats HostAllocator::getTotalStats() {
+		HostAllocationStats total;
+
+		for (const auto &counters : getPools().scopes) {
+			const HostAllocationStats stats = counters.load();
+
+			total.liveBytes += stats.liveBytes;
+			total.liveCount += stats.liveCount;
+			total.totalCount += stats.totalCount;
+		}
+
+		return total;
+	}
+
+
+	HostAllocationStats HostAllocator::getInternalStats(VkSystemAllocationScope scope) {
+		return getPools().internal[scope].load();
+	}
+
+
+	std::string HostAllocator::getStatsAsStr() {
+		const Pools &pools = getPools();
+		const HostAllocationStats total = getTotalStats();
+
+		std::string str{ fmt::format("Driver host memory: {:d} bytes in {:d} allocations ({:d} made)", total.liveBytes, total.liveCount, total.totalCount) };
+
+		for (u32 i = 0; i < TYPE_SLOTS; i++) {
+			const HostAllocationStats stats = pools.types[i].load();
+
+			if (stats.totalCount > 0) {
+				str.append(fmt::format("\n  {:<22} {:>10d} bytes {:>6d} live {:>8d} made", TYPE_NAMES[i], stats.liveBytes, stats.liveCount, stats.totalCount));
+			}
+		}
+
+		for (u32 i = 0; i < SCOPE_COUNT; i++) {
+			const HostAllocationStats stats = pools.scopes[i].load();
+			const HostAllocationStats internal = pools.internal[i].load();
+
+			if (stats.totalCount > 0 || internal.totalCount > 0) {
+				str.append(fmt::format("\n  {:<8} scope {:>10d} bytes {:>6d} live, {:d} internal bytes", SCOPE_NAMES[i], stats.liveBytes, stats.liveCount, internal.liveBytes));
+			}
+		}
+
+		return str;
+	}
+
+} // namespace carbon
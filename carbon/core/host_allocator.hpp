@@ -0,0 +1,108 @@
+// file      : carbon/core/host_allocator.hpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#pragma once
+
+#ifndef CORE_HOST_ALLOCATOR_HPP
+#define CORE_HOST_ALLOCATOR_HPP
+
+#include "carbon/backend.hpp"
+
+#include <string>
+
+namespace carbon {
+
+	/**
+	 * @brief Host memory allocated by the driver for a kind of object or scope.
+	 */
+	struct HostAllocationStats {
+		/**
+		 * @brief Bytes currently allocated.
+		 */
+		u64 liveBytes{ 0 };
+
+		/**
+		 * @brief Allocations currently live.
+		 */
+		u64 liveCount{ 0 };
+
+		/**
+		 * @brief Allocations ever made, including reallocations.
+		 */
+		u64 totalCount{ 0 };
+	};
+
+	/**
+	 * @brief Allocation callbacks that the engine hands to the driver, so the
+	 * host memory the driver needs comes from thread-local pools of fixed-size
+	 * blocks rather than `malloc`. Each object type gets its own callbacks,
+	 * which tag every allocation with the type and its
+	 * `VkSystemAllocationScope`, so the live bytes and allocation counts of
+	 * each can be read back to find where the driver allocates in hot paths.
+	 * An object must be destroyed with the callbacks it was created with.
+	 */
+	class HostAllocator {
+
+	public:
+
+		/**
+		 * @brief Largest block (in bytes, including its header) handed out of
+		 * the pools. Anything larger goes straight to `malloc`.
+		 */
+		static constexpr size_t MAX_POOLED_SIZE = 4096;
+
+		/**
+		 * @brief Number of object types that are counted separately. Types
+		 * without a slot of their own are counted as `VK_OBJECT_TYPE_UNKNOWN`.
+		 */
+		static constexpr u32 TYPE_SLOTS = VK_OBJECT_TYPE_COMMAND_POOL + 4;
+
+		/**
+		 * @brief Number of allocation scopes.
+		 */
+		static constexpr u32 SCOPE_COUNT = VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1;
+
+		HostAllocator() = delete;
+
+		/**
+		 * @param type The type of the object being created or destroyed.
+		 * @returns The callbacks to pass when creating or destroying an object
+		 * of the type, or `nullptr` if the driver should use its own allocator.
+		 */
+		static const VkAllocationCallbacks* get(VkObjectType type);
+
+		/**
+		 * @param type The type of object.
+		 * @returns The host memory allocated for objects of the type.
+		 */
+		static HostAllocationStats getStats(VkObjectType type);
+
+		/**
+		 * @param scope The scope of the allocations.
+		 * @returns The host memory allocated with the scope, for any object.
+		 */
+		static HostAllocationStats getScopeStats(VkSystemAllocationScope scope);
+
+		/**
+		 * @returns The host memory allocated for every object.
+		 */
+		static HostAllocationStats getTotalStats();
+
+		/**
+		 * @returns The host memory that the driver reported allocating itself
+		 * with the scope, without going through the callbacks.
+		 */
+		static HostAllocationStats getInternalStats(VkSystemAllocationScope scope);
+
+		/**
+		 * @returns The live bytes and counts of every object type and scope
+		 * that has allocated, as a formatted string.
+		 */
+		static std::string getStatsAsStr();
+
+	};
+
+} // namespace carbon
+
+#endif // CORE_HOST_ALLOCATOR_HPP
@@ -4,17 +4,23 @@
 
 #include "instance.hpp"
 
+#include "host_allocator.hpp"
 #include "carbon/macros.hpp"
 #include "carbon/common/logger.hpp"
 
 namespace carbon {
 
 	const std::vector<const char*> Instance::getRequiredInstanceExtensions() {
-		u32 numExtensions{ 0 };
+		std::vector<const char *> required;
 
-		// get required extensions and convert to std::vector<string>
-		const char** reqExts = glfwGetRequiredInstanceExtensions(&numExtensions);
-		std::vector<const char *> required(reqExts, reqExts + numExtensions);
+		// surface extensions are only needed when presenting to a window
+		if (!m_headless) {
+			u32 numExtensions{ 0 };
+
+			// get required extensions and convert to std::vector<string>
+			const char** reqExts = glfwGetRequiredInstanceExtensions(&numExtensions);
+			required.assign(reqExts, reqExts + numExtensions);
+		}
 
 		// additional extension if validation layers are included
 		if (CARBON_USE_VALIDATION_LAYERS) {
@@ -70,7 +76,19 @@ namespace carbon {
 
 		appInfo.pEngineName = CARBON_ENGINE_NAME;
 		appInfo.engineVersion = CARBON_VERSION;
-		appInfo.apiVersion = VK_MAKE_VERSION(1, 0, 0);
+
+		// 1.2 brings descriptor indexing into core, but 1.0 loaders reject any version above 1.0
+		auto enumerateInstanceVersion = reinterpret_cast<PFN_vkEnumerateInstanceVersion>(
+			vkGetInstanceProcAddr(VK_NULL_HANDLE, "vkEnumerateInstanceVersion")
+		);
+
+		u32 loaderVersion{ VK_API_VERSION_1_0 };
+		if (enumerateInstanceVersion == nullptr || enumerateInstanceVersion(&loaderVersion) != VK_SUCCESS) {
+			loaderVersion = VK_API_VERSION_1_0;
+		}
+
+		m_api_version = loaderVersion >= VK_API_VERSION_1_2 ? VK_API_VERSION_1_2 : loaderVersion;
+		appInfo.apiVersion = m_api_version;
 	}
 
 
@@ -103,10 +121,15 @@ namespace carbon {
 	}
 
 
-	Instance::Instance(const std::string &appName, const utils::version &version) {
+	Instance::Instance(const std::string &appName, const utils::version &version, bool headless)
+		: m_headless(headless)
+	{
 		// set status of validation layers
 		m_validation_enabled = static_cast<bool>(CARBON_USE_VALIDATION_LAYERS);
 
+		// get extensions needed for the instance
+		m_req_instance_extensions = getRequiredInstanceExtensions();
+
 		checkSupport();
 
 		// inform driver of how best to optimize application
@@ -118,7 +141,7 @@ namespace carbon {
 		fillInstanceCreateInfo(instanceInfo, appInfo);
 
 		// attempt to create instance
-		if (vkCreateInstance(&instanceInfo, nullptr, &m_handle) != VK_SUCCESS) {
+		if (vkCreateInstance(&instanceInfo, HostAllocator::get(VK_OBJECT_TYPE_INSTANCE), &m_handle) != VK_SUCCESS) {
 			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to create instance.");
 		}
 
@@ -127,7 +150,7 @@ namespace carbon {
 			return;
 		}
 
-		if (debug::createMessenger(m_handle, &m_debug_create_info, nullptr, &m_debug_messenger) != VK_SUCCESS) {
+		if (debug::createMessenger(m_handle, &m_debug_create_info, HostAllocator::get(VK_OBJECT_TYPE_DEBUG_UTILS_MESSENGER_EXT), &m_debug_messenger) != VK_SUCCESS) {
 			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to create debug messenger.");
 		}
 	}
@@ -146,7 +169,7 @@ namespace carbon {
 	void Instance::destroy() {
 		// destroy debug messenger if applicable
 		if (m_validation_enabled && m_debug_messenger != VK_NULL_HANDLE) {
-			debug::destroyMessenger(m_handle, m_debug_messenger, nullptr);
+			debug::destroyMessenger(m_handle, m_debug_messenger, HostAllocator::get(VK_OBJECT_TYPE_DEBUG_UTILS_MESSENGER_EXT));
 			m_debug_messenger = VK_NULL_HANDLE;
 		}
 
@@ -155,7 +178,7 @@ namespace carbon {
 		}
 
 		// destroy instance
-		vkDestroyInstance(m_handle, nullptr);
+		vkDestroyInstance(m_handle, HostAllocator::get(VK_OBJECT_TYPE_INSTANCE));
 		m_handle = VK_NULL_HANDLE;
 	}
 
@@ -30,16 +30,15 @@ namespace carbon {
 		};
 
 		/**
-		 * @returns The extensions required by GLFW.
+		 * @returns The extensions required by GLFW, or none if the instance
+		 * is headless.
 		 */
 		const std::vector<const char *> getRequiredInstanceExtensions();
 
 		/**
 		 * @brief The required instance extensions.
 		 */
-		const std::vector<const char *> m_req_instance_extensions{
-			getRequiredInstanceExtensions()
-		};
+		std::vector<const char *> m_req_instance_extensions;
 
 		/**
 		 * @brief Handle to underlying Vulkan instance.
@@ -71,6 +70,16 @@ namespace carbon {
 		 */
 		bool m_validation_enabled;
 
+		/**
+		 * @brief `true` if the instance does not present to a window, `false` otherwise.
+		 */
+		bool m_headless{ false };
+
+		/**
+		 * @brief The Vulkan version the instance was created with.
+		 */
+		u32 m_api_version{ VK_API_VERSION_1_0 };
+
 		/**
 		 * @returns `true` if validation layers are supported, `false` otherwise.
 		 */
@@ -110,8 +119,14 @@ namespace carbon {
 		 * extensions and validation layers.
 		 * @param appName The name of the application.
 		 * @param version Optional. The version of your application.
+		 * @param headless Optional. `true` to skip the surface extensions
+		 * required by GLFW, so that no display is needed.
 		 */
-		explicit Instance(const std::string &appName, const carbon::utils::version &version = { 1, 0, 0 });
+		explicit Instance(
+			const std::string &appName,
+			const carbon::utils::version &version = { 1, 0, 0 },
+			bool headless = false
+		);
 
 		/**
 		 * @brief Default constructor for initializing a Vulkan instance.
@@ -142,6 +157,20 @@ namespace carbon {
 			return m_validation_enabled;
 		}
 
+		/**
+		 * @returns `true` if the instance does not present to a window, `false` otherwise.
+		 */
+		bool isHeadless() const {
+			return m_headless;
+		}
+
+		/**
+		 * @returns The Vulkan version the instance was created with.
+		 */
+		const u32 getApiVersion() const {
+			return m_api_version;
+		}
+
 		/**
 		 * @returns The enabled validation layers that will be used if
 		 * `CARBON_DISABLE_DEBUG` is not defined.
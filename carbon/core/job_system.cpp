@@ -0,0 +1,494 @@
+// file      : carbon/core/job_system.cpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#include "job_system.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace carbon {
+
+	/**
+	 * @brief Index of the worker running on this thread.
+	 */
+	static thread_local u32 t_worker_idx = u32_max;
+
+	// the deque follows "Correct and Efficient Work-Stealing for Weak Memory Models" (Le et al., 2013)
+
+	bool JobSystem::WorkStealingQueue::push(Job *job) {
+		i64 b = m_bottom.load(std::memory_order_relaxed);
+		i64 t = m_top.load(std::memory_order_acquire);
+
+		if (b - t >= CAPACITY) {
+			return false;
+		}
+
+		m_jobs[b & (CAPACITY - 1)].store(job, std::memory_order_relaxed);
+
+		// job must be visible before thieves can see the new bottom
+		std::atomic_thread_fence(std::memory_order_release);
+		m_bottom.store(b + 1, std::memory_order_relaxed);
+
+		return true;
+	}
+
+
+	JobSystem::Job* JobSystem::WorkStealingQueue::pop() {
+		i64 b = m_bottom.load(std::memory_order_relaxed) - 1;
+		m_bottom.store(b, std::memory_order_relaxed);
+
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		i64 t = m_top.load(std::memory_order_relaxed);
+
+		// queue was empty
+		if (t > b) {
+			m_bottom.store(b + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		Job *job = m_jobs[b & (CAPACITY - 1)].load(std::memory_order_relaxed);
+
+		// last job, so race against thieves for it
+		if (t == b) {
+			if (!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+				job = nullptr;
+			}
+
+			m_bottom.store(b + 1, std::memory_order_relaxed);
+		}
+
+		return job;
+	}
+
+
+	JobSystem::Job* JobSystem::WorkStealingQueue::steal() {
+		i64 t = m_top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		i64 b = m_bottom.load(std::memory_order_acquire);
+
+		if (t >= b) {
+			return nullptr;
+		}
+
+		Job *job = m_jobs[t & (CAPACITY - 1)].load(std::memory_order_relaxed);
+
+		// another thief or the owner got there first
+		if (!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+			return nullptr;
+		}
+
+		return job;
+	}
+
+
+	JobSystem::Job* JobSystem::acquireJob() {
+		{
+			std::lock_guard<std::mutex> lock(m_free_mutex);
+
+			if (!m_free_jobs.empty()) {
+				Job *job = m_free_jobs.back();
+				m_free_jobs.pop_back();
+
+				return job;
+			}
+		}
+
+		return new Job();
+	}
+
+
+	void JobSystem::releaseJob(Job *job) {
+		// let go of whatever the function captured
+		*job = {};
+
+		std::lock_guard<std::mutex> lock(m_free_mutex);
+		m_free_jobs.push_back(job);
+	}
+
+
+	void JobSystem::workerLoop(u32 workerIdx) {
+		t_worker_idx = workerIdx;
+
+		while (m_running.load(std::memory_order_acquire)) {
+			Job *job = findJob();
+
+			if (job) {
+				execute(job);
+				continue;
+			}
+
+			// frame work comes first, so background jobs only run when there is none
+			job = findBackgroundJob();
+
+			if (job) {
+				executeBackground(job);
+				continue;
+			}
+
+			// nothing to do, so sleep until a job is submitted
+			std::unique_lock<std::mutex> lock(m_sleep_mutex);
+			m_sleeping.fetch_add(1);
+
+			m_sleep_cv.wait(lock, [this]() {
+				return !m_running.load(std::memory_order_acquire) || m_queued.load() > 0 || hasBackgroundJob();
+			});
+
+			m_sleeping.fetch_sub(1);
+		}
+	}
+
+
+	void JobSystem::notifyWorker() {
+		// only pay for the lock when a worker is actually asleep
+		if (m_sleeping.load() > 0) {
+			{
+				std::lock_guard<std::mutex> lock(m_sleep_mutex);
+			}
+
+			m_sleep_cv.notify_one();
+		}
+	}
+
+
+	void JobSystem::enqueue(Job *job) {
+		m_queued.fetch_add(1);
+
+		if (t_worker_idx < m_queues.size()) {
+			// run straight away if the queue of this worker is full
+			if (!m_queues[t_worker_idx]->push(job)) {
+				m_queued.fetch_sub(1);
+
+				if (job->dependency) {
+					wait(*job->dependency);
+				}
+
+				execute(job);
+				return;
+			}
+		} else {
+			std::lock_guard<std::mutex> lock(m_injected_mutex);
+			m_injected.push_back(job);
+		}
+
+		notifyWorker();
+	}
+
+
+	bool JobSystem::hasBackgroundJob() const {
+		return m_background_queued.load() > 0 && m_background_running.load() < m_background_limit;
+	}
+
+
+	JobSystem::Job* JobSystem::findJob() {
+		if (m_queued.load() == 0) {
+			return nullptr;
+		}
+
+		Job *job = nullptr;
+		u32 count = to_u32(m_queues.size());
+		u32 self = t_worker_idx;
+
+		// newest jobs of our own queue are the most likely to be in cache
+		if (self < count) {
+			job = m_queues[self]->pop();
+		}
+
+		// otherwise steal the oldest job of another worker
+		for (u32 i = 1; !job && i <= count; i++) {
+			u32 victim = (self == u32_max ? i : self + i) % count;
+
+			if (victim != self) {
+				job = m_queues[victim]->steal();
+			}
+		}
+
+		if (!job) {
+			std::lock_guard<std::mutex> lock(m_injected_mutex);
+
+			if (!m_injected.empty()) {
+				job = m_injected.front();
+				m_injected.pop_front();
+			}
+		}
+
+		if (job) {
+			m_queued.fetch_sub(1);
+		}
+
+		return job;
+	}
+
+
+	JobSystem::Job* JobSystem::findBackgroundJob() {
+		if (m_background_queued.load() == 0) {
+			return nullptr;
+		}
+
+		// claim a place among the running background jobs before taking one
+		u32 running = m_background_running.load();
+
+		do {
+			if (running >= m_background_limit) {
+				return nullptr;
+			}
+		} while (!m_background_running.compare_exchange_weak(running, running + 1));
+
+		Job *job = nullptr;
+
+		{
+			std::lock_guard<std::mutex> lock(m_background_mutex);
+
+			if (!m_background.empty()) {
+				job = m_background.front();
+				m_background.pop_front();
+				m_background_queued.fetch_sub(1);
+			}
+		}
+
+		if (!job) {
+			m_background_running.fetch_sub(1);
+		}
+
+		return job;
+	}
+
+
+	void JobSystem::executeBackground(Job *job) {
+		job->function();
+
+		JobCounter *counter = job->counter;
+		releaseJob(job);
+
+		m_background_running.fetch_sub(1);
+
+		if (counter && counter->m_value.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			resume(counter);
+		}
+
+		// another background job may start now that this one is done
+		if (m_background_queued.load() > 0) {
+			notifyWorker();
+		}
+	}
+
+
+	void JobSystem::execute(Job *job) {
+		// not ready yet, so leave it with its dependency rather than spinning on it
+		if (job->dependency && park(job)) {
+			return;
+		}
+
+		if (job->range) {
+			(*job->range)(job->first, job->last);
+		} else {
+			job->function();
+		}
+
+		// taken before the counter drops, since the waiter may destroy the range function straight after
+		JobCounter *counter = job->counter;
+		releaseJob(job);
+
+		if (counter && counter->m_value.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			resume(counter);
+		}
+	}
+
+
+	bool JobSystem::park(Job *job) {
+		std::lock_guard<std::mutex> lock(m_parked_mutex);
+
+		// checked under the lock, so either the last job of the dependency finds this one parked or this sees it done
+		if (job->dependency->isDone()) {
+			return false;
+		}
+
+		m_parked.push_back(job);
+		return true;
+	}
+
+
+	void JobSystem::resume(const JobCounter *counter) {
+		// queued one at a time outside the lock, since queuing may run the job straight away
+		while (true) {
+			Job *job = nullptr;
+
+			{
+				std::lock_guard<std::mutex> lock(m_parked_mutex);
+
+				auto it = std::find_if(m_parked.begin(), m_parked.end(), [counter](const Job *parked) {
+					return parked->dependency == counter;
+				});
+
+				if (it == m_parked.end()) {
+					return;
+				}
+
+				job = *it;
+				*it = m_parked.back();
+				m_parked.pop_back();
+			}
+
+			enqueue(job);
+		}
+	}
+
+
+	JobSystem::JobSystem(u32 workerCount) {
+		workerCount = std::max(workerCount, 1U);
+
+		m_queues.reserve(workerCount);
+
+		for (u32 i = 0; i < workerCount; i++) {
+			m_queues.push_back(new WorkStealingQueue());
+		}
+
+		// calling thread is worker 0
+		t_worker_idx = 0;
+
+		m_threads.reserve(workerCount - 1);
+
+		// leave a worker thread free for frame work whenever there are two or more
+		m_background_limit = workerCount > 2 ? workerCount - 2 : 1;
+
+		for (u32 i = 1; i < workerCount; i++) {
+			m_threads.emplace_back(&JobSystem::workerLoop, this, i);
+		}
+	}
+
+
+	JobSystem::~JobSystem() {
+		destroy();
+	}
+
+
+	void JobSystem::destroy() {
+		{
+			std::lock_guard<std::mutex> lock(m_sleep_mutex);
+			m_running.store(false, std::memory_order_release);
+		}
+
+		m_sleep_cv.notify_all();
+
+		for (auto &thread : m_threads) {
+			if (thread.joinable()) {
+				thread.join();
+			}
+		}
+
+		m_threads.clear();
+
+		// drop any jobs that never started
+		for (auto *queue : m_queues) {
+			while (Job *job = queue->steal()) {
+				delete job;
+			}
+
+			delete queue;
+		}
+
+		for (auto *job : m_injected) {
+			delete job;
+		}
+
+		for (auto *job : m_background) {
+			delete job;
+		}
+
+		for (auto *job : m_parked) {
+			delete job;
+		}
+
+		for (auto *job : m_free_jobs) {
+			delete job;
+		}
+
+		m_queues.clear();
+		m_injected.clear();
+		m_background.clear();
+		m_parked.clear();
+		m_free_jobs.clear();
+		m_queued.store(0);
+		m_background_queued.store(0);
+	}
+
+
+	void JobSystem::run(const JobFn &function, JobCounter *counter, const JobCounter *dependency) {
+		assert(m_running.load() && "Job system has been destroyed.");
+
+		if (counter) {
+			counter->m_value.fetch_add(1, std::memory_order_acq_rel);
+		}
+
+		Job *job = acquireJob();
+		job->function = function;
+		job->counter = counter;
+		job->dependency = dependency;
+
+		enqueue(job);
+	}
+
+
+	void JobSystem::runBackground(const JobFn &function, JobCounter *counter) {
+		assert(m_running.load() && "Job system has been destroyed.");
+
+		if (counter) {
+			counter->m_value.fetch_add(1, std::memory_order_acq_rel);
+		}
+
+		Job *job = acquireJob();
+		job->function = function;
+		job->counter = counter;
+
+		// no worker would ever take it
+		if (m_threads.empty()) {
+			m_background_running.fetch_add(1);
+			executeBackground(job);
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_background_mutex);
+			m_background.push_back(job);
+			m_background_queued.fetch_add(1);
+		}
+
+		notifyWorker();
+	}
+
+
+	void JobSystem::parallelFor(u32 count, u32 batchSize, const RangeFn &function, JobCounter &counter) {
+		batchSize = std::max(batchSize, 1U);
+
+		for (u32 first = 0; first < count; first += batchSize) {
+			Job *job = acquireJob();
+			job->range = &function;
+			job->first = first;
+			job->last = std::min(first + batchSize, count);
+			job->counter = &counter;
+
+			counter.m_value.fetch_add(1, std::memory_order_acq_rel);
+			enqueue(job);
+		}
+	}
+
+
+	void JobSystem::wait(const JobCounter &counter) {
+		// help out instead of blocking, which also avoids deadlocking when waiting inside a job
+		while (!counter.isDone()) {
+			Job *job = findJob();
+
+			if (job) {
+				execute(job);
+			} else {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+
+	u32 JobSystem::getWorkerIndex() {
+		return t_worker_idx;
+	}
+
+} // namespace carbon
@@ -0,0 +1,396 @@
+// file      : carbon/core/job_system.hpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#pragma once
+
+#ifndef CORE_JOB_SYSTEM_HPP
+#define CORE_JOB_SYSTEM_HPP
+
+#include "carbon/types.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace carbon {
+
+	// forward-declare classes that would result in circular dependency
+	class JobSystem;
+
+	/**
+	 * @brief Counts the jobs that are still to be finished. Jobs add to the
+	 * counter when they are submitted and take away from it when they finish,
+	 * so a counter reaching zero means that all of its jobs are done.
+	 */
+	class JobCounter {
+
+	private:
+
+		friend class JobSystem;
+
+		/**
+		 * @brief Number of jobs that have not finished yet.
+		 */
+		std::atomic<u32> m_value{ 0 };
+
+	public:
+
+		JobCounter() = default;
+
+		JobCounter(const JobCounter&) = delete;
+
+		JobCounter& operator=(const JobCounter&) = delete;
+
+		/**
+		 * @returns `true` if all jobs of the counter have finished, `false` otherwise.
+		 */
+		bool isDone() const {
+			return m_value.load(std::memory_order_acquire) == 0;
+		}
+
+		/**
+		 * @returns The number of jobs that have not finished yet.
+		 */
+		u32 getValue() const {
+			return m_value.load(std::memory_order_acquire);
+		}
+
+	};
+
+	/**
+	 * @brief Work-stealing job scheduler with one worker per core. Each worker
+	 * has its own lock-free deque: it pushes and pops jobs at one end, while
+	 * idle workers steal from the other end. The thread that creates the job
+	 * system is worker 0 and only runs jobs while it waits on a counter.
+	 * Long jobs that no frame waits on, such as pipeline compiles, go on a
+	 * separate background queue that only workers 1 and up take from, so a
+	 * thread waiting on frame work never picks one up.
+	 */
+	class JobSystem {
+
+	public:
+
+		/**
+		 * @brief Function run by a job.
+		 */
+		using JobFn = std::function<void()>;
+
+		/**
+		 * @brief Function run by a batch of `parallelFor()`, over the range [first, last).
+		 */
+		using RangeFn = std::function<void(u32, u32)>;
+
+	private:
+
+		/**
+		 * @brief A single unit of work. Batches of `parallelFor()` point at
+		 * the function of the caller rather than copying it, so submitting
+		 * them never allocates.
+		 */
+		struct Job {
+			JobFn function;
+			const RangeFn *range{ nullptr };
+			u32 first{ 0 };
+			u32 last{ 0 };
+			JobCounter *counter{ nullptr };
+			const JobCounter *dependency{ nullptr };
+		};
+
+		/**
+		 * @brief Fixed-size Chase-Lev deque. Only the owning worker may call
+		 * `push()` and `pop()`; any thread may call `steal()`.
+		 */
+		class WorkStealingQueue {
+
+		private:
+
+			/**
+			 * @brief Maximum number of jobs in the queue (must be a power of 2).
+			 */
+			static inline constexpr i64 CAPACITY = 4096;
+
+			/**
+			 * @brief Index that jobs are stolen from.
+			 */
+			std::atomic<i64> m_top{ 0 };
+
+			/**
+			 * @brief Index that the owner pushes and pops jobs at.
+			 */
+			std::atomic<i64> m_bottom{ 0 };
+
+			/**
+			 * @brief Ring buffer of jobs.
+			 */
+			std::vector<std::atomic<Job*>> m_jobs;
+
+		public:
+
+			WorkStealingQueue()
+				: m_jobs(CAPACITY)
+			{}
+
+			/**
+			 * @brief Adds a job to the bottom of the queue.
+			 * @param job The job to add.
+			 * @returns `true` if the job was added, `false` if the queue is full.
+			 */
+			bool push(Job *job);
+
+			/**
+			 * @returns The job at the bottom of the queue, or `nullptr` if the queue is empty.
+			 */
+			Job* pop();
+
+			/**
+			 * @returns The job at the top of the queue, or `nullptr` if the queue
+			 * is empty or another thread took the job first.
+			 */
+			Job* steal();
+
+		};
+
+		/**
+		 * @brief Queue of every worker, indexed by worker.
+		 */
+		std::vector<WorkStealingQueue*> m_queues;
+
+		/**
+		 * @brief Threads of workers 1 and up.
+		 */
+		std::vector<std::thread> m_threads;
+
+		/**
+		 * @brief Jobs submitted from threads that are not workers.
+		 */
+		std::deque<Job*> m_injected;
+
+		/**
+		 * @brief Guards the jobs submitted from threads that are not workers.
+		 */
+		std::mutex m_injected_mutex;
+
+		/**
+		 * @brief Jobs submitted with `runBackground()`, which waiting threads never run.
+		 */
+		std::deque<Job*> m_background;
+
+		/**
+		 * @brief Guards the background jobs.
+		 */
+		std::mutex m_background_mutex;
+
+		/**
+		 * @brief Number of background jobs that have not been taken yet.
+		 */
+		std::atomic<u32> m_background_queued{ 0 };
+
+		/**
+		 * @brief Number of background jobs that are running.
+		 */
+		std::atomic<u32> m_background_running{ 0 };
+
+		/**
+		 * @brief Most background jobs that may run at once, which leaves a
+		 * worker free for frame work whenever there is more than one.
+		 */
+		u32 m_background_limit{ 1 };
+
+		/**
+		 * @brief Jobs whose dependency had not finished when they were taken.
+		 * They are queued again once it does, rather than spinning on it.
+		 */
+		std::vector<Job*> m_parked;
+
+		/**
+		 * @brief Guards the parked jobs.
+		 */
+		std::mutex m_parked_mutex;
+
+		/**
+		 * @brief Finished jobs, reused so that steady frames do not allocate.
+		 */
+		std::vector<Job*> m_free_jobs;
+
+		/**
+		 * @brief Guards the finished jobs, since any worker may finish a job.
+		 */
+		std::mutex m_free_mutex;
+
+		/**
+		 * @brief Number of jobs that are queued and have not been taken yet.
+		 */
+		std::atomic<u32> m_queued{ 0 };
+
+		/**
+		 * @brief Number of workers that are asleep waiting for jobs.
+		 */
+		std::atomic<u32> m_sleeping{ 0 };
+
+		/**
+		 * @brief Set to `false` to stop the workers.
+		 */
+		std::atomic<bool> m_running{ true };
+
+		/**
+		 * @brief Guards workers going to sleep.
+		 */
+		std::mutex m_sleep_mutex;
+
+		/**
+		 * @brief Wakes sleeping workers when jobs are submitted.
+		 */
+		std::condition_variable m_sleep_cv;
+
+		/**
+		 * @returns A job that is not in use, taken from the finished jobs if there are any.
+		 */
+		Job* acquireJob();
+
+		/**
+		 * @brief Hands a finished job back to be reused.
+		 * @param job The job, which must not be queued.
+		 */
+		void releaseJob(Job *job);
+
+		/**
+		 * @brief Main loop of workers 1 and up.
+		 * @param workerIdx The index of the worker.
+		 */
+		void workerLoop(u32 workerIdx);
+
+		/**
+		 * @brief Wakes a sleeping worker, if there is one.
+		 */
+		void notifyWorker();
+
+		/**
+		 * @brief Queues a job and wakes a sleeping worker.
+		 * @param job The job to queue.
+		 */
+		void enqueue(Job *job);
+
+		/**
+		 * @returns `true` if a background job is queued and another may start.
+		 */
+		bool hasBackgroundJob() const;
+
+		/**
+		 * @brief Takes a job from the queue of the calling worker, otherwise
+		 * steals one from another worker.
+		 * @returns A job to run, or `nullptr` if no job was found.
+		 */
+		Job* findJob();
+
+		/**
+		 * @brief Takes a background job, unless as many are running as are allowed.
+		 * @returns A job to run, or `nullptr` if no job may start.
+		 */
+		Job* findBackgroundJob();
+
+		/**
+		 * @brief Runs a background job taken with `findBackgroundJob()`.
+		 * @param job The job to run.
+		 */
+		void executeBackground(Job *job);
+
+		/**
+		 * @brief Runs a job and marks it as finished, unless its dependency
+		 * has not finished yet, in which case it is parked until it has.
+		 * @param job The job to run.
+		 */
+		void execute(Job *job);
+
+		/**
+		 * @brief Parks a job until its dependency finishes.
+		 * @param job The job, which must have a dependency.
+		 * @returns `true` if the job was parked, `false` if the dependency has already finished.
+		 */
+		bool park(Job *job);
+
+		/**
+		 * @brief Queues the jobs that were parked on a counter that just reached zero.
+		 * @param counter The counter, which is only compared and never read.
+		 */
+		void resume(const JobCounter *counter);
+
+	public:
+
+		/**
+		 * @brief Starts the workers. The calling thread becomes worker 0.
+		 * @param workerCount The number of workers, including the calling thread.
+		 */
+		explicit JobSystem(u32 workerCount);
+
+		JobSystem(const JobSystem&) = delete;
+
+		JobSystem& operator=(const JobSystem&) = delete;
+
+		/**
+		 * @brief Destructor for the job system.
+		 */
+		~JobSystem();
+
+		/**
+		 * @brief Stops and joins all workers. Jobs that have not started are dropped.
+		 */
+		void destroy();
+
+		/**
+		 * @brief Submits a job.
+		 * @param function The function to run.
+		 * @param counter [Optional] Counter to add the job to.
+		 * @param dependency [Optional] Counter that must reach zero before the job can start.
+		 */
+		void run(const JobFn &function, JobCounter *counter = nullptr, const JobCounter *dependency = nullptr);
+
+		/**
+		 * @brief Submits a long job that no frame waits on. Only workers 1 and
+		 * up run it, never a thread inside `wait()`, so it cannot stall a frame.
+		 * Runs straight away if there are no other workers.
+		 * @param function The function to run.
+		 * @param counter [Optional] Counter to add the job to.
+		 */
+		void runBackground(const JobFn &function, JobCounter *counter = nullptr);
+
+		/**
+		 * @brief Splits the range [0, count) into batches and submits a job for each batch.
+		 * The function is not copied, so it must live until the counter reaches zero.
+		 * @param count The number of items.
+		 * @param batchSize The number of items in each batch.
+		 * @param function The function to run for each batch.
+		 * @param counter Counter to add the jobs to.
+		 */
+		void parallelFor(u32 count, u32 batchSize, const RangeFn &function, JobCounter &counter);
+
+		/**
+		 * @brief Waits until all jobs of the counter have finished, running
+		 * other jobs in the meantime rather than blocking. Background jobs are
+		 * left to the workers.
+		 * @param counter The counter to wait on.
+		 */
+		void wait(const JobCounter &counter);
+
+		/**
+		 * @returns The number of workers, including the thread that created the job system.
+		 */
+		const u32 getWorkerCount() const {
+			return to_u32(m_queues.size());
+		}
+
+		/**
+		 * @returns The index of the worker running on the calling thread,
+		 * or `u32_max` if the calling thread is not a worker.
+		 */
+		static u32 getWorkerIndex();
+
+	};
+
+} // namespace carbon
+
+#endif // CORE_JOB_SYSTEM_HPP
@@ -4,11 +4,15 @@
 
 #include "logical_device.hpp"
 
+#include "deletion_queue.hpp"
+#include "host_allocator.hpp"
 #include "instance.hpp"
+#include "memory_allocator.hpp"
 #include "physical_device.hpp"
 
 #include "carbon/common/logger.hpp"
 #include "carbon/display/surface.hpp"
+#include "carbon/engine/config.hpp"
 
 #include <set>
 
@@ -34,12 +38,14 @@ namespace carbon {
 				m_queue_family_indices.graphicsFamily = i;
 			}
 
-			// check for surface support
-			VkBool32 presentSupport{ false };
-			vkGetPhysicalDeviceSurfaceSupportKHR(m_physical_device->getHandle(), i, m_surface->getHandle(), &presentSupport);
+			// check for surface support (nothing to present to when headless)
+			if (m_surface) {
+				VkBool32 presentSupport{ false };
+				vkGetPhysicalDeviceSurfaceSupportKHR(m_physical_device->getHandle(), i, m_surface->getHandle(), &presentSupport);
 
-			if (queueFam.queueCount > 0 && presentSupport) {
-				m_queue_family_indices.presentFamily = i;
+				if (queueFam.queueCount > 0 && presentSupport) {
+					m_queue_family_indices.presentFamily = i;
+				}
 			}
 
 			// check for compute support
@@ -53,7 +59,7 @@ namespace carbon {
 			}
 
 			// check if all families are supported
-			if (m_queue_family_indices.hasFamilies()) {
+			if (m_queue_family_indices.hasFamilies(m_surface != nullptr)) {
 				break;
 			}
 
@@ -63,6 +69,28 @@ namespace carbon {
 		if (m_queue_family_indices.graphicsFamily == u32_max) {
 			CARBON_LOG_FATAL(carbon::log::To::File, "No graphics family support.");
 		}
+
+		// a family that can only copy is usually a DMA engine, which streams
+		// data without taking time from rendering
+		m_queue_family_indices.transferFamily = m_queue_family_indices.graphicsFamily;
+
+		for (u32 j = 0; j < numQueueFamilies; j++) {
+			const VkQueueFlags flags = queueFamilies[j].queueFlags;
+
+			if (queueFamilies[j].queueCount > 0 && (flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+				m_queue_family_indices.transferFamily = j;
+				break;
+			}
+		}
+
+		// otherwise a second graphics queue still keeps uploads out of the way of drawing
+		if (m_queue_family_indices.transferFamily == m_queue_family_indices.graphicsFamily && queueFamilies[m_queue_family_indices.graphicsFamily].queueCount > 1) {
+			m_transfer_queue_index = 1;
+		}
+
+		if (m_surface && m_queue_family_indices.presentFamily == u32_max) {
+			CARBON_LOG_FATAL(carbon::log::To::File, "No present family support.");
+		}
 	}
 
 
@@ -70,28 +98,36 @@ namespace carbon {
 		// unique indices for queue families
 		std::set<u32> uniqueQueueFamilies = {
 			m_queue_family_indices.graphicsFamily,
-			m_queue_family_indices.presentFamily
+			m_queue_family_indices.transferFamily
 		};
 
+		// headless devices have no presentation family
+		if (m_queue_family_indices.presentFamily != u32_max) {
+			uniqueQueueFamilies.insert(m_queue_family_indices.presentFamily);
+		}
+
 		// createinfo for each queue family
 		std::vector<VkDeviceQueueCreateInfo> createInfoQueues;
 
-		// priority given to this queue
-		float queuePriority{ 1.0f };
+		// priority given to the queues, with a second graphics queue for uploads
+		float queuePriorities[]{ 1.0f, 1.0f };
 
 		for (const u32 queueFam : uniqueQueueFamilies) {
 			VkDeviceQueueCreateInfo queueCreateInfo;
 			initStruct(queueCreateInfo, VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO);
 
 			queueCreateInfo.queueFamilyIndex = queueFam;
-			queueCreateInfo.queueCount = 1;
-			queueCreateInfo.pQueuePriorities = &queuePriority;
+			queueCreateInfo.queueCount = queueFam == m_queue_family_indices.transferFamily ? m_transfer_queue_index + 1 : 1;
+			queueCreateInfo.pQueuePriorities = queuePriorities;
 			createInfoQueues.push_back(queueCreateInfo);
 		}
 
 		// specify device features to use
 		VkPhysicalDeviceFeatures deviceFeats{};
-		deviceFeats.samplerAnisotropy = VK_TRUE;
+		m_anisotropy = m_physical_device->getFeatures().samplerAnisotropy == VK_TRUE;
+
+		// samplers fall back to plain filtering on devices without it
+		deviceFeats.samplerAnisotropy = m_anisotropy ? VK_TRUE : VK_FALSE;
 		deviceFeats.sampleRateShading = VK_TRUE;
 
 		std::vector<const char*> deviceExtensions{ m_physical_device->getDeviceExtensions() };
@@ -101,6 +137,24 @@ namespace carbon {
 		VkDeviceCreateInfo createInfo;
 		initStruct(createInfo, VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO);
 
+		// only the features needed for bindless arrays of textures and buffers
+		VkPhysicalDeviceDescriptorIndexingFeatures indexingFeats;
+		initStruct(indexingFeats, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES);
+
+		m_bindless = config::ENABLE_BINDLESS && m_physical_device->supportsBindless();
+
+		if (m_bindless) {
+			indexingFeats.runtimeDescriptorArray = VK_TRUE;
+			indexingFeats.descriptorBindingPartiallyBound = VK_TRUE;
+			indexingFeats.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+			indexingFeats.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+			indexingFeats.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+			indexingFeats.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+			indexingFeats.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+
+			createInfo.pNext = &indexingFeats;
+		}
+
 		createInfo.queueCreateInfoCount = to_u32(createInfoQueues.size());
 		createInfo.pQueueCreateInfos = createInfoQueues.data();
 
@@ -118,13 +172,18 @@ namespace carbon {
 		}
 
 		// attempt to create logical device
-		if (vkCreateDevice(m_physical_device->getHandle(), &createInfo, nullptr, &m_device) != VK_SUCCESS) {
+		if (vkCreateDevice(m_physical_device->getHandle(), &createInfo, HostAllocator::get(VK_OBJECT_TYPE_DEVICE), &m_device) != VK_SUCCESS) {
 			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to create logical device.");
 		}
 
 		// create single graphics queue from device
 		vkGetDeviceQueue(m_device, m_queue_family_indices.graphicsFamily, 0, &m_graphics_queue);
-		vkGetDeviceQueue(m_device, m_queue_family_indices.presentFamily, 0, &m_present_queue);
+
+		if (m_queue_family_indices.presentFamily != u32_max) {
+			vkGetDeviceQueue(m_device, m_queue_family_indices.presentFamily, 0, &m_present_queue);
+		}
+
+		vkGetDeviceQueue(m_device, m_queue_family_indices.transferFamily, m_transfer_queue_index, &m_transfer_queue);
 	}
 
 	LogicalDevice::LogicalDevice(Instance *instance, PhysicalDevice *physicalDevice, Surface *surface)
@@ -135,6 +194,9 @@ namespace carbon {
 		// find queue families and then create the logical device
 		findQueueFamilyIndices();
 		createDevice();
+
+		m_allocator = new MemoryAllocator(this);
+		m_deletion_queue = new DeletionQueue(this);
 	}
 
 
@@ -151,8 +213,16 @@ namespace carbon {
 		// wait for asynchronous drawing commands to complete
 		vkDeviceWaitIdle(m_device);
 
+		// queued objects give their memory back to the allocator
+		delete m_deletion_queue;
+		m_deletion_queue = nullptr;
+
+		// memory has to be freed before the device that owns it
+		delete m_allocator;
+		m_allocator = nullptr;
+
 		// destroy and reset
-		vkDestroyDevice(m_device, nullptr);
+		vkDestroyDevice(m_device, HostAllocator::get(VK_OBJECT_TYPE_DEVICE));
 		m_device = VK_NULL_HANDLE;
 
 		// m_surface is member class and thus will be destroyed
@@ -15,6 +15,8 @@ namespace carbon {
 	class Instance;
 	class PhysicalDevice;
 	class Surface;
+	class MemoryAllocator;
+	class DeletionQueue;
 
 	/**
 	 * @brief A wrapper for the Vulkan logical device that represents
@@ -35,10 +37,11 @@ namespace carbon {
 			u32 transferFamily{ u32_max };
 
 			/**
+			 * @param needsPresent `true` if a presentation family is required.
 			 * @returns `true` if all graphics families are present, `false` otherwise.
 			 */
-			bool hasFamilies() {
-				return graphicsFamily != u32_max && presentFamily != u32_max && computeFamily != u32_max && transferFamily != u32_max;
+			bool hasFamilies(bool needsPresent = true) {
+				return graphicsFamily != u32_max && (presentFamily != u32_max || !needsPresent) && computeFamily != u32_max && transferFamily != u32_max;
 			}
 		};
 
@@ -53,7 +56,7 @@ namespace carbon {
 		const class PhysicalDevice *m_physical_device;
 
 		/**
-		 * @brief Surface to use for displaying.
+		 * @brief Surface to use for displaying, or `nullptr` if headless.
 		 */
 		const class Surface *m_surface;
 
@@ -72,12 +75,44 @@ namespace carbon {
 		 */
 		VkQueue m_present_queue{ VK_NULL_HANDLE };
 
+		/**
+		 * @brief Handle on the queue that uploads are submitted to.
+		 */
+		VkQueue m_transfer_queue{ VK_NULL_HANDLE };
+
+		/**
+		 * @brief Index of the transfer queue within its family, which is 1 when
+		 * it is a second queue of the graphics family.
+		 */
+		u32 m_transfer_queue_index{ 0 };
+
 		/**
 		 * @brief Keep track of indices for different queue families (graphics,
 		 * present, compute and transfer).
 		 */
 		QueueFamilyIndices m_queue_family_indices;
 
+		/**
+		 * @brief `true` if the descriptor indexing features needed for bindless
+		 * resources were enabled, `false` otherwise.
+		 */
+		bool m_bindless{ false };
+
+		/**
+		 * @brief `true` if samplers may filter anisotropically, `false` otherwise.
+		 */
+		bool m_anisotropy{ false };
+
+		/**
+		 * @brief Hands out the device memory of buffers and images.
+		 */
+		class MemoryAllocator *m_allocator{ nullptr };
+
+		/**
+		 * @brief Holds on to objects until no frame in flight can be using them.
+		 */
+		class DeletionQueue *m_deletion_queue{ nullptr };
+
 		/**
 		 * @brief Finds the queue family indices.
 		 */
@@ -94,7 +129,8 @@ namespace carbon {
 		 * @brief Initialize and create a logical device.
 		 * @param instance The owning instance.
 		 * @param physicalDevice The physical device to use.
-		 * @param surface The surface to use for rendering to the window.
+		 * @param surface The surface to use for rendering to the window, or
+		 * `nullptr` if the device will not present to a window.
 		 */
 		explicit LogicalDevice(
 			class Instance *instance,
@@ -119,6 +155,27 @@ namespace carbon {
 			return m_device;
 		}
 
+		/**
+		 * @returns The physical device the logical device was created from.
+		 */
+		const class PhysicalDevice* getPhysicalDevice() const {
+			return m_physical_device;
+		}
+
+		/**
+		 * @returns The allocator to take device memory from.
+		 */
+		class MemoryAllocator& getMemoryAllocator() const {
+			return *m_allocator;
+		}
+
+		/**
+		 * @returns The queue to hand objects that are no longer needed to.
+		 */
+		class DeletionQueue& getDeletionQueue() const {
+			return *m_deletion_queue;
+		}
+
 		/**
 		 * @returns The graphics queue.
 		 */
@@ -127,12 +184,49 @@ namespace carbon {
 		}
 
 		/**
-		 * @returns The presentation queue.
+		 * @returns The queue that uploads are submitted to, which is the
+		 * graphics queue if the device has no other queue that can copy.
+		 */
+		const VkQueue& getTransferQueue() const {
+			return m_transfer_queue;
+		}
+
+		/**
+		 * @returns `true` if uploads have a queue of their own, `false` if
+		 * they share the graphics queue.
+		 */
+		bool hasTransferQueue() const {
+			return m_transfer_queue != m_graphics_queue;
+		}
+
+		/**
+		 * @returns `true` if the device has a presentation queue, `false` otherwise.
+		 */
+		bool hasPresentQueue() const {
+			return m_present_queue != VK_NULL_HANDLE;
+		}
+
+		/**
+		 * @returns The presentation queue, or `VK_NULL_HANDLE` if headless.
 		 */
 		const VkQueue& getPresentQueue() const {
 			return m_present_queue;
 		}
 
+		/**
+		 * @returns `true` if bindless resources can be used, `false` otherwise.
+		 */
+		bool isBindlessEnabled() const {
+			return m_bindless;
+		}
+
+		/**
+		 * @returns `true` if samplers may filter anisotropically, `false` otherwise.
+		 */
+		bool isAnisotropyEnabled() const {
+			return m_anisotropy;
+		}
+
 		/**
 		 * @returns The graphics family.
 		 */
@@ -0,0 +1,557 @@
+// file      : carbon/core/memory_allocator.cpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#include "memory_allocator.hpp"
+
+#include "host_allocator.hpp"
+#include "logical_device.hpp"
+#include "physical_device.hpp"
+#include "carbon/common/logger.hpp"
+#include "carbon/common/tlsf.hpp"
+#include "carbon/engine/config.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace carbon {
+
+	/**
+	 * @returns The number of set bits in the flags.
+	 */
+	static u32 countBits(VkFlags flags) {
+		u32 count{ 0 };
+
+		for (; flags != 0; flags &= flags - 1) {
+			count++;
+		}
+
+		return count;
+	}
+
+
+	VkDeviceSize MemoryAllocator::getBlockSize(u32 memoryType) const {
+		const VkPhysicalDeviceMemoryProperties &props = m_physical_device->getMemoryProperties();
+		const VkDeviceSize heapSize = props.memoryHeaps[props.memoryTypes[memoryType].heapIndex].size;
+
+		// small heaps (such as the host-visible part of VRAM) would be used up by a few blocks
+		return std::min<VkDeviceSize>(config::MEMORY_BLOCK_SIZE, heapSize / 8);
+	}
+
+
+	VkDeviceSize MemoryAllocator::getAlignment(u32 memoryType, const VkMemoryRequirements &reqs) const {
+		const VkMemoryPropertyFlags flags = m_physical_device->getMemoryProperties().memoryTypes[memoryType].propertyFlags;
+		VkDeviceSize alignment = std::max<VkDeviceSize>(reqs.alignment, 1);
+
+		// flushes cover whole atoms, which must not spill into a neighbour
+		if ((flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+			alignment = std::max(alignment, m_physical_device->getProperties().limits.nonCoherentAtomSize);
+		}
+
+		return alignment;
+	}
+
+
+	u32 MemoryAllocator::getHeapIndex(u32 memoryType) const {
+		return m_physical_device->getMemoryProperties().memoryTypes[memoryType].heapIndex;
+	}
+
+
+	VkDeviceMemory MemoryAllocator::allocateMemory(u32 memoryType, VkDeviceSize size, u8 *&mapped) {
+		VkDevice device = m_logical_device->getHandle();
+
+		if (m_device_allocations >= m_physical_device->getProperties().limits.maxMemoryAllocationCount) {
+			CARBON_LOG_ERROR(carbon::log::To::File, "Reached the limit on the number of device memory allocations.");
+			return VK_NULL_HANDLE;
+		}
+
+		// going over budget still works, but may page to system memory or fail later
+		const u32 heap = getHeapIndex(memoryType);
+		const MemoryBudget &budget = m_budget[heap];
+		const VkDeviceSize usage = budget.usage + m_heap_usage[heap] - m_budget_usage[heap];
+
+		if (budget.budget > 0 && usage + size > budget.budget && !(m_over_budget & (1U << heap))) {
+			CARBON_LOG_WARN(carbon::log::To::File, fmt::format("Memory heap {} is over budget ({} of {} bytes).", heap, usage + size, budget.budget));
+			m_over_budget |= 1U << heap;
+		}
+
+		VkMemoryAllocateInfo allocInfo;
+		initStruct(allocInfo, VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO);
+
+		allocInfo.allocationSize = size;
+		allocInfo.memoryTypeIndex = memoryType;
+
+		VkDeviceMemory memory{ VK_NULL_HANDLE };
+
+		if (vkAllocateMemory(device, &allocInfo, HostAllocator::get(VK_OBJECT_TYPE_DEVICE_MEMORY), &memory) != VK_SUCCESS) {
+			CARBON_LOG_ERROR(carbon::log::To::File, fmt::format("Failed to allocate {} bytes of device memory.", size));
+			return VK_NULL_HANDLE;
+		}
+
+		m_device_allocations++;
+		m_heap_usage[heap] += size;
+		mapped = nullptr;
+
+		// memory can only be mapped once, so host-visible memory is mapped for good
+		const VkMemoryPropertyFlags flags = m_physical_device->getMemoryProperties().memoryTypes[memoryType].propertyFlags;
+
+		if (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+			void *data{ nullptr };
+
+			if (vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS) {
+				CARBON_LOG_ERROR(carbon::log::To::File, "Failed to map device memory.");
+			}
+
+			mapped = static_cast<u8*>(data);
+		}
+
+		return memory;
+	}
+
+
+	void MemoryAllocator::freeMemory(VkDeviceMemory memory, VkDeviceSize size, u32 memoryType, bool mapped) {
+		VkDevice device = m_logical_device->getHandle();
+
+		if (mapped) {
+			vkUnmapMemory(device, memory);
+		}
+
+		vkFreeMemory(device, memory, HostAllocator::get(VK_OBJECT_TYPE_DEVICE_MEMORY));
+		m_device_allocations--;
+		m_heap_usage[getHeapIndex(memoryType)] -= size;
+
+		// flushing memory that no longer exists is not allowed
+		if (!m_dirty.empty()) {
+			m_dirty.erase(std::remove_if(m_dirty.begin(), m_dirty.end(), [memory](const VkMappedMemoryRange &range) {
+				return range.memory == memory;
+			}), m_dirty.end());
+		}
+	}
+
+
+	VkMappedMemoryRange MemoryAllocator::getFlushRange(const MemoryAllocation &allocation, VkDeviceSize offset, VkDeviceSize size) const {
+		// the allocation starts and ends on an atom, so rounding out stays inside it
+		const VkDeviceSize atom = m_physical_device->getProperties().limits.nonCoherentAtomSize;
+		const VkDeviceSize end = size == VK_WHOLE_SIZE ? allocation.size : std::min(allocation.size, offset + size);
+
+		VkMappedMemoryRange range;
+		initStruct(range, VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE);
+
+		range.memory = allocation.memory;
+		range.offset = allocation.offset + (offset / atom) * atom;
+		range.size = allocation.offset + ((end + atom - 1) / atom) * atom - range.offset;
+
+		return range;
+	}
+
+
+	MemoryAllocator::MemoryAllocator(LogicalDevice *logiDevice)
+		: m_logical_device(logiDevice)
+	{
+		assert(m_logical_device && "Logical device must not be null.");
+		m_physical_device = m_logical_device->getPhysicalDevice();
+
+		updateBudget();
+	}
+
+
+	MemoryAllocator::~MemoryAllocator() {
+		destroy();
+	}
+
+
+	void MemoryAllocator::destroy() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (m_allocation_count > 0) {
+			CARBON_LOG_WARN(carbon::log::To::File, fmt::format("{} device memory allocations were never freed.", m_allocation_count));
+		}
+
+		for (u32 type = 0; type < VK_MAX_MEMORY_TYPES; type++) {
+			for (auto &blocks : m_blocks[type]) {
+				for (auto &block : blocks) {
+					if (block.memory != VK_NULL_HANDLE) {
+						freeMemory(block.memory, block.ranges->getSize(), type, block.mapped != nullptr);
+						delete block.ranges;
+					}
+				}
+
+				blocks.clear();
+			}
+		}
+	}
+
+
+	u32 MemoryAllocator::findMemoryType(u32 typeFilter, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred) const {
+		const VkPhysicalDeviceMemoryProperties &props = m_physical_device->getMemoryProperties();
+
+		u32 best{ u32_max };
+		u32 bestScore{ 0 };
+
+		for (u32 i = 0; i < props.memoryTypeCount; i++) {
+			const VkMemoryPropertyFlags flags = props.memoryTypes[i].propertyFlags;
+
+			if (!(typeFilter & (1U << i)) || (flags & required) != required) {
+				continue;
+			}
+
+			// types are ordered by performance, so the first with the most preferred properties wins
+			const u32 score = countBits(flags & preferred) + 1;
+
+			if (score > bestScore) {
+				best = i;
+				bestScore = score;
+			}
+		}
+
+		return best;
+	}
+
+
+	MemoryAllocation MemoryAllocator::allocate(
+		const VkMemoryRequirements &reqs,
+		VkMemoryPropertyFlags required,
+		VkMemoryPropertyFlags preferred,
+		bool linear
+	) {
+		MemoryAllocation alloc;
+		alloc.memoryType = findMemoryType(reqs.memoryTypeBits, required, preferred);
+		alloc.linear = linear;
+
+		if (alloc.memoryType == u32_max) {
+			CARBON_LOG_ERROR(carbon::log::To::File, "Failed to find a suitable memory type.");
+			return {};
+		}
+
+		const VkDeviceSize alignment = getAlignment(alloc.memoryType, reqs);
+		const VkDeviceSize size = (reqs.size + alignment - 1) & ~(alignment - 1);
+		alloc.size = size;
+
+		const VkDeviceSize blockSize = getBlockSize(alloc.memoryType);
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		// large resources would leave most of a block unusable, so get their own memory
+		if (size > blockSize / 2) {
+			u8 *mapped{ nullptr };
+			alloc.memory = allocateMemory(alloc.memoryType, size, mapped);
+
+			if (alloc.memory == VK_NULL_HANDLE) {
+				return {};
+			}
+
+			alloc.mapped = mapped;
+			m_allocation_count++;
+			m_dedicated_count++;
+			m_dedicated_size += size;
+
+			return alloc;
+		}
+
+		std::vector<Block> &blocks = m_blocks[alloc.memoryType][linear ? 1 : 0];
+		u32 emptySlot{ u32_max };
+
+		for (u32 i = 0; i < blocks.size(); i++) {
+			Block &block = blocks[i];
+
+			if (block.memory == VK_NULL_HANDLE) {
+				emptySlot = std::min(emptySlot, i);
+				continue;
+			}
+
+			alloc.range = block.ranges->allocate(size, alignment, alloc.offset);
+
+			if (alloc.range != Tlsf::NONE) {
+				alloc.block = i;
+				break;
+			}
+		}
+
+		// every block is full
+		if (alloc.range == Tlsf::NONE) {
+			Block block;
+			block.memory = allocateMemory(alloc.memoryType, blockSize, block.mapped);
+
+			if (block.memory == VK_NULL_HANDLE) {
+				return {};
+			}
+
+			block.ranges = new Tlsf(blockSize);
+			alloc.range = block.ranges->allocate(size, alignment, alloc.offset);
+
+			if (emptySlot == u32_max) {
+				emptySlot = to_u32(blocks.size());
+				blocks.emplace_back();
+			}
+
+			blocks[emptySlot] = block;
+			alloc.block = emptySlot;
+		}
+
+		const Block &block = blocks[alloc.block];
+
+		alloc.memory = block.memory;
+		alloc.mapped = block.mapped ? block.mapped + alloc.offset : nullptr;
+		m_allocation_count++;
+
+		return alloc;
+	}
+
+
+	void MemoryAllocator::free(MemoryAllocation &allocation) {
+		if (!allocation.isValid()) {
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_allocation_count--;
+
+		if (allocation.block == u32_max) {
+			freeMemory(allocation.memory, allocation.size, allocation.memoryType, allocation.mapped != nullptr);
+			m_dedicated_count--;
+			m_dedicated_size -= allocation.size;
+
+			allocation = {};
+			return;
+		}
+
+		std::vector<Block> &blocks = m_blocks[allocation.memoryType][allocation.linear ? 1 : 0];
+		Block &block = blocks[allocation.block];
+
+		block.ranges->free(allocation.range);
+
+		// give empty blocks back, but keep one around so allocating and freeing in a loop does not thrash
+		if (block.ranges->isEmpty()) {
+			const auto live = std::count_if(blocks.begin(), blocks.end(), [](const Block &b) {
+				return b.memory != VK_NULL_HANDLE;
+			});
+
+			if (live > 1) {
+				freeMemory(block.memory, block.ranges->getSize(), allocation.memoryType, block.mapped != nullptr);
+				delete block.ranges;
+				block = {};
+			}
+		}
+
+		allocation = {};
+	}
+
+
+	bool MemoryAllocator::flush(const MemoryAllocation &allocation, VkDeviceSize offset, VkDeviceSize size) {
+		assert(allocation.isValid() && "Cannot flush memory that was never allocated.");
+
+		if (isCoherent(allocation)) {
+			return true;
+		}
+
+		const VkMappedMemoryRange range = getFlushRange(allocation, offset, size);
+		return vkFlushMappedMemoryRanges(m_logical_device->getHandle(), 1, &range) == VK_SUCCESS;
+	}
+
+
+	bool MemoryAllocator::isCoherent(const MemoryAllocation &allocation) const {
+		const VkMemoryPropertyFlags flags = m_physical_device->getMemoryProperties().memoryTypes[allocation.memoryType].propertyFlags;
+		return (flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+	}
+
+
+	void MemoryAllocator::markDirty(const MemoryAllocation &allocation, VkDeviceSize offset, VkDeviceSize size) {
+		assert(allocation.isValid() && "Cannot flush memory that was never allocated.");
+
+		if (isCoherent(allocation)) {
+			return;
+		}
+
+		const VkMappedMemoryRange range = getFlushRange(allocation, offset, size);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_dirty.push_back(range);
+	}
+
+
+	bool MemoryAllocator::flushDirty() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (m_dirty.empty()) {
+			return true;
+		}
+
+		// neighbouring writes (such as consecutive elements of an array) become one range
+		std::sort(m_dirty.begin(), m_dirty.end(), [](const VkMappedMemoryRange &a, const VkMappedMemoryRange &b) {
+			return a.memory != b.memory ? a.memory < b.memory : a.offset < b.offset;
+		});
+
+		size_t count{ 0 };
+
+		for (size_t i = 1; i < m_dirty.size(); i++) {
+			VkMappedMemoryRange &last = m_dirty[count];
+			const VkMappedMemoryRange &range = m_dirty[i];
+
+			if (range.memory == last.memory && range.offset <= last.offset + last.size) {
+				last.size = std::max(last.offset + last.size, range.offset + range.size) - last.offset;
+			} else {
+				m_dirty[++count] = range;
+			}
+		}
+
+		const bool flushed = vkFlushMappedMemoryRanges(m_logical_device->getHandle(), to_u32(count + 1), m_dirty.data()) == VK_SUCCESS;
+
+		// keeps its capacity, so steady frames do not allocate
+		m_dirty.clear();
+
+		return flushed;
+	}
+
+
+	MemoryStats MemoryAllocator::getStats() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		MemoryStats stats;
+		stats.dedicatedCount = m_dedicated_count;
+		stats.allocationCount = m_allocation_count;
+		stats.reserved = m_dedicated_size;
+		stats.used = m_dedicated_size;
+
+		for (const auto &kinds : m_blocks) {
+			for (const auto &blocks : kinds) {
+				for (const auto &block : blocks) {
+					if (block.memory == VK_NULL_HANDLE) {
+						continue;
+					}
+
+					stats.blockCount++;
+					stats.reserved += block.ranges->getSize();
+					stats.used += block.ranges->getUsed();
+					stats.freeRangeCount += block.ranges->getFreeCount();
+					stats.largestFree = std::max(stats.largestFree, block.ranges->getLargestFree());
+				}
+			}
+		}
+
+		const VkDeviceSize freeBytes = stats.reserved - stats.used;
+
+		if (freeBytes > 0) {
+			stats.fragmentation = 1.0f - static_cast<f32>(stats.largestFree) / static_cast<f32>(freeBytes);
+		}
+
+		return stats;
+	}
+
+
+	void MemoryAllocator::updateBudget() {
+		const VkPhysicalDeviceMemoryProperties &props = m_physical_device->getMemoryProperties();
+
+		VkPhysicalDeviceMemoryBudgetPropertiesEXT reported;
+		const bool hasBudget = m_physical_device->queryMemoryBudget(reported);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		for (u32 i = 0; i < props.memoryHeapCount; i++) {
+			MemoryBudget &budget = m_budget[i];
+
+			if (hasBudget) {
+				budget.usage = reported.heapUsage[i];
+				budget.budget = reported.heapBudget[i];
+			} else {
+				// other processes and the driver need some of the heap too
+				budget.usage = m_heap_usage[i];
+				budget.budget = props.memoryHeaps[i].size / 10 * 8;
+			}
+
+			m_budget_usage[i] = m_heap_usage[i];
+
+			// warn again if the heap goes back over budget later
+			if (budget.usage < budget.budget) {
+				m_over_budget &= ~(1U << i);
+			}
+		}
+	}
+
+
+	std::array<MemoryBudget, VK_MAX_MEMORY_HEAPS> MemoryAllocator::getBudget() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::array<MemoryBudget, VK_MAX_MEMORY_HEAPS> budgets{ m_budget };
+
+		// the driver only sees allocations made before it was last asked
+		for (u32 i = 0; i < VK_MAX_MEMORY_HEAPS; i++) {
+			budgets[i].usage = budgets[i].usage + m_heap_usage[i] - m_budget_usage[i];
+		}
+
+		return budgets;
+	}
+
+
+	f32 MemoryAllocator::getBlockOccupancy(const MemoryAllocation &allocation) {
+		if (!allocation.isValid() || allocation.block == u32_max) {
+			return 1.0f;
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		const Tlsf *ranges = m_blocks[allocation.memoryType][allocation.linear ? 1 : 0][allocation.block].ranges;
+
+		return static_cast<f32>(ranges->getUsed()) / static_cast<f32>(ranges->getSize());
+	}
+
+
+	MemoryAllocation MemoryAllocator::reallocate(const MemoryAllocation &allocation, const VkMemoryRequirements &reqs) {
+		if (!allocation.isValid() || allocation.block == u32_max) {
+			return {};
+		}
+
+		const VkDeviceSize alignment = getAlignment(allocation.memoryType, reqs);
+		const VkDeviceSize size = (reqs.size + alignment - 1) & ~(alignment - 1);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::vector<Block> &blocks = m_blocks[allocation.memoryType][allocation.linear ? 1 : 0];
+
+		const u64 sourceUsed = blocks[allocation.block].ranges->getUsed();
+
+		MemoryAllocation alloc;
+		alloc.memoryType = allocation.memoryType;
+		alloc.linear = allocation.linear;
+		alloc.size = size;
+
+		// fullest blocks first, so resources gather in as few blocks as possible
+		u32 best{ u32_max };
+		u64 bestUsed{ 0 };
+
+		for (u32 i = 0; i < blocks.size(); i++) {
+			const Block &block = blocks[i];
+
+			if (i == allocation.block || block.memory == VK_NULL_HANDLE) {
+				continue;
+			}
+
+			const u64 used = block.ranges->getUsed();
+
+			// moving into a sparser block would only swap which block is sparse
+			if (used < sourceUsed || block.ranges->getLargestFree() < size) {
+				continue;
+			}
+
+			if (best == u32_max || used > bestUsed) {
+				best = i;
+				bestUsed = used;
+			}
+		}
+
+		if (best == u32_max) {
+			return {};
+		}
+
+		const Block &block = blocks[best];
+		alloc.range = block.ranges->allocate(size, alignment, alloc.offset);
+
+		// the largest free range may still be too small once aligned
+		if (alloc.range == Tlsf::NONE) {
+			return {};
+		}
+
+		alloc.block = best;
+		alloc.memory = block.memory;
+		alloc.mapped = block.mapped ? block.mapped + alloc.offset : nullptr;
+		m_allocation_count++;
+
+		return alloc;
+	}
+
+} // namespace carbon
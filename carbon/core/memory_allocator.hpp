@@ -0,0 +1,354 @@
+// file      : carbon/core/memory_allocator.hpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#pragma once
+
+#ifndef CORE_MEMORY_ALLOCATOR_HPP
+#define CORE_MEMORY_ALLOCATOR_HPP
+
+#include "carbon/backend.hpp"
+
+#include <array>
+#include <mutex>
+#include <vector>
+
+namespace carbon {
+
+	// forward-declare classes that would result in circular dependency
+	class LogicalDevice;
+	class PhysicalDevice;
+	class Tlsf;
+
+	/**
+	 * @brief A range of device memory handed out by the memory allocator.
+	 * Resources are bound to `memory` at `offset`.
+	 */
+	struct MemoryAllocation {
+		VkDeviceMemory memory{ VK_NULL_HANDLE };
+		VkDeviceSize offset{ 0 };
+		VkDeviceSize size{ 0 };
+
+		/**
+		 * @brief Start of the range in host memory, or `nullptr` if the memory is not host visible.
+		 */
+		void *mapped{ nullptr };
+
+		u32 memoryType{ u32_max };
+		u32 block{ u32_max };
+		u32 range{ u32_max };
+		bool linear{ true };
+
+		/**
+		 * @returns `true` if the allocation holds memory, `false` otherwise.
+		 */
+		bool isValid() const {
+			return memory != VK_NULL_HANDLE;
+		}
+	};
+
+	/**
+	 * @brief How much device memory the allocator holds and how well it is used.
+	 */
+	struct MemoryStats {
+		u32 blockCount{ 0 };
+		u32 dedicatedCount{ 0 };
+		u32 allocationCount{ 0 };
+
+		/**
+		 * @brief Bytes of device memory held, in blocks and dedicated allocations.
+		 */
+		VkDeviceSize reserved{ 0 };
+
+		/**
+		 * @brief Bytes handed out.
+		 */
+		VkDeviceSize used{ 0 };
+
+		/**
+		 * @brief Number of separate free ranges across all blocks.
+		 */
+		u32 freeRangeCount{ 0 };
+
+		/**
+		 * @brief Largest allocation that fits in an existing block.
+		 */
+		VkDeviceSize largestFree{ 0 };
+
+		/**
+		 * @brief Share of free memory that is not in the largest free range,
+		 * from 0 (one free range) towards 1 (many small ones).
+		 */
+		f32 fragmentation{ 0.0f };
+	};
+
+	/**
+	 * @brief How much of a memory heap is in use and how much may be used.
+	 */
+	struct MemoryBudget {
+		/**
+		 * @brief Bytes of the heap in use. Reported by the driver (across every
+		 * process) if it supports the memory budget extension, otherwise only
+		 * what this allocator holds.
+		 */
+		VkDeviceSize usage{ 0 };
+
+		/**
+		 * @brief Bytes of the heap this process can use before allocations start
+		 * to fail or get slower. Estimated as most of the heap if the driver
+		 * does not report it.
+		 */
+		VkDeviceSize budget{ 0 };
+	};
+
+	/**
+	 * @brief Carves resources out of large blocks of device memory instead of
+	 * allocating memory for each one, since allocations are slow and their
+	 * number is limited by `maxMemoryAllocationCount`. Each block is managed
+	 * with a two-level segregated fit allocator, so allocating and freeing
+	 * take constant time. Buffers and images are kept in separate blocks so
+	 * `bufferImageGranularity` never has to be padded for, and host-visible
+	 * blocks stay mapped. Safe to use from any thread.
+	 */
+	class MemoryAllocator {
+
+	private:
+
+		/**
+		 * @brief A large allocation of device memory that ranges are carved from.
+		 */
+		struct Block {
+			VkDeviceMemory memory{ VK_NULL_HANDLE };
+			class Tlsf *ranges{ nullptr };
+			u8 *mapped{ nullptr };
+		};
+
+		/**
+		 * @brief The logical device to allocate on.
+		 */
+		const class LogicalDevice *m_logical_device;
+
+		/**
+		 * @brief The physical device, for its memory types and limits.
+		 */
+		const class PhysicalDevice *m_physical_device;
+
+		/**
+		 * @brief Guards the blocks and counters.
+		 */
+		std::mutex m_mutex;
+
+		/**
+		 * @brief Blocks of each memory type, for images (0) and buffers (1).
+		 * Freed blocks are left empty so indices held by allocations stay valid.
+		 */
+		std::array<std::array<std::vector<Block>, 2>, VK_MAX_MEMORY_TYPES> m_blocks;
+
+		/**
+		 * @brief Number of ranges handed out.
+		 */
+		u32 m_allocation_count{ 0 };
+
+		/**
+		 * @brief Number of allocations that got their own device memory.
+		 */
+		u32 m_dedicated_count{ 0 };
+
+		/**
+		 * @brief Bytes held by allocations that got their own device memory.
+		 */
+		VkDeviceSize m_dedicated_size{ 0 };
+
+		/**
+		 * @brief Number of live `vkAllocateMemory` calls.
+		 */
+		u32 m_device_allocations{ 0 };
+
+		/**
+		 * @brief Bytes allocated from each heap by this allocator.
+		 */
+		std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> m_heap_usage{};
+
+		/**
+		 * @brief Budget of each heap as of the last `updateBudget()`.
+		 */
+		std::array<MemoryBudget, VK_MAX_MEMORY_HEAPS> m_budget{};
+
+		/**
+		 * @brief Bytes allocated from each heap at the last `updateBudget()`, so
+		 * allocations since can be added to what the driver reported.
+		 */
+		std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> m_budget_usage{};
+
+		/**
+		 * @brief Heaps that have been warned about going over budget.
+		 */
+		u32 m_over_budget{ 0 };
+
+		/**
+		 * @brief Written ranges of non-coherent memory waiting to be flushed.
+		 */
+		std::vector<VkMappedMemoryRange> m_dirty;
+
+		/**
+		 * @returns The size of the blocks of the given memory type.
+		 */
+		VkDeviceSize getBlockSize(u32 memoryType) const;
+
+		/**
+		 * @brief Allocates device memory, mapping it if it is host visible.
+		 * @param memoryType The memory type to allocate from.
+		 * @param size Size (in bytes) of the memory.
+		 * @param mapped Set to the mapped memory, or `nullptr`.
+		 * @returns The memory, or `VK_NULL_HANDLE` if the allocation failed.
+		 */
+		VkDeviceMemory allocateMemory(u32 memoryType, VkDeviceSize size, u8 *&mapped);
+
+		/**
+		 * @brief Unmaps and frees device memory, dropping its dirty ranges.
+		 */
+		void freeMemory(VkDeviceMemory memory, VkDeviceSize size, u32 memoryType, bool mapped);
+
+		/**
+		 * @returns The alignment of a resource with the given requirements in the memory type.
+		 */
+		VkDeviceSize getAlignment(u32 memoryType, const VkMemoryRequirements &reqs) const;
+
+		/**
+		 * @returns The index of the heap of the memory type.
+		 */
+		u32 getHeapIndex(u32 memoryType) const;
+
+		/**
+		 * @brief Rounds part of an allocation out to whole atoms.
+		 * @returns The range of memory to flush.
+		 */
+		VkMappedMemoryRange getFlushRange(const MemoryAllocation &allocation, VkDeviceSize offset, VkDeviceSize size) const;
+
+	public:
+
+		/**
+		 * @brief Creates an allocator without any blocks.
+		 * @param logiDevice The logical device to allocate on.
+		 */
+		explicit MemoryAllocator(class LogicalDevice *logiDevice);
+
+		MemoryAllocator(const MemoryAllocator&) = delete;
+
+		MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+
+		/**
+		 * @brief Destructor for the memory allocator.
+		 */
+		~MemoryAllocator();
+
+		/**
+		 * @brief Frees every block. Every allocation must have been freed.
+		 */
+		void destroy();
+
+		/**
+		 * @brief Finds the memory type allowed by the filter that has all the
+		 * required properties and as many of the preferred ones as possible.
+		 * @param typeFilter Bitmask of the allowed memory types (from `VkMemoryRequirements`).
+		 * @param required The properties the memory type must have.
+		 * @param preferred [Optional] The properties the memory type should have.
+		 * @returns The index of the memory type, or `u32_max` if none is suitable.
+		 */
+		u32 findMemoryType(u32 typeFilter, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred = 0) const;
+
+		/**
+		 * @brief Hands out a range of device memory, adding a block if none has room.
+		 * Allocations larger than half a block get their own device memory.
+		 * @param reqs The memory requirements of the resource.
+		 * @param required The properties the memory must have.
+		 * @param preferred [Optional] The properties the memory should have.
+		 * @param linear [Optional] `true` for buffers and linear images, `false` for optimal images.
+		 * @returns The allocation, which is not valid if no memory could be found.
+		 */
+		MemoryAllocation allocate(
+			const VkMemoryRequirements &reqs,
+			VkMemoryPropertyFlags required,
+			VkMemoryPropertyFlags preferred = 0,
+			bool linear = true
+		);
+
+		/**
+		 * @brief Gives a range back. The GPU must have finished with it.
+		 * @param allocation The allocation to free, which is reset.
+		 */
+		void free(MemoryAllocation &allocation);
+
+		/**
+		 * @brief Makes host writes to part of an allocation visible to the device.
+		 * Does nothing for host-coherent memory.
+		 * @param allocation The allocation that was written to.
+		 * @param offset [Optional] Start of the written range, from the start of the allocation.
+		 * @param size [Optional] Size of the written range, or `VK_WHOLE_SIZE` for the rest.
+		 * @returns `true` if the range was flushed, `false` otherwise.
+		 */
+		bool flush(const MemoryAllocation &allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+
+		/**
+		 * @param allocation The allocation to check.
+		 * @returns `true` if host writes to the allocation need no flush, `false` otherwise.
+		 */
+		bool isCoherent(const MemoryAllocation &allocation) const;
+
+		/**
+		 * @brief Records that part of an allocation was written by the host, to be
+		 * flushed by the next `flushDirty()`. Does nothing for host-coherent memory.
+		 * @param allocation The allocation that was written to.
+		 * @param offset [Optional] Start of the written range, from the start of the allocation.
+		 * @param size [Optional] Size of the written range, or `VK_WHOLE_SIZE` for the rest.
+		 */
+		void markDirty(const MemoryAllocation &allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+
+		/**
+		 * @brief Flushes every range marked dirty since the last call, merged
+		 * where they touch, in a single `vkFlushMappedMemoryRanges`. Called
+		 * once per frame before submitting.
+		 * @returns `true` if the ranges were flushed, `false` otherwise.
+		 */
+		bool flushDirty();
+
+		/**
+		 * @returns How much memory is held and how fragmented it is.
+		 */
+		MemoryStats getStats();
+
+		/**
+		 * @brief Asks the driver for the usage and budget of every heap, or
+		 * estimates them if it cannot say. Called once per frame.
+		 */
+		void updateBudget();
+
+		/**
+		 * @returns The usage and budget of each heap (indexed as in
+		 * `VkPhysicalDeviceMemoryProperties::memoryHeaps`), including
+		 * allocations made since the last `updateBudget()`.
+		 */
+		std::array<MemoryBudget, VK_MAX_MEMORY_HEAPS> getBudget();
+
+		/**
+		 * @param allocation An allocation handed out by the allocator.
+		 * @returns How full the block of the allocation is, from 0 to 1, or 1 if
+		 * the allocation has its own device memory.
+		 */
+		f32 getBlockOccupancy(const MemoryAllocation &allocation);
+
+		/**
+		 * @brief Finds a new place for an allocation in another block of the same
+		 * memory type that is at least as full, so moving resources out of sparse
+		 * blocks lets those blocks be freed. Never adds a block.
+		 * @param allocation The allocation to move, which stays valid.
+		 * @param reqs The memory requirements of the resource.
+		 * @returns The new allocation, which is not valid if no block has room.
+		 */
+		MemoryAllocation reallocate(const MemoryAllocation &allocation, const VkMemoryRequirements &reqs);
+
+	};
+
+} // namespace carbon
+
+#endif // CORE_MEMORY_ALLOCATOR_HPP
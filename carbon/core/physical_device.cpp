@@ -7,6 +7,7 @@
 #include "instance.hpp"
 #include "carbon/common/logger.hpp"
 
+#include <cstring>
 #include <set>
 
 namespace carbon {
@@ -72,9 +73,62 @@ namespace carbon {
 	}
 
 
+	void PhysicalDevice::queryDescriptorIndexing() {
+		initStruct(m_indexing_feats, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES);
+		initStruct(m_indexing_props, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES);
+
+		// the queries below are only core from 1.2 on, for both the instance and device
+		if (m_instance->getApiVersion() < VK_API_VERSION_1_2 || m_device_props.apiVersion < VK_API_VERSION_1_2) {
+			return;
+		}
+
+		VkPhysicalDeviceFeatures2 feats;
+		initStruct(feats, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2);
+		feats.pNext = &m_indexing_feats;
+
+		VkPhysicalDeviceProperties2 props;
+		initStruct(props, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2);
+		props.pNext = &m_indexing_props;
+
+		vkGetPhysicalDeviceFeatures2(m_device, &feats);
+		vkGetPhysicalDeviceProperties2(m_device, &props);
+
+		// the structs are copied out, so must not point at the locals
+		m_indexing_feats.pNext = nullptr;
+		m_indexing_props.pNext = nullptr;
+	}
+
+
+	void PhysicalDevice::queryMemoryBudgetSupport() {
+		// the budget is read through a query that is only core from 1.1 on
+		if (m_instance->getApiVersion() < VK_API_VERSION_1_1 || m_device_props.apiVersion < VK_API_VERSION_1_1) {
+			return;
+		}
+
+		u32 numExtensions{ 0 };
+		vkEnumerateDeviceExtensionProperties(m_device, nullptr, &numExtensions, nullptr);
+
+		std::vector<VkExtensionProperties> available(numExtensions);
+		vkEnumerateDeviceExtensionProperties(m_device, nullptr, &numExtensions, available.data());
+
+		for (const auto &ext : available) {
+			if (std::strcmp(ext.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0) {
+				m_device_extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+				m_memory_budget = true;
+				return;
+			}
+		}
+	}
+
+
 	PhysicalDevice::PhysicalDevice(Instance *instance)
 		: m_instance(instance)
 	{
+		// swapchain is not needed when there is nothing to present to
+		if (m_instance->isHeadless()) {
+			m_device_extensions.clear();
+		}
+
 		// get number of physical devices available
 		u32 numDevices{ 0 };
 		vkEnumeratePhysicalDevices(m_instance->getHandle(), &numDevices, nullptr);
@@ -99,6 +153,9 @@ namespace carbon {
 		vkGetPhysicalDeviceProperties(m_device, &m_device_props);
 		vkGetPhysicalDeviceFeatures(m_device, &m_device_feats);
 		vkGetPhysicalDeviceMemoryProperties(m_device, &m_device_memory_props);
+
+		queryDescriptorIndexing();
+		queryMemoryBudgetSupport();
 	}
 
 
@@ -108,6 +165,21 @@ namespace carbon {
 		props.append(fmt::format("\n  Type:                        {}", getDeviceType()));
 		props.append(fmt::format("\n  Vendor ID:                   {:d}", m_device_props.vendorID));
 		props.append(fmt::format("\n  Memory heap count:           {:d}", m_device_memory_props.memoryHeapCount));
+
+		VkPhysicalDeviceMemoryBudgetPropertiesEXT budget;
+		const bool hasBudget = queryMemoryBudget(budget);
+
+		for (u32 i = 0; i < m_device_memory_props.memoryHeapCount; i++) {
+			const VkMemoryHeap &heap = m_device_memory_props.memoryHeaps[i];
+			const char *kind = (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) ? "device" : "host";
+
+			props.append(fmt::format("\n    Heap {:d} ({}): {:d} MiB", i, kind, heap.size >> 20));
+
+			if (hasBudget) {
+				props.append(fmt::format(", {:d} MiB used, {:d} MiB budget", budget.heapUsage[i] >> 20, budget.heapBudget[i] >> 20));
+			}
+		}
+
 		props.append(fmt::format("\n  Maximum clip distances:      {:d}", m_device_props.limits.maxClipDistances));
 		props.append(fmt::format("\n  Maximum cull distances:      {:d}", m_device_props.limits.maxCullDistances));
 		props.append(fmt::format("\n  Maximum number of viewports: {:d}", m_device_props.limits.maxViewports));
@@ -118,6 +190,48 @@ namespace carbon {
 	}
 
 
+	u32 PhysicalDevice::findMemoryType(u32 typeFilter, VkMemoryPropertyFlags properties) const {
+		for (u32 i = 0; i < m_device_memory_props.memoryTypeCount; i++) {
+			// check that type is allowed and supports all properties
+			if ((typeFilter & (1U << i)) && (m_device_memory_props.memoryTypes[i].propertyFlags & properties) == properties) {
+				return i;
+			}
+		}
+
+		return u32_max;
+	}
+
+
+	bool PhysicalDevice::queryMemoryBudget(VkPhysicalDeviceMemoryBudgetPropertiesEXT &budget) const {
+		initStruct(budget, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT);
+
+		if (!m_memory_budget) {
+			return false;
+		}
+
+		VkPhysicalDeviceMemoryProperties2 props;
+		initStruct(props, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2);
+		props.pNext = &budget;
+
+		vkGetPhysicalDeviceMemoryProperties2(m_device, &props);
+
+		// copied out, so must not point at the local
+		budget.pNext = nullptr;
+		return true;
+	}
+
+
+	bool PhysicalDevice::supportsBindless() const {
+		return m_indexing_feats.runtimeDescriptorArray &&
+			m_indexing_feats.descriptorBindingPartiallyBound &&
+			m_indexing_feats.descriptorBindingUpdateUnusedWhilePending &&
+			m_indexing_feats.descriptorBindingSampledImageUpdateAfterBind &&
+			m_indexing_feats.descriptorBindingStorageBufferUpdateAfterBind &&
+			m_indexing_feats.shaderSampledImageArrayNonUniformIndexing &&
+			m_indexing_feats.shaderStorageBufferArrayNonUniformIndexing;
+	}
+
+
 	const char* PhysicalDevice::getDeviceType() const {
 		switch (m_device_props.deviceType) {
 			case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
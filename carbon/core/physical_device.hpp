@@ -34,7 +34,7 @@ namespace carbon {
 		/**
 		 * @brief The required device extensions.
 		 */
-		const std::vector<const char *> m_device_extensions{
+		std::vector<const char *> m_device_extensions{
 			VK_KHR_SWAPCHAIN_EXTENSION_NAME
 		};
 
@@ -58,6 +58,23 @@ namespace carbon {
 		 */
 		VkPhysicalDeviceMemoryProperties m_device_memory_props{};
 
+		/**
+		 * @brief Descriptor indexing features of the selected device, all
+		 * `VK_FALSE` if the device or instance is older than Vulkan 1.2.
+		 */
+		VkPhysicalDeviceDescriptorIndexingFeatures m_indexing_feats{};
+
+		/**
+		 * @brief Descriptor indexing limits of the selected device.
+		 */
+		VkPhysicalDeviceDescriptorIndexingProperties m_indexing_props{};
+
+		/**
+		 * @brief `true` if the driver reports how much of each heap is in use
+		 * and available (`VK_EXT_memory_budget`), `false` otherwise.
+		 */
+		bool m_memory_budget{ false };
+
 		/**
 		 * @brief Ordered map of possible candidate physical devices.
 		 */
@@ -78,6 +95,16 @@ namespace carbon {
 		 */
 		VkPhysicalDevice selectBestPhysicalDevice(const std::vector<VkPhysicalDevice> &devices);
 
+		/**
+		 * @brief Queries the descriptor indexing features and limits of the selected device.
+		 */
+		void queryDescriptorIndexing();
+
+		/**
+		 * @brief Enables the memory budget extension if the selected device has it.
+		 */
+		void queryMemoryBudgetSupport();
+
 	public:
 
 		/**
@@ -102,6 +129,15 @@ namespace carbon {
 		 */
 		const char* getDeviceType() const;
 
+		/**
+		 * @brief Finds the index of a memory type that is allowed by the
+		 * given filter and has all of the given properties.
+		 * @param typeFilter Bitmask of the allowed memory types (from `VkMemoryRequirements`).
+		 * @param properties The properties the memory type must have.
+		 * @returns The index of the memory type, or `u32_max` if none is suitable.
+		 */
+		u32 findMemoryType(u32 typeFilter, VkMemoryPropertyFlags properties) const;
+
 		/**
 		 * @returns The underlying `VkPhysicalDevice`.
 		 */
@@ -130,6 +166,42 @@ namespace carbon {
 			return m_device_memory_props;
 		}
 
+		/**
+		 * @returns The descriptor indexing features of the selected physical device.
+		 */
+		const VkPhysicalDeviceDescriptorIndexingFeatures& getDescriptorIndexingFeatures() const {
+			return m_indexing_feats;
+		}
+
+		/**
+		 * @returns The descriptor indexing limits of the selected physical device.
+		 */
+		const VkPhysicalDeviceDescriptorIndexingProperties& getDescriptorIndexingProperties() const {
+			return m_indexing_props;
+		}
+
+		/**
+		 * @returns `true` if the device can keep large, partially bound arrays of
+		 * textures and buffers that are updated after being bound, `false` otherwise.
+		 */
+		bool supportsBindless() const;
+
+		/**
+		 * @returns `true` if the driver reports the usage and budget of each
+		 * memory heap, `false` otherwise.
+		 */
+		bool supportsMemoryBudget() const {
+			return m_memory_budget;
+		}
+
+		/**
+		 * @brief Asks the driver how much of each memory heap is in use, across
+		 * all processes, and how much this process can use.
+		 * @param budget Filled with the usage and budget of each heap.
+		 * @returns `true` if the budget was queried, `false` if it is not supported.
+		 */
+		bool queryMemoryBudget(VkPhysicalDeviceMemoryBudgetPropertiesEXT &budget) const;
+
 		/**
 		 * @returns The found physical devices and their scores.
 		 */
@@ -7,8 +7,11 @@
 #ifndef CORE_TIME_HPP
 #define CORE_TIME_HPP
 
+#include "carbon/types.hpp"
+
 #include <cassert>
 #include <chrono>
+#include <cmath>
 
 namespace carbon {
 
@@ -84,6 +87,150 @@ namespace carbon {
 
 	};
 
+	/**
+	 * @brief Measures the time between frames and splits it into fixed-size
+	 * simulation steps, so that simulation runs at a constant rate no matter
+	 * how fast or slow frames are rendered.
+	 */
+	class FrameClock {
+
+	private:
+
+		/**
+		 * @brief Time of the last tick.
+		 */
+		time_point_t m_last;
+
+		/**
+		 * @brief Length (in seconds) of a single simulation step.
+		 */
+		double m_fixed_step;
+
+		/**
+		 * @brief Maximum number of simulation steps run in a single tick.
+		 */
+		u32 m_max_steps;
+
+		/**
+		 * @brief Time (in seconds) that has passed but has not been simulated yet.
+		 */
+		double m_accumulator{ 0.0 };
+
+		/**
+		 * @brief Time (in seconds) between the last two ticks.
+		 */
+		double m_delta{ 0.0 };
+
+		/**
+		 * @brief How far (from 0 to 1) the current time is between the last
+		 * simulation step and the next.
+		 */
+		double m_alpha{ 0.0 };
+
+		/**
+		 * @brief Number of simulation steps that have been run.
+		 */
+		u64 m_step_count{ 0 };
+
+		/**
+		 * @brief Number of simulation steps that were dropped to catch up.
+		 */
+		u64 m_dropped_steps{ 0 };
+
+	public:
+
+		/**
+		 * @brief Initializes the frame clock.
+		 * @param fixedStep The length (in seconds) of a single simulation step.
+		 * @param maxSteps The maximum number of simulation steps to run in a single tick.
+		 */
+		FrameClock(double fixedStep, u32 maxSteps)
+			: m_last(clock_t::now())
+			, m_fixed_step(fixedStep)
+			, m_max_steps(maxSteps)
+		{
+			assert(fixedStep > 0.0 && "[ERROR] Fixed timestep must be positive.");
+			assert(maxSteps > 0 && "[ERROR] Must allow at least one simulation step per tick.");
+		}
+
+		/**
+		 * @brief Resets the clock, discarding any time that has not been simulated.
+		 */
+		void reset() {
+			m_last = clock_t::now();
+			m_accumulator = 0.0;
+			m_delta = 0.0;
+			m_alpha = 0.0;
+		}
+
+		/**
+		 * @brief Advances the clock by the time since the last tick.
+		 * If more steps are owed than allowed, the extra time is dropped so
+		 * that a slow frame cannot cause ever more simulation to be run.
+		 * @returns The number of simulation steps to run this frame.
+		 */
+		u32 tick() {
+			time_point_t now = clock_t::now();
+			m_delta = std::chrono::duration_cast<seconds_t>(now - m_last).count();
+			m_last = now;
+
+			m_accumulator += m_delta;
+			u64 owed = static_cast<u64>(m_accumulator / m_fixed_step);
+			u32 steps = owed > m_max_steps ? m_max_steps : static_cast<u32>(owed);
+
+			if (owed > m_max_steps) {
+				// keep only the partial step, so rendering stays smooth
+				m_dropped_steps += owed - m_max_steps;
+				m_accumulator = std::fmod(m_accumulator, m_fixed_step);
+			} else {
+				m_accumulator -= static_cast<double>(steps) * m_fixed_step;
+			}
+
+			m_alpha = m_accumulator / m_fixed_step;
+			m_step_count += steps;
+
+			return steps;
+		}
+
+		/**
+		 * @returns The length (in seconds) of a single simulation step.
+		 */
+		double getFixedStep() const {
+			return m_fixed_step;
+		}
+
+		/**
+		 * @returns The time (in seconds) between the last two ticks.
+		 */
+		double getDelta() const {
+			return m_delta;
+		}
+
+		/**
+		 * @returns How far (from 0 to 1) the current time is between the
+		 * last simulation step and the next. Rendering uses this to blend
+		 * between the previous and current simulation states.
+		 */
+		double getAlpha() const {
+			return m_alpha;
+		}
+
+		/**
+		 * @returns The number of simulation steps that have been run.
+		 */
+		u64 getStepCount() const {
+			return m_step_count;
+		}
+
+		/**
+		 * @returns The number of simulation steps that were dropped to catch up.
+		 */
+		u64 getDroppedSteps() const {
+			return m_dropped_steps;
+		}
+
+	};
+
 } // namespace carbon
 
 #endif // CORE_TIME_HPP
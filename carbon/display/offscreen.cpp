@@ -0,0 +1,141 @@
+// file      : carbon/display/offscreen.cpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#include "offscreen.hpp"
+
+#include "carbon/common/logger.hpp"
+#include "carbon/core/host_allocator.hpp"
+#include "carbon/core/logical_device.hpp"
+
+#include <cassert>
+
+namespace carbon {
+
+	void Offscreen::createImages(u32 imageCount) {
+		assert(m_logical_device && "Logical device must not be null.");
+		VkDevice device = m_logical_device->getHandle();
+		MemoryAllocator &allocator = m_logical_device->getMemoryAllocator();
+
+		m_images.resize(imageCount);
+		m_allocations.resize(imageCount);
+
+		for (size_t i = 0; i < m_images.size(); i++) {
+			VkImageCreateInfo createInfo;
+			initStruct(createInfo, VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO);
+
+			createInfo.imageType = VK_IMAGE_TYPE_2D;
+			createInfo.format = m_image_format;
+			createInfo.extent = { m_extent.width, m_extent.height, 1 };
+			createInfo.mipLevels = 1;
+			createInfo.arrayLayers = 1;
+			createInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+			createInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+
+			// rendered to, then copied out for saving or comparing results
+			createInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+			createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			createInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+			if (vkCreateImage(device, &createInfo, HostAllocator::get(VK_OBJECT_TYPE_IMAGE), &m_images[i]) != VK_SUCCESS) {
+				CARBON_LOG_FATAL(carbon::log::To::File, "Failed to create offscreen image.");
+			}
+
+			VkMemoryRequirements memReqs;
+			vkGetImageMemoryRequirements(device, m_images[i], &memReqs);
+
+			m_allocations[i] = allocator.allocate(memReqs, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, false);
+
+			if (!m_allocations[i].isValid()) {
+				CARBON_LOG_FATAL(carbon::log::To::File, "Failed to allocate offscreen image memory.");
+			}
+
+			vkBindImageMemory(device, m_images[i], m_allocations[i].memory, m_allocations[i].offset);
+		}
+	}
+
+
+	void Offscreen::createImageViews() {
+		assert(m_logical_device && "Logical device must not be null.");
+
+		m_image_views.resize(m_images.size());
+
+		for (size_t i = 0; i < m_images.size(); i++) {
+			VkImageViewCreateInfo createInfo;
+			initStruct(createInfo, VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO);
+
+			createInfo.image = m_images[i];
+			createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			createInfo.format = m_image_format;
+
+			createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+			createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+			createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+			createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+
+			createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			createInfo.subresourceRange.baseMipLevel = 0;
+			createInfo.subresourceRange.levelCount = 1;
+			createInfo.subresourceRange.baseArrayLayer = 0;
+			createInfo.subresourceRange.layerCount = 1;
+
+			if (vkCreateImageView(m_logical_device->getHandle(), &createInfo, HostAllocator::get(VK_OBJECT_TYPE_IMAGE_VIEW), &m_image_views[i]) != VK_SUCCESS) {
+				CARBON_LOG_FATAL(carbon::log::To::File, "Failed to create offscreen image views.");
+			}
+		}
+	}
+
+
+	Offscreen::Offscreen(
+		LogicalDevice *logiDevice,
+		const VkExtent2D &extent,
+		u32 imageCount,
+		const VkFormat &format
+	)
+		: m_logical_device(logiDevice)
+		, m_extent(extent)
+		, m_image_format(format)
+	{
+		assert(m_logical_device && "Logical device must not be null.");
+
+		createImages(imageCount);
+		createImageViews();
+	}
+
+
+	Offscreen::~Offscreen() {
+		destroy();
+	}
+
+
+	void Offscreen::destroy() {
+		assert(m_logical_device && "Logical device must not be null.");
+		VkDevice device = m_logical_device->getHandle();
+
+		// destroy image views
+		for (size_t i = 0; i < m_image_views.size(); i++) {
+			if (m_image_views[i] != VK_NULL_HANDLE) {
+				vkDestroyImageView(device, m_image_views[i], HostAllocator::get(VK_OBJECT_TYPE_IMAGE_VIEW));
+				m_image_views[i] = VK_NULL_HANDLE;
+			}
+		}
+
+		// destroy images and their memory
+		for (size_t i = 0; i < m_images.size(); i++) {
+			if (m_images[i] != VK_NULL_HANDLE) {
+				vkDestroyImage(device, m_images[i], HostAllocator::get(VK_OBJECT_TYPE_IMAGE));
+				m_images[i] = VK_NULL_HANDLE;
+			}
+
+			if (m_allocations[i].isValid()) {
+				m_logical_device->getMemoryAllocator().free(m_allocations[i]);
+			}
+		}
+	}
+
+
+	void Offscreen::acquireNextImage() {
+		m_curr_image_idx = (m_curr_image_idx + 1) % to_u32(m_images.size());
+	}
+
+} // namespace carbon
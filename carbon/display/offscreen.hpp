@@ -0,0 +1,164 @@
+// file      : carbon/display/offscreen.hpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#pragma once
+
+#ifndef DISPLAY_OFFSCREEN_HPP
+#define DISPLAY_OFFSCREEN_HPP
+
+#include "carbon/backend.hpp"
+#include "carbon/core/memory_allocator.hpp"
+
+#include <vector>
+
+namespace carbon {
+
+	// forward-declare classes that would result in circular dependency
+	class LogicalDevice;
+
+	/**
+	 * @brief A set of engine-owned images that are rendered to instead of
+	 * the swapchain when there is no window to present to. There is one
+	 * image per frame in flight, so the fence of a frame also guards its image.
+	 */
+	class Offscreen {
+
+	private:
+
+		/**
+		 * @brief The logical device to create the images on.
+		 */
+		const class LogicalDevice *m_logical_device;
+
+		/**
+		 * @brief Size of the offscreen images.
+		 */
+		VkExtent2D m_extent;
+
+		/**
+		 * @brief The format of the offscreen images.
+		 */
+		VkFormat m_image_format;
+
+		/**
+		 * @brief Index of the current image.
+		 */
+		u32 m_curr_image_idx{};
+
+		/**
+		 * @brief The offscreen images.
+		 */
+		std::vector<VkImage> m_images;
+
+		/**
+		 * @brief The memory backing each offscreen image.
+		 */
+		std::vector<MemoryAllocation> m_allocations;
+
+		/**
+		 * @brief The image views for the offscreen images.
+		 */
+		std::vector<VkImageView> m_image_views;
+
+		/**
+		 * @brief Creates the images and binds device-local memory to them.
+		 * @param imageCount The number of images to create.
+		 */
+		void createImages(u32 imageCount);
+
+		/**
+		 * @brief Creates the image views for the offscreen images.
+		 */
+		void createImageViews();
+
+	public:
+
+		/**
+		 * @brief Initializes the offscreen images.
+		 * @param logiDevice The logical device to use.
+		 * @param extent The size of the images.
+		 * @param imageCount The number of images to create.
+		 * @param format [Optional] The format of the images.
+		 */
+		explicit Offscreen(
+			class LogicalDevice *logiDevice,
+			const VkExtent2D &extent,
+			u32 imageCount,
+			const VkFormat &format = VK_FORMAT_R8G8B8A8_UNORM
+		);
+
+		Offscreen(const Offscreen&) = delete;
+
+		Offscreen& operator=(const Offscreen&) = delete;
+
+		/**
+		 * @brief Destructor for the offscreen images.
+		 */
+		~Offscreen();
+
+		/**
+		 * @brief Destroys the offscreen images and their views.
+		 */
+		void destroy();
+
+		/**
+		 * @brief Moves on to the next offscreen image.
+		 * Unlike the swapchain, this never has to wait on the presentation engine.
+		 */
+		void acquireNextImage();
+
+		/**
+		 * @returns The size of the offscreen images.
+		 */
+		const VkExtent2D& getExtent() const {
+			return m_extent;
+		}
+
+		/**
+		 * @returns The format of the offscreen images.
+		 */
+		const VkFormat& getImageFormat() const {
+			return m_image_format;
+		}
+
+		/**
+		 * @returns The current offscreen image.
+		 */
+		const VkImage& getCurrentImage() const {
+			return m_images[m_curr_image_idx];
+		}
+
+		/**
+		 * @returns The view of the current offscreen image.
+		 */
+		const VkImageView& getCurrentImageView() const {
+			return m_image_views[m_curr_image_idx];
+		}
+
+		/**
+		 * @returns The index of the current offscreen image.
+		 */
+		const u32 getCurrentImageIndex() const {
+			return m_curr_image_idx;
+		}
+
+		/**
+		 * @returns The number of offscreen images.
+		 */
+		const size_t getImageCount() const {
+			return m_images.size();
+		}
+
+		/**
+		 * @returns The offscreen images.
+		 */
+		const std::vector<VkImage>& getImages() const {
+			return m_images;
+		}
+
+	};
+
+} // namespace carbon
+
+#endif // DISPLAY_OFFSCREEN_HPP
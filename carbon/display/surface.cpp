@@ -5,6 +5,7 @@
 #include "surface.hpp"
 
 #include "carbon/common/logger.hpp"
+#include "carbon/core/host_allocator.hpp"
 #include "carbon/core/instance.hpp"
 
 carbon::Surface::Surface(carbon::Instance *instance, GLFWwindow *window)
@@ -12,7 +13,7 @@ carbon::Surface::Surface(carbon::Instance *instance, GLFWwindow *window)
 	, m_window(window)
 {
 	// check if surface creation was successful
-	if (glfwCreateWindowSurface(m_instance->getHandle(), m_window, nullptr, &m_surface) != VK_SUCCESS) {
+	if (glfwCreateWindowSurface(m_instance->getHandle(), m_window, HostAllocator::get(VK_OBJECT_TYPE_SURFACE_KHR), &m_surface) != VK_SUCCESS) {
 		CARBON_LOG_FATAL(carbon::log::To::File, "Failed to create window surface.");
 	}
 }
@@ -29,6 +30,6 @@ void carbon::Surface::destroy() {
 	}
 
 	// destroy and reset
-	vkDestroySurfaceKHR(m_instance->getHandle(), m_surface, nullptr);
+	vkDestroySurfaceKHR(m_instance->getHandle(), m_surface, HostAllocator::get(VK_OBJECT_TYPE_SURFACE_KHR));
 	m_surface = VK_NULL_HANDLE;
 }
@@ -7,8 +7,9 @@
 #include "carbon/common/logger.hpp"
 
 #include "carbon/core/physical_device.hpp"
+#include "carbon/core/deletion_queue.hpp"
+#include "carbon/core/host_allocator.hpp"
 #include "carbon/core/logical_device.hpp"
-#include "carbon/pipeline/render_pass.hpp"
 
 #include "surface.hpp"
 
@@ -179,11 +180,11 @@ namespace carbon {
 		// clip objects that are obscured (best performance)
 		createInfo.clipped = VK_TRUE;
 
-		// can specify previous swapchain if current one becomes invalid or unoptimized
-		createInfo.oldSwapchain = VK_NULL_HANDLE;
+		// the swapchain being replaced (if any) hands its resources over to the new one
+		createInfo.oldSwapchain = m_swapchain;
 
 		// create swapchain
-		if (vkCreateSwapchainKHR(m_logical_device->getHandle(), &createInfo, nullptr, &m_swapchain) != VK_SUCCESS) {
+		if (vkCreateSwapchainKHR(m_logical_device->getHandle(), &createInfo, HostAllocator::get(VK_OBJECT_TYPE_SWAPCHAIN_KHR), &m_swapchain) != VK_SUCCESS) {
 			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to create swapchain.");
 		}
 
@@ -225,46 +226,13 @@ namespace carbon {
 			createInfo.subresourceRange.layerCount = 1;
 
 			// create image views
-			if (vkCreateImageView(m_logical_device->getHandle(), &createInfo, nullptr, &m_image_views[i]) != VK_SUCCESS) {
+			if (vkCreateImageView(m_logical_device->getHandle(), &createInfo, HostAllocator::get(VK_OBJECT_TYPE_IMAGE_VIEW), &m_image_views[i]) != VK_SUCCESS) {
 				CARBON_LOG_FATAL(carbon::log::To::File, "Failed to create image views.");
 			}
 		}
 	}
 
 
-	void Swapchain::createRenderPass() {
-		m_render_pass = new RenderPass(m_logical_device, m_image_format);
-	}
-
-
-	void Swapchain::createFramebuffers() {
-		assert(m_render_pass && "Render pass must not be null.");
-
-		// hold all image views
-		m_framebuffers.resize(m_image_views.size());
-
-		// create framebuffer for each image view
-		for (size_t i = 0; i < m_image_views.size(); i++) {
-			VkImageView attachments[]{ m_image_views[i] };
-
-			// create framebuffer
-			VkFramebufferCreateInfo info;
-			initStruct(info, VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO);
-
-			info.renderPass = m_render_pass->getHandle();
-			info.attachmentCount = 1;
-			info.pAttachments = attachments;
-			info.width = m_extent.width;
-			info.height = m_extent.height;
-			info.layers = 1;
-
-			if (vkCreateFramebuffer(m_logical_device->getHandle(), &info, nullptr, &m_framebuffers[i]) != VK_SUCCESS) {
-				CARBON_LOG_FATAL(carbon::log::To::File, "Failed to create framebuffer.");
-			}
-		}
-	}
-
-
 	Swapchain::Swapchain(
 		GLFWwindow *window,
 		LogicalDevice *logiDevice,
@@ -280,8 +248,6 @@ namespace carbon {
 
 		setup();
 		createImageViews();
-		createRenderPass();
-		createFramebuffers();
 	}
 
 
@@ -290,32 +256,28 @@ namespace carbon {
 	}
 
 
-	void Swapchain::destroy() {
+	void Swapchain::destroyImages() {
 		assert(m_logical_device && "Logical device must not be null.");
-		VkDevice device = m_logical_device->getHandle();
-
-		// destroy framebuffers
-		for (size_t i = 0; i < m_framebuffers.size(); i++) {
-			if (m_framebuffers[i] != VK_NULL_HANDLE) {
-				vkDestroyFramebuffer(device, m_framebuffers[i], nullptr);
-				m_framebuffers[i] = VK_NULL_HANDLE;
-			}
-		}
 
-		// destroy render pass
-		delete m_render_pass;
+		// frames in flight may still be drawing into the images, so they go once those are done
+		DeletionQueue &deletionQueue = m_logical_device->getDeletionQueue();
 
 		// destroy image views
 		for (size_t i = 0; i < m_image_views.size(); i++) {
 			if (m_image_views[i] != VK_NULL_HANDLE) {
-				vkDestroyImageView(device, m_image_views[i], nullptr);
+				deletionQueue.push(VK_OBJECT_TYPE_IMAGE_VIEW, m_image_views[i]);
 				m_image_views[i] = VK_NULL_HANDLE;
 			}
 		}
+	}
+
+
+	void Swapchain::destroy() {
+		destroyImages();
 
 		// destroy swapchain
 		if (m_swapchain != VK_NULL_HANDLE) {
-			vkDestroySwapchainKHR(device, m_swapchain, nullptr);
+			m_logical_device->getDeletionQueue().push(VK_OBJECT_TYPE_SWAPCHAIN_KHR, m_swapchain);
 			m_swapchain = VK_NULL_HANDLE;
 		}
 	}
@@ -334,15 +296,16 @@ namespace carbon {
 			glfwGetFramebufferSize(m_window, &width, &height);
 		}
 
-		// wait for logical device
-		vkDeviceWaitIdle(m_logical_device->getHandle());
-
-		destroy();
+		// no need to wait for the device, since the old images are only
+		// destroyed once the frames in flight are done with them
+		const VkSwapchainKHR oldSwapchain{ m_swapchain };
+		destroyImages();
 
 		setup();
 		createImageViews();
-		createRenderPass();
-		createFramebuffers();
+
+		// retired by creating the new swapchain, but may still be presenting
+		m_logical_device->getDeletionQueue().push(VK_OBJECT_TYPE_SWAPCHAIN_KHR, oldSwapchain);
 	}
 
 
@@ -16,7 +16,6 @@ namespace carbon {
 	// forward-declare classes that would result in circular dependency
 	class PhysicalDevice;
 	class LogicalDevice;
-	class RenderPass;
 	class Surface;
 
 	/**
@@ -46,11 +45,6 @@ namespace carbon {
 		 */
 		const class LogicalDevice *m_logical_device;
 
-		/**
-		 * @brief The render pass used for drawing.
-		 */
-		const class RenderPass *m_render_pass;
-
 		/**
 		 * @brief The surface to use in the swapchain.
 		 */
@@ -106,11 +100,6 @@ namespace carbon {
 		 */
 		std::vector<VkImageView> m_image_views;
 
-		/**
-		 * @brief The framebuffers for the swapchain images.
-		 */
-		std::vector<VkFramebuffer> m_framebuffers;
-
 		/**
 		 * @brief Queries the swapchain support of a device.
 		 * @returns The `SupportDetails` struct containing support information for the swapchain.
@@ -169,18 +158,10 @@ namespace carbon {
 		void createImageViews();
 
 		/**
-		 * @brief Creates the render pass that specifies information about the framebuffer
-		 * attachments and how many colour and depth buffers there will be.
-		 */
-		void createRenderPass();
-
-		/**
-		 * @brief Creates the framebuffers that will be used for rendering the
-		 * swapchain images. We have to create a framebuffer for each image in
-		 * the swapchain and use the one that corresponds to the retrieved image
-		 * at draw time.
+		 * @brief Hands the image views to the deletion queue. Render passes and
+		 * framebuffers for the images come from the `RenderPassCache`.
 		 */
-		void createFramebuffers();
+		void destroyImages();
 
 	public:
 
@@ -215,6 +196,9 @@ namespace carbon {
 
 		/**
 		 * @brief Recreates the swapchain by checking the size of the framebuffer.
+		 * Framebuffers cached for the old image views must be evicted first. The
+		 * old swapchain is retired rather than waited on, and destroyed once the
+		 * frames in flight are done with it.
 		 */
 		void recreate();
 
@@ -99,6 +99,16 @@ namespace carbon {
 	}
 
 
+	const bool Window::isResized() const {
+		return m_resized;
+	}
+
+
+	void Window::resetResized() {
+		m_resized = false;
+	}
+
+
 	const window::Mode Window::getWindowMode() const {
 		return m_window_mode;
 	}
@@ -312,6 +312,17 @@ namespace carbon {
 		 */
 		const bool isMinimized() const;
 
+		/**
+		 * @returns `true` if the framebuffer has been resized since the last
+		 * call to `resetResized`, `false` otherwise.
+		 */
+		const bool isResized() const;
+
+		/**
+		 * @brief Clears the resized flag once the resize has been handled.
+		 */
+		void resetResized();
+
 		/**
 		 * @returns The current mode of the window.
 		 */
@@ -16,8 +16,29 @@ namespace carbon {
 		static inline constexpr unsigned NUM_ATTACHEMENTS = 8U;
 		static inline constexpr unsigned NUM_VERTEX_BUFFERS = 4U;
 		static inline constexpr unsigned MAX_UBO_SIZE = 16 * 1024;
+		static inline constexpr unsigned UNIFORM_RING_SIZE = 4 * 1024 * 1024;
+		static inline constexpr unsigned MEMORY_BLOCK_SIZE = 64 * 1024 * 1024;
+		static inline constexpr unsigned STAGING_RING_SIZE = 32 * 1024 * 1024;
+		static inline constexpr unsigned FRAME_ARENA_SIZE = 1024 * 1024;
+		static inline constexpr unsigned DEFRAG_BYTES_PER_FRAME = 8 * 1024 * 1024;
+		static inline constexpr float DEFRAG_MAX_OCCUPANCY = 0.5f;
+		static inline constexpr unsigned DESCRIPTOR_SETS_PER_POOL = 64U * NUM_DESCRIPTOR_SETS;
+		static inline constexpr float MAX_SAMPLER_ANISOTROPY = 16.0f;
+		static inline constexpr bool ENABLE_HOST_ALLOCATOR = true;
 
 		static inline constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+		static inline constexpr unsigned ALLOCATION_WARMUP_FRAMES = 300U;
+
+		static inline constexpr bool ENABLE_BINDLESS = true;
+		static inline constexpr unsigned BINDLESS_MAX_TEXTURES = 16384U;
+		static inline constexpr unsigned BINDLESS_MAX_BUFFERS = 4096U;
+
+		static inline constexpr double FIXED_TIMESTEP = 1.0 / 60.0;
+		static inline constexpr unsigned MAX_CATCH_UP_STEPS = 5U;
+
+		static inline constexpr const char *PIPELINE_CACHE_FILE = "pipeline_cache.bin";
+		static inline constexpr const char *SHADER_INDEX_FILE = "shader_index.bin";
+		static inline constexpr const char *SHADER_DIR = "shaders";
 
 	} // namespace config
 
@@ -4,74 +4,622 @@
 
 #include "engine.hpp"
 
+#include "carbon/common/allocation_tracker.hpp"
 #include "carbon/common/logger.hpp"
+#include "carbon/core/command_recorder.hpp"
+#include "carbon/core/deletion_queue.hpp"
+#include "carbon/core/descriptor_allocator.hpp"
+#include "carbon/core/frame_arena.hpp"
+#include "carbon/core/host_allocator.hpp"
 #include "carbon/core/instance.hpp"
+#include "carbon/core/job_system.hpp"
 #include "carbon/core/physical_device.hpp"
 #include "carbon/core/logical_device.hpp"
+#include "carbon/core/memory_allocator.hpp"
+#include "carbon/core/time.hpp"
+#include "carbon/display/offscreen.hpp"
 #include "carbon/display/surface.hpp"
 #include "carbon/display/swapchain.hpp"
+#include "carbon/pipeline/bindless_table.hpp"
+#include "carbon/pipeline/descriptor_layout_cache.hpp"
+#include "carbon/pipeline/pipeline_cache.hpp"
+#include "carbon/pipeline/pipeline_library.hpp"
+#include "carbon/pipeline/render_graph.hpp"
+#include "carbon/pipeline/render_pass_cache.hpp"
+#include "carbon/pipeline/sampler_cache.hpp"
+#include "carbon/pipeline/shader_cache.hpp"
+#include "carbon/resources/buffer.hpp"
+#include "carbon/resources/defragmenter.hpp"
+#include "carbon/resources/uniform_ring.hpp"
+#include "carbon/resources/upload_manager.hpp"
+
+#include <filesystem>
+#include <thread>
 
 namespace carbon {
 
+	void Engine::createJobSystem() {
+		// calling thread is a worker too (hardware_concurrency() may return 0 if unknown)
+		m_job_system = new JobSystem(std::thread::hardware_concurrency());
+	}
+
+
 	void Engine::createWindow() {
 		m_window = new WindowGLFW(m_props);
 	}
 
 
-	void Engine::createVulkan() {
+	void Engine::createInstance() {
+		Timer timer;
+
 		// create instance
-		m_instance = new Instance(m_props.title, m_props.version);
+		m_instance = new Instance(m_props.title, m_props.version, isHeadless());
+		m_startup_times.instance = timer.elapsed();
 
-		// create surface for rendering to
-		m_surface = new Surface(m_instance, m_window->getHandle());
+		timer.reset();
 
 		// create physical device used for computation
 		m_physical_device = new PhysicalDevice(m_instance);
+		m_startup_times.physicalDevice = timer.elapsed();
+	}
 
-		// create logical device
+
+	void Engine::createDevice() {
+		// create surface for rendering to
+		if (!isHeadless()) {
+			m_surface = new Surface(m_instance, m_window->getHandle());
+		}
+
+		// create logical device, without a present queue if there is no surface
 		m_logical_device = new LogicalDevice(m_instance, m_physical_device, m_surface);
+	}
+
+
+	void Engine::createPresentation() {
+		if (isHeadless()) {
+			// one image per frame in flight, so the frame fence also guards the image
+			VkExtent2D extent{ static_cast<u32>(m_props.width), static_cast<u32>(m_props.height) };
+			m_offscreen = new Offscreen(m_logical_device, extent, config::MAX_FRAMES_IN_FLIGHT);
+			return;
+		}
 
 		// create swapchain
 		m_swapchain = new Swapchain(m_window->getHandle(), m_logical_device, m_physical_device, m_surface);
 	}
 
 
-	Engine::Engine(const window::Props &properties)
-		: m_props(properties)
-	{
-		m_logger->init();
+	void Engine::createPipelineCache() {
+		const std::filesystem::path path{ std::filesystem::path(paths::binaryPath()) / config::PIPELINE_CACHE_FILE };
+		m_pipeline_cache = new PipelineCache(m_logical_device, m_physical_device, path.string());
+	}
+
 
-		createWindow();
-		createVulkan();
+	void Engine::createShaderCache() {
+		const std::filesystem::path shaderDir{ std::filesystem::path(paths::assetsPath()) / config::SHADER_DIR };
+		const std::filesystem::path indexPath{ std::filesystem::path(paths::binaryPath()) / config::SHADER_INDEX_FILE };
+		m_shader_cache = new ShaderCache(m_logical_device, shaderDir.string(), indexPath.string());
 	}
 
 
-	Engine::Engine() {
+	void Engine::createRenderGraph() {
+		m_render_pass_cache = new RenderPassCache(m_logical_device);
+		m_render_graph = new RenderGraph(m_logical_device, m_render_pass_cache);
+		buildRenderGraph();
+	}
+
+
+	void Engine::buildRenderGraph() {
+		m_render_graph->reset();
+
+		// the image presented (or read back when headless) at the end of the frame
+		if (isHeadless()) {
+			m_backbuffer = m_render_graph->importImage("backbuffer", m_offscreen->getImageFormat(), m_offscreen->getExtent(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+		} else {
+			m_backbuffer = m_render_graph->importImage("backbuffer", m_swapchain->getImageFormat(), m_swapchain->getExtent(), VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+		}
+
+		if (m_build_render_graph) {
+			m_build_render_graph(*m_render_graph, m_backbuffer);
+		} else {
+			// default graph clears the backbuffer and draws straight into it
+			m_render_graph->addPass("main")
+				.writeColour(m_backbuffer, true, { { 0.0f, 0.0f, 0.0f, 1.0f } })
+				.setExecute([this](const RenderGraph::PassContext &context) { recordDraws(context); }, true);
+		}
+
+		m_render_graph->compile();
+	}
+
+
+	void Engine::startup() {
+		Timer total;
+		Timer timer;
+
 		m_logger->init();
+		createJobSystem();
+		m_startup_times.jobSystem = timer.elapsed();
+
+		// the instance needs GLFW for its extensions, but the window must be
+		// created on this thread, so initialize GLFW here before anything else
+		if (!isHeadless() && !glfwInit()) {
+			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to initialize GLFW.");
+		}
+
+		// enumerate extensions, layers and devices while the window is opened
+		JobCounter instanceReady;
+		m_job_system->run([this]() { createInstance(); }, &instanceReady);
+
+		if (!isHeadless()) {
+			timer.reset();
+			createWindow();
+			m_startup_times.window = timer.elapsed();
+		}
+
+		m_job_system->wait(instanceReady);
+
+		timer.reset();
+		createDevice();
+		m_startup_times.device = timer.elapsed();
+
+		// command pools, sync objects and the caches only need the device,
+		// so create them while the swapchain is set up
+		JobCounter frameReady;
+
+		m_job_system->run([this]() {
+			Timer frameTimer;
+			createCommandBuffers();
+			createSyncObjects();
+			m_startup_times.frameResources = frameTimer.elapsed();
+		}, &frameReady);
+
+		// reading the cache from disk is mostly waiting on IO
+		m_job_system->run([this]() {
+			Timer cacheTimer;
+			createPipelineCache();
+			m_startup_times.pipelineCache = cacheTimer.elapsed();
+		}, &frameReady);
+
+		m_job_system->run([this]() {
+			Timer cacheTimer;
+			createShaderCache();
+			m_startup_times.shaderCache = cacheTimer.elapsed();
+		}, &frameReady);
+
+		timer.reset();
+		createPresentation();
+		createRenderGraph();
+		m_startup_times.presentation = timer.elapsed();
+
+		m_job_system->wait(frameReady);
+
+		// pipelines compile against the cache loaded above
+		m_pipeline_library = new PipelineLibrary(m_logical_device, m_pipeline_cache, m_job_system);
+		m_descriptor_layout_cache = new DescriptorLayoutCache(m_logical_device);
+		m_sampler_cache = new SamplerCache(m_logical_device);
+
+		// without descriptor indexing, sets are bound per draw as before
+		if (m_logical_device->isBindlessEnabled()) {
+			m_bindless_table = new BindlessTable(m_logical_device, m_physical_device);
+		}
+
+		// no swapchain image is in use yet
+		if (m_swapchain) {
+			m_images_in_flight.assign(m_swapchain->getImageCount(), VK_NULL_HANDLE);
+		}
+
+		m_startup_times.total = total.elapsed();
+
+		// do not simulate the time spent starting up
+		m_clock.reset();
+	}
+
+
+	void Engine::createCommandBuffers() {
+		m_command_recorder = new CommandRecorder(m_logical_device, m_job_system);
+		m_descriptor_allocator = new DescriptorAllocator(m_logical_device, m_job_system);
+		m_uniform_ring = new UniformRing(m_logical_device);
+		m_frame_arena = new FrameArena();
+		m_upload_manager = new UploadManager(m_logical_device);
+		m_defragmenter = new Defragmenter(m_logical_device);
+
+		// cached descriptor sets still point at the handle a buffer had before it moved,
+		// and bindless slots that frames in flight may read are moved to new slots rather than rewritten
+		m_defragmenter->addListener([this](const Buffer &buffer, VkBuffer oldHandle) {
+			if (m_descriptor_layout_cache) {
+				m_descriptor_layout_cache->evict(oldHandle);
+			}
+
+			if (m_bindless_table) {
+				m_bindless_table->replaceBuffer(oldHandle, buffer.getHandle());
+			}
+		});
+	}
+
+
+	void Engine::createSyncObjects() {
+		VkDevice device = m_logical_device->getHandle();
+
+		VkSemaphoreCreateInfo semaphoreInfo;
+		initStruct(semaphoreInfo, VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO);
+
+		// create fences signalled so that the first wait on each frame returns immediately
+		VkFenceCreateInfo fenceInfo;
+		initStruct(fenceInfo, VK_STRUCTURE_TYPE_FENCE_CREATE_INFO);
+		fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+		for (size_t i = 0; i < config::MAX_FRAMES_IN_FLIGHT; i++) {
+			if (vkCreateSemaphore(device, &semaphoreInfo, HostAllocator::get(VK_OBJECT_TYPE_SEMAPHORE), &m_image_available_semaphores[i]) != VK_SUCCESS ||
+				vkCreateSemaphore(device, &semaphoreInfo, HostAllocator::get(VK_OBJECT_TYPE_SEMAPHORE), &m_render_finished_semaphores[i]) != VK_SUCCESS ||
+				vkCreateFence(device, &fenceInfo, HostAllocator::get(VK_OBJECT_TYPE_FENCE), &m_in_flight_fences[i]) != VK_SUCCESS
+			) {
+				CARBON_LOG_FATAL(carbon::log::To::File, "Failed to create synchronization objects for a frame.");
+			}
+		}
+	}
+
+
+	void Engine::destroyFrameResources() {
+		VkDevice device = m_logical_device->getHandle();
+
+		for (size_t i = 0; i < config::MAX_FRAMES_IN_FLIGHT; i++) {
+			if (m_image_available_semaphores[i] != VK_NULL_HANDLE) {
+				vkDestroySemaphore(device, m_image_available_semaphores[i], HostAllocator::get(VK_OBJECT_TYPE_SEMAPHORE));
+				m_image_available_semaphores[i] = VK_NULL_HANDLE;
+			}
+
+			if (m_render_finished_semaphores[i] != VK_NULL_HANDLE) {
+				vkDestroySemaphore(device, m_render_finished_semaphores[i], HostAllocator::get(VK_OBJECT_TYPE_SEMAPHORE));
+				m_render_finished_semaphores[i] = VK_NULL_HANDLE;
+			}
+
+			if (m_in_flight_fences[i] != VK_NULL_HANDLE) {
+				vkDestroyFence(device, m_in_flight_fences[i], HostAllocator::get(VK_OBJECT_TYPE_FENCE));
+				m_in_flight_fences[i] = VK_NULL_HANDLE;
+			}
+		}
+
+		delete m_defragmenter;
+		m_defragmenter = nullptr;
+
+		delete m_upload_manager;
+		m_upload_manager = nullptr;
+
+		delete m_frame_arena;
+		m_frame_arena = nullptr;
+
+		delete m_uniform_ring;
+		m_uniform_ring = nullptr;
+
+		delete m_descriptor_allocator;
+		m_descriptor_allocator = nullptr;
+
+		delete m_command_recorder;
+		m_command_recorder = nullptr;
+	}
+
+
+	void Engine::recreateSwapchain() {
+		// framebuffers of the old images must go before their views are reused, and
+		// are only destroyed once the frames in flight are done with them
+		for (const auto view : m_swapchain->getImageViews()) {
+			m_render_pass_cache->evict(view);
+		}
+
+		m_swapchain->recreate();
+		m_window->resetResized();
+
+		// image size may have changed
+		buildRenderGraph();
+
+		// number of images may have changed
+		m_images_in_flight.assign(m_swapchain->getImageCount(), VK_NULL_HANDLE);
+	}
+
+
+	void Engine::recordDraws(const RenderGraph::PassContext &context) {
+		if (m_draw_count == 0 || !m_record_draws) {
+			return;
+		}
+
+		// draws are recorded in parallel into secondary command buffers
+		const std::vector<VkCommandBuffer> &secondaries = m_command_recorder->recordParallel(
+			context.renderPass,
+			context.framebuffer,
+			m_draw_count,
+			m_record_draws
+		);
+
+		vkCmdExecuteCommands(context.commandBuffer, to_u32(secondaries.size()), secondaries.data());
+	}
+
+
+	void Engine::recordCommandBuffer(VkCommandBuffer commandBuffer, VkImage image, VkImageView view) {
+		VkCommandBufferBeginInfo beginInfo;
+		initStruct(beginInfo, VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO);
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to begin recording command buffer.");
+		}
+
+		// buffers uploaded on another queue family must be taken over before they are read
+		m_upload_manager->recordAcquire(commandBuffer);
+
+		// buffers are moved before anything in the frame reads them
+		m_defragmenter->record(commandBuffer);
+
+		// render graph draws into the current image and leaves it ready to present
+		m_render_graph->setImportedImage(m_backbuffer, image, view);
+		m_render_graph->execute(commandBuffer);
+
+		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to record command buffer.");
+		}
+	}
+
+
+	void Engine::setWaitSemaphores() {
+		const std::vector<VkSemaphore> &uploads = m_upload_manager->getWaitSemaphores();
+
+		// the vectors keep their capacity, so this does not allocate once warmed up
+		m_wait_semaphores.assign(uploads.begin(), uploads.end());
+		m_wait_stages.assign(uploads.size(), UploadManager::CONSUMER_STAGES);
+	}
+
+
+	void Engine::drawFrame() {
+		VkDevice device = m_logical_device->getHandle();
+		VkFence frameFence = m_in_flight_fences[m_current_frame];
+
+		// wait for the GPU to finish with the resources of this frame, timing
+		// how long the CPU is stalled for
+		Timer waitTimer;
+		vkWaitForFences(device, 1, &frameFence, VK_TRUE, u64_max);
+		m_fence_wait_time = waitTimer.elapsed();
+
+		VkResult result = m_swapchain->acquireNextImage(m_image_available_semaphores[m_current_frame]);
+
+		if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+			recreateSwapchain();
+			return;
+		} else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to acquire swapchain image.");
+		}
+
+		u32 imageIdx = m_swapchain->getCurrentImageIndex();
+
+		// a previous frame may still be rendering to this image
+		if (m_images_in_flight[imageIdx] != VK_NULL_HANDLE && m_images_in_flight[imageIdx] != frameFence) {
+			waitTimer.reset();
+			vkWaitForFences(device, 1, &m_images_in_flight[imageIdx], VK_TRUE, u64_max);
+			m_fence_wait_time += waitTimer.elapsed();
+		}
+
+		m_images_in_flight[imageIdx] = frameFence;
+		m_total_fence_wait_time += m_fence_wait_time;
+
+		// objects dropped the last time this frame was recorded are no longer in use
+		m_logical_device->getDeletionQueue().beginFrame(to_u32(m_current_frame));
+
+		// re-record the commands of this frame, recycling its command buffers
+		m_command_recorder->beginFrame(to_u32(m_current_frame));
+		m_descriptor_allocator->beginFrame(to_u32(m_current_frame));
+		m_uniform_ring->beginFrame(to_u32(m_current_frame));
+		m_frame_arena->beginFrame(to_u32(m_current_frame));
+		m_upload_manager->beginFrame(to_u32(m_current_frame));
+		m_logical_device->getMemoryAllocator().updateBudget();
+
+		if (m_bindless_table) {
+			m_bindless_table->beginFrame(to_u32(m_current_frame));
+		}
+
+		VkCommandBuffer commandBuffer = m_command_recorder->requestPrimary();
+		recordCommandBuffer(commandBuffer, m_swapchain->getCurrentImage(), m_swapchain->getCurrentImageView());
+
+		// uploads only hold back the stages that read them
+		setWaitSemaphores();
+		m_wait_semaphores.push_back(m_image_available_semaphores[m_current_frame]);
+		m_wait_stages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+
+		VkSemaphore signalSemaphores[]{ m_render_finished_semaphores[m_current_frame] };
+
+		VkSubmitInfo submitInfo;
+		initStruct(submitInfo, VK_STRUCTURE_TYPE_SUBMIT_INFO);
+
+		submitInfo.waitSemaphoreCount = to_u32(m_wait_semaphores.size());
+		submitInfo.pWaitSemaphores = m_wait_semaphores.data();
+		submitInfo.pWaitDstStageMask = m_wait_stages.data();
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &commandBuffer;
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = signalSemaphores;
+
+		// writes to non-coherent buffers during the frame go out in one call
+		m_logical_device->getMemoryAllocator().flushDirty();
+
+		// only reset the fence once work is guaranteed to be submitted
+		vkResetFences(device, 1, &frameFence);
+
+		if (vkQueueSubmit(m_logical_device->getGraphicsQueue(), 1, &submitInfo, frameFence) != VK_SUCCESS) {
+			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to submit command buffer.");
+		}
+
+		result = m_swapchain->queuePresent(m_logical_device->getPresentQueue(), m_render_finished_semaphores[m_current_frame]);
 
-		createWindow();
-		createVulkan();
+		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || m_window->isResized()) {
+			recreateSwapchain();
+		} else if (result != VK_SUCCESS) {
+			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to present swapchain image.");
+		}
+
+		// move on to the next frame, which the CPU can record while the GPU works on this one
+		m_current_frame = (m_current_frame + 1) % config::MAX_FRAMES_IN_FLIGHT;
+		m_frame_count++;
+	}
+
+
+	void Engine::drawFrameHeadless() {
+		VkDevice device = m_logical_device->getHandle();
+		VkFence frameFence = m_in_flight_fences[m_current_frame];
+
+		// the fence of this frame also guards its offscreen image
+		Timer waitTimer;
+		vkWaitForFences(device, 1, &frameFence, VK_TRUE, u64_max);
+		m_fence_wait_time = waitTimer.elapsed();
+		m_total_fence_wait_time += m_fence_wait_time;
+
+		m_offscreen->acquireNextImage();
+
+		// objects dropped the last time this frame was recorded are no longer in use
+		m_logical_device->getDeletionQueue().beginFrame(to_u32(m_current_frame));
+
+		// re-record the commands of this frame, recycling its command buffers
+		m_command_recorder->beginFrame(to_u32(m_current_frame));
+		m_descriptor_allocator->beginFrame(to_u32(m_current_frame));
+		m_uniform_ring->beginFrame(to_u32(m_current_frame));
+		m_frame_arena->beginFrame(to_u32(m_current_frame));
+		m_upload_manager->beginFrame(to_u32(m_current_frame));
+		m_logical_device->getMemoryAllocator().updateBudget();
+
+		if (m_bindless_table) {
+			m_bindless_table->beginFrame(to_u32(m_current_frame));
+		}
+
+		VkCommandBuffer commandBuffer = m_command_recorder->requestPrimary();
+		recordCommandBuffer(commandBuffer, m_offscreen->getCurrentImage(), m_offscreen->getCurrentImageView());
+
+		// nothing is acquired or presented, so only uploads are waited on
+		setWaitSemaphores();
+
+		VkSubmitInfo submitInfo;
+		initStruct(submitInfo, VK_STRUCTURE_TYPE_SUBMIT_INFO);
+
+		submitInfo.waitSemaphoreCount = to_u32(m_wait_semaphores.size());
+		submitInfo.pWaitSemaphores = m_wait_semaphores.data();
+		submitInfo.pWaitDstStageMask = m_wait_stages.data();
+
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &commandBuffer;
+
+		m_logical_device->getMemoryAllocator().flushDirty();
+		vkResetFences(device, 1, &frameFence);
+
+		if (vkQueueSubmit(m_logical_device->getGraphicsQueue(), 1, &submitInfo, frameFence) != VK_SUCCESS) {
+			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to submit command buffer.");
+		}
+
+		m_current_frame = (m_current_frame + 1) % config::MAX_FRAMES_IN_FLIGHT;
+		m_frame_count++;
+	}
+
+
+	Engine::Engine(const window::Props &properties, engine::Mode mode)
+		: m_props(properties)
+		, m_mode(mode)
+	{
+		startup();
+	}
+
+
+	Engine::Engine() {
+		startup();
 	}
 
 
 	Engine::~Engine() {
+		if (AllocationTracker::getViolationCount() > 0) {
+			CARBON_LOG_ERROR(carbon::log::To::File, fmt::format("{} frames made {} heap allocations after warming up.", AllocationTracker::getViolatingFrameCount(), AllocationTracker::getViolationCount()));
+		}
+
+		// frames may still be in flight
+		vkDeviceWaitIdle(m_logical_device->getHandle());
+
+		// nothing is in use any more, and queued descriptor sets must go before their pools
+		m_logical_device->getDeletionQueue().destroy();
+		destroyFrameResources();
+
+		// waits for pipelines still compiling, which also end up in the cache
+		delete m_pipeline_library;
+		delete m_descriptor_layout_cache;
+		delete m_bindless_table;
+		delete m_sampler_cache;
+
+		// keep the pipelines compiled and shaders loaded this run for the next one
+		m_pipeline_cache->save();
+		m_shader_cache->save();
+
+		delete m_shader_cache;
+		delete m_pipeline_cache;
+		delete m_render_graph;
+		delete m_render_pass_cache;
+		delete m_offscreen;
 		delete m_swapchain;
 		delete m_logical_device;
 		delete m_physical_device;
 		delete m_surface;
 		delete m_instance;
 		delete m_window;
+		delete m_job_system;
 		delete m_logger;
 	}
 
 
 	bool Engine::isRunning() const {
-		return !m_window->shouldClose();
+		if (!m_running) {
+			return false;
+		}
+
+		return isHeadless() || !m_window->shouldClose();
+	}
+
+
+	void Engine::stop() {
+		m_running = false;
 	}
 
 
 	void Engine::update() {
-		m_window->update();
+		// does nothing unless built with CARBON_TRACK_ALLOCATIONS
+		AllocationTracker::beginFrame();
+
+		if (!isHeadless()) {
+			m_window->update();
+		}
+
+		// simulation keeps its own rate, independent of how fast frames are drawn
+		u32 steps = m_clock.tick();
+
+		for (u32 i = 0; i < steps && m_fixed_update; i++) {
+			m_fixed_update(m_clock.getFixedStep());
+		}
+
+		if (isHeadless()) {
+			drawFrameHeadless();
+		} else if (!m_window->isMinimized()) {
+			// nothing to draw to while minimized
+			drawFrame();
+		}
+
+		AllocationTracker::endFrame();
+	}
+
+
+	void Engine::setFixedUpdate(const std::function<void(f64)> &fixedUpdate) {
+		m_fixed_update = fixedUpdate;
+	}
+
+
+	void Engine::setRenderGraphBuilder(const std::function<void(RenderGraph&, RenderGraph::ResourceHandle)> &buildGraph) {
+		m_build_render_graph = buildGraph;
+
+		// the images of the old graph are only destroyed once the frames in flight are done with them
+		buildRenderGraph();
+	}
+
+
+	void Engine::setRecordDraws(u32 drawCount, const CommandRecorder::RecordFn &recordDraws) {
+		m_draw_count = drawCount;
+		m_record_draws = recordDraws;
 	}
 
 
@@ -85,6 +633,11 @@ namespace carbon {
 	}
 
 
+	JobSystem& Engine::getJobSystem() const {
+		return *m_job_system;
+	}
+
+
 	const Instance& Engine::getInstance() const {
 		return *m_instance;
 	}
@@ -100,8 +653,86 @@ namespace carbon {
 	}
 
 
+	const CommandRecorder& Engine::getCommandRecorder() const {
+		return *m_command_recorder;
+	}
+
+
+	DescriptorAllocator& Engine::getDescriptorAllocator() const {
+		return *m_descriptor_allocator;
+	}
+
+
+	UniformRing& Engine::getUniformRing() const {
+		return *m_uniform_ring;
+	}
+
+
+	FrameArena& Engine::getFrameArena() const {
+		return *m_frame_arena;
+	}
+
+
+	UploadManager& Engine::getUploadManager() const {
+		return *m_upload_manager;
+	}
+
+
+	Defragmenter& Engine::getDefragmenter() const {
+		return *m_defragmenter;
+	}
+
+
+	const RenderGraph& Engine::getRenderGraph() const {
+		return *m_render_graph;
+	}
+
+
+	const RenderPassCache& Engine::getRenderPassCache() const {
+		return *m_render_pass_cache;
+	}
+
+
+	const PipelineCache& Engine::getPipelineCache() const {
+		return *m_pipeline_cache;
+	}
+
+
+	PipelineLibrary& Engine::getPipelineLibrary() const {
+		return *m_pipeline_library;
+	}
+
+
+	DescriptorLayoutCache& Engine::getDescriptorLayoutCache() const {
+		return *m_descriptor_layout_cache;
+	}
+
+
+	SamplerCache& Engine::getSamplerCache() const {
+		return *m_sampler_cache;
+	}
+
+
+	BindlessTable& Engine::getBindlessTable() const {
+		assert(m_bindless_table && "Device does not support bindless resources.");
+		return *m_bindless_table;
+	}
+
+
+	ShaderCache& Engine::getShaderCache() const {
+		return *m_shader_cache;
+	}
+
+
 	const Swapchain& Engine::getSwapchain() const {
+		assert(m_swapchain && "Headless engine has no swapchain.");
 		return *m_swapchain;
 	}
 
+
+	const Offscreen& Engine::getOffscreen() const {
+		assert(m_offscreen && "Windowed engine has no offscreen images.");
+		return *m_offscreen;
+	}
+
 } // namespace carbon
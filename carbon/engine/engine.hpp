@@ -10,9 +10,16 @@
 #include "config.hpp"
 
 #include "carbon/common/utils.hpp"
+#include "carbon/core/command_recorder.hpp"
+#include "carbon/core/time.hpp"
+#include "carbon/pipeline/render_graph.hpp"
 #include "carbon/display/window/window_glfw.hpp"
 
+#include <array>
+#include <cassert>
+#include <functional>
 #include <string>
+#include <vector>
 
 namespace carbon {
 
@@ -23,6 +30,49 @@ namespace carbon {
 	class LogicalDevice;
 	class Surface;
 	class Swapchain;
+	class Offscreen;
+	class JobSystem;
+
+	namespace engine {
+
+		/**
+		 * @brief How the engine presents the frames that it renders.
+		 */
+		enum class Mode {
+			/**
+			 * @brief Frames are presented to a window through a swapchain.
+			 */
+			Windowed = 0,
+
+			/**
+			 * @brief No window, surface or present queue is created and frames
+			 * are rendered into engine-owned offscreen images instead.
+			 */
+			Headless,
+
+			NONE
+		};
+
+		/**
+		 * @brief Time (in milliseconds) spent in each phase of starting the engine.
+		 * The instance and physical device are created while the window opens,
+		 * and the frame resources and caches while the swapchain is created,
+		 * so the phases add up to more than the total.
+		 */
+		struct StartupTimes {
+			f64 jobSystem{ 0.0 };
+			f64 window{ 0.0 };
+			f64 instance{ 0.0 };
+			f64 physicalDevice{ 0.0 };
+			f64 device{ 0.0 };
+			f64 presentation{ 0.0 };
+			f64 frameResources{ 0.0 };
+			f64 pipelineCache{ 0.0 };
+			f64 shaderCache{ 0.0 };
+			f64 total{ 0.0 };
+		};
+
+	} // namespace engine
 
 	/**
 	 * @brief Main engine that can be used to start creating a game.
@@ -38,6 +88,11 @@ namespace carbon {
 		 */
 		class Logger *m_logger = nullptr;
 
+		/**
+		 * @brief Schedules jobs across all cores.
+		 */
+		class JobSystem *m_job_system = nullptr;
+
 		/**
 		 * @brief Base Vulkan instance needed for almost everything.
 		 */
@@ -63,6 +118,63 @@ namespace carbon {
 		 */
 		class Swapchain *m_swapchain = nullptr;
 
+		/**
+		 * @brief Offscreen images to render to when running headless.
+		 */
+		class Offscreen *m_offscreen = nullptr;
+
+		/**
+		 * @brief Render passes and framebuffers, kept across render graph rebuilds.
+		 */
+		class RenderPassCache *m_render_pass_cache = nullptr;
+
+		/**
+		 * @brief Compiled pipelines, loaded from and saved to disk.
+		 */
+		class PipelineCache *m_pipeline_cache = nullptr;
+
+		/**
+		 * @brief Pipelines, compiled on the job system.
+		 */
+		class PipelineLibrary *m_pipeline_library = nullptr;
+
+		/**
+		 * @brief Descriptor set layouts, pipeline layouts and descriptor sets
+		 * whose resources never change.
+		 */
+		class DescriptorLayoutCache *m_descriptor_layout_cache = nullptr;
+
+		/**
+		 * @brief Samplers shared by every material that describes them the same way.
+		 */
+		class SamplerCache *m_sampler_cache = nullptr;
+
+		/**
+		 * @brief Textures and buffers that shaders index into, or `nullptr`
+		 * if the device does not support descriptor indexing.
+		 */
+		class BindlessTable *m_bindless_table = nullptr;
+
+		/**
+		 * @brief Shader modules, keyed by the hash of their code.
+		 */
+		class ShaderCache *m_shader_cache = nullptr;
+
+		/**
+		 * @brief Passes that make up each frame.
+		 */
+		class RenderGraph *m_render_graph = nullptr;
+
+		/**
+		 * @brief The swapchain or offscreen image in the render graph.
+		 */
+		RenderGraph::ResourceHandle m_backbuffer = 0;
+
+		/**
+		 * @brief Adds the passes of the render graph, or `nullptr` for the default graph.
+		 */
+		std::function<void(RenderGraph&, RenderGraph::ResourceHandle)> m_build_render_graph;
+
 		/**
 		 * @brief Base window that handles user interaction.
 		 */
@@ -73,6 +185,21 @@ namespace carbon {
 		 */
 		window::Props m_props{};
 
+		/**
+		 * @brief How the engine presents its frames.
+		 */
+		engine::Mode m_mode = engine::Mode::Windowed;
+
+		/**
+		 * @brief Set to `false` when the engine is asked to stop.
+		 */
+		bool m_running = true;
+
+		/**
+		 * @brief Time spent in each phase of starting the engine.
+		 */
+		engine::StartupTimes m_startup_times{};
+
 		/**
 		 * @brief Used to indicate if a resize operation is necessary.
 		 */
@@ -83,24 +210,225 @@ namespace carbon {
 		 */
 		size_t m_current_frame = 0;
 
+		/**
+		 * @brief Records the command buffers of each frame across threads.
+		 */
+		class CommandRecorder *m_command_recorder = nullptr;
+
+		/**
+		 * @brief Records a range of draws into a secondary command buffer.
+		 */
+		CommandRecorder::RecordFn m_record_draws;
+
+		/**
+		 * @brief Allocates the descriptor sets used by each frame across threads.
+		 */
+		class DescriptorAllocator *m_descriptor_allocator = nullptr;
+
+		/**
+		 * @brief Per-draw uniform data of each frame, bound with dynamic offsets.
+		 */
+		class UniformRing *m_uniform_ring = nullptr;
+
+		/**
+		 * @brief Scratch memory for data that only lives for a frame.
+		 */
+		class FrameArena *m_frame_arena = nullptr;
+
+		/**
+		 * @brief Streams data into device-local buffers on the transfer queue.
+		 */
+		class UploadManager *m_upload_manager = nullptr;
+
+		/**
+		 * @brief Moves buffers out of sparse memory blocks a little each frame.
+		 */
+		class Defragmenter *m_defragmenter = nullptr;
+
+		/**
+		 * @brief Semaphores that the graphics submission of the current frame waits on.
+		 */
+		std::vector<VkSemaphore> m_wait_semaphores;
+
+		/**
+		 * @brief Stages at which each of `m_wait_semaphores` is waited on.
+		 */
+		std::vector<VkPipelineStageFlags> m_wait_stages;
+
+		/**
+		 * @brief Number of draws to record every frame.
+		 */
+		u32 m_draw_count = 0;
+
+		/**
+		 * @brief Signalled when the swapchain image for each frame in flight
+		 * is ready to be rendered to.
+		 */
+		std::array<VkSemaphore, config::MAX_FRAMES_IN_FLIGHT> m_image_available_semaphores{};
+
+		/**
+		 * @brief Signalled when rendering for each frame in flight has finished
+		 * and the image can be presented.
+		 */
+		std::array<VkSemaphore, config::MAX_FRAMES_IN_FLIGHT> m_render_finished_semaphores{};
+
+		/**
+		 * @brief Signalled when the GPU has finished with the resources of each
+		 * frame in flight, so that the CPU can reuse them.
+		 */
+		std::array<VkFence, config::MAX_FRAMES_IN_FLIGHT> m_in_flight_fences{};
+
+		/**
+		 * @brief The fence of the frame currently using each swapchain image,
+		 * or `VK_NULL_HANDLE` if the image is not in use.
+		 */
+		std::vector<VkFence> m_images_in_flight;
+
+		/**
+		 * @brief Time (in milliseconds) that the CPU spent waiting on fences
+		 * during the last frame.
+		 */
+		double m_fence_wait_time = 0.0;
+
+		/**
+		 * @brief Total time (in milliseconds) that the CPU has spent waiting on
+		 * fences since the engine started.
+		 */
+		double m_total_fence_wait_time = 0.0;
+
+		/**
+		 * @brief Number of frames that have been submitted.
+		 */
+		u64 m_frame_count = 0;
+
+		/**
+		 * @brief Splits the time between frames into fixed simulation steps.
+		 */
+		FrameClock m_clock{ config::FIXED_TIMESTEP, config::MAX_CATCH_UP_STEPS };
+
+		/**
+		 * @brief Called once for every fixed simulation step.
+		 */
+		std::function<void(f64)> m_fixed_update;
+
+		/**
+		 * @brief Creates the job system, with one worker per core.
+		 */
+		void createJobSystem();
+
 		/**
 		 * @brief Creates the window for the Engine.
 		 */
 		void createWindow();
 
 		/**
-		 * @brief Creates all necessary Vulkan backend classes
-		 * needed to start the Engine.
+		 * @brief Creates the Vulkan instance and selects the physical device.
+		 * Does not touch the window, so it can run on any thread.
+		 */
+		void createInstance();
+
+		/**
+		 * @brief Creates the surface (if there is a window) and the logical device.
+		 */
+		void createDevice();
+
+		/**
+		 * @brief Creates the swapchain, or the offscreen images when headless.
+		 */
+		void createPresentation();
+
+		/**
+		 * @brief Creates the pipeline cache, loading the pipelines compiled in earlier runs.
+		 */
+		void createPipelineCache();
+
+		/**
+		 * @brief Creates the shader cache, mapping the shader index from earlier runs.
+		 */
+		void createShaderCache();
+
+		/**
+		 * @brief Starts all subsystems of the engine, overlapping the phases
+		 * that do not depend on each other.
 		 */
-		void createVulkan();
+		void startup();
+
+		/**
+		 * @brief Creates the command recorder and descriptor allocator, with
+		 * a command pool and descriptor pool for every worker and frame in
+		 * flight, and the uniform ring.
+		 */
+		void createCommandBuffers();
+
+		/**
+		 * @brief Creates the semaphores and fences used to synchronize each
+		 * frame in flight with the GPU.
+		 */
+		void createSyncObjects();
+
+		/**
+		 * @brief Destroys the command recorder, descriptor allocator, uniform
+		 * ring and synchronization objects.
+		 */
+		void destroyFrameResources();
+
+		/**
+		 * @brief Recreates the swapchain and resets the per-image fences.
+		 */
+		void recreateSwapchain();
+
+		/**
+		 * @brief Creates the render graph and adds its passes.
+		 */
+		void createRenderGraph();
+
+		/**
+		 * @brief Adds the passes of the render graph for the current swapchain
+		 * or offscreen images, and compiles it.
+		 */
+		void buildRenderGraph();
+
+		/**
+		 * @brief Records the draws in parallel and executes them in the given pass.
+		 * @param context The pass to draw in.
+		 */
+		void recordDraws(const RenderGraph::PassContext &context);
+
+		/**
+		 * @brief Records the commands for the current frame.
+		 * @param commandBuffer The command buffer to record into.
+		 * @param image The image to draw into.
+		 * @param view The view of the image to draw into.
+		 */
+		void recordCommandBuffer(VkCommandBuffer commandBuffer, VkImage image, VkImageView view);
+
+		/**
+		 * @brief Fills the wait semaphores of the current frame with those of the
+		 * uploads it has to wait for.
+		 */
+		void setWaitSemaphores();
+
+		/**
+		 * @brief Acquires the next swapchain image, records and submits the
+		 * commands for it and queues it for presentation.
+		 */
+		void drawFrame();
+
+		/**
+		 * @brief Moves on to the next offscreen image and records and submits
+		 * the commands for it. Nothing is presented.
+		 */
+		void drawFrameHeadless();
 
 	public:
 
 		/**
 		 * @brief Initializes the engine with a name. Version number is optional.
-		 * @param properties The properties for the Engine window.
+		 * @param properties The properties for the Engine window. When headless,
+		 * only the title, version and size are used.
+		 * @param mode [Optional] How the engine presents its frames.
 		 */
-		explicit Engine(const window::Props &properties);
+		explicit Engine(const window::Props &properties, engine::Mode mode = engine::Mode::Windowed);
 
 		/**
 		 * @brief Initializes the engine with all default settings.
@@ -122,17 +450,111 @@ namespace carbon {
 		bool isRunning() const;
 
 		/**
-		 * @brief Updates the engine.
+		 * @brief Stops the engine, so that `isRunning()` returns `false`.
+		 * Headless engines have no window to close, so this is how they end.
+		 */
+		void stop();
+
+		/**
+		 * @brief Updates the engine, runs any simulation steps that are due
+		 * and draws the next frame.
 		 */
 		void update();
 
+		/**
+		 * @brief Sets the function called for every fixed simulation step.
+		 * It is given the length (in seconds) of the step, which is always
+		 * `config::FIXED_TIMESTEP`.
+		 * @param fixedUpdate The function to call.
+		 */
+		void setFixedUpdate(const std::function<void(f64)> &fixedUpdate);
+
+		/**
+		 * @brief Sets the function that adds the passes of the render graph.
+		 * It is called again whenever the swapchain is recreated. The default
+		 * graph has a single pass that clears the backbuffer and runs the draws.
+		 * @param buildGraph The function to call, given the graph and its backbuffer.
+		 */
+		void setRenderGraphBuilder(const std::function<void(RenderGraph&, RenderGraph::ResourceHandle)> &buildGraph);
+
+		/**
+		 * @brief Sets the function that records the draws of every frame.
+		 * The draws are split into contiguous ranges that are recorded in
+		 * parallel into secondary command buffers, so the function must be
+		 * safe to call from multiple threads at once.
+		 * @param drawCount The number of draws to record every frame.
+		 * @param recordDraws The function that records a range of draws.
+		 */
+		void setRecordDraws(u32 drawCount, const CommandRecorder::RecordFn &recordDraws);
+
+		/**
+		 * @returns The time (in seconds) between the last two frames.
+		 */
+		const f64 getDeltaTime() const {
+			return m_clock.getDelta();
+		}
+
+		/**
+		 * @returns How far (from 0 to 1) the current frame is between the
+		 * last simulation step and the next, for interpolating rendered state.
+		 */
+		const f64 getInterpolationAlpha() const {
+			return m_clock.getAlpha();
+		}
+
+		/**
+		 * @returns The frame clock used to step the simulation.
+		 */
+		const FrameClock& getFrameClock() const {
+			return m_clock;
+		}
+
+		/**
+		 * @returns The time (in milliseconds) that the CPU spent waiting on
+		 * fences during the last frame. A consistently high value means that
+		 * the engine is GPU-bound.
+		 */
+		const double getFenceWaitTime() const {
+			return m_fence_wait_time;
+		}
+
+		/**
+		 * @returns The average time (in milliseconds) that the CPU has spent
+		 * waiting on fences per frame.
+		 */
+		const double getAverageFenceWaitTime() const {
+			return m_frame_count == 0 ? 0.0 : m_total_fence_wait_time / static_cast<double>(m_frame_count);
+		}
+
+		/**
+		 * @returns The time (in milliseconds) spent in each phase of starting the engine.
+		 */
+		const engine::StartupTimes& getStartupTimes() const {
+			return m_startup_times;
+		}
+
+		/**
+		 * @returns The number of frames that have been submitted.
+		 */
+		const u64 getFrameCount() const {
+			return m_frame_count;
+		}
+
 		/**
 		 * @returns The window associated with the engine.
 		 */
 		const WindowGLFW& getWindow() const {
+			assert(m_window && "Headless engine has no window.");
 			return *m_window;
 		}
 
+		/**
+		 * @returns `true` if the engine is rendering without a window, `false` otherwise.
+		 */
+		const bool isHeadless() const {
+			return m_mode == engine::Mode::Headless;
+		}
+
 		/**
 		 * @returns `true` if validation layers are enabled, `false` otherwise.
 		 */
@@ -143,6 +565,11 @@ namespace carbon {
 		 */
 		const class Logger& getLogger() const;
 
+		/**
+		 * @returns The job system used to spread work across all cores.
+		 */
+		class JobSystem& getJobSystem() const;
+
 		/**
 		 * @returns The instance associated with the engine.
 		 */
@@ -159,11 +586,94 @@ namespace carbon {
 		 */
 		const class LogicalDevice& getLogicalDevice() const;
 
+		/**
+		 * @returns The command recorder used to record each frame.
+		 */
+		const class CommandRecorder& getCommandRecorder() const;
+
+		/**
+		 * @returns The allocator for descriptor sets that only live for one frame.
+		 */
+		class DescriptorAllocator& getDescriptorAllocator() const;
+
+		/**
+		 * @returns The ring to write per-draw uniform data into.
+		 */
+		class UniformRing& getUniformRing() const;
+
+		/**
+		 * @returns The arena to allocate per-frame scratch data from.
+		 */
+		class FrameArena& getFrameArena() const;
+
+		/**
+		 * @returns The manager to upload buffer data through.
+		 */
+		class UploadManager& getUploadManager() const;
+
+		/**
+		 * @returns The defragmenter to track movable buffers with.
+		 */
+		class Defragmenter& getDefragmenter() const;
+
+		/**
+		 * @returns The render graph that makes up each frame.
+		 */
+		const class RenderGraph& getRenderGraph() const;
+
+		/**
+		 * @returns The cache of render passes and framebuffers used by the render graph.
+		 */
+		const class RenderPassCache& getRenderPassCache() const;
+
+		/**
+		 * @returns The pipeline cache to create pipelines with.
+		 */
+		const class PipelineCache& getPipelineCache() const;
+
+		/**
+		 * @returns The library to request pipelines from.
+		 */
+		class PipelineLibrary& getPipelineLibrary() const;
+
+		/**
+		 * @returns The cache to request layouts and static descriptor sets from.
+		 */
+		class DescriptorLayoutCache& getDescriptorLayoutCache() const;
+
+		/**
+		 * @returns The cache to request samplers from.
+		 */
+		class SamplerCache& getSamplerCache() const;
+
+		/**
+		 * @returns `true` if textures and buffers can be bound once and indexed
+		 * into by shaders, `false` otherwise.
+		 */
+		const bool hasBindless() const {
+			return m_bindless_table != nullptr;
+		}
+
+		/**
+		 * @returns The table of textures and buffers that shaders index into.
+		 */
+		class BindlessTable& getBindlessTable() const;
+
+		/**
+		 * @returns The cache to load shader modules from.
+		 */
+		class ShaderCache& getShaderCache() const;
+
 		/**
 		 * @returns The swapchain used in the engine.
 		 */
 		const Swapchain& getSwapchain() const;
 
+		/**
+		 * @returns The offscreen images rendered to when headless.
+		 */
+		const Offscreen& getOffscreen() const;
+
 	};
 
 } // namespace carbon
@@ -46,4 +46,11 @@
 #	define CARBON_USE_VALIDATION_LAYERS CARBON_TRUE
 #endif // CARBON_DISABLE_DEBUG
 
+// counts heap allocations made during frames, which steady frames should not make
+#ifdef CARBON_TRACK_ALLOCATIONS
+#	define CARBON_USE_ALLOCATION_TRACKING CARBON_TRUE
+#else
+#	define CARBON_USE_ALLOCATION_TRACKING CARBON_FALSE
+#endif // CARBON_TRACK_ALLOCATIONS
+
 #endif // MACROS_HPP
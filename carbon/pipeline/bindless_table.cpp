@@ -0,0 +1,307 @@
+// file      : carbon/pipeline/bindless_table.cpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#include "bindless_table.hpp"
+
+#include "carbon/common/logger.hpp"
+#include "carbon/core/host_allocator.hpp"
+#include "carbon/core/logical_device.hpp"
+#include "carbon/core/physical_device.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+namespace carbon {
+
+	u32 BindlessTable::acquire(Slots &slots) {
+		if (!slots.free.empty()) {
+			const u32 index = slots.free.back();
+			slots.free.pop_back();
+			return index;
+		}
+
+		if (slots.next < slots.capacity) {
+			return slots.next++;
+		}
+
+		return u32_max;
+	}
+
+
+	void BindlessTable::writeBuffer(u32 index) {
+		VkWriteDescriptorSet write;
+		initStruct(write, VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET);
+
+		write.dstSet = m_set;
+		write.dstBinding = BUFFER_BINDING;
+		write.dstArrayElement = index;
+		write.descriptorCount = 1;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		write.pBufferInfo = &m_buffer_infos[index];
+
+		vkUpdateDescriptorSets(m_logical_device->getHandle(), 1, &write, 0, nullptr);
+	}
+
+
+	void BindlessTable::create() {
+		VkDevice device = m_logical_device->getHandle();
+
+		std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+
+		bindings[0].binding = TEXTURE_BINDING;
+		bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		bindings[0].descriptorCount = m_textures.capacity;
+		bindings[0].stageFlags = VK_SHADER_STAGE_ALL;
+
+		bindings[1].binding = BUFFER_BINDING;
+		bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[1].descriptorCount = m_buffers.capacity;
+		bindings[1].stageFlags = VK_SHADER_STAGE_ALL;
+
+		// most of each array is empty, and entries change while frames are in flight
+		const VkDescriptorBindingFlags flags{
+			VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+			VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+			VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT
+		};
+
+		const std::array<VkDescriptorBindingFlags, 2> bindingFlags{ flags, flags };
+
+		VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo;
+		initStruct(flagsInfo, VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO);
+
+		flagsInfo.bindingCount = to_u32(bindingFlags.size());
+		flagsInfo.pBindingFlags = bindingFlags.data();
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo;
+		initStruct(layoutInfo, VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO);
+
+		layoutInfo.pNext = &flagsInfo;
+		layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+		layoutInfo.bindingCount = to_u32(bindings.size());
+		layoutInfo.pBindings = bindings.data();
+
+		if (vkCreateDescriptorSetLayout(device, &layoutInfo, HostAllocator::get(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT), &m_layout) != VK_SUCCESS) {
+			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to create bindless descriptor set layout.");
+		}
+
+		const std::array<VkDescriptorPoolSize, 2> poolSizes{ {
+			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_textures.capacity },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_buffers.capacity }
+		} };
+
+		VkDescriptorPoolCreateInfo poolInfo;
+		initStruct(poolInfo, VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO);
+
+		poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+		poolInfo.maxSets = 1;
+		poolInfo.poolSizeCount = to_u32(poolSizes.size());
+		poolInfo.pPoolSizes = poolSizes.data();
+
+		if (vkCreateDescriptorPool(device, &poolInfo, HostAllocator::get(VK_OBJECT_TYPE_DESCRIPTOR_POOL), &m_pool) != VK_SUCCESS) {
+			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to create bindless descriptor pool.");
+		}
+
+		VkDescriptorSetAllocateInfo allocInfo;
+		initStruct(allocInfo, VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO);
+
+		allocInfo.descriptorPool = m_pool;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &m_layout;
+
+		if (vkAllocateDescriptorSets(device, &allocInfo, &m_set) != VK_SUCCESS) {
+			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to allocate bindless descriptor set.");
+		}
+	}
+
+
+	BindlessTable::BindlessTable(LogicalDevice *logiDevice, PhysicalDevice *physDevice)
+		: m_logical_device(logiDevice)
+	{
+		assert(m_logical_device && physDevice && "Logical and physical device must not be null.");
+		assert(m_logical_device->isBindlessEnabled() && "Descriptor indexing must be enabled on the logical device.");
+
+		// combined image samplers count as both a sampler and a sampled image
+		const VkPhysicalDeviceDescriptorIndexingProperties &limits = physDevice->getDescriptorIndexingProperties();
+
+		m_textures.capacity = std::min({
+			config::BINDLESS_MAX_TEXTURES,
+			limits.maxDescriptorSetUpdateAfterBindSampledImages,
+			limits.maxDescriptorSetUpdateAfterBindSamplers,
+			limits.maxPerStageDescriptorUpdateAfterBindSampledImages,
+			limits.maxPerStageDescriptorUpdateAfterBindSamplers
+		});
+
+		m_buffers.capacity = std::min({
+			config::BINDLESS_MAX_BUFFERS,
+			limits.maxDescriptorSetUpdateAfterBindStorageBuffers,
+			limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers
+		});
+
+		m_buffer_infos.resize(m_buffers.capacity);
+
+		create();
+
+		CARBON_LOG_INFO(carbon::log::To::File, fmt::format("Bindless table holds {} textures and {} buffers.", m_textures.capacity, m_buffers.capacity));
+	}
+
+
+	BindlessTable::~BindlessTable() {
+		destroy();
+	}
+
+
+	void BindlessTable::destroy() {
+		VkDevice device = m_logical_device->getHandle();
+
+		// destroying the pool frees the set
+		if (m_pool != VK_NULL_HANDLE) {
+			vkDestroyDescriptorPool(device, m_pool, HostAllocator::get(VK_OBJECT_TYPE_DESCRIPTOR_POOL));
+			m_pool = VK_NULL_HANDLE;
+			m_set = VK_NULL_HANDLE;
+		}
+
+		if (m_layout != VK_NULL_HANDLE) {
+			vkDestroyDescriptorSetLayout(device, m_layout, HostAllocator::get(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT));
+			m_layout = VK_NULL_HANDLE;
+		}
+	}
+
+
+	void BindlessTable::beginFrame(u32 frameIdx) {
+		assert(frameIdx < config::MAX_FRAMES_IN_FLIGHT && "Frame index out of range.");
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		m_frame_idx = frameIdx;
+
+		for (Slots *slots : { &m_textures, &m_buffers }) {
+			std::vector<u32> &retired = slots->retired[m_frame_idx];
+			slots->free.insert(slots->free.end(), retired.begin(), retired.end());
+			retired.clear();
+		}
+	}
+
+
+	u32 BindlessTable::addTexture(VkImageView view, VkSampler sampler, VkImageLayout layout) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		const u32 index = acquire(m_textures);
+		if (index == u32_max) {
+			CARBON_LOG_ERROR(carbon::log::To::File, "Bindless table is out of texture slots.");
+			return u32_max;
+		}
+
+		VkDescriptorImageInfo imageInfo{ sampler, view, layout };
+
+		VkWriteDescriptorSet write;
+		initStruct(write, VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET);
+
+		write.dstSet = m_set;
+		write.dstBinding = TEXTURE_BINDING;
+		write.dstArrayElement = index;
+		write.descriptorCount = 1;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		write.pImageInfo = &imageInfo;
+
+		// no frame in flight reads this slot, so it can be written while the set is bound
+		vkUpdateDescriptorSets(m_logical_device->getHandle(), 1, &write, 0, nullptr);
+		return index;
+	}
+
+
+	u32 BindlessTable::addBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		const u32 index = acquire(m_buffers);
+		if (index == u32_max) {
+			CARBON_LOG_ERROR(carbon::log::To::File, "Bindless table is out of buffer slots.");
+			return u32_max;
+		}
+
+		m_buffer_infos[index] = { buffer, offset, range };
+
+		writeBuffer(index);
+		return index;
+	}
+
+
+	u32 BindlessTable::replaceBuffer(VkBuffer oldBuffer, VkBuffer newBuffer) {
+		assert(oldBuffer != VK_NULL_HANDLE && "Cannot replace a null buffer.");
+
+		// old and new index of each slot that moved
+		std::vector<std::pair<u32, u32>> moved;
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			for (u32 i = 0; i < m_buffers.next; i++) {
+				if (m_buffer_infos[i].buffer != oldBuffer) {
+					continue;
+				}
+
+				const u32 index = acquire(m_buffers);
+
+				// nowhere to move to, so the slot has to be rewritten while frames in flight may read it
+				if (index == u32_max) {
+					CARBON_LOG_ERROR(carbon::log::To::File, "Bindless table is out of buffer slots, so a moved buffer is rewritten in place.");
+
+					m_buffer_infos[i].buffer = newBuffer;
+					writeBuffer(i);
+					continue;
+				}
+
+				m_buffer_infos[index] = m_buffer_infos[i];
+				m_buffer_infos[index].buffer = newBuffer;
+				writeBuffer(index);
+
+				// frames in flight still read the old slot, and the old buffer lives as long as they do
+				m_buffer_infos[i].buffer = VK_NULL_HANDLE;
+				m_buffers.retired[m_frame_idx].push_back(i);
+
+				moved.emplace_back(i, index);
+			}
+		}
+
+		// called without the lock, since listeners may add or remove entries
+		for (const auto &entry : moved) {
+			for (const auto &listener : m_listeners) {
+				listener(entry.first, entry.second);
+			}
+		}
+
+		return to_u32(moved.size());
+	}
+
+
+	void BindlessTable::addListener(Listener listener) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_listeners.push_back(std::move(listener));
+	}
+
+
+	void BindlessTable::removeTexture(u32 index) {
+		assert(index < m_textures.next && "Texture index was never handed out.");
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		// the descriptor is left as is, since partially bound entries that are not read need not be valid
+		m_textures.retired[m_frame_idx].push_back(index);
+	}
+
+
+	void BindlessTable::removeBuffer(u32 index) {
+		assert(index < m_buffers.next && "Buffer index was never handed out.");
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		// removed buffers may be destroyed, and must not be mistaken for a later buffer with the same handle
+		m_buffer_infos[index].buffer = VK_NULL_HANDLE;
+		m_buffers.retired[m_frame_idx].push_back(index);
+	}
+
+
+	void BindlessTable::bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout layout, u32 setIdx) const {
+		vkCmdBindDescriptorSets(commandBuffer, bindPoint, layout, setIdx, 1, &m_set, 0, nullptr);
+	}
+
+} // namespace carbon
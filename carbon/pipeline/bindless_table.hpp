@@ -0,0 +1,257 @@
+// file      : carbon/pipeline/bindless_table.hpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#pragma once
+
+#ifndef PIPELINE_BINDLESS_TABLE_HPP
+#define PIPELINE_BINDLESS_TABLE_HPP
+
+#include "carbon/backend.hpp"
+#include "carbon/engine/config.hpp"
+
+#include <array>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace carbon {
+
+	// forward-declare classes that would result in circular dependency
+	class LogicalDevice;
+	class PhysicalDevice;
+
+	/**
+	 * @brief One descriptor set holding a large array of textures and a
+	 * large array of storage buffers, which is bound once per command
+	 * buffer. Shaders index into the arrays (for example by material ID)
+	 * instead of having a set bound for every draw. The arrays are updated
+	 * after being bound, so resources can be added while frames are in
+	 * flight. Requires descriptor indexing, see `LogicalDevice::isBindlessEnabled()`.
+	 * Safe to use from any thread.
+	 */
+	class BindlessTable {
+
+	public:
+
+		/**
+		 * @brief Called with the old and the new index of a buffer that was
+		 * given a new slot, so anything that refers to the old index can be updated.
+		 */
+		using Listener = std::function<void(u32, u32)>;
+
+	private:
+
+		/**
+		 * @brief Hands out the indices of one of the arrays.
+		 */
+		struct Slots {
+			u32 capacity{ 0 };
+			u32 next{ 0 };
+			std::vector<u32> free;
+			std::array<std::vector<u32>, config::MAX_FRAMES_IN_FLIGHT> retired;
+		};
+
+		/**
+		 * @brief The logical device to create the set on.
+		 */
+		const class LogicalDevice *m_logical_device;
+
+		/**
+		 * @brief Layout of the set, with the textures and buffers as partially bound arrays.
+		 */
+		VkDescriptorSetLayout m_layout{ VK_NULL_HANDLE };
+
+		/**
+		 * @brief Pool that the set is allocated from.
+		 */
+		VkDescriptorPool m_pool{ VK_NULL_HANDLE };
+
+		/**
+		 * @brief The set holding every texture and buffer.
+		 */
+		VkDescriptorSet m_set{ VK_NULL_HANDLE };
+
+		/**
+		 * @brief Guards the slots and writes to the set.
+		 */
+		std::mutex m_mutex;
+
+		/**
+		 * @brief Indices into the array of textures.
+		 */
+		Slots m_textures;
+
+		/**
+		 * @brief Indices into the array of buffers.
+		 */
+		Slots m_buffers;
+
+		/**
+		 * @brief What each buffer slot points at, so slots can be rewritten when a buffer moves.
+		 */
+		std::vector<VkDescriptorBufferInfo> m_buffer_infos;
+
+		/**
+		 * @brief Functions to tell when a buffer gets a new slot.
+		 */
+		std::vector<Listener> m_listeners;
+
+		/**
+		 * @brief Index of the frame in flight that removed indices are retired to.
+		 */
+		u32 m_frame_idx{ 0 };
+
+		/**
+		 * @param slots The slots to take from.
+		 * @returns A free index, or `u32_max` if the array is full.
+		 */
+		static u32 acquire(Slots &slots);
+
+		/**
+		 * @brief Writes the slot of a buffer into the set. The mutex must be held.
+		 * @param index The index of the buffer.
+		 */
+		void writeBuffer(u32 index);
+
+		/**
+		 * @brief Creates the layout, pool and set.
+		 */
+		void create();
+
+	public:
+
+		/**
+		 * @brief Binding of the array of combined image samplers.
+		 */
+		static constexpr u32 TEXTURE_BINDING = 0;
+
+		/**
+		 * @brief Binding of the array of storage buffers.
+		 */
+		static constexpr u32 BUFFER_BINDING = 1;
+
+		/**
+		 * @brief Creates the table, with arrays as large as the config asks
+		 * for or the device allows, whichever is smaller.
+		 * @param logiDevice The logical device to use.
+		 * @param physDevice The physical device, for its limits.
+		 */
+		explicit BindlessTable(class LogicalDevice *logiDevice, class PhysicalDevice *physDevice);
+
+		BindlessTable(const BindlessTable&) = delete;
+
+		BindlessTable& operator=(const BindlessTable&) = delete;
+
+		/**
+		 * @brief Destructor for the bindless table.
+		 */
+		~BindlessTable();
+
+		/**
+		 * @brief Destroys the set, its pool and its layout.
+		 */
+		void destroy();
+
+		/**
+		 * @brief Moves on to the given frame in flight, so indices removed
+		 * when it last ran can be handed out again. The GPU must have
+		 * finished with the frame.
+		 * @param frameIdx The index of the frame in flight.
+		 */
+		void beginFrame(u32 frameIdx);
+
+		/**
+		 * @brief Adds a texture to the table.
+		 * @param view The view of the image.
+		 * @param sampler The sampler to read the image with.
+		 * @param layout [Optional] The layout the image is in when read.
+		 * @returns The index of the texture, or `u32_max` if the table is full.
+		 */
+		u32 addTexture(VkImageView view, VkSampler sampler, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+		/**
+		 * @brief Adds a storage buffer to the table.
+		 * @param buffer The buffer.
+		 * @param offset [Optional] Start of the range (in bytes) shaders can access.
+		 * @param range [Optional] Size of the range (in bytes) shaders can access.
+		 * @returns The index of the buffer, or `u32_max` if the table is full.
+		 */
+		u32 addBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+
+		/**
+		 * @brief Moves every slot that holds a buffer to a new slot holding
+		 * its new handle, for buffers that moved to other memory with the same
+		 * contents. Frames in flight may still read the old slots, which cannot
+		 * be rewritten while they do, so the old slots are retired like removed
+		 * ones and listeners are told the new indices to use from now on.
+		 * @param oldBuffer The handle the buffer had when it was added.
+		 * @param newBuffer The handle the buffer has now.
+		 * @returns The number of slots that were moved.
+		 */
+		u32 replaceBuffer(VkBuffer oldBuffer, VkBuffer newBuffer);
+
+		/**
+		 * @brief Adds a function to call whenever a buffer gets a new slot.
+		 * Listeners are called on the thread that records the frame, before
+		 * anything in the frame is drawn.
+		 * @param listener The function to call.
+		 */
+		void addListener(Listener listener);
+
+		/**
+		 * @brief Removes a texture. Its index is only reused once frames that
+		 * may still read it have finished.
+		 * @param index The index returned by `addTexture()`.
+		 */
+		void removeTexture(u32 index);
+
+		/**
+		 * @brief Removes a buffer. Its index is only reused once frames that
+		 * may still read it have finished.
+		 * @param index The index returned by `addBuffer()`.
+		 */
+		void removeBuffer(u32 index);
+
+		/**
+		 * @brief Binds the table, which stays bound for every draw after it.
+		 * @param commandBuffer The command buffer to bind in.
+		 * @param bindPoint Whether to bind for graphics or compute.
+		 * @param layout A pipeline layout that has the table's set layout at `setIdx`.
+		 * @param setIdx [Optional] The set number to bind the table to.
+		 */
+		void bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout layout, u32 setIdx = 0) const;
+
+		/**
+		 * @returns The layout of the set, for creating pipeline layouts.
+		 */
+		const VkDescriptorSetLayout& getSetLayout() const {
+			return m_layout;
+		}
+
+		/**
+		 * @returns The set holding every texture and buffer.
+		 */
+		const VkDescriptorSet& getSet() const {
+			return m_set;
+		}
+
+		/**
+		 * @returns The number of textures the table can hold.
+		 */
+		const u32 getTextureCapacity() const {
+			return m_textures.capacity;
+		}
+
+		/**
+		 * @returns The number of buffers the table can hold.
+		 */
+		const u32 getBufferCapacity() const {
+			return m_buffers.capacity;
+		}
+
+	};
+
+} // namespace carbon
+
+#endif // PIPELINE_BINDLESS_TABLE_HPP
@@ -0,0 +1,354 @@
+// file      : carbon/pipeline/descriptor_layout_cache.cpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#include "descriptor_layout_cache.hpp"
+
+#include "carbon/common/logger.hpp"
+#include "carbon/core/descriptor_allocator.hpp"
+#include "carbon/core/deletion_queue.hpp"
+#include "carbon/core/host_allocator.hpp"
+#include "carbon/core/logical_device.hpp"
+#include "carbon/engine/config.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace carbon {
+
+	/**
+	 * @brief Number of words each bound resource takes up in the key of a set.
+	 */
+	static constexpr size_t RESOURCE_WORDS = 8;
+
+	/**
+	 * @brief Number of words before the first resource in the key of a set.
+	 */
+	static constexpr size_t SET_HEADER_WORDS = 2;
+
+	/**
+	 * @param type The type of descriptor.
+	 * @returns `true` if the descriptor refers to a buffer, `false` if it refers to an image or sampler.
+	 */
+	static bool isBufferType(VkDescriptorType type) {
+		return type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER || type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC ||
+			type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER || type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+	}
+
+
+	VkDescriptorPool DescriptorLayoutCache::createPool() const {
+		const std::vector<VkDescriptorPoolSize> sizes = DescriptorAllocator::getPoolSizes(config::DESCRIPTOR_SETS_PER_POOL);
+
+		VkDescriptorPoolCreateInfo info;
+		initStruct(info, VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO);
+
+		// sets only live as long as their resources, so they have to be freed one at a time
+		info.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+		info.maxSets = config::DESCRIPTOR_SETS_PER_POOL;
+		info.poolSizeCount = to_u32(sizes.size());
+		info.pPoolSizes = sizes.data();
+
+		VkDescriptorPool pool{ VK_NULL_HANDLE };
+
+		if (vkCreateDescriptorPool(m_logical_device->getHandle(), &info, HostAllocator::get(VK_OBJECT_TYPE_DESCRIPTOR_POOL), &pool) != VK_SUCCESS) {
+			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to create descriptor pool.");
+		}
+
+		return pool;
+	}
+
+
+	DescriptorLayoutCache::Set DescriptorLayoutCache::allocate(VkDescriptorSetLayout layout) {
+		VkDescriptorSetAllocateInfo info;
+		initStruct(info, VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO);
+
+		info.descriptorSetCount = 1;
+		info.pSetLayouts = &layout;
+
+		Set set;
+
+		// a new pool is empty, so at most one more try is needed
+		for (u32 attempt = 0; attempt < 2; attempt++) {
+			if (m_pools.empty() || attempt > 0) {
+				m_pools.push_back(createPool());
+			}
+
+			set.pool = m_pools.back();
+			info.descriptorPool = set.pool;
+
+			const VkResult result = vkAllocateDescriptorSets(m_logical_device->getHandle(), &info, &set.handle);
+
+			if (result == VK_SUCCESS) {
+				return set;
+			}
+
+			if (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL) {
+				break;
+			}
+		}
+
+		CARBON_LOG_FATAL(carbon::log::To::File, "Failed to allocate descriptor set.");
+		return {};
+	}
+
+
+	void DescriptorLayoutCache::evictHandle(u64 handle) {
+		DeletionQueue &deletionQueue = m_logical_device->getDeletionQueue();
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		for (auto it = m_sets.begin(); it != m_sets.end();) {
+			const Key &key = it->first;
+			bool uses = false;
+
+			// only compare the words that hold the buffer, sampler and image view
+			for (size_t i = SET_HEADER_WORDS; i < key.size() && !uses; i += RESOURCE_WORDS) {
+				uses = key[i + 2] == handle || key[i + 5] == handle || key[i + 6] == handle;
+			}
+
+			if (uses) {
+				// frames in flight may still have the set bound
+				deletionQueue.pushDescriptorSet(it->second.pool, it->second.handle);
+				it = m_sets.erase(it);
+			} else {
+				++it;
+			}
+		}
+	}
+
+
+	DescriptorLayoutCache::DescriptorLayoutCache(LogicalDevice *logiDevice)
+		: m_logical_device(logiDevice)
+	{
+		assert(m_logical_device && "Logical device must not be null.");
+	}
+
+
+	DescriptorLayoutCache::~DescriptorLayoutCache() {
+		destroy();
+	}
+
+
+	void DescriptorLayoutCache::destroy() {
+		VkDevice device = m_logical_device->getHandle();
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		// destroying the pools frees the sets allocated from them
+		for (auto pool : m_pools) {
+			vkDestroyDescriptorPool(device, pool, HostAllocator::get(VK_OBJECT_TYPE_DESCRIPTOR_POOL));
+		}
+
+		for (auto &entry : m_pipeline_layouts) {
+			vkDestroyPipelineLayout(device, entry.second, HostAllocator::get(VK_OBJECT_TYPE_PIPELINE_LAYOUT));
+		}
+
+		for (auto &entry : m_set_layouts) {
+			vkDestroyDescriptorSetLayout(device, entry.second, HostAllocator::get(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT));
+		}
+
+		m_pools.clear();
+		m_sets.clear();
+		m_pipeline_layouts.clear();
+		m_set_layouts.clear();
+	}
+
+
+	VkDescriptorSetLayout DescriptorLayoutCache::getSetLayout(
+		const std::vector<VkDescriptorSetLayoutBinding> &bindings,
+		VkDescriptorSetLayoutCreateFlags flags
+	) {
+		// the same bindings in a different order make the same layout
+		std::vector<VkDescriptorSetLayoutBinding> sorted{ bindings };
+		std::sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b) {
+			return a.binding < b.binding;
+		});
+
+		Key key;
+		key.reserve(2 + sorted.size() * 5);
+
+		key.push_back(flags);
+		key.push_back(sorted.size());
+
+		for (const auto &b : sorted) {
+			key.push_back(b.binding);
+			key.push_back(b.descriptorType);
+			key.push_back(b.descriptorCount);
+			key.push_back(b.stageFlags);
+
+			// immutable samplers are part of the layout
+			if (b.pImmutableSamplers == nullptr) {
+				key.push_back(u64_max);
+			} else {
+				for (u32 i = 0; i < b.descriptorCount; i++) {
+					key.push_back(utils::handleToWord(b.pImmutableSamplers[i]));
+				}
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		auto it = m_set_layouts.find(key);
+		if (it != m_set_layouts.end()) {
+			m_hits++;
+			return it->second;
+		}
+
+		m_misses++;
+
+		VkDescriptorSetLayoutCreateInfo info;
+		initStruct(info, VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO);
+
+		info.flags = flags;
+		info.bindingCount = to_u32(sorted.size());
+		info.pBindings = sorted.data();
+
+		VkDescriptorSetLayout layout{ VK_NULL_HANDLE };
+
+		if (vkCreateDescriptorSetLayout(m_logical_device->getHandle(), &info, HostAllocator::get(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT), &layout) != VK_SUCCESS) {
+			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to create descriptor set layout.");
+		}
+
+		m_set_layouts.emplace(std::move(key), layout);
+		return layout;
+	}
+
+
+	VkPipelineLayout DescriptorLayoutCache::getPipelineLayout(
+		const std::vector<VkDescriptorSetLayout> &setLayouts,
+		const std::vector<VkPushConstantRange> &pushConstants
+	) {
+		Key key;
+		key.reserve(2 + setLayouts.size() + pushConstants.size() * 3);
+
+		// set layouts come from this cache, so equal handles mean equal layouts
+		key.push_back(setLayouts.size());
+		for (const auto setLayout : setLayouts) {
+			key.push_back(utils::handleToWord(setLayout));
+		}
+
+		key.push_back(pushConstants.size());
+		for (const auto &range : pushConstants) {
+			key.push_back(range.stageFlags);
+			key.push_back(range.offset);
+			key.push_back(range.size);
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		auto it = m_pipeline_layouts.find(key);
+		if (it != m_pipeline_layouts.end()) {
+			m_hits++;
+			return it->second;
+		}
+
+		m_misses++;
+
+		VkPipelineLayoutCreateInfo info;
+		initStruct(info, VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO);
+
+		info.setLayoutCount = to_u32(setLayouts.size());
+		info.pSetLayouts = setLayouts.data();
+		info.pushConstantRangeCount = to_u32(pushConstants.size());
+		info.pPushConstantRanges = pushConstants.data();
+
+		VkPipelineLayout layout{ VK_NULL_HANDLE };
+
+		if (vkCreatePipelineLayout(m_logical_device->getHandle(), &info, HostAllocator::get(VK_OBJECT_TYPE_PIPELINE_LAYOUT), &layout) != VK_SUCCESS) {
+			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to create pipeline layout.");
+		}
+
+		m_pipeline_layouts.emplace(std::move(key), layout);
+		return layout;
+	}
+
+
+	VkDescriptorSet DescriptorLayoutCache::getSet(VkDescriptorSetLayout layout, const std::vector<DescriptorResource> &resources) {
+		Key key;
+		key.reserve(SET_HEADER_WORDS + resources.size() * RESOURCE_WORDS);
+
+		key.push_back(utils::handleToWord(layout));
+		key.push_back(resources.size());
+
+		// only the info matching the type is used, so leave the other out of the key
+		for (const auto &r : resources) {
+			const bool isBuffer = isBufferType(r.type);
+
+			key.push_back((static_cast<u64>(r.binding) << 32) | r.arrayElement);
+			key.push_back(r.type);
+			key.push_back(isBuffer ? utils::handleToWord(r.buffer.buffer) : 0);
+			key.push_back(isBuffer ? r.buffer.offset : 0);
+			key.push_back(isBuffer ? r.buffer.range : 0);
+			key.push_back(isBuffer ? 0 : utils::handleToWord(r.image.sampler));
+			key.push_back(isBuffer ? 0 : utils::handleToWord(r.image.imageView));
+			key.push_back(isBuffer ? 0 : r.image.imageLayout);
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		auto it = m_sets.find(key);
+		if (it != m_sets.end()) {
+			m_hits++;
+			return it->second.handle;
+		}
+
+		m_misses++;
+		Set set = allocate(layout);
+
+		// the only time this set is ever written
+		std::vector<VkWriteDescriptorSet> writes(resources.size());
+
+		for (size_t i = 0; i < resources.size(); i++) {
+			const DescriptorResource &r = resources[i];
+			assert(r.type != VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER && r.type != VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER && "Texel buffers are not supported.");
+
+			initStruct(writes[i], VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET);
+
+			writes[i].dstSet = set.handle;
+			writes[i].dstBinding = r.binding;
+			writes[i].dstArrayElement = r.arrayElement;
+			writes[i].descriptorCount = 1;
+			writes[i].descriptorType = r.type;
+
+			if (isBufferType(r.type)) {
+				writes[i].pBufferInfo = &r.buffer;
+			} else {
+				writes[i].pImageInfo = &r.image;
+			}
+		}
+
+		vkUpdateDescriptorSets(m_logical_device->getHandle(), to_u32(writes.size()), writes.data(), 0, nullptr);
+
+		m_sets.emplace(std::move(key), set);
+		return set.handle;
+	}
+
+
+	const size_t DescriptorLayoutCache::getSetLayoutCount() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_set_layouts.size();
+	}
+
+
+	const size_t DescriptorLayoutCache::getPipelineLayoutCount() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_pipeline_layouts.size();
+	}
+
+
+	const size_t DescriptorLayoutCache::getSetCount() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_sets.size();
+	}
+
+
+	const u64 DescriptorLayoutCache::getHitCount() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_hits;
+	}
+
+
+	const u64 DescriptorLayoutCache::getMissCount() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_misses;
+	}
+
+} // namespace carbon
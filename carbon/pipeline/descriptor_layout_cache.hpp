@@ -0,0 +1,213 @@
+// file      : carbon/pipeline/descriptor_layout_cache.hpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#pragma once
+
+#ifndef PIPELINE_DESCRIPTOR_LAYOUT_CACHE_HPP
+#define PIPELINE_DESCRIPTOR_LAYOUT_CACHE_HPP
+
+#include "carbon/backend.hpp"
+#include "carbon/common/utils.hpp"
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace carbon {
+
+	// forward-declare classes that would result in circular dependency
+	class LogicalDevice;
+
+	/**
+	 * @brief A resource bound to one element of a descriptor set. Only the
+	 * buffer or image info matching the type is used.
+	 */
+	struct DescriptorResource {
+		u32 binding{ 0 };
+		u32 arrayElement{ 0 };
+		VkDescriptorType type{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER };
+		VkDescriptorBufferInfo buffer{};
+		VkDescriptorImageInfo image{};
+	};
+
+	/**
+	 * @brief Owns every descriptor set layout and pipeline layout, so that
+	 * identical descriptions share one object. Also keeps descriptor sets
+	 * whose resources never change (such as those of static materials),
+	 * which are written once and handed out again whenever the same
+	 * resources are bound. Safe to use from any thread.
+	 */
+	class DescriptorLayoutCache {
+
+	private:
+
+		/**
+		 * @brief Flattened description of a layout or descriptor set.
+		 */
+		using Key = std::vector<u64>;
+
+		/**
+		 * @brief A cached descriptor set and the pool it came from.
+		 */
+		struct Set {
+			VkDescriptorSet handle{ VK_NULL_HANDLE };
+			VkDescriptorPool pool{ VK_NULL_HANDLE };
+		};
+
+		/**
+		 * @brief The logical device to create the objects on.
+		 */
+		const class LogicalDevice *m_logical_device;
+
+		/**
+		 * @brief Guards the maps, since layouts may be requested from jobs.
+		 */
+		std::mutex m_mutex;
+
+		/**
+		 * @brief Descriptor set layouts, keyed by their bindings.
+		 */
+		std::unordered_map<Key, VkDescriptorSetLayout, utils::WordHash> m_set_layouts;
+
+		/**
+		 * @brief Pipeline layouts, keyed by their set layouts and push constants.
+		 */
+		std::unordered_map<Key, VkPipelineLayout, utils::WordHash> m_pipeline_layouts;
+
+		/**
+		 * @brief Descriptor sets, keyed by their layout and bound resources.
+		 */
+		std::unordered_map<Key, Set, utils::WordHash> m_sets;
+
+		/**
+		 * @brief Pools that the cached sets are allocated from. Sets are only
+		 * allocated from the last one.
+		 */
+		std::vector<VkDescriptorPool> m_pools;
+
+		/**
+		 * @brief Number of requests that returned an existing object.
+		 */
+		u64 m_hits{ 0 };
+
+		/**
+		 * @brief Number of requests that had to create a new object.
+		 */
+		u64 m_misses{ 0 };
+
+		/**
+		 * @returns A new descriptor pool whose sets can be freed.
+		 */
+		VkDescriptorPool createPool() const;
+
+		/**
+		 * @brief Allocates a set from the last pool, adding a pool if it is full.
+		 * @param layout The layout of the set.
+		 * @returns The set.
+		 */
+		Set allocate(VkDescriptorSetLayout layout);
+
+		/**
+		 * @brief Frees every cached set that has the handle bound.
+		 * @param handle The handle as stored in the keys.
+		 */
+		void evictHandle(u64 handle);
+
+	public:
+
+		/**
+		 * @brief Creates an empty cache.
+		 * @param logiDevice The logical device to use.
+		 */
+		explicit DescriptorLayoutCache(class LogicalDevice *logiDevice);
+
+		DescriptorLayoutCache(const DescriptorLayoutCache&) = delete;
+
+		DescriptorLayoutCache& operator=(const DescriptorLayoutCache&) = delete;
+
+		/**
+		 * @brief Destructor for the descriptor layout cache.
+		 */
+		~DescriptorLayoutCache();
+
+		/**
+		 * @brief Destroys every layout, set and pool in the cache.
+		 * The GPU must have finished with all of them.
+		 */
+		void destroy();
+
+		/**
+		 * @brief Gets a descriptor set layout, creating it on a miss. The
+		 * order of the bindings does not matter.
+		 * @param bindings The bindings of the set.
+		 * @param flags [Optional] The flags to create the layout with.
+		 * @returns The set layout, which is owned by the cache.
+		 */
+		VkDescriptorSetLayout getSetLayout(
+			const std::vector<VkDescriptorSetLayoutBinding> &bindings,
+			VkDescriptorSetLayoutCreateFlags flags = 0
+		);
+
+		/**
+		 * @brief Gets a pipeline layout, creating it on a miss.
+		 * @param setLayouts The layouts of the descriptor sets.
+		 * @param pushConstants [Optional] The push constant ranges.
+		 * @returns The pipeline layout, which is owned by the cache.
+		 */
+		VkPipelineLayout getPipelineLayout(
+			const std::vector<VkDescriptorSetLayout> &setLayouts,
+			const std::vector<VkPushConstantRange> &pushConstants = {}
+		);
+
+		/**
+		 * @brief Gets a descriptor set with the resources bound, allocating
+		 * and writing it on a miss. The set must not be updated afterwards.
+		 * @param layout The layout of the set.
+		 * @param resources The resources bound to the set.
+		 * @returns The descriptor set, which is owned by the cache.
+		 */
+		VkDescriptorSet getSet(VkDescriptorSetLayout layout, const std::vector<DescriptorResource> &resources);
+
+		/**
+		 * @brief Frees every cached set that has the buffer, image view or
+		 * sampler bound. Must be called before the resource is destroyed,
+		 * since a new resource may reuse its handle. The sets are freed once
+		 * no frame in flight can still be using them.
+		 * @param handle The resource that is going away.
+		 */
+		template<class T>
+		void evict(T handle) {
+			evictHandle(utils::handleToWord(handle));
+		}
+
+		/**
+		 * @returns The number of descriptor set layouts in the cache.
+		 */
+		const size_t getSetLayoutCount();
+
+		/**
+		 * @returns The number of pipeline layouts in the cache.
+		 */
+		const size_t getPipelineLayoutCount();
+
+		/**
+		 * @returns The number of descriptor sets in the cache.
+		 */
+		const size_t getSetCount();
+
+		/**
+		 * @returns The number of requests that returned an existing object.
+		 */
+		const u64 getHitCount();
+
+		/**
+		 * @returns The number of requests that had to create a new object.
+		 */
+		const u64 getMissCount();
+
+	};
+
+} // namespace carbon
+
+#endif // PIPELINE_DESCRIPTOR_LAYOUT_CACHE_HPP
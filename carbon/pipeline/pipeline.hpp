@@ -0,0 +1,108 @@
+// file      : carbon/pipeline/pipeline.hpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#pragma once
+
+#ifndef PIPELINE_PIPELINE_HPP
+#define PIPELINE_PIPELINE_HPP
+
+#include "carbon/backend.hpp"
+#include "carbon/core/job_system.hpp"
+
+namespace carbon {
+
+	/**
+	 * @brief Handle on a pipeline that may still be compiling in the
+	 * background. Owned by the `PipelineLibrary` that created it.
+	 */
+	class Pipeline {
+
+	private:
+
+		friend class PipelineLibrary;
+
+		/**
+		 * @brief Whether the pipeline is for graphics or compute.
+		 */
+		VkPipelineBindPoint m_bind_point;
+
+		/**
+		 * @brief The layout of the descriptor sets and push constants.
+		 */
+		VkPipelineLayout m_layout;
+
+		/**
+		 * @brief Handle on the underlying pipeline, set once compiling is done.
+		 */
+		VkPipeline m_pipeline{ VK_NULL_HANDLE };
+
+		/**
+		 * @brief Reaches zero once the pipeline has been compiled.
+		 */
+		JobCounter m_compiled;
+
+		/**
+		 * @param bindPoint Whether the pipeline is for graphics or compute.
+		 * @param layout The layout of the pipeline.
+		 */
+		Pipeline(VkPipelineBindPoint bindPoint, VkPipelineLayout layout)
+			: m_bind_point(bindPoint)
+			, m_layout(layout)
+		{}
+
+	public:
+
+		Pipeline(const Pipeline&) = delete;
+
+		Pipeline& operator=(const Pipeline&) = delete;
+
+		/**
+		 * @returns `true` if the pipeline has been compiled and can be bound, `false` otherwise.
+		 */
+		bool isReady() const {
+			return m_compiled.isDone();
+		}
+
+		/**
+		 * @brief Binds the pipeline if it is ready. Draws that need it can be
+		 * skipped for the frames where it is not.
+		 * @param commandBuffer The command buffer to bind the pipeline in.
+		 * @returns `true` if the pipeline was bound, `false` if it is still compiling.
+		 */
+		bool bind(VkCommandBuffer commandBuffer) const {
+			if (!isReady()) {
+				return false;
+			}
+
+			vkCmdBindPipeline(commandBuffer, m_bind_point, m_pipeline);
+			return true;
+		}
+
+		/**
+		 * @returns The handle on the underlying pipeline, or `VK_NULL_HANDLE`
+		 * if it is still compiling.
+		 */
+		const VkPipeline getHandle() const {
+			return isReady() ? m_pipeline : VK_NULL_HANDLE;
+		}
+
+		/**
+		 * @returns The layout of the pipeline.
+		 */
+		const VkPipelineLayout& getLayout() const {
+			return m_layout;
+		}
+
+		/**
+		 * @returns Whether the pipeline is for graphics or compute.
+		 */
+		const VkPipelineBindPoint& getBindPoint() const {
+			return m_bind_point;
+		}
+
+	};
+
+} // namespace carbon
+
+#endif // PIPELINE_PIPELINE_HPP
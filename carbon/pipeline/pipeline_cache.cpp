@@ -0,0 +1,161 @@
+// file      : carbon/pipeline/pipeline_cache.cpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#include "pipeline_cache.hpp"
+
+#include "carbon/common/logger.hpp"
+#include "carbon/core/host_allocator.hpp"
+#include "carbon/core/logical_device.hpp"
+#include "carbon/core/physical_device.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace carbon {
+
+	/**
+	 * @brief Layout of the header at the start of all pipeline cache data,
+	 * as defined by `VK_PIPELINE_CACHE_HEADER_VERSION_ONE`.
+	 */
+	struct PipelineCacheHeader {
+		u32 headerSize;
+		u32 headerVersion;
+		u32 vendorID;
+		u32 deviceID;
+		u8 pipelineCacheUUID[VK_UUID_SIZE];
+	};
+
+
+	std::vector<char> PipelineCache::load() const {
+		std::ifstream file(m_path, std::ios::binary | std::ios::ate);
+
+		// first run, or the file was removed
+		if (!file.is_open()) {
+			return {};
+		}
+
+		std::vector<char> data(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+
+		if (!file.read(data.data(), data.size())) {
+			CARBON_LOG_WARN(carbon::log::To::File, fmt::format("Failed to read pipeline cache `{}`.", m_path));
+			return {};
+		}
+
+		if (!isCompatible(data)) {
+			CARBON_LOG_INFO(carbon::log::To::File, fmt::format("Ignoring pipeline cache `{}` from a different device or driver.", m_path));
+			return {};
+		}
+
+		return data;
+	}
+
+
+	bool PipelineCache::isCompatible(const std::vector<char> &data) const {
+		if (data.size() < sizeof(PipelineCacheHeader)) {
+			return false;
+		}
+
+		// data from disk may not be aligned
+		PipelineCacheHeader header;
+		std::memcpy(&header, data.data(), sizeof(header));
+
+		const VkPhysicalDeviceProperties &props = m_physical_device->getProperties();
+
+		// a newer driver may have changed the UUID, in which case the data is useless
+		return header.headerSize >= sizeof(PipelineCacheHeader)
+			&& header.headerSize <= data.size()
+			&& header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+			&& header.vendorID == props.vendorID
+			&& header.deviceID == props.deviceID
+			&& std::memcmp(header.pipelineCacheUUID, props.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+	}
+
+
+	void PipelineCache::create() {
+		const std::vector<char> data = load();
+
+		VkPipelineCacheCreateInfo info;
+		initStruct(info, VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO);
+
+		info.initialDataSize = data.size();
+		info.pInitialData = data.empty() ? nullptr : data.data();
+
+		if (vkCreatePipelineCache(m_logical_device->getHandle(), &info, HostAllocator::get(VK_OBJECT_TYPE_PIPELINE_CACHE), &m_pipeline_cache) != VK_SUCCESS) {
+			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to create pipeline cache.");
+		}
+
+		m_loaded_size = data.size();
+	}
+
+
+	PipelineCache::PipelineCache(LogicalDevice *logiDevice, PhysicalDevice *physDevice, const std::string &path)
+		: m_logical_device(logiDevice)
+		, m_physical_device(physDevice)
+		, m_path(path)
+	{
+		assert(m_logical_device && m_physical_device && "Logical device and physical device must not be null.");
+		create();
+	}
+
+
+	PipelineCache::~PipelineCache() {
+		destroy();
+	}
+
+
+	void PipelineCache::destroy() {
+		if (m_pipeline_cache == VK_NULL_HANDLE) {
+			return;
+		}
+
+		vkDestroyPipelineCache(m_logical_device->getHandle(), m_pipeline_cache, HostAllocator::get(VK_OBJECT_TYPE_PIPELINE_CACHE));
+		m_pipeline_cache = VK_NULL_HANDLE;
+	}
+
+
+	bool PipelineCache::save() const {
+		assert(m_pipeline_cache != VK_NULL_HANDLE && "Pipeline cache has been destroyed.");
+		VkDevice device = m_logical_device->getHandle();
+
+		// query size, then data
+		size_t size{ 0 };
+		if (vkGetPipelineCacheData(device, m_pipeline_cache, &size, nullptr) != VK_SUCCESS || size == 0) {
+			return false;
+		}
+
+		std::vector<char> data(size);
+		if (vkGetPipelineCacheData(device, m_pipeline_cache, &size, data.data()) != VK_SUCCESS) {
+			CARBON_LOG_WARN(carbon::log::To::File, "Failed to get pipeline cache data.");
+			return false;
+		}
+
+		std::error_code err;
+		const std::filesystem::path path{ m_path };
+		std::filesystem::create_directories(path.parent_path(), err);
+
+		// write next to the old file and swap, so a crash never leaves half a cache
+		const std::filesystem::path tmpPath{ m_path + ".tmp" };
+		{
+			std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+
+			if (!file.is_open() || !file.write(data.data(), size)) {
+				CARBON_LOG_WARN(carbon::log::To::File, fmt::format("Failed to write pipeline cache `{}`.", m_path));
+				return false;
+			}
+		}
+
+		std::filesystem::rename(tmpPath, path, err);
+		if (err) {
+			CARBON_LOG_WARN(carbon::log::To::File, fmt::format("Failed to replace pipeline cache `{}`: {}", m_path, err.message()));
+			std::filesystem::remove(tmpPath, err);
+			return false;
+		}
+
+		return true;
+	}
+
+} // namespace carbon
@@ -0,0 +1,135 @@
+// file      : carbon/pipeline/pipeline_cache.hpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#pragma once
+
+#ifndef PIPELINE_PIPELINE_CACHE_HPP
+#define PIPELINE_PIPELINE_CACHE_HPP
+
+#include "carbon/backend.hpp"
+
+#include <string>
+#include <vector>
+
+namespace carbon {
+
+	// forward-declare classes that would result in circular dependency
+	class LogicalDevice;
+	class PhysicalDevice;
+
+	/**
+	 * @brief A Vulkan pipeline cache that is kept on disk between runs, so
+	 * pipelines compiled in an earlier run do not have to be compiled again.
+	 * The file is only used if it was written by the same GPU and driver.
+	 */
+	class PipelineCache {
+
+	private:
+
+		/**
+		 * @brief The logical device to create the pipeline cache on.
+		 */
+		const class LogicalDevice *m_logical_device;
+
+		/**
+		 * @brief The physical device that the cached pipelines were compiled for.
+		 */
+		const class PhysicalDevice *m_physical_device;
+
+		/**
+		 * @brief Path of the file that the cache is loaded from and saved to.
+		 */
+		std::string m_path;
+
+		/**
+		 * @brief Handle on the underlying pipeline cache.
+		 */
+		VkPipelineCache m_pipeline_cache{ VK_NULL_HANDLE };
+
+		/**
+		 * @brief Size (in bytes) of the data loaded from disk, or 0 if nothing was loaded.
+		 */
+		size_t m_loaded_size{ 0 };
+
+		/**
+		 * @brief Reads the cache file, keeping it only if its header matches the current device.
+		 * @returns The contents of the file, or nothing if it is missing or does not match.
+		 */
+		std::vector<char> load() const;
+
+		/**
+		 * @brief Checks that the cache data was written by the current GPU and driver.
+		 * @param data The cache data, starting with its header.
+		 * @returns `true` if the data can be given to the driver, `false` otherwise.
+		 */
+		bool isCompatible(const std::vector<char> &data) const;
+
+		/**
+		 * @brief Creates the pipeline cache with the data from disk, if any.
+		 */
+		void create();
+
+	public:
+
+		/**
+		 * @brief Creates the pipeline cache, loading it from the given file if it is valid.
+		 * @param logiDevice The logical device to use.
+		 * @param physDevice The physical device (GPU) to use.
+		 * @param path The file to load the cache from and save it to.
+		 */
+		explicit PipelineCache(class LogicalDevice *logiDevice, class PhysicalDevice *physDevice, const std::string &path);
+
+		PipelineCache(const PipelineCache&) = delete;
+
+		PipelineCache& operator=(const PipelineCache&) = delete;
+
+		/**
+		 * @brief Destructor for the pipeline cache.
+		 */
+		~PipelineCache();
+
+		/**
+		 * @brief Destroys the pipeline cache without saving it.
+		 */
+		void destroy();
+
+		/**
+		 * @brief Writes the pipeline cache to disk, replacing the previous file.
+		 * @returns `true` if the cache was written, `false` otherwise.
+		 */
+		bool save() const;
+
+		/**
+		 * @returns The handle on the underlying pipeline cache.
+		 */
+		const VkPipelineCache& getHandle() const {
+			return m_pipeline_cache;
+		}
+
+		/**
+		 * @returns The path of the cache file.
+		 */
+		const std::string& getPath() const {
+			return m_path;
+		}
+
+		/**
+		 * @returns `true` if the cache was loaded from disk, `false` if it started empty.
+		 */
+		const bool isWarm() const {
+			return m_loaded_size > 0;
+		}
+
+		/**
+		 * @returns The size (in bytes) of the data loaded from disk.
+		 */
+		const size_t getLoadedSize() const {
+			return m_loaded_size;
+		}
+
+	};
+
+} // namespace carbon
+
+#endif // PIPELINE_PIPELINE_CACHE_HPP
@@ -0,0 +1,125 @@
+// file      : carbon/pipeline/pipeline_library.cpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#include "pipeline_library.hpp"
+
+#include "pipeline.hpp"
+#include "pipeline_cache.hpp"
+#include "pipeline_state.hpp"
+#include "carbon/common/logger.hpp"
+#include "carbon/core/host_allocator.hpp"
+#include "carbon/core/job_system.hpp"
+#include "carbon/core/logical_device.hpp"
+
+#include <cassert>
+
+namespace carbon {
+
+	const Pipeline* PipelineLibrary::request(
+		Key &&key,
+		VkPipelineBindPoint bindPoint,
+		VkPipelineLayout layout,
+		std::function<VkPipeline(VkDevice, VkPipelineCache)> &&compile
+	) {
+		Pipeline *pipeline{ nullptr };
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			auto it = m_pipelines.find(key);
+			if (it != m_pipelines.end()) {
+				return it->second;
+			}
+
+			pipeline = new Pipeline(bindPoint, layout);
+			m_pipelines.emplace(std::move(key), pipeline);
+		}
+
+		// the counter is raised before the job is queued, so the pipeline is never seen as ready early;
+		// compiles go on the background queue, so a frame waiting on its own jobs never runs one
+		m_job_system->runBackground([this, pipeline, compile = std::move(compile)]() {
+			pipeline->m_pipeline = compile(m_logical_device->getHandle(), m_pipeline_cache->getHandle());
+		}, &pipeline->m_compiled);
+
+		return pipeline;
+	}
+
+
+	PipelineLibrary::PipelineLibrary(LogicalDevice *logiDevice, PipelineCache *pipelineCache, JobSystem *jobSystem)
+		: m_logical_device(logiDevice)
+		, m_pipeline_cache(pipelineCache)
+		, m_job_system(jobSystem)
+	{
+		assert(m_logical_device && m_pipeline_cache && m_job_system && "Logical device, pipeline cache and job system must not be null.");
+	}
+
+
+	PipelineLibrary::~PipelineLibrary() {
+		destroy();
+	}
+
+
+	void PipelineLibrary::destroy() {
+		// compile jobs write into the pipelines
+		waitAll();
+
+		VkDevice device = m_logical_device->getHandle();
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		for (auto &entry : m_pipelines) {
+			if (entry.second->m_pipeline != VK_NULL_HANDLE) {
+				vkDestroyPipeline(device, entry.second->m_pipeline, HostAllocator::get(VK_OBJECT_TYPE_PIPELINE));
+			}
+
+			delete entry.second;
+		}
+
+		m_pipelines.clear();
+	}
+
+
+	const Pipeline* PipelineLibrary::getPipeline(const GraphicsPipelineState &state) {
+		return request(state.getKey(), VK_PIPELINE_BIND_POINT_GRAPHICS, state.getLayout(), [state](VkDevice device, VkPipelineCache cache) {
+			return state.create(device, cache);
+		});
+	}
+
+
+	const Pipeline* PipelineLibrary::getPipeline(const ComputePipelineState &state) {
+		return request(state.getKey(), VK_PIPELINE_BIND_POINT_COMPUTE, state.getLayout(), [state](VkDevice device, VkPipelineCache cache) {
+			return state.create(device, cache);
+		});
+	}
+
+
+	void PipelineLibrary::wait(const Pipeline &pipeline) {
+		m_job_system->wait(pipeline.m_compiled);
+	}
+
+
+	void PipelineLibrary::waitAll() {
+		std::vector<const Pipeline*> pipelines;
+
+		// do not hold the lock while waiting, since the jobs run meanwhile may request pipelines
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			pipelines.reserve(m_pipelines.size());
+
+			for (const auto &entry : m_pipelines) {
+				pipelines.push_back(entry.second);
+			}
+		}
+
+		for (const Pipeline *pipeline : pipelines) {
+			wait(*pipeline);
+		}
+	}
+
+
+	const size_t PipelineLibrary::getPipelineCount() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_pipelines.size();
+	}
+
+} // namespace carbon
@@ -0,0 +1,144 @@
+// file      : carbon/pipeline/pipeline_library.hpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#pragma once
+
+#ifndef PIPELINE_PIPELINE_LIBRARY_HPP
+#define PIPELINE_PIPELINE_LIBRARY_HPP
+
+#include "carbon/backend.hpp"
+#include "carbon/common/utils.hpp"
+
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace carbon {
+
+	// forward-declare classes that would result in circular dependency
+	class LogicalDevice;
+	class PipelineCache;
+	class JobSystem;
+	class Pipeline;
+	class GraphicsPipelineState;
+	class ComputePipelineState;
+
+	/**
+	 * @brief Owns every pipeline. Requesting a pipeline
+	 * returns straight away: a new description is compiled as a background
+	 * job on the job system, and a description that was requested before returns the
+	 * same pipeline. Safe to use from any thread.
+	 */
+	class PipelineLibrary {
+
+	private:
+
+		/**
+		 * @brief Flattened description of a pipeline.
+		 */
+		using Key = std::vector<u64>;
+
+		/**
+		 * @brief The logical device to create the pipelines on.
+		 */
+		const class LogicalDevice *m_logical_device;
+
+		/**
+		 * @brief The pipeline cache to compile with.
+		 */
+		const class PipelineCache *m_pipeline_cache;
+
+		/**
+		 * @brief The job system whose workers compile the pipelines.
+		 */
+		class JobSystem *m_job_system;
+
+		/**
+		 * @brief Guards the maps, since pipelines may be requested from jobs.
+		 */
+		std::mutex m_mutex;
+
+		/**
+		 * @brief All pipelines, keyed by their state.
+		 */
+		std::unordered_map<Key, class Pipeline*, utils::WordHash> m_pipelines;
+
+		/**
+		 * @brief Returns the pipeline with the given key, or creates it and
+		 * schedules the compile function on a miss.
+		 * @param key The flattened state of the pipeline.
+		 * @param bindPoint Whether the pipeline is for graphics or compute.
+		 * @param layout The layout of the pipeline.
+		 * @param compile Compiles the pipeline and returns it.
+		 * @returns The pipeline, which may still be compiling.
+		 */
+		const class Pipeline* request(
+			Key &&key,
+			VkPipelineBindPoint bindPoint,
+			VkPipelineLayout layout,
+			std::function<VkPipeline(VkDevice, VkPipelineCache)> &&compile
+		);
+
+	public:
+
+		/**
+		 * @brief Creates an empty pipeline library.
+		 * @param logiDevice The logical device to use.
+		 * @param pipelineCache The pipeline cache to compile with.
+		 * @param jobSystem The job system to compile on.
+		 */
+		explicit PipelineLibrary(class LogicalDevice *logiDevice, class PipelineCache *pipelineCache, class JobSystem *jobSystem);
+
+		PipelineLibrary(const PipelineLibrary&) = delete;
+
+		PipelineLibrary& operator=(const PipelineLibrary&) = delete;
+
+		/**
+		 * @brief Destructor for the pipeline library.
+		 */
+		~PipelineLibrary();
+
+		/**
+		 * @brief Waits for all compiles to finish, then destroys every
+		 * pipeline. The GPU must have finished with them.
+		 */
+		void destroy();
+
+		/**
+		 * @brief Gets a graphics pipeline, compiling it in the background if it does not exist yet.
+		 * @param state The state of the pipeline.
+		 * @returns The pipeline, which may still be compiling.
+		 */
+		const class Pipeline* getPipeline(const class GraphicsPipelineState &state);
+
+		/**
+		 * @brief Gets a compute pipeline, compiling it in the background if it does not exist yet.
+		 * @param state The state of the pipeline.
+		 * @returns The pipeline, which may still be compiling.
+		 */
+		const class Pipeline* getPipeline(const class ComputePipelineState &state);
+
+		/**
+		 * @brief Waits for the pipeline to finish compiling, helping with
+		 * frame jobs in the meantime.
+		 * @param pipeline The pipeline to wait for.
+		 */
+		void wait(const class Pipeline &pipeline);
+
+		/**
+		 * @brief Waits for every pipeline to finish compiling.
+		 */
+		void waitAll();
+
+		/**
+		 * @returns The number of pipelines in the library.
+		 */
+		const size_t getPipelineCount();
+
+	};
+
+} // namespace carbon
+
+#endif // PIPELINE_PIPELINE_LIBRARY_HPP
@@ -0,0 +1,296 @@
+// file      : carbon/pipeline/pipeline_state.cpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#include "pipeline_state.hpp"
+
+#include "carbon/common/logger.hpp"
+#include "carbon/common/utils.hpp"
+#include "carbon/core/host_allocator.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstring>
+
+namespace carbon {
+
+	/**
+	 * @brief Appends a string to a key, eight characters per word.
+	 * @param key The key to append to.
+	 * @param str The string to append.
+	 */
+	static void appendString(std::vector<u64> &key, const std::string &str) {
+		key.push_back(str.size());
+
+		for (size_t i = 0; i < str.size(); i += sizeof(u64)) {
+			u64 word{ 0 };
+			std::memcpy(&word, str.data() + i, std::min(sizeof(u64), str.size() - i));
+			key.push_back(word);
+		}
+	}
+
+
+	GraphicsPipelineState& GraphicsPipelineState::addShaderStage(VkShaderStageFlagBits stage, VkShaderModule module, const std::string &entryPoint) {
+		m_stages.push_back({ stage, module, entryPoint });
+		return *this;
+	}
+
+
+	GraphicsPipelineState& GraphicsPipelineState::setVertexInput(
+		const std::vector<VkVertexInputBindingDescription> &bindings,
+		const std::vector<VkVertexInputAttributeDescription> &attributes
+	) {
+		m_vertex_bindings = bindings;
+		m_vertex_attributes = attributes;
+		return *this;
+	}
+
+
+	GraphicsPipelineState& GraphicsPipelineState::setTopology(VkPrimitiveTopology topology) {
+		m_topology = topology;
+		return *this;
+	}
+
+
+	GraphicsPipelineState& GraphicsPipelineState::setRasterization(VkPolygonMode polygonMode, VkCullModeFlags cullMode, VkFrontFace frontFace) {
+		m_polygon_mode = polygonMode;
+		m_cull_mode = cullMode;
+		m_front_face = frontFace;
+		return *this;
+	}
+
+
+	GraphicsPipelineState& GraphicsPipelineState::setMultisampling(VkSampleCountFlagBits samples) {
+		m_samples = samples;
+		return *this;
+	}
+
+
+	GraphicsPipelineState& GraphicsPipelineState::setDepth(bool test, bool write, VkCompareOp compare) {
+		m_depth_test = test;
+		m_depth_write = write;
+		m_depth_compare = compare;
+		return *this;
+	}
+
+
+	GraphicsPipelineState& GraphicsPipelineState::setColourBlend(u32 attachmentCount, bool alphaBlend) {
+		m_colour_attachment_count = attachmentCount;
+		m_alpha_blend = alphaBlend;
+		return *this;
+	}
+
+
+	GraphicsPipelineState& GraphicsPipelineState::setLayout(VkPipelineLayout layout) {
+		m_layout = layout;
+		return *this;
+	}
+
+
+	GraphicsPipelineState& GraphicsPipelineState::setRenderPass(VkRenderPass renderPass, u32 subpass) {
+		m_render_pass = renderPass;
+		m_subpass = subpass;
+		return *this;
+	}
+
+
+	std::vector<u64> GraphicsPipelineState::getKey() const {
+		std::vector<u64> key;
+		key.reserve(16 + m_stages.size() * 4 + m_vertex_bindings.size() * 3 + m_vertex_attributes.size() * 4);
+
+		// keeps graphics and compute keys apart
+		key.push_back(VK_PIPELINE_BIND_POINT_GRAPHICS);
+
+		key.push_back(m_stages.size());
+		for (const auto &s : m_stages) {
+			key.push_back(s.stage);
+			key.push_back(utils::handleToWord(s.module));
+			appendString(key, s.entryPoint);
+		}
+
+		key.push_back(m_vertex_bindings.size());
+		for (const auto &b : m_vertex_bindings) {
+			key.push_back(b.binding);
+			key.push_back(b.stride);
+			key.push_back(b.inputRate);
+		}
+
+		key.push_back(m_vertex_attributes.size());
+		for (const auto &a : m_vertex_attributes) {
+			key.push_back(a.location);
+			key.push_back(a.binding);
+			key.push_back(a.format);
+			key.push_back(a.offset);
+		}
+
+		key.push_back(m_topology);
+		key.push_back(m_polygon_mode);
+		key.push_back(m_cull_mode);
+		key.push_back(m_front_face);
+		key.push_back(m_samples);
+		key.push_back(m_depth_test);
+		key.push_back(m_depth_write);
+		key.push_back(m_depth_compare);
+		key.push_back(m_colour_attachment_count);
+		key.push_back(m_alpha_blend);
+		key.push_back(utils::handleToWord(m_layout));
+		key.push_back(utils::handleToWord(m_render_pass));
+		key.push_back(m_subpass);
+
+		return key;
+	}
+
+
+	VkPipeline GraphicsPipelineState::create(VkDevice device, VkPipelineCache cache) const {
+		assert(m_layout != VK_NULL_HANDLE && m_render_pass != VK_NULL_HANDLE && "Pipeline layout and render pass must be set.");
+
+		// shader stages
+		std::vector<VkPipelineShaderStageCreateInfo> stages(m_stages.size());
+
+		for (size_t i = 0; i < m_stages.size(); i++) {
+			initStruct(stages[i], VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO);
+			stages[i].stage = m_stages[i].stage;
+			stages[i].module = m_stages[i].module;
+			stages[i].pName = m_stages[i].entryPoint.c_str();
+		}
+
+		// vertex input
+		VkPipelineVertexInputStateCreateInfo vertexInput;
+		initStruct(vertexInput, VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO);
+
+		vertexInput.vertexBindingDescriptionCount = to_u32(m_vertex_bindings.size());
+		vertexInput.pVertexBindingDescriptions = m_vertex_bindings.data();
+		vertexInput.vertexAttributeDescriptionCount = to_u32(m_vertex_attributes.size());
+		vertexInput.pVertexAttributeDescriptions = m_vertex_attributes.data();
+
+		VkPipelineInputAssemblyStateCreateInfo inputAssembly;
+		initStruct(inputAssembly, VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO);
+		inputAssembly.topology = m_topology;
+
+		// viewport and scissor are set when recording
+		VkPipelineViewportStateCreateInfo viewport;
+		initStruct(viewport, VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO);
+		viewport.viewportCount = 1;
+		viewport.scissorCount = 1;
+
+		VkPipelineRasterizationStateCreateInfo rasterization;
+		initStruct(rasterization, VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO);
+		rasterization.polygonMode = m_polygon_mode;
+		rasterization.cullMode = m_cull_mode;
+		rasterization.frontFace = m_front_face;
+		rasterization.lineWidth = 1.0f;
+
+		VkPipelineMultisampleStateCreateInfo multisample;
+		initStruct(multisample, VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO);
+		multisample.rasterizationSamples = m_samples;
+
+		VkPipelineDepthStencilStateCreateInfo depthStencil;
+		initStruct(depthStencil, VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO);
+		depthStencil.depthTestEnable = m_depth_test ? VK_TRUE : VK_FALSE;
+		depthStencil.depthWriteEnable = m_depth_write ? VK_TRUE : VK_FALSE;
+		depthStencil.depthCompareOp = m_depth_compare;
+
+		// same blending for every colour attachment
+		VkPipelineColorBlendAttachmentState blend{};
+		blend.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+		if (m_alpha_blend) {
+			blend.blendEnable = VK_TRUE;
+			blend.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+			blend.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+			blend.colorBlendOp = VK_BLEND_OP_ADD;
+			blend.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+			blend.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+			blend.alphaBlendOp = VK_BLEND_OP_ADD;
+		}
+
+		std::vector<VkPipelineColorBlendAttachmentState> blends(m_colour_attachment_count, blend);
+
+		VkPipelineColorBlendStateCreateInfo colourBlend;
+		initStruct(colourBlend, VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO);
+		colourBlend.attachmentCount = to_u32(blends.size());
+		colourBlend.pAttachments = blends.data();
+
+		const std::array<VkDynamicState, 2> dynamicStates{ VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+		VkPipelineDynamicStateCreateInfo dynamic;
+		initStruct(dynamic, VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO);
+		dynamic.dynamicStateCount = to_u32(dynamicStates.size());
+		dynamic.pDynamicStates = dynamicStates.data();
+
+		// put it all together
+		VkGraphicsPipelineCreateInfo info;
+		initStruct(info, VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO);
+
+		info.stageCount = to_u32(stages.size());
+		info.pStages = stages.data();
+		info.pVertexInputState = &vertexInput;
+		info.pInputAssemblyState = &inputAssembly;
+		info.pViewportState = &viewport;
+		info.pRasterizationState = &rasterization;
+		info.pMultisampleState = &multisample;
+		info.pDepthStencilState = &depthStencil;
+		info.pColorBlendState = &colourBlend;
+		info.pDynamicState = &dynamic;
+		info.layout = m_layout;
+		info.renderPass = m_render_pass;
+		info.subpass = m_subpass;
+
+		VkPipeline pipeline{ VK_NULL_HANDLE };
+
+		if (vkCreateGraphicsPipelines(device, cache, 1, &info, HostAllocator::get(VK_OBJECT_TYPE_PIPELINE), &pipeline) != VK_SUCCESS) {
+			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to create graphics pipeline.");
+		}
+
+		return pipeline;
+	}
+
+
+	ComputePipelineState& ComputePipelineState::setShader(VkShaderModule module, const std::string &entryPoint) {
+		m_module = module;
+		m_entry_point = entryPoint;
+		return *this;
+	}
+
+
+	ComputePipelineState& ComputePipelineState::setLayout(VkPipelineLayout layout) {
+		m_layout = layout;
+		return *this;
+	}
+
+
+	std::vector<u64> ComputePipelineState::getKey() const {
+		std::vector<u64> key;
+
+		key.push_back(VK_PIPELINE_BIND_POINT_COMPUTE);
+		key.push_back(utils::handleToWord(m_module));
+		appendString(key, m_entry_point);
+		key.push_back(utils::handleToWord(m_layout));
+
+		return key;
+	}
+
+
+	VkPipeline ComputePipelineState::create(VkDevice device, VkPipelineCache cache) const {
+		assert(m_module != VK_NULL_HANDLE && m_layout != VK_NULL_HANDLE && "Compute shader and pipeline layout must be set.");
+
+		VkComputePipelineCreateInfo info;
+		initStruct(info, VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO);
+
+		initStruct(info.stage, VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO);
+		info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		info.stage.module = m_module;
+		info.stage.pName = m_entry_point.c_str();
+		info.layout = m_layout;
+
+		VkPipeline pipeline{ VK_NULL_HANDLE };
+
+		if (vkCreateComputePipelines(device, cache, 1, &info, HostAllocator::get(VK_OBJECT_TYPE_PIPELINE), &pipeline) != VK_SUCCESS) {
+			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to create compute pipeline.");
+		}
+
+		return pipeline;
+	}
+
+} // namespace carbon
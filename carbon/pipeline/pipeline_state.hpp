@@ -0,0 +1,208 @@
+// file      : carbon/pipeline/pipeline_state.hpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#pragma once
+
+#ifndef PIPELINE_PIPELINE_STATE_HPP
+#define PIPELINE_PIPELINE_STATE_HPP
+
+#include "carbon/backend.hpp"
+
+#include <string>
+#include <vector>
+
+namespace carbon {
+
+	/**
+	 * @brief Describes a graphics pipeline. Every setter returns the state so
+	 * calls can be chained, and the whole description can be flattened into
+	 * a key so that identical pipelines are only compiled once. Viewport and
+	 * scissor are always dynamic, so pipelines do not depend on the window size.
+	 */
+	class GraphicsPipelineState {
+
+	private:
+
+		/**
+		 * @brief A shader and the stage it runs in.
+		 */
+		struct Stage {
+			VkShaderStageFlagBits stage;
+			VkShaderModule module;
+			std::string entryPoint;
+		};
+
+		std::vector<Stage> m_stages;
+
+		std::vector<VkVertexInputBindingDescription> m_vertex_bindings;
+		std::vector<VkVertexInputAttributeDescription> m_vertex_attributes;
+
+		VkPrimitiveTopology m_topology{ VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST };
+
+		VkPolygonMode m_polygon_mode{ VK_POLYGON_MODE_FILL };
+		VkCullModeFlags m_cull_mode{ VK_CULL_MODE_BACK_BIT };
+		VkFrontFace m_front_face{ VK_FRONT_FACE_COUNTER_CLOCKWISE };
+
+		VkSampleCountFlagBits m_samples{ VK_SAMPLE_COUNT_1_BIT };
+
+		bool m_depth_test{ false };
+		bool m_depth_write{ false };
+		VkCompareOp m_depth_compare{ VK_COMPARE_OP_LESS };
+
+		u32 m_colour_attachment_count{ 1 };
+		bool m_alpha_blend{ false };
+
+		VkPipelineLayout m_layout{ VK_NULL_HANDLE };
+		VkRenderPass m_render_pass{ VK_NULL_HANDLE };
+		u32 m_subpass{ 0 };
+
+	public:
+
+		/**
+		 * @brief Adds a shader to the pipeline.
+		 * @param stage The stage that the shader runs in.
+		 * @param module The shader module.
+		 * @param entryPoint [Optional] The function to start the shader at.
+		 * @returns This state, for chaining.
+		 */
+		GraphicsPipelineState& addShaderStage(VkShaderStageFlagBits stage, VkShaderModule module, const std::string &entryPoint = "main");
+
+		/**
+		 * @brief Sets the layout of the vertex buffers.
+		 * @param bindings The vertex buffers and their strides.
+		 * @param attributes The attributes read from the vertex buffers.
+		 * @returns This state, for chaining.
+		 */
+		GraphicsPipelineState& setVertexInput(
+			const std::vector<VkVertexInputBindingDescription> &bindings,
+			const std::vector<VkVertexInputAttributeDescription> &attributes
+		);
+
+		/**
+		 * @param topology The kind of primitives to assemble from the vertices.
+		 * @returns This state, for chaining.
+		 */
+		GraphicsPipelineState& setTopology(VkPrimitiveTopology topology);
+
+		/**
+		 * @brief Sets how primitives are turned into fragments.
+		 * @param polygonMode How to fill the primitives.
+		 * @param cullMode Which faces to discard.
+		 * @param frontFace The winding order of front faces.
+		 * @returns This state, for chaining.
+		 */
+		GraphicsPipelineState& setRasterization(VkPolygonMode polygonMode, VkCullModeFlags cullMode, VkFrontFace frontFace);
+
+		/**
+		 * @param samples The number of samples per pixel of the attachments.
+		 * @returns This state, for chaining.
+		 */
+		GraphicsPipelineState& setMultisampling(VkSampleCountFlagBits samples);
+
+		/**
+		 * @brief Sets how the depth attachment is used.
+		 * @param test `true` to discard fragments that fail the depth test.
+		 * @param write `true` to write the depth of fragments that pass.
+		 * @param compare [Optional] The depth test to use.
+		 * @returns This state, for chaining.
+		 */
+		GraphicsPipelineState& setDepth(bool test, bool write, VkCompareOp compare = VK_COMPARE_OP_LESS);
+
+		/**
+		 * @brief Sets how the colour attachments are written.
+		 * @param attachmentCount The number of colour attachments in the subpass.
+		 * @param alphaBlend `true` to blend using the source alpha, otherwise overwrite.
+		 * @returns This state, for chaining.
+		 */
+		GraphicsPipelineState& setColourBlend(u32 attachmentCount, bool alphaBlend);
+
+		/**
+		 * @param layout The layout of the descriptor sets and push constants.
+		 * @returns This state, for chaining.
+		 */
+		GraphicsPipelineState& setLayout(VkPipelineLayout layout);
+
+		/**
+		 * @brief Sets the render pass that the pipeline is used in.
+		 * @param renderPass The render pass.
+		 * @param subpass [Optional] The index of the subpass.
+		 * @returns This state, for chaining.
+		 */
+		GraphicsPipelineState& setRenderPass(VkRenderPass renderPass, u32 subpass = 0);
+
+		/**
+		 * @returns The whole state flattened into words, for comparing and hashing.
+		 */
+		std::vector<u64> getKey() const;
+
+		/**
+		 * @brief Compiles the pipeline. Blocks until the driver is done.
+		 * @param device The device to create the pipeline on.
+		 * @param cache The pipeline cache to use.
+		 * @returns The pipeline.
+		 */
+		VkPipeline create(VkDevice device, VkPipelineCache cache) const;
+
+		/**
+		 * @returns The layout of the pipeline.
+		 */
+		const VkPipelineLayout& getLayout() const {
+			return m_layout;
+		}
+
+	};
+
+	/**
+	 * @brief Describes a compute pipeline.
+	 */
+	class ComputePipelineState {
+
+	private:
+
+		VkShaderModule m_module{ VK_NULL_HANDLE };
+		std::string m_entry_point{ "main" };
+
+		VkPipelineLayout m_layout{ VK_NULL_HANDLE };
+
+	public:
+
+		/**
+		 * @brief Sets the compute shader.
+		 * @param module The shader module.
+		 * @param entryPoint [Optional] The function to start the shader at.
+		 * @returns This state, for chaining.
+		 */
+		ComputePipelineState& setShader(VkShaderModule module, const std::string &entryPoint = "main");
+
+		/**
+		 * @param layout The layout of the descriptor sets and push constants.
+		 * @returns This state, for chaining.
+		 */
+		ComputePipelineState& setLayout(VkPipelineLayout layout);
+
+		/**
+		 * @returns The whole state flattened into words, for comparing and hashing.
+		 */
+		std::vector<u64> getKey() const;
+
+		/**
+		 * @brief Compiles the pipeline. Blocks until the driver is done.
+		 * @param device The device to create the pipeline on.
+		 * @param cache The pipeline cache to use.
+		 * @returns The pipeline.
+		 */
+		VkPipeline create(VkDevice device, VkPipelineCache cache) const;
+
+		/**
+		 * @returns The layout of the pipeline.
+		 */
+		const VkPipelineLayout& getLayout() const {
+			return m_layout;
+		}
+
+	};
+
+} // namespace carbon
+
+#endif // PIPELINE_PIPELINE_STATE_HPP
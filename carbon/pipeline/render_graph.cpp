@@ -0,0 +1,719 @@
+// file      : carbon/pipeline/render_graph.cpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#include "render_graph.hpp"
+
+#include "render_pass.hpp"
+#include "render_pass_cache.hpp"
+#include "carbon/common/logger.hpp"
+#include "carbon/core/deletion_queue.hpp"
+#include "carbon/core/host_allocator.hpp"
+#include "carbon/core/logical_device.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace carbon {
+
+	/**
+	 * @brief Accesses that write to memory and so must be made available to later accesses.
+	 */
+	static constexpr VkAccessFlags WRITE_ACCESS_MASK =
+		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+		VK_ACCESS_SHADER_WRITE_BIT |
+		VK_ACCESS_TRANSFER_WRITE_BIT;
+
+
+	/**
+	 * @param format The format to check.
+	 * @returns `true` if the format has a depth component, `false` otherwise.
+	 */
+	static bool isDepthFormat(VkFormat format) {
+		switch (format) {
+			case VK_FORMAT_D16_UNORM:
+			case VK_FORMAT_X8_D24_UNORM_PACK32:
+			case VK_FORMAT_D32_SFLOAT:
+			case VK_FORMAT_D16_UNORM_S8_UINT:
+			case VK_FORMAT_D24_UNORM_S8_UINT:
+			case VK_FORMAT_D32_SFLOAT_S8_UINT:
+				return true;
+			default:
+				return false;
+		}
+	}
+
+
+	/**
+	 * @param format The format of the image.
+	 * @returns The aspects of an image with the given format.
+	 */
+	static VkImageAspectFlags getAspectMask(VkFormat format) {
+		return isDepthFormat(format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+	}
+
+
+	RenderGraph::PassBuilder& RenderGraph::PassBuilder::writeColour(ResourceHandle resource, bool clear, const VkClearColorValue &clearColour) {
+		assert(resource < m_graph->m_resources.size() && "Invalid resource handle.");
+
+		VkClearValue clearValue{};
+		clearValue.color = clearColour;
+
+		m_graph->m_passes[m_pass_idx].colours.push_back({ resource, clear, clearValue });
+		m_graph->m_resources[resource].usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+
+		return *this;
+	}
+
+
+	RenderGraph::PassBuilder& RenderGraph::PassBuilder::writeDepth(ResourceHandle resource, bool clear, const VkClearDepthStencilValue &clearDepth) {
+		assert(resource < m_graph->m_resources.size() && "Invalid resource handle.");
+		assert(m_graph->m_passes[m_pass_idx].depth.empty() && "Pass already has a depth attachment.");
+
+		VkClearValue clearValue{};
+		clearValue.depthStencil = clearDepth;
+
+		m_graph->m_passes[m_pass_idx].depth.push_back({ resource, clear, clearValue });
+		m_graph->m_resources[resource].usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+
+		return *this;
+	}
+
+
+	RenderGraph::PassBuilder& RenderGraph::PassBuilder::read(ResourceHandle resource) {
+		assert(resource < m_graph->m_resources.size() && "Invalid resource handle.");
+
+		m_graph->m_passes[m_pass_idx].reads.push_back(resource);
+		m_graph->m_resources[resource].usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+
+		return *this;
+	}
+
+
+	RenderGraph::PassBuilder& RenderGraph::PassBuilder::setExecute(const ExecuteFn &execute, bool secondary) {
+		m_graph->m_passes[m_pass_idx].execute = execute;
+		m_graph->m_passes[m_pass_idx].secondary = secondary;
+
+		return *this;
+	}
+
+
+	void RenderGraph::cullPasses() {
+		// images whose current contents are needed by a later pass or after the frame
+		std::vector<bool> needed(m_resources.size(), false);
+
+		for (size_t i = 0; i < m_resources.size(); i++) {
+			needed[i] = m_resources[i].imported || m_resources[i].output;
+		}
+
+		for (size_t i = m_passes.size(); i-- > 0;) {
+			Pass &pass = m_passes[i];
+			pass.culled = true;
+
+			for (const auto &attachments : { &pass.colours, &pass.depth }) {
+				for (const auto &a : *attachments) {
+					pass.culled = pass.culled && !needed[a.resource];
+				}
+			}
+
+			if (pass.culled) {
+				continue;
+			}
+
+			// earlier writers are only needed if this pass keeps their contents
+			for (const auto &attachments : { &pass.colours, &pass.depth }) {
+				for (const auto &a : *attachments) {
+					needed[a.resource] = !a.clear;
+				}
+			}
+
+			for (const auto r : pass.reads) {
+				needed[r] = true;
+			}
+		}
+	}
+
+
+	void RenderGraph::computeLifetimes() {
+		for (auto &r : m_resources) {
+			r.firstPass = u32_max;
+			r.lastPass = 0;
+		}
+
+		auto use = [this](ResourceHandle resource, u32 passIdx) {
+			Resource &r = m_resources[resource];
+			r.firstPass = std::min(r.firstPass, passIdx);
+			r.lastPass = std::max(r.lastPass, passIdx);
+		};
+
+		for (u32 i = 0; i < to_u32(m_passes.size()); i++) {
+			const Pass &pass = m_passes[i];
+
+			if (pass.culled) {
+				continue;
+			}
+
+			for (const auto &a : pass.colours) {
+				use(a.resource, i);
+			}
+
+			for (const auto &a : pass.depth) {
+				use(a.resource, i);
+			}
+
+			for (const auto r : pass.reads) {
+				use(r, i);
+			}
+		}
+	}
+
+
+	void RenderGraph::allocateTransients() {
+		VkDevice device = m_logical_device->getHandle();
+		std::vector<ResourceHandle> transients;
+
+		// create every transient image that is used, to find out how much memory it needs
+		for (ResourceHandle i = 0; i < to_u32(m_resources.size()); i++) {
+			Resource &r = m_resources[i];
+
+			if (r.imported || r.firstPass == u32_max) {
+				continue;
+			}
+
+			VkImageCreateInfo createInfo;
+			initStruct(createInfo, VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO);
+
+			createInfo.imageType = VK_IMAGE_TYPE_2D;
+			createInfo.format = r.format;
+			createInfo.extent = { r.extent.width, r.extent.height, 1 };
+			createInfo.mipLevels = 1;
+			createInfo.arrayLayers = 1;
+			createInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+			createInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+			createInfo.usage = r.usage;
+			createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			createInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+			if (vkCreateImage(device, &createInfo, HostAllocator::get(VK_OBJECT_TYPE_IMAGE), &r.image) != VK_SUCCESS) {
+				CARBON_LOG_FATAL(carbon::log::To::File, "Failed to create transient image.");
+			}
+
+			vkGetImageMemoryRequirements(device, r.image, &r.memoryRequirements);
+			transients.push_back(i);
+		}
+
+		// place the largest images first, so smaller ones can fit into their blocks
+		std::sort(transients.begin(), transients.end(), [this](ResourceHandle a, ResourceHandle b) {
+			return m_resources[a].memoryRequirements.size > m_resources[b].memoryRequirements.size;
+		});
+
+		auto overlaps = [this](ResourceHandle a, ResourceHandle b) {
+			const Resource &ra = m_resources[a];
+			const Resource &rb = m_resources[b];
+			return !(ra.lastPass < rb.firstPass || rb.lastPass < ra.firstPass);
+		};
+
+		for (const auto t : transients) {
+			Resource &r = m_resources[t];
+
+			for (u32 b = 0; b < to_u32(m_memory_blocks.size()) && r.memoryBlock == u32_max; b++) {
+				MemoryBlock &block = m_memory_blocks[b];
+
+				if ((block.memoryTypeBits & r.memoryRequirements.memoryTypeBits) == 0) {
+					continue;
+				}
+
+				bool shareable = std::none_of(block.resources.begin(), block.resources.end(), [&](ResourceHandle other) {
+					return overlaps(t, other);
+				});
+
+				if (shareable) {
+					r.memoryBlock = b;
+				}
+			}
+
+			if (r.memoryBlock == u32_max) {
+				r.memoryBlock = to_u32(m_memory_blocks.size());
+				m_memory_blocks.emplace_back();
+			}
+
+			MemoryBlock &block = m_memory_blocks[r.memoryBlock];
+			block.size = std::max(block.size, r.memoryRequirements.size);
+			block.alignment = std::max(block.alignment, r.memoryRequirements.alignment);
+			block.memoryTypeBits &= r.memoryRequirements.memoryTypeBits;
+			block.resources.push_back(t);
+		}
+
+		MemoryAllocator &allocator = m_logical_device->getMemoryAllocator();
+
+		for (auto &block : m_memory_blocks) {
+			// the allocator counts the memory against the heap budget, and gives large blocks their own memory
+			const VkMemoryRequirements reqs{ block.size, block.alignment, block.memoryTypeBits };
+			block.allocation = allocator.allocate(reqs, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, false);
+
+			if (!block.allocation.isValid()) {
+				CARBON_LOG_FATAL(carbon::log::To::File, "Failed to allocate transient image memory.");
+			}
+
+			// every image starts at the beginning of its block, which is aligned for all of them
+			for (const auto t : block.resources) {
+				Resource &r = m_resources[t];
+				vkBindImageMemory(device, r.image, block.allocation.memory, block.allocation.offset);
+
+				VkImageViewCreateInfo viewInfo;
+				initStruct(viewInfo, VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO);
+
+				viewInfo.image = r.image;
+				viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+				viewInfo.format = r.format;
+				viewInfo.subresourceRange.aspectMask = getAspectMask(r.format);
+				viewInfo.subresourceRange.baseMipLevel = 0;
+				viewInfo.subresourceRange.levelCount = 1;
+				viewInfo.subresourceRange.baseArrayLayer = 0;
+				viewInfo.subresourceRange.layerCount = 1;
+
+				if (vkCreateImageView(device, &viewInfo, HostAllocator::get(VK_OBJECT_TYPE_IMAGE_VIEW), &r.view) != VK_SUCCESS) {
+					CARBON_LOG_FATAL(carbon::log::To::File, "Failed to create transient image view.");
+				}
+			}
+		}
+	}
+
+
+	void RenderGraph::computeBarriers() {
+		// state each image is left in by the last pass that uses it
+		std::vector<ResourceState> lastUse(m_resources.size());
+
+		auto forEachUse = [this](const std::function<void(u32, ResourceHandle, const ResourceState&)> &visit) {
+			for (u32 i = 0; i < to_u32(m_passes.size()); i++) {
+				const Pass &pass = m_passes[i];
+
+				if (pass.culled) {
+					continue;
+				}
+
+				for (const auto &a : pass.colours) {
+					VkAccessFlags access = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | (a.clear ? 0 : VK_ACCESS_COLOR_ATTACHMENT_READ_BIT);
+					visit(i, a.resource, { VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, access });
+				}
+
+				for (const auto &a : pass.depth) {
+					visit(i, a.resource, {
+						VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+						VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+						VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+					});
+				}
+
+				for (const auto r : pass.reads) {
+					visit(i, r, { VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT });
+				}
+			}
+		};
+
+		forEachUse([&lastUse](u32, ResourceHandle r, const ResourceState &state) {
+			lastUse[r] = state;
+		});
+
+		// contents are discarded at the start of every frame, but the previous user of the memory must be finished with it
+		std::vector<ResourceState> states(m_resources.size());
+
+		for (ResourceHandle i = 0; i < to_u32(m_resources.size()); i++) {
+			const Resource &r = m_resources[i];
+
+			if (r.imported) {
+				// matches the stage that waits on the swapchain image being acquired
+				states[i] = { VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0 };
+				continue;
+			}
+
+			if (r.memoryBlock == u32_max) {
+				continue;
+			}
+
+			// previous user is the image in the same block that was last used before this one,
+			// or the image last used in the block during the previous frame
+			const MemoryBlock &block = m_memory_blocks[r.memoryBlock];
+			ResourceHandle previous = i;
+			ResourceHandle wrapped = i;
+
+			for (const auto other : block.resources) {
+				const Resource &o = m_resources[other];
+
+				if (o.lastPass < r.firstPass && (previous == i || o.lastPass > m_resources[previous].lastPass)) {
+					previous = other;
+				}
+
+				if (o.lastPass > m_resources[wrapped].lastPass) {
+					wrapped = other;
+				}
+			}
+
+			const ResourceState &prior = lastUse[previous != i ? previous : wrapped];
+			states[i] = { VK_IMAGE_LAYOUT_UNDEFINED, prior.stages, prior.access };
+		}
+
+		forEachUse([this, &states](u32 passIdx, ResourceHandle r, const ResourceState &need) {
+			ResourceState &current = states[r];
+			Pass &pass = m_passes[passIdx];
+
+			bool layoutChange = current.layout != need.layout;
+			bool hazard = (current.access & WRITE_ACCESS_MASK) != 0 || (need.access & WRITE_ACCESS_MASK) != 0;
+
+			// reading after reading in the same layout needs no synchronization
+			if (layoutChange || hazard) {
+				pass.barriers.push_back({ r, current.layout, need.layout, current.access & WRITE_ACCESS_MASK, need.access });
+				pass.srcStages |= current.stages;
+				pass.dstStages |= need.stages;
+			}
+
+			current = need;
+		});
+
+		// leave the outputs in the layout they are used in after the frame
+		for (ResourceHandle i = 0; i < to_u32(m_resources.size()); i++) {
+			const Resource &r = m_resources[i];
+
+			if (!r.imported || r.finalLayout == VK_IMAGE_LAYOUT_UNDEFINED || r.finalLayout == states[i].layout) {
+				continue;
+			}
+
+			m_final_barriers.push_back({ i, states[i].layout, r.finalLayout, states[i].access & WRITE_ACCESS_MASK, 0 });
+			m_final_src_stages |= states[i].stages;
+		}
+	}
+
+
+	void RenderGraph::createRenderPasses() {
+		for (u32 i = 0; i < to_u32(m_passes.size()); i++) {
+			Pass &pass = m_passes[i];
+
+			if (pass.culled) {
+				continue;
+			}
+
+			std::vector<VkAttachmentDescription> descs;
+			std::vector<VkAttachmentReference> colourRefs;
+			VkAttachmentReference depthRef{};
+
+			auto describe = [&](const Attachment &a, VkImageLayout layout) {
+				const Resource &r = m_resources[a.resource];
+
+				VkAttachmentDescription desc{};
+				desc.format = r.format;
+				desc.samples = VK_SAMPLE_COUNT_1_BIT;
+
+				// nothing to keep on first use, and nothing to store if no one reads it later
+				desc.loadOp = a.clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : (r.firstPass == i ? VK_ATTACHMENT_LOAD_OP_DONT_CARE : VK_ATTACHMENT_LOAD_OP_LOAD);
+				desc.storeOp = (r.lastPass > i || r.imported || r.output) ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+				desc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+				desc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+
+				// transitions are done by the barriers before the pass
+				desc.initialLayout = layout;
+				desc.finalLayout = layout;
+
+				descs.push_back(desc);
+				pass.clearValues.push_back(a.clearValue);
+
+				assert((pass.extent.width == 0 || (pass.extent.width == r.extent.width && pass.extent.height == r.extent.height)) && "Attachments of a pass must be the same size.");
+				pass.extent = r.extent;
+
+				return VkAttachmentReference{ to_u32(descs.size() - 1), layout };
+			};
+
+			for (const auto &a : pass.colours) {
+				colourRefs.push_back(describe(a, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL));
+			}
+
+			for (const auto &a : pass.depth) {
+				depthRef = describe(a, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+			}
+
+			VkSubpassDescription subpass{};
+			subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+			subpass.colorAttachmentCount = to_u32(colourRefs.size());
+			subpass.pColorAttachments = colourRefs.data();
+			subpass.pDepthStencilAttachment = pass.depth.empty() ? nullptr : &depthRef;
+
+			// graphs rebuilt on resize end up with the same descriptions
+			pass.renderPass = m_render_pass_cache->getRenderPass(descs, { subpass });
+		}
+	}
+
+
+	VkFramebuffer RenderGraph::getFramebuffer(Pass &pass) {
+		pass.views.clear();
+
+		for (const auto &a : pass.colours) {
+			pass.views.push_back(m_resources[a.resource].view);
+		}
+
+		for (const auto &a : pass.depth) {
+			pass.views.push_back(m_resources[a.resource].view);
+		}
+
+		// imported images change every frame, but only cycle through a few views
+		return m_render_pass_cache->getFramebuffer(pass.renderPass->getHandle(), pass.views, pass.extent);
+	}
+
+
+	void RenderGraph::recordBarriers(
+		VkCommandBuffer commandBuffer,
+		const std::vector<Barrier> &barriers,
+		VkPipelineStageFlags srcStages,
+		VkPipelineStageFlags dstStages
+	) {
+		if (barriers.empty()) {
+			return;
+		}
+
+		m_image_barriers.clear();
+
+		for (const auto &b : barriers) {
+			const Resource &r = m_resources[b.resource];
+
+			VkImageMemoryBarrier barrier;
+			initStruct(barrier, VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER);
+
+			barrier.srcAccessMask = b.srcAccess;
+			barrier.dstAccessMask = b.dstAccess;
+			barrier.oldLayout = b.oldLayout;
+			barrier.newLayout = b.newLayout;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = r.image;
+			barrier.subresourceRange.aspectMask = getAspectMask(r.format);
+			barrier.subresourceRange.baseMipLevel = 0;
+			barrier.subresourceRange.levelCount = 1;
+			barrier.subresourceRange.baseArrayLayer = 0;
+			barrier.subresourceRange.layerCount = 1;
+
+			m_image_barriers.push_back(barrier);
+		}
+
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			srcStages,
+			dstStages,
+			0,
+			0, nullptr,
+			0, nullptr,
+			to_u32(m_image_barriers.size()), m_image_barriers.data()
+		);
+	}
+
+
+	RenderGraph::RenderGraph(LogicalDevice *logiDevice, RenderPassCache *renderPassCache)
+		: m_logical_device(logiDevice)
+		, m_render_pass_cache(renderPassCache)
+	{
+		assert(m_logical_device && m_render_pass_cache && "Logical device and render pass cache must not be null.");
+	}
+
+
+	RenderGraph::~RenderGraph() {
+		destroy();
+	}
+
+
+	void RenderGraph::destroy() {
+		// frames in flight may still be using the transient images
+		DeletionQueue &deletionQueue = m_logical_device->getDeletionQueue();
+
+		// render passes are owned by the cache and kept for the next compile
+		for (auto &pass : m_passes) {
+			pass.renderPass = nullptr;
+
+			pass.views.clear();
+			pass.clearValues.clear();
+			pass.barriers.clear();
+			pass.srcStages = 0;
+			pass.dstStages = 0;
+			pass.extent = {};
+			pass.culled = false;
+		}
+
+		// only transient images are owned by the graph
+		for (auto &r : m_resources) {
+			if (r.imported) {
+				continue;
+			}
+
+			if (r.view != VK_NULL_HANDLE) {
+				// a new view could reuse the handle and hit a stale framebuffer
+				m_render_pass_cache->evict(r.view);
+				deletionQueue.push(VK_OBJECT_TYPE_IMAGE_VIEW, r.view);
+				r.view = VK_NULL_HANDLE;
+			}
+
+			if (r.image != VK_NULL_HANDLE) {
+				deletionQueue.push(VK_OBJECT_TYPE_IMAGE, r.image);
+				r.image = VK_NULL_HANDLE;
+			}
+
+			r.memoryBlock = u32_max;
+		}
+
+		for (auto &block : m_memory_blocks) {
+			deletionQueue.push(block.allocation);
+		}
+
+		m_memory_blocks.clear();
+		m_final_barriers.clear();
+		m_final_src_stages = 0;
+		m_compiled = false;
+	}
+
+
+	void RenderGraph::reset() {
+		destroy();
+
+		m_passes.clear();
+		m_resources.clear();
+	}
+
+
+	RenderGraph::ResourceHandle RenderGraph::importImage(const std::string &name, VkFormat format, const VkExtent2D &extent, VkImageLayout finalLayout) {
+		Resource r;
+		r.name = name;
+		r.format = format;
+		r.extent = extent;
+		r.imported = true;
+		r.output = true;
+		r.finalLayout = finalLayout;
+
+		m_resources.push_back(r);
+		return to_u32(m_resources.size() - 1);
+	}
+
+
+	void RenderGraph::setImportedImage(ResourceHandle resource, VkImage image, VkImageView view) {
+		assert(resource < m_resources.size() && m_resources[resource].imported && "Resource is not an imported image.");
+
+		m_resources[resource].image = image;
+		m_resources[resource].view = view;
+	}
+
+
+	RenderGraph::ResourceHandle RenderGraph::createAttachment(const std::string &name, VkFormat format, const VkExtent2D &extent) {
+		Resource r;
+		r.name = name;
+		r.format = format;
+		r.extent = extent;
+
+		m_resources.push_back(r);
+		return to_u32(m_resources.size() - 1);
+	}
+
+
+	void RenderGraph::markOutput(ResourceHandle resource) {
+		assert(resource < m_resources.size() && "Invalid resource handle.");
+		m_resources[resource].output = true;
+	}
+
+
+	RenderGraph::PassBuilder RenderGraph::addPass(const std::string &name) {
+		m_passes.emplace_back();
+		m_passes.back().name = name;
+
+		return PassBuilder(this, to_u32(m_passes.size() - 1));
+	}
+
+
+	void RenderGraph::compile() {
+		// start over if the graph was already compiled
+		destroy();
+
+		cullPasses();
+		computeLifetimes();
+		allocateTransients();
+		computeBarriers();
+		createRenderPasses();
+
+		m_compiled = true;
+	}
+
+
+	void RenderGraph::execute(VkCommandBuffer commandBuffer) {
+		assert(m_compiled && "Render graph must be compiled before it is executed.");
+
+		for (auto &pass : m_passes) {
+			if (pass.culled) {
+				continue;
+			}
+
+			recordBarriers(commandBuffer, pass.barriers, pass.srcStages, pass.dstStages);
+
+			VkRenderPassBeginInfo beginInfo;
+			initStruct(beginInfo, VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO);
+
+			beginInfo.renderPass = pass.renderPass->getHandle();
+			beginInfo.framebuffer = getFramebuffer(pass);
+			beginInfo.renderArea.offset = { 0, 0 };
+			beginInfo.renderArea.extent = pass.extent;
+			beginInfo.clearValueCount = to_u32(pass.clearValues.size());
+			beginInfo.pClearValues = pass.clearValues.data();
+
+			vkCmdBeginRenderPass(commandBuffer, &beginInfo, pass.secondary ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+
+			if (pass.execute) {
+				pass.execute({ commandBuffer, beginInfo.renderPass, beginInfo.framebuffer, pass.extent });
+			}
+
+			vkCmdEndRenderPass(commandBuffer);
+		}
+
+		recordBarriers(commandBuffer, m_final_barriers, m_final_src_stages, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+	}
+
+
+	VkImageView RenderGraph::getImageView(ResourceHandle resource) const {
+		assert(resource < m_resources.size() && "Invalid resource handle.");
+		return m_resources[resource].view;
+	}
+
+
+	const size_t RenderGraph::getCulledPassCount() const {
+		return static_cast<size_t>(std::count_if(m_passes.begin(), m_passes.end(), [](const Pass &pass) {
+			return pass.culled;
+		}));
+	}
+
+
+	const size_t RenderGraph::getBarrierCount() const {
+		size_t count = m_final_barriers.size();
+
+		for (const auto &pass : m_passes) {
+			count += pass.barriers.size();
+		}
+
+		return count;
+	}
+
+
+	const VkDeviceSize RenderGraph::getTransientMemorySize() const {
+		VkDeviceSize size = 0;
+
+		for (const auto &block : m_memory_blocks) {
+			size += block.size;
+		}
+
+		return size;
+	}
+
+
+	const VkDeviceSize RenderGraph::getUnaliasedMemorySize() const {
+		VkDeviceSize size = 0;
+
+		for (const auto &r : m_resources) {
+			if (!r.imported && r.memoryBlock != u32_max) {
+				size += r.memoryRequirements.size;
+			}
+		}
+
+		return size;
+	}
+
+} // namespace carbon
@@ -0,0 +1,419 @@
+// file      : carbon/pipeline/render_graph.hpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#pragma once
+
+#ifndef PIPELINE_RENDER_GRAPH_HPP
+#define PIPELINE_RENDER_GRAPH_HPP
+
+#include "carbon/backend.hpp"
+#include "carbon/core/memory_allocator.hpp"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace carbon {
+
+	// forward-declare classes that would result in circular dependency
+	class LogicalDevice;
+	class RenderPass;
+	class RenderPassCache;
+
+	/**
+	 * @brief A frame graph of passes that declare which images they read and
+	 * write. Compiling the graph culls passes whose results are never used,
+	 * works out the barriers and layout transitions between passes, and lets
+	 * transient attachments whose lifetimes do not overlap share memory.
+	 * Passes run in the order that they are added.
+	 */
+	class RenderGraph {
+
+	public:
+
+		/**
+		 * @brief Handle on an image in the graph.
+		 */
+		using ResourceHandle = u32;
+
+		/**
+		 * @brief Everything a pass needs to record its commands.
+		 */
+		struct PassContext {
+			VkCommandBuffer commandBuffer;
+			VkRenderPass renderPass;
+			VkFramebuffer framebuffer;
+			VkExtent2D extent;
+		};
+
+		/**
+		 * @brief Function that records the commands of a pass.
+		 */
+		using ExecuteFn = std::function<void(const PassContext&)>;
+
+		/**
+		 * @brief Declares the images used by a pass.
+		 */
+		class PassBuilder {
+
+		private:
+
+			friend class RenderGraph;
+
+			/**
+			 * @brief The graph that the pass belongs to.
+			 */
+			class RenderGraph *m_graph;
+
+			/**
+			 * @brief Index of the pass in the graph.
+			 */
+			u32 m_pass_idx;
+
+			PassBuilder(class RenderGraph *graph, u32 passIdx)
+				: m_graph(graph)
+				, m_pass_idx(passIdx)
+			{}
+
+		public:
+
+			/**
+			 * @brief Renders to the image as a colour attachment.
+			 * @param resource The image to render to.
+			 * @param clear [Optional] `true` to clear the image first, otherwise
+			 * its previous contents are kept.
+			 * @param clearColour [Optional] The colour to clear to.
+			 * @returns This builder, for chaining.
+			 */
+			PassBuilder& writeColour(ResourceHandle resource, bool clear = false, const VkClearColorValue &clearColour = {});
+
+			/**
+			 * @brief Uses the image as the depth attachment.
+			 * @param resource The depth image.
+			 * @param clear [Optional] `true` to clear the image first.
+			 * @param clearDepth [Optional] The depth and stencil values to clear to.
+			 * @returns This builder, for chaining.
+			 */
+			PassBuilder& writeDepth(ResourceHandle resource, bool clear = false, const VkClearDepthStencilValue &clearDepth = { 1.0f, 0 });
+
+			/**
+			 * @brief Samples the image in the fragment shader.
+			 * @param resource The image to sample.
+			 * @returns This builder, for chaining.
+			 */
+			PassBuilder& read(ResourceHandle resource);
+
+			/**
+			 * @brief Sets the function that records the commands of the pass.
+			 * @param execute The function to call.
+			 * @param secondary [Optional] `true` if the function only executes
+			 * secondary command buffers.
+			 * @returns This builder, for chaining.
+			 */
+			PassBuilder& setExecute(const ExecuteFn &execute, bool secondary = false);
+
+		};
+
+	private:
+
+		/**
+		 * @brief How an image is accessed at a point in the frame.
+		 */
+		struct ResourceState {
+			VkImageLayout layout{ VK_IMAGE_LAYOUT_UNDEFINED };
+			VkPipelineStageFlags stages{ VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT };
+			VkAccessFlags access{ 0 };
+		};
+
+		/**
+		 * @brief An image in the graph.
+		 */
+		struct Resource {
+			std::string name;
+			VkFormat format{ VK_FORMAT_UNDEFINED };
+			VkExtent2D extent{};
+			VkImageUsageFlags usage{ 0 };
+
+			bool imported{ false };
+			bool output{ false };
+			VkImageLayout finalLayout{ VK_IMAGE_LAYOUT_UNDEFINED };
+
+			VkImage image{ VK_NULL_HANDLE };
+			VkImageView view{ VK_NULL_HANDLE };
+			VkMemoryRequirements memoryRequirements{};
+
+			u32 firstPass{ u32_max };
+			u32 lastPass{ 0 };
+			u32 memoryBlock{ u32_max };
+		};
+
+		/**
+		 * @brief An image rendered to by a pass.
+		 */
+		struct Attachment {
+			ResourceHandle resource;
+			bool clear;
+			VkClearValue clearValue;
+		};
+
+		/**
+		 * @brief A transition of an image between two states.
+		 */
+		struct Barrier {
+			ResourceHandle resource;
+			VkImageLayout oldLayout;
+			VkImageLayout newLayout;
+			VkAccessFlags srcAccess;
+			VkAccessFlags dstAccess;
+		};
+
+		/**
+		 * @brief A single pass of the frame.
+		 */
+		struct Pass {
+			std::string name;
+			std::vector<Attachment> colours;
+			std::vector<Attachment> depth;
+			std::vector<ResourceHandle> reads;
+
+			ExecuteFn execute;
+			bool secondary{ false };
+
+			bool culled{ false };
+
+			std::vector<Barrier> barriers;
+			VkPipelineStageFlags srcStages{ 0 };
+			VkPipelineStageFlags dstStages{ 0 };
+
+			const class RenderPass *renderPass{ nullptr };
+			VkExtent2D extent{};
+			std::vector<VkClearValue> clearValues;
+			std::vector<VkImageView> views;
+		};
+
+		/**
+		 * @brief Device memory shared by transient images that are never alive at the same time.
+		 */
+		struct MemoryBlock {
+			MemoryAllocation allocation;
+			VkDeviceSize size{ 0 };
+			VkDeviceSize alignment{ 1 };
+			u32 memoryTypeBits{ u32_max };
+			std::vector<ResourceHandle> resources;
+		};
+
+		/**
+		 * @brief The logical device to create the graph objects on.
+		 */
+		const class LogicalDevice *m_logical_device;
+
+		/**
+		 * @brief Cache that owns the render passes and framebuffers of the passes.
+		 */
+		class RenderPassCache *m_render_pass_cache;
+
+		/**
+		 * @brief All images in the graph.
+		 */
+		std::vector<Resource> m_resources;
+
+		/**
+		 * @brief All passes in the graph, in the order they run.
+		 */
+		std::vector<Pass> m_passes;
+
+		/**
+		 * @brief Memory backing the transient images.
+		 */
+		std::vector<MemoryBlock> m_memory_blocks;
+
+		/**
+		 * @brief Transitions of the outputs to their final layouts at the end of the frame.
+		 */
+		std::vector<Barrier> m_final_barriers;
+
+		/**
+		 * @brief Stages that the final transitions wait on.
+		 */
+		VkPipelineStageFlags m_final_src_stages{ 0 };
+
+		/**
+		 * @brief Barriers of the pass being executed, reused every frame.
+		 */
+		std::vector<VkImageMemoryBarrier> m_image_barriers;
+
+		/**
+		 * @brief `true` once the graph has been compiled.
+		 */
+		bool m_compiled{ false };
+
+		/**
+		 * @brief Removes passes whose results are never read or output, by
+		 * walking the passes backwards and tracking which images are still needed.
+		 */
+		void cullPasses();
+
+		/**
+		 * @brief Finds the first and last pass that uses each image.
+		 */
+		void computeLifetimes();
+
+		/**
+		 * @brief Creates the transient images and binds them to memory blocks,
+		 * sharing a block between images whose lifetimes do not overlap.
+		 */
+		void allocateTransients();
+
+		/**
+		 * @brief Works out the barriers needed before each pass and at the end of the frame.
+		 */
+		void computeBarriers();
+
+		/**
+		 * @brief Gets the render pass of each pass from the cache.
+		 */
+		void createRenderPasses();
+
+		/**
+		 * @param pass The pass to get a framebuffer for.
+		 * @returns The framebuffer for the current images of the pass, from the cache.
+		 */
+		VkFramebuffer getFramebuffer(Pass &pass);
+
+		/**
+		 * @brief Records the given barriers.
+		 * @param commandBuffer The command buffer to record into.
+		 * @param barriers The barriers to record.
+		 * @param srcStages The stages to wait on.
+		 * @param dstStages The stages that wait.
+		 */
+		void recordBarriers(
+			VkCommandBuffer commandBuffer,
+			const std::vector<Barrier> &barriers,
+			VkPipelineStageFlags srcStages,
+			VkPipelineStageFlags dstStages
+		);
+
+	public:
+
+		/**
+		 * @brief Creates an empty render graph.
+		 * @param logiDevice The logical device to use.
+		 * @param renderPassCache The cache to get render passes and framebuffers from.
+		 */
+		explicit RenderGraph(class LogicalDevice *logiDevice, class RenderPassCache *renderPassCache);
+
+		RenderGraph(const RenderGraph&) = delete;
+
+		RenderGraph& operator=(const RenderGraph&) = delete;
+
+		/**
+		 * @brief Destructor for the render graph.
+		 */
+		~RenderGraph();
+
+		/**
+		 * @brief Destroys all objects created by compiling the graph.
+		 */
+		void destroy();
+
+		/**
+		 * @brief Destroys the graph and removes all of its passes and images.
+		 * The GPU must have finished with the graph.
+		 */
+		void reset();
+
+		/**
+		 * @brief Adds an image that is owned outside of the graph, such as a
+		 * swapchain image. Imported images are always outputs of the graph.
+		 * @param name The name of the image.
+		 * @param format The format of the image.
+		 * @param extent The size of the image.
+		 * @param finalLayout The layout to leave the image in at the end of the frame.
+		 * @returns The handle of the image.
+		 */
+		ResourceHandle importImage(const std::string &name, VkFormat format, const VkExtent2D &extent, VkImageLayout finalLayout);
+
+		/**
+		 * @brief Sets the image used for an imported image this frame.
+		 * @param resource The handle of the imported image.
+		 * @param image The image to use.
+		 * @param view The view of the image.
+		 */
+		void setImportedImage(ResourceHandle resource, VkImage image, VkImageView view);
+
+		/**
+		 * @brief Adds an image that only lives within the frame. Its memory may
+		 * be shared with other transient images.
+		 * @param name The name of the image.
+		 * @param format The format of the image.
+		 * @param extent The size of the image.
+		 * @returns The handle of the image.
+		 */
+		ResourceHandle createAttachment(const std::string &name, VkFormat format, const VkExtent2D &extent);
+
+		/**
+		 * @brief Keeps the image, and the passes that write it, from being culled.
+		 * @param resource The handle of the image.
+		 */
+		void markOutput(ResourceHandle resource);
+
+		/**
+		 * @brief Adds a pass to the end of the graph.
+		 * @param name The name of the pass.
+		 * @returns A builder to declare the images used by the pass.
+		 */
+		PassBuilder addPass(const std::string &name);
+
+		/**
+		 * @brief Culls unused passes, allocates the transient images and works
+		 * out the barriers between passes. Must be called after all passes
+		 * have been added and before executing.
+		 */
+		void compile();
+
+		/**
+		 * @brief Records every pass that was not culled, with the barriers between them.
+		 * @param commandBuffer The primary command buffer to record into.
+		 */
+		void execute(VkCommandBuffer commandBuffer);
+
+		/**
+		 * @param resource The handle of the image.
+		 * @returns The view of the image, for binding it to be read.
+		 */
+		VkImageView getImageView(ResourceHandle resource) const;
+
+		/**
+		 * @returns The number of passes in the graph.
+		 */
+		const size_t getPassCount() const {
+			return m_passes.size();
+		}
+
+		/**
+		 * @returns The number of passes removed because their results are never used.
+		 */
+		const size_t getCulledPassCount() const;
+
+		/**
+		 * @returns The number of image barriers recorded every frame.
+		 */
+		const size_t getBarrierCount() const;
+
+		/**
+		 * @returns The memory (in bytes) used by the transient images.
+		 */
+		const VkDeviceSize getTransientMemorySize() const;
+
+		/**
+		 * @returns The memory (in bytes) the transient images would use without sharing.
+		 */
+		const VkDeviceSize getUnaliasedMemorySize() const;
+
+	};
+
+} // namespace carbon
+
+#endif // PIPELINE_RENDER_GRAPH_HPP
@@ -5,6 +5,7 @@
 #include "render_pass.hpp"
 
 #include "carbon/common/logger.hpp"
+#include "carbon/core/host_allocator.hpp"
 #include "carbon/core/logical_device.hpp"
 
 #include <cassert>
@@ -27,7 +28,7 @@ namespace carbon {
 
 		// decide on layout of images being rendered
 		desc.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		desc.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; // images to be presented in swap chain
+		desc.finalLayout = m_final_layout; // presented in swap chain by default
 
 		// put into vector
 		m_attachment_descriptions.clear();
@@ -95,6 +96,9 @@ namespace carbon {
 	void RenderPass::create() {
 		assert(m_logical_device && "Logical device cannot be null.");
 
+		// setters recreate the render pass, so release the previous handle
+		destroy();
+
 		// describe render pass
 		VkRenderPassCreateInfo renderPassInfo;
 		initStruct(renderPassInfo, VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO);
@@ -109,21 +113,39 @@ namespace carbon {
 		renderPassInfo.pDependencies = m_subpass_dependencies.data();
 
 		// create render pass
-		if (vkCreateRenderPass(m_logical_device->getHandle(), &renderPassInfo, nullptr, &m_render_pass) != VK_SUCCESS) {
+		if (vkCreateRenderPass(m_logical_device->getHandle(), &renderPassInfo, HostAllocator::get(VK_OBJECT_TYPE_RENDER_PASS), &m_render_pass) != VK_SUCCESS) {
 			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to create render pass.");
 		}
 	}
 
 
-	RenderPass::RenderPass(const LogicalDevice *device, const VkFormat &imageFormat)
+	RenderPass::RenderPass(const LogicalDevice *device, const VkFormat &imageFormat, const VkImageLayout &finalLayout)
 		: m_logical_device(device)
 		, m_image_format(imageFormat)
+		, m_final_layout(finalLayout)
 	{
 		setup();
 		create();
 	}
 
 
+	RenderPass::RenderPass(
+		const LogicalDevice *device,
+		const std::vector<VkAttachmentDescription> &attachments,
+		const std::vector<VkSubpassDescription> &subpasses,
+		const std::vector<VkSubpassDependency> &dependencies
+	)
+		: m_logical_device(device)
+		, m_image_format(attachments.empty() ? VK_FORMAT_UNDEFINED : attachments[0].format)
+		, m_final_layout(attachments.empty() ? VK_IMAGE_LAYOUT_UNDEFINED : attachments[0].finalLayout)
+		, m_attachment_descriptions(attachments)
+		, m_subpass_descriptions(subpasses)
+		, m_subpass_dependencies(dependencies)
+	{
+		create();
+	}
+
+
 	RenderPass::~RenderPass() {
 		destroy();
 	}
@@ -137,7 +159,7 @@ namespace carbon {
 		}
 
 		// destroy render pass
-		vkDestroyRenderPass(m_logical_device->getHandle(), m_render_pass, nullptr);
+		vkDestroyRenderPass(m_logical_device->getHandle(), m_render_pass, HostAllocator::get(VK_OBJECT_TYPE_RENDER_PASS));
 		m_render_pass = VK_NULL_HANDLE;
 	}
 
@@ -34,6 +34,12 @@ namespace carbon {
 		 */
 		VkFormat m_image_format;
 
+		/**
+		 * @brief The layout the colour attachment is transitioned to when
+		 * the render pass ends.
+		 */
+		VkImageLayout m_final_layout;
+
 		/**
 		 * @brief Handle on the underlying render pass.
 		 */
@@ -96,8 +102,30 @@ namespace carbon {
 		 * @brief Initializes the render pass using the given logical device.
 		 * @param device The logical device to use for creating the render pass.
 		 * @param imageFormat The format of the swapchain images.
+		 * @param finalLayout [Optional] The layout of the colour attachment once
+		 * the render pass ends. Defaults to the layout needed for presenting.
 		 */
-		explicit RenderPass(const class LogicalDevice *device, const VkFormat &imageFormat);
+		explicit RenderPass(
+			const class LogicalDevice *device,
+			const VkFormat &imageFormat,
+			const VkImageLayout &finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+		);
+
+		/**
+		 * @brief Initializes the render pass from a full description. The
+		 * attachment references pointed to by the subpasses only need to stay
+		 * alive until the constructor returns.
+		 * @param device The logical device to use for creating the render pass.
+		 * @param attachments The attachments used by the render pass.
+		 * @param subpasses The subpasses of the render pass.
+		 * @param dependencies [Optional] The dependencies between subpasses.
+		 */
+		explicit RenderPass(
+			const class LogicalDevice *device,
+			const std::vector<VkAttachmentDescription> &attachments,
+			const std::vector<VkSubpassDescription> &subpasses,
+			const std::vector<VkSubpassDependency> &dependencies = {}
+		);
 
 		RenderPass(const RenderPass&) = delete;
 
@@ -0,0 +1,188 @@
+// file      : carbon/pipeline/render_pass_cache.cpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#include "render_pass_cache.hpp"
+
+#include "render_pass.hpp"
+#include "carbon/common/logger.hpp"
+#include "carbon/core/deletion_queue.hpp"
+#include "carbon/core/host_allocator.hpp"
+#include "carbon/core/logical_device.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace carbon {
+
+	/**
+	 * @brief Appends the attachment references to the key, including how many there are.
+	 * @param key The key to append to.
+	 * @param refs The attachment references, which may be null.
+	 * @param count The number of attachment references.
+	 */
+	static void appendReferences(std::vector<u64> &key, const VkAttachmentReference *refs, u32 count) {
+		if (refs == nullptr) {
+			key.push_back(u64_max);
+			return;
+		}
+
+		key.push_back(count);
+
+		for (u32 i = 0; i < count; i++) {
+			key.push_back((static_cast<u64>(refs[i].attachment) << 32) | refs[i].layout);
+		}
+	}
+
+
+	RenderPassCache::RenderPassCache(LogicalDevice *logiDevice)
+		: m_logical_device(logiDevice)
+	{
+		assert(m_logical_device && "Logical device must not be null.");
+	}
+
+
+	RenderPassCache::~RenderPassCache() {
+		destroy();
+	}
+
+
+	void RenderPassCache::destroy() {
+		VkDevice device = m_logical_device->getHandle();
+
+		// framebuffers refer to the render passes, so go first
+		for (auto &entry : m_framebuffers) {
+			vkDestroyFramebuffer(device, entry.second.handle, HostAllocator::get(VK_OBJECT_TYPE_FRAMEBUFFER));
+		}
+
+		for (auto &entry : m_render_passes) {
+			delete entry.second;
+		}
+
+		m_framebuffers.clear();
+		m_render_passes.clear();
+	}
+
+
+	const RenderPass* RenderPassCache::getRenderPass(
+		const std::vector<VkAttachmentDescription> &attachments,
+		const std::vector<VkSubpassDescription> &subpasses,
+		const std::vector<VkSubpassDependency> &dependencies
+	) {
+		Key key;
+		key.reserve(1 + attachments.size() * 9 + subpasses.size() * 8 + dependencies.size() * 7);
+
+		key.push_back(attachments.size());
+		for (const auto &a : attachments) {
+			key.push_back(a.flags);
+			key.push_back(a.format);
+			key.push_back(a.samples);
+			key.push_back(a.loadOp);
+			key.push_back(a.storeOp);
+			key.push_back(a.stencilLoadOp);
+			key.push_back(a.stencilStoreOp);
+			key.push_back(a.initialLayout);
+			key.push_back(a.finalLayout);
+		}
+
+		// compare what the subpasses point to, not the pointers themselves
+		key.push_back(subpasses.size());
+		for (const auto &s : subpasses) {
+			key.push_back(s.flags);
+			key.push_back(s.pipelineBindPoint);
+			appendReferences(key, s.pInputAttachments, s.inputAttachmentCount);
+			appendReferences(key, s.pColorAttachments, s.colorAttachmentCount);
+			appendReferences(key, s.pResolveAttachments, s.colorAttachmentCount);
+			appendReferences(key, s.pDepthStencilAttachment, 1);
+
+			key.push_back(s.preserveAttachmentCount);
+			for (u32 i = 0; i < s.preserveAttachmentCount; i++) {
+				key.push_back(s.pPreserveAttachments[i]);
+			}
+		}
+
+		key.push_back(dependencies.size());
+		for (const auto &d : dependencies) {
+			key.push_back(d.srcSubpass);
+			key.push_back(d.dstSubpass);
+			key.push_back(d.srcStageMask);
+			key.push_back(d.dstStageMask);
+			key.push_back(d.srcAccessMask);
+			key.push_back(d.dstAccessMask);
+			key.push_back(d.dependencyFlags);
+		}
+
+		auto it = m_render_passes.find(key);
+		if (it != m_render_passes.end()) {
+			m_hits++;
+			return it->second;
+		}
+
+		m_misses++;
+
+		RenderPass *renderPass = new RenderPass(m_logical_device, attachments, subpasses, dependencies);
+		m_render_passes.emplace(std::move(key), renderPass);
+
+		return renderPass;
+	}
+
+
+	VkFramebuffer RenderPassCache::getFramebuffer(VkRenderPass renderPass, const std::vector<VkImageView> &views, const VkExtent2D &extent) {
+		Key &key = m_framebuffer_key;
+		key.clear();
+
+		key.push_back(utils::handleToWord(renderPass));
+		key.push_back((static_cast<u64>(extent.width) << 32) | extent.height);
+
+		for (const auto view : views) {
+			key.push_back(utils::handleToWord(view));
+		}
+
+		auto it = m_framebuffers.find(key);
+		if (it != m_framebuffers.end()) {
+			m_hits++;
+			return it->second.handle;
+		}
+
+		m_misses++;
+
+		VkFramebufferCreateInfo info;
+		initStruct(info, VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO);
+
+		info.renderPass = renderPass;
+		info.attachmentCount = to_u32(views.size());
+		info.pAttachments = views.data();
+		info.width = extent.width;
+		info.height = extent.height;
+		info.layers = 1;
+
+		Framebuffer framebuffer;
+		framebuffer.views = views;
+
+		if (vkCreateFramebuffer(m_logical_device->getHandle(), &info, HostAllocator::get(VK_OBJECT_TYPE_FRAMEBUFFER), &framebuffer.handle) != VK_SUCCESS) {
+			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to create framebuffer.");
+		}
+
+		// the lookup key is reused, so the map keeps a copy
+		return m_framebuffers.emplace(key, std::move(framebuffer)).first->second.handle;
+	}
+
+
+	void RenderPassCache::evict(VkImageView view) {
+		DeletionQueue &deletionQueue = m_logical_device->getDeletionQueue();
+
+		for (auto it = m_framebuffers.begin(); it != m_framebuffers.end();) {
+			const auto &views = it->second.views;
+
+			if (std::find(views.begin(), views.end(), view) == views.end()) {
+				++it;
+				continue;
+			}
+
+			// frames in flight may still be drawing into the framebuffer
+			deletionQueue.push(VK_OBJECT_TYPE_FRAMEBUFFER, it->second.handle);
+			it = m_framebuffers.erase(it);
+		}
+	}
+
+} // namespace carbon
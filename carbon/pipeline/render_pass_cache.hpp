@@ -0,0 +1,163 @@
+// file      : carbon/pipeline/render_pass_cache.hpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#pragma once
+
+#ifndef PIPELINE_RENDER_PASS_CACHE_HPP
+#define PIPELINE_RENDER_PASS_CACHE_HPP
+
+#include "carbon/backend.hpp"
+#include "carbon/common/utils.hpp"
+
+#include <unordered_map>
+#include <vector>
+
+namespace carbon {
+
+	// forward-declare classes that would result in circular dependency
+	class LogicalDevice;
+	class RenderPass;
+
+	/**
+	 * @brief Hands out render passes and framebuffers, only creating them
+	 * when nothing with the same description has been created before.
+	 * Descriptions are flattened into a key that is compared in full, so
+	 * two different descriptions never share an object.
+	 */
+	class RenderPassCache {
+
+	private:
+
+		/**
+		 * @brief Flattened description of a render pass or framebuffer.
+		 */
+		using Key = std::vector<u64>;
+
+		/**
+		 * @brief A framebuffer along with the views it was created from.
+		 */
+		struct Framebuffer {
+			VkFramebuffer handle{ VK_NULL_HANDLE };
+			std::vector<VkImageView> views;
+		};
+
+		/**
+		 * @brief The logical device to create the objects on.
+		 */
+		const class LogicalDevice *m_logical_device;
+
+		/**
+		 * @brief Render passes, keyed by their attachments, subpasses and dependencies.
+		 */
+		std::unordered_map<Key, class RenderPass*, utils::WordHash> m_render_passes;
+
+		/**
+		 * @brief Framebuffers, keyed by their render pass, views and size.
+		 */
+		std::unordered_map<Key, Framebuffer, utils::WordHash> m_framebuffers;
+
+		/**
+		 * @brief Key that framebuffers are looked up with, kept so that
+		 * looking up an existing framebuffer every frame never allocates.
+		 */
+		Key m_framebuffer_key;
+
+		/**
+		 * @brief Number of requests that returned an existing object.
+		 */
+		u64 m_hits{ 0 };
+
+		/**
+		 * @brief Number of requests that had to create a new object.
+		 */
+		u64 m_misses{ 0 };
+
+	public:
+
+		/**
+		 * @brief Creates an empty cache.
+		 * @param logiDevice The logical device to use.
+		 */
+		explicit RenderPassCache(class LogicalDevice *logiDevice);
+
+		RenderPassCache(const RenderPassCache&) = delete;
+
+		RenderPassCache& operator=(const RenderPassCache&) = delete;
+
+		/**
+		 * @brief Destructor for the render pass cache.
+		 */
+		~RenderPassCache();
+
+		/**
+		 * @brief Destroys every render pass and framebuffer in the cache.
+		 * The GPU must have finished with all of them.
+		 */
+		void destroy();
+
+		/**
+		 * @brief Gets a render pass matching the description, creating it on a miss.
+		 * The attachment references pointed to by the subpasses only need to stay
+		 * alive until this returns.
+		 * @param attachments The attachments used by the render pass.
+		 * @param subpasses The subpasses of the render pass.
+		 * @param dependencies [Optional] The dependencies between subpasses.
+		 * @returns The render pass, which is owned by the cache.
+		 */
+		const class RenderPass* getRenderPass(
+			const std::vector<VkAttachmentDescription> &attachments,
+			const std::vector<VkSubpassDescription> &subpasses,
+			const std::vector<VkSubpassDependency> &dependencies = {}
+		);
+
+		/**
+		 * @brief Gets a framebuffer for the given views, creating it on a miss.
+		 * @param renderPass The render pass the framebuffer is used with.
+		 * @param views The views of the attachments, in render pass order.
+		 * @param extent The size of the framebuffer.
+		 * @returns The framebuffer, which is owned by the cache.
+		 */
+		VkFramebuffer getFramebuffer(VkRenderPass renderPass, const std::vector<VkImageView> &views, const VkExtent2D &extent);
+
+		/**
+		 * @brief Destroys every framebuffer that uses the view. Must be called
+		 * before the view is destroyed, since a new view may reuse its handle.
+		 * The GPU must have finished with the framebuffers.
+		 * @param view The view that is going away.
+		 */
+		void evict(VkImageView view);
+
+		/**
+		 * @returns The number of render passes in the cache.
+		 */
+		const size_t getRenderPassCount() const {
+			return m_render_passes.size();
+		}
+
+		/**
+		 * @returns The number of framebuffers in the cache.
+		 */
+		const size_t getFramebufferCount() const {
+			return m_framebuffers.size();
+		}
+
+		/**
+		 * @returns The number of requests that returned an existing object.
+		 */
+		const u64 getHitCount() const {
+			return m_hits;
+		}
+
+		/**
+		 * @returns The number of requests that had to create a new object.
+		 */
+		const u64 getMissCount() const {
+			return m_misses;
+		}
+
+	};
+
+} // namespace carbon
+
+#endif // PIPELINE_RENDER_PASS_CACHE_HPP
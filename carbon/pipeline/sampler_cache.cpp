@@ -0,0 +1,172 @@
+// file      : carbon/pipeline/sampler_cache.cpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#include "sampler_cache.hpp"
+
+#include "carbon/common/logger.hpp"
+#include "carbon/core/host_allocator.hpp"
+#include "carbon/core/logical_device.hpp"
+#include "carbon/core/physical_device.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace carbon {
+
+	/**
+	 * @returns The two values packed into one word.
+	 */
+	static u64 packWord(u32 low, u32 high) {
+		return (static_cast<u64>(high) << 32) | low;
+	}
+
+
+	/**
+	 * @returns The bits of the float, so equal values give equal keys.
+	 */
+	static u32 floatBits(float value) {
+		// -0 and 0 sample the same
+		if (value == 0.0f) {
+			value = 0.0f;
+		}
+
+		u32 bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+
+
+	void SamplerCache::normalize(VkSamplerCreateInfo &info) const {
+		info.anisotropyEnable = info.anisotropyEnable && m_max_anisotropy > 1.0f ? VK_TRUE : VK_FALSE;
+		info.maxAnisotropy = info.anisotropyEnable ? std::clamp(info.maxAnisotropy, 1.0f, m_max_anisotropy) : 1.0f;
+
+		// ignored unless comparison is turned on
+		if (!info.compareEnable) {
+			info.compareOp = VK_COMPARE_OP_NEVER;
+		}
+	}
+
+
+	SamplerCache::Key SamplerCache::makeKey(const VkSamplerCreateInfo &info) {
+		return {
+			packWord(info.flags, info.magFilter),
+			packWord(info.minFilter, info.mipmapMode),
+			packWord(info.addressModeU, info.addressModeV),
+			packWord(info.addressModeW, floatBits(info.mipLodBias)),
+			packWord(info.anisotropyEnable, floatBits(info.maxAnisotropy)),
+			packWord(info.compareEnable, info.compareOp),
+			packWord(floatBits(info.minLod), floatBits(info.maxLod)),
+			packWord(info.borderColor, info.unnormalizedCoordinates)
+		};
+	}
+
+
+	SamplerCache::SamplerCache(LogicalDevice *logiDevice)
+		: m_logical_device(logiDevice)
+	{
+		assert(m_logical_device && "Logical device must not be null.");
+
+		const VkPhysicalDeviceLimits &limits = m_logical_device->getPhysicalDevice()->getProperties().limits;
+
+		m_max_anisotropy = m_logical_device->isAnisotropyEnabled() ? limits.maxSamplerAnisotropy : 1.0f;
+		m_max_samplers = limits.maxSamplerAllocationCount;
+	}
+
+
+	SamplerCache::~SamplerCache() {
+		destroy();
+	}
+
+
+	void SamplerCache::destroy() {
+		VkDevice device = m_logical_device->getHandle();
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		for (auto &entry : m_samplers) {
+			vkDestroySampler(device, entry.second, HostAllocator::get(VK_OBJECT_TYPE_SAMPLER));
+		}
+
+		m_samplers.clear();
+	}
+
+
+	VkSampler SamplerCache::getSampler(const VkSamplerCreateInfo &info) {
+		assert(info.pNext == nullptr && "Chained sampler structures are not part of the key.");
+
+		VkSamplerCreateInfo normalized{ info };
+		normalize(normalized);
+
+		const Key key = makeKey(normalized);
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		auto it = m_samplers.find(key);
+		if (it != m_samplers.end()) {
+			m_hits++;
+			return it->second;
+		}
+
+		m_misses++;
+
+		// creating past the limit is undefined, so fail loudly instead
+		if (m_samplers.size() >= m_max_samplers) {
+			CARBON_LOG_ERROR(carbon::log::To::File, fmt::format("Device allows at most {} samplers.", m_max_samplers));
+			return VK_NULL_HANDLE;
+		}
+
+		VkSampler sampler{ VK_NULL_HANDLE };
+
+		if (vkCreateSampler(m_logical_device->getHandle(), &normalized, HostAllocator::get(VK_OBJECT_TYPE_SAMPLER), &sampler) != VK_SUCCESS) {
+			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to create sampler.");
+		}
+
+		m_samplers.emplace(key, sampler);
+		return sampler;
+	}
+
+
+	VkSampler SamplerCache::getSampler(VkFilter filter, VkSamplerAddressMode addressMode, float maxAnisotropy) {
+		VkSamplerCreateInfo info;
+		initStruct(info, VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO);
+
+		info.magFilter = filter;
+		info.minFilter = filter;
+		info.mipmapMode = filter == VK_FILTER_NEAREST ? VK_SAMPLER_MIPMAP_MODE_NEAREST : VK_SAMPLER_MIPMAP_MODE_LINEAR;
+		info.addressModeU = addressMode;
+		info.addressModeV = addressMode;
+		info.addressModeW = addressMode;
+		info.mipLodBias = 0.0f;
+		info.anisotropyEnable = maxAnisotropy > 1.0f ? VK_TRUE : VK_FALSE;
+		info.maxAnisotropy = maxAnisotropy;
+		info.compareEnable = VK_FALSE;
+		info.compareOp = VK_COMPARE_OP_NEVER;
+		info.minLod = 0.0f;
+
+		// every mip level the image has
+		info.maxLod = VK_LOD_CLAMP_NONE;
+		info.borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK;
+		info.unnormalizedCoordinates = VK_FALSE;
+
+		return getSampler(info);
+	}
+
+
+	const size_t SamplerCache::getSamplerCount() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_samplers.size();
+	}
+
+
+	const u64 SamplerCache::getHitCount() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_hits;
+	}
+
+
+	const u64 SamplerCache::getMissCount() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_misses;
+	}
+
+} // namespace carbon
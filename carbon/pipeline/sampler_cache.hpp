@@ -0,0 +1,170 @@
+// file      : carbon/pipeline/sampler_cache.hpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#pragma once
+
+#ifndef PIPELINE_SAMPLER_CACHE_HPP
+#define PIPELINE_SAMPLER_CACHE_HPP
+
+#include "carbon/backend.hpp"
+#include "carbon/common/utils.hpp"
+#include "carbon/engine/config.hpp"
+
+#include <array>
+#include <mutex>
+#include <unordered_map>
+
+namespace carbon {
+
+	// forward-declare classes that would result in circular dependency
+	class LogicalDevice;
+
+	/**
+	 * @brief Owns every sampler, so that identical descriptions share one
+	 * object no matter how many materials ask for it. Devices cap the number
+	 * of samplers that may exist at once (`maxSamplerAllocationCount`, as low
+	 * as 4000), so samplers are never created anywhere else. Samplers are
+	 * immutable and live as long as the cache. Anisotropy follows the
+	 * `samplerAnisotropy` feature of the device, and is clamped to its limit.
+	 * Safe to use from any thread.
+	 */
+	class SamplerCache {
+
+	private:
+
+		/**
+		 * @brief Every field of a sampler description, two to a word.
+		 */
+		using Key = std::array<u64, 8>;
+
+		/**
+		 * @brief Hashes a key, which has a fixed size so looking up a sampler never allocates.
+		 */
+		struct KeyHash {
+			size_t operator()(const Key &key) const {
+				return static_cast<size_t>(utils::hashBytes(key.data(), sizeof(Key)));
+			}
+		};
+
+		/**
+		 * @brief The logical device to create the samplers on.
+		 */
+		const class LogicalDevice *m_logical_device;
+
+		/**
+		 * @brief Guards the map, since samplers may be requested from jobs.
+		 */
+		std::mutex m_mutex;
+
+		/**
+		 * @brief Samplers, keyed by their description.
+		 */
+		std::unordered_map<Key, VkSampler, KeyHash> m_samplers;
+
+		/**
+		 * @brief Highest anisotropy a sampler may have, or 1 if the device cannot filter anisotropically.
+		 */
+		float m_max_anisotropy;
+
+		/**
+		 * @brief Most samplers the device allows at once.
+		 */
+		u32 m_max_samplers;
+
+		/**
+		 * @brief Number of requests that returned an existing sampler.
+		 */
+		u64 m_hits{ 0 };
+
+		/**
+		 * @brief Number of requests that had to create a new sampler.
+		 */
+		u64 m_misses{ 0 };
+
+		/**
+		 * @brief Makes descriptions that create the same sampler equal, by
+		 * clearing fields the driver ignores and applying the anisotropy limit.
+		 * @param info The description to change.
+		 */
+		void normalize(VkSamplerCreateInfo &info) const;
+
+		/**
+		 * @param info A normalized description.
+		 * @returns The key of the description.
+		 */
+		static Key makeKey(const VkSamplerCreateInfo &info);
+
+	public:
+
+		/**
+		 * @brief Creates an empty cache.
+		 * @param logiDevice The logical device to use.
+		 */
+		explicit SamplerCache(class LogicalDevice *logiDevice);
+
+		SamplerCache(const SamplerCache&) = delete;
+
+		SamplerCache& operator=(const SamplerCache&) = delete;
+
+		/**
+		 * @brief Destructor for the sampler cache.
+		 */
+		~SamplerCache();
+
+		/**
+		 * @brief Destroys every sampler in the cache. The GPU must have
+		 * finished with all of them.
+		 */
+		void destroy();
+
+		/**
+		 * @brief Gets a sampler, creating it on a miss. Anisotropy is turned
+		 * off if the device does not support it.
+		 * @param info The description of the sampler, which must not chain any other structures.
+		 * @returns The sampler, which is owned by the cache.
+		 */
+		VkSampler getSampler(const VkSamplerCreateInfo &info);
+
+		/**
+		 * @brief Gets a sampler with the same filter and address mode in every
+		 * direction, which covers most textures.
+		 * @param filter The filter for magnification, minification and between mip levels.
+		 * @param addressMode How coordinates outside the image are handled.
+		 * @param maxAnisotropy [Optional] Highest anisotropy to filter with, where 1 turns it off.
+		 * @returns The sampler, which is owned by the cache.
+		 */
+		VkSampler getSampler(
+			VkFilter filter,
+			VkSamplerAddressMode addressMode,
+			float maxAnisotropy = config::MAX_SAMPLER_ANISOTROPY
+		);
+
+		/**
+		 * @returns Highest anisotropy a sampler may have, or 1 if the device
+		 * cannot filter anisotropically.
+		 */
+		const float getMaxAnisotropy() const {
+			return m_max_anisotropy;
+		}
+
+		/**
+		 * @returns The number of samplers in the cache.
+		 */
+		const size_t getSamplerCount();
+
+		/**
+		 * @returns The number of requests that returned an existing sampler.
+		 */
+		const u64 getHitCount();
+
+		/**
+		 * @returns The number of requests that had to create a new sampler.
+		 */
+		const u64 getMissCount();
+
+	};
+
+} // namespace carbon
+
+#endif // PIPELINE_SAMPLER_CACHE_HPP
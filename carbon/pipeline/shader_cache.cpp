@@ -0,0 +1,327 @@
+// file      : carbon/pipeline/shader_cache.cpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#include "shader_cache.hpp"
+
+#include "carbon/common/logger.hpp"
+#include "carbon/common/mapped_file.hpp"
+#include "carbon/common/utils.hpp"
+#include "carbon/core/host_allocator.hpp"
+#include "carbon/core/logical_device.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace carbon {
+
+	/**
+	 * @brief First word of every SPIR-V module.
+	 */
+	static constexpr u32 SPIRV_MAGIC = 0x07230203;
+
+	/**
+	 * @brief Identifies a shader index file ("CSHI").
+	 */
+	static constexpr u32 INDEX_MAGIC = 0x49485343;
+
+	/**
+	 * @brief Bumped whenever the layout of the index changes.
+	 */
+	static constexpr u32 INDEX_VERSION = 1;
+
+	/**
+	 * @brief Start of the index file, followed by the entries and then the code.
+	 */
+	struct IndexHeader {
+		u32 magic;
+		u32 version;
+		u32 entryCount;
+		u32 reserved;
+	};
+
+	/**
+	 * @brief A shader file in the index, and where its code is stored.
+	 */
+	struct IndexEntry {
+		u64 nameHash;
+		u64 sourceSize;
+		i64 sourceTime;
+		u64 contentHash;
+		u64 codeOffset;
+		u64 codeSize;
+	};
+
+
+	void ShaderCache::loadIndex() {
+		delete m_index;
+		m_index = new MappedFile(m_index_path);
+
+		if (!m_index->isOpen()) {
+			return;
+		}
+
+		const u8 *data = m_index->getData();
+		const size_t size = m_index->getSize();
+
+		IndexHeader header;
+		if (size < sizeof(header)) {
+			return;
+		}
+
+		std::memcpy(&header, data, sizeof(header));
+
+		if (header.magic != INDEX_MAGIC || header.version != INDEX_VERSION || sizeof(header) + header.entryCount * sizeof(IndexEntry) > size) {
+			CARBON_LOG_INFO(carbon::log::To::File, fmt::format("Ignoring invalid shader index `{}`.", m_index_path));
+			return;
+		}
+
+		// the mapping is page aligned, so entries and code can be used in place
+		const IndexEntry *entries = reinterpret_cast<const IndexEntry*>(data + sizeof(header));
+
+		for (u32 i = 0; i < header.entryCount; i++) {
+			const IndexEntry &e = entries[i];
+
+			if (e.codeSize == 0 || e.codeOffset % sizeof(u32) != 0 || e.codeSize % sizeof(u32) != 0 || e.codeOffset + e.codeSize > size) {
+				continue;
+			}
+
+			// files read this run are newer than the index
+			m_sources.emplace(e.nameHash, Source{ e.sourceSize, e.sourceTime, e.contentHash });
+
+			// modules that already exist do not need the code again, but keep it valid anyway
+			Blob &blob = m_blobs[e.contentHash];
+			blob.code = reinterpret_cast<const u32*>(data + e.codeOffset);
+			blob.size = static_cast<size_t>(e.codeSize);
+			blob.owned = {};
+		}
+	}
+
+
+	bool ShaderCache::readSource(const std::string &path, u64 &contentHash) {
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+
+		if (!file.is_open()) {
+			CARBON_LOG_ERROR(carbon::log::To::File, fmt::format("Failed to open shader `{}`.", path));
+			return false;
+		}
+
+		const size_t size = static_cast<size_t>(file.tellg());
+
+		// SPIR-V is a stream of 32-bit words
+		if (size < sizeof(u32) || size % sizeof(u32) != 0) {
+			CARBON_LOG_ERROR(carbon::log::To::File, fmt::format("Shader `{}` is not valid SPIR-V.", path));
+			return false;
+		}
+
+		std::vector<u32> code(size / sizeof(u32));
+		file.seekg(0);
+
+		if (!file.read(reinterpret_cast<char*>(code.data()), size) || code[0] != SPIRV_MAGIC) {
+			CARBON_LOG_ERROR(carbon::log::To::File, fmt::format("Shader `{}` is not valid SPIR-V.", path));
+			return false;
+		}
+
+		m_file_reads++;
+		contentHash = utils::hashBytes(code.data(), size);
+
+		// another file already has the same code
+		Blob &blob = m_blobs[contentHash];
+
+		if (blob.code != nullptr) {
+			m_shared_count++;
+			return true;
+		}
+
+		blob.owned = std::move(code);
+		blob.code = blob.owned.data();
+		blob.size = size;
+
+		return true;
+	}
+
+
+	ShaderCache::ShaderCache(LogicalDevice *logiDevice, const std::string &shaderDir, const std::string &indexPath)
+		: m_logical_device(logiDevice)
+		, m_shader_dir(shaderDir)
+		, m_index_path(indexPath)
+	{
+		assert(m_logical_device && "Logical device must not be null.");
+		loadIndex();
+	}
+
+
+	ShaderCache::~ShaderCache() {
+		destroy();
+	}
+
+
+	void ShaderCache::destroy() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		for (auto &entry : m_blobs) {
+			if (entry.second.module != VK_NULL_HANDLE) {
+				vkDestroyShaderModule(m_logical_device->getHandle(), entry.second.module, HostAllocator::get(VK_OBJECT_TYPE_SHADER_MODULE));
+			}
+		}
+
+		m_blobs.clear();
+		m_sources.clear();
+
+		delete m_index;
+		m_index = nullptr;
+	}
+
+
+	VkShaderModule ShaderCache::getModule(const std::string &name) {
+		const u64 nameHash = utils::hashBytes(name.data(), name.size());
+		const std::filesystem::path path{ std::filesystem::path(m_shader_dir) / name };
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		// the size and time of the file are enough to tell if it changed
+		std::error_code err;
+		const u64 size = static_cast<u64>(std::filesystem::file_size(path, err));
+		const bool exists = !err;
+		const i64 time = exists ? static_cast<i64>(std::filesystem::last_write_time(path, err).time_since_epoch().count()) : 0;
+
+		auto it = m_sources.find(nameHash);
+		u64 contentHash{ 0 };
+
+		// files may be left out of a shipped build, in which case the index is all there is
+		if (it != m_sources.end() && (!exists || (it->second.size == size && it->second.time == time))) {
+			contentHash = it->second.contentHash;
+		} else {
+			if (!readSource(path.string(), contentHash)) {
+				return VK_NULL_HANDLE;
+			}
+
+			m_sources[nameHash] = { size, time, contentHash };
+			m_dirty = true;
+		}
+
+		Blob &blob = m_blobs[contentHash];
+
+		if (blob.module != VK_NULL_HANDLE) {
+			return blob.module;
+		}
+
+		VkShaderModuleCreateInfo info;
+		initStruct(info, VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO);
+
+		info.codeSize = blob.size;
+		info.pCode = blob.code;
+
+		if (vkCreateShaderModule(m_logical_device->getHandle(), &info, HostAllocator::get(VK_OBJECT_TYPE_SHADER_MODULE), &blob.module) != VK_SUCCESS) {
+			CARBON_LOG_FATAL(carbon::log::To::File, fmt::format("Failed to create shader module for `{}`.", name));
+		}
+
+		return blob.module;
+	}
+
+
+	bool ShaderCache::save() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (!m_dirty) {
+			return true;
+		}
+
+		// every unique piece of code is written once, however many files share it
+		std::vector<IndexEntry> entries;
+		std::vector<const Blob*> blobs;
+		std::unordered_map<u64, u64> offsets;
+		u64 codeSize{ 0 };
+
+		entries.reserve(m_sources.size());
+
+		for (const auto &entry : m_sources) {
+			const Source &source = entry.second;
+			const Blob &blob = m_blobs.at(source.contentHash);
+
+			auto offset = offsets.find(source.contentHash);
+			if (offset == offsets.end()) {
+				offset = offsets.emplace(source.contentHash, codeSize).first;
+				codeSize += blob.size;
+				blobs.push_back(&blob);
+			}
+
+			entries.push_back({ entry.first, source.size, source.time, source.contentHash, offset->second, blob.size });
+		}
+
+		const u64 codeStart = sizeof(IndexHeader) + entries.size() * sizeof(IndexEntry);
+		for (auto &e : entries) {
+			e.codeOffset += codeStart;
+		}
+
+		std::error_code err;
+		const std::filesystem::path path{ m_index_path };
+		std::filesystem::create_directories(path.parent_path(), err);
+
+		const std::filesystem::path tmpPath{ m_index_path + ".tmp" };
+		{
+			std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+			const IndexHeader header{ INDEX_MAGIC, INDEX_VERSION, to_u32(entries.size()), 0 };
+
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(IndexEntry));
+
+			for (const Blob *blob : blobs) {
+				file.write(reinterpret_cast<const char*>(blob->code), blob->size);
+			}
+
+			if (!file) {
+				CARBON_LOG_WARN(carbon::log::To::File, fmt::format("Failed to write shader index `{}`.", m_index_path));
+				return false;
+			}
+		}
+
+		// code that no file uses any more is not in the new index, so must not point into the old one
+		for (auto it = m_blobs.begin(); it != m_blobs.end();) {
+			if (offsets.find(it->first) != offsets.end()) {
+				++it;
+			} else if (it->second.module == VK_NULL_HANDLE) {
+				it = m_blobs.erase(it);
+			} else {
+				it->second.code = nullptr;
+				it->second.size = 0;
+				it->second.owned = {};
+				++it;
+			}
+		}
+
+		// the old index must be unmapped before it can be replaced
+		delete m_index;
+		m_index = nullptr;
+
+		std::filesystem::rename(tmpPath, path, err);
+		if (err) {
+			CARBON_LOG_WARN(carbon::log::To::File, fmt::format("Failed to replace shader index `{}`: {}", m_index_path, err.message()));
+			std::filesystem::remove(tmpPath, err);
+		} else {
+			m_dirty = false;
+		}
+
+		// points the code back into whichever index is now on disk
+		loadIndex();
+		return !m_dirty;
+	}
+
+
+	const size_t ShaderCache::getModuleCount() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		size_t count{ 0 };
+
+		// code from the index only gets a module once it is requested
+		for (const auto &entry : m_blobs) {
+			if (entry.second.module != VK_NULL_HANDLE) {
+				count++;
+			}
+		}
+
+		return count;
+	}
+
+} // namespace carbon
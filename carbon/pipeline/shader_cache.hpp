@@ -0,0 +1,179 @@
+// file      : carbon/pipeline/shader_cache.hpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#pragma once
+
+#ifndef PIPELINE_SHADER_CACHE_HPP
+#define PIPELINE_SHADER_CACHE_HPP
+
+#include "carbon/backend.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace carbon {
+
+	// forward-declare classes that would result in circular dependency
+	class LogicalDevice;
+	class MappedFile;
+
+	/**
+	 * @brief Loads SPIR-V shaders and creates their modules, keyed by a hash
+	 * of their contents so files with identical code share one module.
+	 * The code of every shader is also packed into an index on disk, which
+	 * is memory-mapped on the next run so unchanged shaders are created
+	 * straight from the index without reading their files. Safe to use from
+	 * any thread.
+	 */
+	class ShaderCache {
+
+	private:
+
+		/**
+		 * @brief What is known about a shader file.
+		 */
+		struct Source {
+			u64 size;
+			i64 time;
+			u64 contentHash;
+		};
+
+		/**
+		 * @brief Unique SPIR-V code and its module.
+		 */
+		struct Blob {
+			const u32 *code{ nullptr };
+			size_t size{ 0 };
+			std::vector<u32> owned;
+			VkShaderModule module{ VK_NULL_HANDLE };
+		};
+
+		/**
+		 * @brief The logical device to create the shader modules on.
+		 */
+		const class LogicalDevice *m_logical_device;
+
+		/**
+		 * @brief Directory that shader names are relative to.
+		 */
+		std::string m_shader_dir;
+
+		/**
+		 * @brief Path of the index file.
+		 */
+		std::string m_index_path;
+
+		/**
+		 * @brief The index from the last run, mapped into memory.
+		 */
+		class MappedFile *m_index{ nullptr };
+
+		/**
+		 * @brief Guards the maps, since shaders may be loaded from jobs.
+		 */
+		std::mutex m_mutex;
+
+		/**
+		 * @brief Shader files, keyed by a hash of their name.
+		 */
+		std::unordered_map<u64, Source> m_sources;
+
+		/**
+		 * @brief Unique code, keyed by a hash of its contents.
+		 */
+		std::unordered_map<u64, Blob> m_blobs;
+
+		/**
+		 * @brief `true` if the index on disk is out of date.
+		 */
+		bool m_dirty{ false };
+
+		/**
+		 * @brief Number of shader files that had to be read.
+		 */
+		std::atomic<u32> m_file_reads{ 0 };
+
+		/**
+		 * @brief Number of shader files whose code matched a module that already existed.
+		 */
+		std::atomic<u32> m_shared_count{ 0 };
+
+		/**
+		 * @brief Maps the index and points the code of each shader into it.
+		 * Modules that already exist are kept.
+		 */
+		void loadIndex();
+
+		/**
+		 * @brief Reads a shader file and adds its code, unless the same code is already known.
+		 * @param path The file to read.
+		 * @param contentHash Set to the hash of the code in the file.
+		 * @returns `true` if the file was a valid SPIR-V shader, `false` otherwise.
+		 */
+		bool readSource(const std::string &path, u64 &contentHash);
+
+	public:
+
+		/**
+		 * @brief Creates the shader cache, mapping the index from the last run if there is one.
+		 * @param logiDevice The logical device to use.
+		 * @param shaderDir The directory to load shaders from.
+		 * @param indexPath The file to keep the index in.
+		 */
+		explicit ShaderCache(class LogicalDevice *logiDevice, const std::string &shaderDir, const std::string &indexPath);
+
+		ShaderCache(const ShaderCache&) = delete;
+
+		ShaderCache& operator=(const ShaderCache&) = delete;
+
+		/**
+		 * @brief Destructor for the shader cache.
+		 */
+		~ShaderCache();
+
+		/**
+		 * @brief Destroys all shader modules and unmaps the index.
+		 */
+		void destroy();
+
+		/**
+		 * @brief Gets the module of a shader, creating it if its code has not been seen before.
+		 * @param name The path of the SPIR-V file, relative to the shader directory.
+		 * @returns The shader module, or `VK_NULL_HANDLE` if the shader could not be loaded.
+		 */
+		VkShaderModule getModule(const std::string &name);
+
+		/**
+		 * @brief Writes the index to disk if any shader changed, then maps the new index.
+		 * @returns `true` if the index on disk is up to date, `false` otherwise.
+		 */
+		bool save();
+
+		/**
+		 * @returns The number of unique shader modules.
+		 */
+		const size_t getModuleCount();
+
+		/**
+		 * @returns The number of shader files that had to be read.
+		 */
+		const u32 getFileReadCount() const {
+			return m_file_reads.load();
+		}
+
+		/**
+		 * @returns The number of shader files that reused the module of identical code.
+		 */
+		const u32 getSharedCount() const {
+			return m_shared_count.load();
+		}
+
+	};
+
+} // namespace carbon
+
+#endif // PIPELINE_SHADER_CACHE_HPP
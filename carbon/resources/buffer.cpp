@@ -4,9 +4,13 @@
 
 #include "buffer.hpp"
 
+#include "carbon/common/logger.hpp"
+#include "carbon/core/deletion_queue.hpp"
+#include "carbon/core/host_allocator.hpp"
 #include "carbon/core/logical_device.hpp"
 
 #include <cassert>
+#include <cstring>
 
 namespace carbon {
 
@@ -22,20 +26,14 @@ namespace carbon {
 
 		// create with given parameters
 		create(m_size, m_usage, m_properties, data);
-
-		// initialize descriptor
-		m_descriptor = {};
-		m_descriptor.buffer = m_buffer;
-		m_descriptor.offset = m_offset;
-		m_descriptor.range = m_size;
 	}
 
 
 	Buffer::Buffer(const LogicalDevice *device) 
 		: m_device(device)
 		, m_size(0)
-		, m_usage(VK_NULL_HANDLE)
-		, m_properties(VK_NULL_HANDLE)
+		, m_usage(0)
+		, m_properties(0)
 		, m_mapped_memory(nullptr)
 		, m_buffer(VK_NULL_HANDLE)
 		, m_memory(VK_NULL_HANDLE)
@@ -45,24 +43,6 @@ namespace carbon {
 	}
 
 
-	Buffer::Buffer(const Buffer &other) {
-		// do nothing if they are exactly the same
-		if (*this == other) {
-			return;
-		}
-
-		// copy contents of buffer to *this
-		m_device = other.getLogicalDevice();
-		m_size = other.getSize();
-		m_usage = other.getUsage();
-		m_properties = other.getMemoryProperties();
-		m_mapped_memory = other.getMappedMemory();
-		m_buffer = other.getHandle();
-		m_memory = other.getDeviceMemory();
-		m_descriptor = other.getDescriptor();
-	}
-
-
 	Buffer::~Buffer() {
 		// ensure buffer has not already been destroyed
 		if (m_buffer != VK_NULL_HANDLE) {
@@ -72,22 +52,19 @@ namespace carbon {
 
 
 	void Buffer::destroy() {
-		unmapMemory();
-
-		// get logical device
-		VkDevice dev = m_device->getHandle();
+		m_mapped_memory = nullptr;
 
-		// destroy buffer
+		// frames in flight may still read the buffer, so it goes once they are done
 		if (m_buffer != VK_NULL_HANDLE) {
-			vkDestroyBuffer(dev, m_buffer, nullptr);
-			m_buffer = VK_NULL_HANDLE;
+			m_device->getDeletionQueue().push(VK_OBJECT_TYPE_BUFFER, m_buffer, m_allocation);
+		} else if (m_allocation.isValid()) {
+			m_device->getDeletionQueue().push(m_allocation);
 		}
 
-		// destroy device memory
-		if (m_memory != VK_NULL_HANDLE) {
-			vkFreeMemory(dev, m_memory, nullptr);
-			m_memory = VK_NULL_HANDLE;
-		}
+		m_buffer = VK_NULL_HANDLE;
+		m_allocation = {};
+		m_memory = VK_NULL_HANDLE;
+		m_offset = 0;
 	}
 
 
@@ -102,29 +79,136 @@ namespace carbon {
 
 
 	void Buffer::create(const VkDeviceSize &size, const VkBufferUsageFlags &usage, const VkMemoryPropertyFlags &properties, const void *data) {
+		// release whatever the buffer held before
+		destroy();
+
+		m_size = size;
+		m_usage = usage;
+		m_properties = properties;
+
+		VkDevice dev = m_device->getHandle();
+
+		VkBufferCreateInfo createInfo;
+		initStruct(createInfo, VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO);
+
+		createInfo.size = m_size;
+		createInfo.usage = m_usage;
+		createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		if (vkCreateBuffer(dev, &createInfo, HostAllocator::get(VK_OBJECT_TYPE_BUFFER), &m_buffer) != VK_SUCCESS) {
+			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to create buffer.");
+		}
+
+		VkMemoryRequirements memReqs;
+		vkGetBufferMemoryRequirements(dev, m_buffer, &memReqs);
+
+		// carved out of a larger block rather than given memory of its own
+		m_allocation = m_device->getMemoryAllocator().allocate(memReqs, m_properties);
+
+		if (!m_allocation.isValid()) {
+			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to allocate buffer memory.");
+		}
+
+		m_memory = m_allocation.memory;
+		m_offset = m_allocation.offset;
+
+		vkBindBufferMemory(dev, m_buffer, m_memory, m_offset);
+
+		// the descriptor offset is into the buffer, not its memory
+		m_descriptor = {};
+		m_descriptor.buffer = m_buffer;
+		m_descriptor.offset = 0;
+		m_descriptor.range = m_size;
+
+		// host-visible memory is mapped once by the allocator, for the life of the buffer
+		m_mapped_memory = m_allocation.mapped;
+
+		if (data == nullptr) {
+			return;
+		}
+
+		// initial data can only be copied straight in if the host can see the memory
+		assert((m_properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && "Buffer with initial data must be host visible.");
+
+		if (m_mapped_memory == nullptr) {
+			CARBON_LOG_ERROR(carbon::log::To::File, "Failed to map buffer memory.");
+			return;
+		}
+
+		std::memcpy(m_mapped_memory, data, static_cast<size_t>(m_size));
+		flush(VK_WHOLE_SIZE, 0);
 	}
 
 
-	void Buffer::copyFrom(Buffer *src, const VkDeviceSize &size) {
+	void Buffer::copyFrom(VkCommandBuffer commandBuffer, const Buffer *src, const VkDeviceSize &size, VkDeviceSize srcOffset, VkDeviceSize dstOffset) {
+		assert(src && "Buffer to copy from must not be null.");
+		assert(srcOffset + size <= src->getSize() && dstOffset + size <= m_size && "Copy is out of range.");
+
+		VkBufferCopy region{};
+		region.srcOffset = srcOffset;
+		region.dstOffset = dstOffset;
+		region.size = size;
+
+		vkCmdCopyBuffer(commandBuffer, src->getHandle(), m_buffer, 1, &region);
 	}
 
 
-	bool Buffer::mapMemory(VkDeviceSize size, VkDeviceSize offset) {
+	VkBuffer Buffer::relocate(VkCommandBuffer commandBuffer, const MemoryAllocation &allocation) {
+		assert(m_buffer != VK_NULL_HANDLE && allocation.isValid() && "Cannot relocate a buffer that was never created.");
+
 		VkDevice dev = m_device->getHandle();
-		return vkMapMemory(dev, m_memory, offset, size, 0, &m_mapped_memory) == VK_SUCCESS;
+
+		VkBufferCreateInfo createInfo;
+		initStruct(createInfo, VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO);
+
+		createInfo.size = m_size;
+		createInfo.usage = m_usage;
+		createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		VkBuffer buffer{ VK_NULL_HANDLE };
+
+		if (vkCreateBuffer(dev, &createInfo, HostAllocator::get(VK_OBJECT_TYPE_BUFFER), &buffer) != VK_SUCCESS) {
+			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to create buffer.");
+		}
+
+		vkBindBufferMemory(dev, buffer, allocation.memory, allocation.offset);
+
+		VkBufferCopy region{};
+		region.size = m_size;
+
+		vkCmdCopyBuffer(commandBuffer, m_buffer, buffer, 1, &region);
+
+		// the copy and earlier frames still read the old buffer
+		const VkBuffer old = m_buffer;
+		m_device->getDeletionQueue().push(VK_OBJECT_TYPE_BUFFER, m_buffer, m_allocation);
+
+		m_buffer = buffer;
+		m_allocation = allocation;
+		m_memory = m_allocation.memory;
+		m_offset = m_allocation.offset;
+		m_descriptor.buffer = m_buffer;
+		m_mapped_memory = m_allocation.mapped;
+
+		return old;
 	}
 
 
-	void Buffer::unmapMemory() {
-		// do nothing if no memory has been mapped
-		if (!m_mapped_memory) {
-			return;
+	bool Buffer::mapMemory([[maybe_unused]] VkDeviceSize size, VkDeviceSize offset) {
+		assert((size == VK_WHOLE_SIZE || offset + size <= m_size) && "Mapped range must lie within the buffer.");
+
+		// memory is shared with other resources, so it stays mapped by the allocator
+		if (m_allocation.mapped == nullptr || offset >= m_size) {
+			return false;
 		}
 
-		// unmap the memory
-		VkDevice dev = m_device->getHandle();
-		vkUnmapMemory(dev, m_memory);
-		m_mapped_memory = nullptr;
+		m_mapped_memory = static_cast<u8*>(m_allocation.mapped) + offset;
+		return true;
+	}
+
+
+	void Buffer::unmapMemory() {
+		// the allocator keeps the memory itself mapped
+		m_mapped_memory = m_allocation.mapped;
 	}
 
 
@@ -134,18 +218,18 @@ namespace carbon {
 
 
 	bool Buffer::flush(const VkDeviceSize size, const VkDeviceSize offset) {
-		VkDevice dev = m_device->getHandle();
+		// rounds the range out to whole atoms, and skips coherent memory
+		return m_device->getMemoryAllocator().flush(m_allocation, offset, size);
+	}
 
-		// flush memory mapped range
-		VkMappedMemoryRange mappedRange;
-		initStruct(mappedRange, VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE);
 
-		mappedRange.size = size;
-		mappedRange.offset = offset;
-		mappedRange.memory = m_memory;
-		mappedRange.pNext = nullptr;
+	void Buffer::markDirty(VkDeviceSize size, VkDeviceSize offset) {
+		m_device->getMemoryAllocator().markDirty(m_allocation, offset, size);
+	}
+
 
-		return vkFlushMappedMemoryRanges(dev, 1, &mappedRange) == VK_SUCCESS;
+	bool Buffer::isCoherent() const {
+		return m_device->getMemoryAllocator().isCoherent(m_allocation);
 	}
 
 
@@ -156,7 +240,8 @@ namespace carbon {
 
 	namespace utils {
 
-		void copyBuffer(Buffer *src, Buffer *dest, const VkDeviceSize &size) {
+		void copyBuffer(VkCommandBuffer commandBuffer, Buffer *src, Buffer *dest, const VkDeviceSize &size) {
+			dest->copyFrom(commandBuffer, src, size);
 		}
 
 	} // namespace utils
@@ -8,6 +8,7 @@
 #define RES_BUFFER_HPP
 
 #include "carbon/backend.hpp"
+#include "carbon/core/memory_allocator.hpp"
 
 namespace carbon {
 
@@ -47,22 +48,28 @@ namespace carbon {
 		VkMemoryPropertyFlags m_properties;
 
 		/**
-		 * @brief Offset of the buffer, if applicable.
+		 * @brief Offset of the buffer in its device memory.
 		 */
 		VkDeviceSize m_offset = 0;
 
 		/**
-		 * @brief Physical device memory of this buffer.
+		 * @brief Physical device memory of this buffer, shared with other resources.
 		 */
 		VkDeviceMemory m_memory;
 
+		/**
+		 * @brief The range of device memory the buffer is bound to.
+		 */
+		MemoryAllocation m_allocation;
+
 		/**
 		 * @brief Stores information about the offset, buffer and size.
 		 */
 		VkDescriptorBufferInfo m_descriptor;
 
 		/**
-		 * @brief Memory that has been mapped to the buffer.
+		 * @brief Memory that has been mapped to the buffer. Host-visible
+		 * buffers are mapped when they are created and stay mapped.
 		 */
 		void *m_mapped_memory = nullptr;
 
@@ -90,11 +97,7 @@ namespace carbon {
 		 */
 		explicit Buffer(const class LogicalDevice *device);
 
-		/**
-		 * @brief Copy constructor to set current buffer to mirror another buffer.
-		 * @param other Buffer object to copy from.
-		 */
-		Buffer(const Buffer &other);
+		Buffer(const Buffer&) = delete;
 
 		Buffer& operator=(const Buffer&) = delete;
 
@@ -104,7 +107,8 @@ namespace carbon {
 		~Buffer();
 
 		/**
-		 * @brief Destroys the buffer, freeing all allocated memory.
+		 * @brief Destroys the buffer, freeing all allocated memory once no
+		 * frame in flight can still be using it.
 		 */
 		void destroy();
 
@@ -130,22 +134,39 @@ namespace carbon {
 		void create(const VkDeviceSize &size, const VkBufferUsageFlags &usage, const VkMemoryPropertyFlags &properties, const void *data = nullptr);
 
 		/**
-		 * @brief Copies the contents from the `src` buffer into this buffer.
+		 * @brief Records a copy of the contents of the `src` buffer into this buffer.
+		 * @param commandBuffer The command buffer to record the copy into.
 		 * @param src The buffer to copy the contents from.
-		 * @param size The size of the buffer to copy.
+		 * @param size The size of the range to copy.
+		 * @param srcOffset [Optional] The offset into the `src` buffer.
+		 * @param dstOffset [Optional] The offset into this buffer.
 		 */
-		static void copyFrom(Buffer *src, const VkDeviceSize &size);
+		void copyFrom(VkCommandBuffer commandBuffer, const Buffer *src, const VkDeviceSize &size, VkDeviceSize srcOffset = 0, VkDeviceSize dstOffset = 0);
 
 		/**
-		 * @brief Attempts to map the buffer into CPU-accessible memory.
-		 * @param size [Optional] The size of the buffer.
-		 * @param offset [Optional] The offset of the buffer.
-		 * @returns `true` if the buffer mapping was successful, `false` otherwise.
+		 * @brief Moves the buffer into other memory, recording a copy of its
+		 * contents. The buffer gets a new handle, and the old buffer and memory
+		 * are destroyed once no frame in flight can still be using them, so
+		 * descriptors that point at the old handle must be rewritten.
+		 * @param commandBuffer The command buffer to record the copy into.
+		 * @param allocation The memory to move into, from `MemoryAllocator::reallocate()`.
+		 * @returns The old handle of the buffer.
+		 */
+		VkBuffer relocate(VkCommandBuffer commandBuffer, const MemoryAllocation &allocation);
+
+		/**
+		 * @brief Points the mapped memory at part of the buffer. Host-visible
+		 * buffers are mapped when they are created, so this never calls `vkMapMemory`.
+		 * @param size [Optional] The size of the range, which is only checked
+		 * since the whole buffer stays mapped.
+		 * @param offset [Optional] The offset into the buffer.
+		 * @returns `true` if the buffer is host visible, `false` otherwise.
 		 */
 		bool mapMemory(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
 
 		/**
-		 * @brief Unmaps the memory from the device.
+		 * @brief Points the mapped memory back at the start of the buffer. The
+		 * memory itself stays mapped until the buffer is destroyed.
 		 */
 		void unmapMemory();
 
@@ -157,11 +178,33 @@ namespace carbon {
 		/**
 		 * @brief Flushes the memory of the device.
 		 * @param size The size of the memory range to flush.
-		 * @param offset The offset into the memory.
+		 * @param offset The offset into the buffer.
 		 * @returns `true` if the memory was successfully flushed, `false` otherwise.
 		 */
 		bool flush(const VkDeviceSize size, const VkDeviceSize offset);
 
+		/**
+		 * @brief Records that part of the buffer was written, to be flushed
+		 * together with every other write of the frame. Cheaper than `flush()`
+		 * for frequent small writes, and does nothing for coherent memory.
+		 * @param size [Optional] The size of the written range.
+		 * @param offset [Optional] The offset into the buffer.
+		 */
+		void markDirty(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+
+		/**
+		 * @returns `true` if the buffer can be written by the host, `false` otherwise.
+		 */
+		bool isMapped() const {
+			return m_allocation.mapped != nullptr;
+		}
+
+		/**
+		 * @returns `true` if host writes are seen by the device without a
+		 * flush, whether or not coherent memory was asked for.
+		 */
+		bool isCoherent() const;
+
 		/**
 		 * @returns The logical device associated with the buffer.
 		 */
@@ -196,7 +239,7 @@ namespace carbon {
 		}
 
 		/**
-		 * @returns The offset of the buffer.
+		 * @returns The offset of the buffer in its device memory.
 		 */
 		const VkDeviceSize& getOffset() const {
 			return m_offset;
@@ -209,6 +252,13 @@ namespace carbon {
 			return m_memory;
 		}
 
+		/**
+		 * @returns The range of device memory the buffer is bound to.
+		 */
+		const MemoryAllocation& getAllocation() const {
+			return m_allocation;
+		}
+
 		/**
 		 * @returns The descriptor buffer information.
 		 */
@@ -229,12 +279,13 @@ namespace carbon {
 	namespace utils {
 
 		/**
-		 * @brief Copies the contents of the `src` buffer into the `dest` buffer.
+		 * @brief Records a copy of the contents of the `src` buffer into the `dest` buffer.
+		 * @param commandBuffer The command buffer to record the copy into.
 		 * @param src The buffer to copy the contents from.
 		 * @param dest The buffer to copy the contents to.
 		 * @param size The size of the buffer to copy.
 		 */
-		static void copyBuffer(Buffer *src, Buffer *dest, const VkDeviceSize &size);
+		void copyBuffer(VkCommandBuffer commandBuffer, Buffer *src, Buffer *dest, const VkDeviceSize &size);
 
 	} // namespace utils
 
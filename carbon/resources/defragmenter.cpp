@@ -0,0 +1,164 @@
+// file      : carbon/resources/defragmenter.cpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#include "defragmenter.hpp"
+
+#include "buffer.hpp"
+#include "carbon/core/logical_device.hpp"
+#include "carbon/core/memory_allocator.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace carbon {
+
+	bool Defragmenter::isMovable(const Buffer *buffer) const {
+		const MemoryAllocation &alloc = buffer->getAllocation();
+		const VkBufferUsageFlags copyUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+		// dedicated memory is freed as soon as its buffer is, so gains nothing from moving
+		return alloc.isValid() && alloc.block != u32_max && !buffer->isMapped() && (buffer->getUsage() & copyUsage) == copyUsage;
+	}
+
+
+	Defragmenter::Defragmenter(LogicalDevice *logiDevice, VkDeviceSize bytesPerFrame)
+		: m_logical_device(logiDevice)
+		, m_bytes_per_frame(bytesPerFrame)
+	{
+		assert(m_logical_device && "Logical device must not be null.");
+	}
+
+
+	void Defragmenter::track(Buffer *buffer) {
+		assert(buffer && "Buffer to track must not be null.");
+
+		if (std::find(m_buffers.begin(), m_buffers.end(), buffer) == m_buffers.end()) {
+			m_buffers.push_back(buffer);
+		}
+	}
+
+
+	void Defragmenter::untrack(Buffer *buffer) {
+		auto it = std::find(m_buffers.begin(), m_buffers.end(), buffer);
+
+		if (it != m_buffers.end()) {
+			*it = m_buffers.back();
+			m_buffers.pop_back();
+		}
+	}
+
+
+	void Defragmenter::addListener(Listener listener) {
+		m_listeners.push_back(std::move(listener));
+	}
+
+
+	u32 Defragmenter::record(VkCommandBuffer commandBuffer) {
+		if (m_buffers.empty()) {
+			return 0;
+		}
+
+		MemoryAllocator &allocator = m_logical_device->getMemoryAllocator();
+
+		// the sparsest block holding a tracked buffer is the one to empty
+		const Buffer *sparsest{ nullptr };
+		f32 lowest{ config::DEFRAG_MAX_OCCUPANCY };
+
+		for (const Buffer *buffer : m_buffers) {
+			if (!isMovable(buffer)) {
+				continue;
+			}
+
+			const f32 occupancy = allocator.getBlockOccupancy(buffer->getAllocation());
+
+			if (occupancy < lowest) {
+				sparsest = buffer;
+				lowest = occupancy;
+			}
+		}
+
+		if (sparsest == nullptr) {
+			return 0;
+		}
+
+		const MemoryAllocation &source = sparsest->getAllocation();
+		m_moving.clear();
+
+		for (Buffer *buffer : m_buffers) {
+			const MemoryAllocation &alloc = buffer->getAllocation();
+
+			if (isMovable(buffer) && alloc.memory == source.memory) {
+				m_moving.push_back(buffer);
+			}
+		}
+
+		// largest first, while the fuller blocks still have room for them
+		std::sort(m_moving.begin(), m_moving.end(), [](const Buffer *a, const Buffer *b) {
+			return a->getSize() > b->getSize();
+		});
+
+		VkMemoryBarrier barrier;
+		initStruct(barrier, VK_STRUCTURE_TYPE_MEMORY_BARRIER);
+
+		VkDevice device = m_logical_device->getHandle();
+		VkDeviceSize moved{ 0 };
+		u32 count{ 0 };
+
+		for (Buffer *buffer : m_moving) {
+			if (moved + buffer->getSize() > m_bytes_per_frame) {
+				continue;
+			}
+
+			VkMemoryRequirements memReqs;
+			vkGetBufferMemoryRequirements(device, buffer->getHandle(), &memReqs);
+
+			const MemoryAllocation target = allocator.reallocate(buffer->getAllocation(), memReqs);
+
+			if (!target.isValid()) {
+				continue;
+			}
+
+			// earlier frames may still be writing the buffers being copied from
+			if (count == 0) {
+				barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+				barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+				vkCmdPipelineBarrier(
+					commandBuffer,
+					VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+					0, 1, &barrier, 0, nullptr, 0, nullptr
+				);
+			}
+
+			const VkBuffer old = buffer->relocate(commandBuffer, target);
+
+			for (const auto &listener : m_listeners) {
+				listener(*buffer, old);
+			}
+
+			moved += buffer->getSize();
+			count++;
+		}
+
+		if (count == 0) {
+			return 0;
+		}
+
+		// the rest of the frame reads the moved buffers
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+			0, 1, &barrier, 0, nullptr, 0, nullptr
+		);
+
+		m_moved_bytes += moved;
+		m_move_count += count;
+
+		return count;
+	}
+
+} // namespace carbon
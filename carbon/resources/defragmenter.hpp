@@ -0,0 +1,142 @@
+// file      : carbon/resources/defragmenter.hpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#pragma once
+
+#ifndef RES_DEFRAGMENTER_HPP
+#define RES_DEFRAGMENTER_HPP
+
+#include "carbon/backend.hpp"
+#include "carbon/engine/config.hpp"
+
+#include <functional>
+#include <vector>
+
+namespace carbon {
+
+	// forward-declare classes that would result in circular dependency
+	class LogicalDevice;
+	class Buffer;
+
+	/**
+	 * @brief Compacts device memory a little at a time. Each frame, buffers
+	 * are moved out of the sparsest block of the allocator into fuller blocks
+	 * of the same memory type with copies recorded at the start of the frame,
+	 * so the sparse block empties and is given back to the device. Only
+	 * buffers that are tracked are moved, and only those the host cannot see,
+	 * since mapped pointers into them would go stale.
+	 */
+	class Defragmenter {
+
+	public:
+
+		/**
+		 * @brief Called with a buffer that was moved and the handle it had
+		 * before, so anything that refers to the old handle can be updated.
+		 */
+		using Listener = std::function<void(const class Buffer&, VkBuffer)>;
+
+	private:
+
+		/**
+		 * @brief The logical device that the buffers belong to.
+		 */
+		const class LogicalDevice *m_logical_device;
+
+		/**
+		 * @brief Most bytes to copy in a single frame.
+		 */
+		VkDeviceSize m_bytes_per_frame;
+
+		/**
+		 * @brief Buffers that may be moved.
+		 */
+		std::vector<class Buffer*> m_buffers;
+
+		/**
+		 * @brief Functions to tell when a buffer moves.
+		 */
+		std::vector<Listener> m_listeners;
+
+		/**
+		 * @brief Tracked buffers in the block being emptied this frame.
+		 */
+		std::vector<class Buffer*> m_moving;
+
+		/**
+		 * @brief Total bytes moved.
+		 */
+		u64 m_moved_bytes{ 0 };
+
+		/**
+		 * @brief Total number of buffers moved.
+		 */
+		u64 m_move_count{ 0 };
+
+		/**
+		 * @returns `true` if the buffer can be moved, `false` otherwise.
+		 */
+		bool isMovable(const class Buffer *buffer) const;
+
+	public:
+
+		/**
+		 * @brief Creates a defragmenter that tracks no buffers.
+		 * @param logiDevice The logical device that the buffers belong to.
+		 * @param bytesPerFrame [Optional] Most bytes to copy in a single frame.
+		 */
+		explicit Defragmenter(class LogicalDevice *logiDevice, VkDeviceSize bytesPerFrame = config::DEFRAG_BYTES_PER_FRAME);
+
+		Defragmenter(const Defragmenter&) = delete;
+
+		Defragmenter& operator=(const Defragmenter&) = delete;
+
+		/**
+		 * @brief Lets a buffer be moved. The buffer must be created with
+		 * `VK_BUFFER_USAGE_TRANSFER_SRC_BIT` and `VK_BUFFER_USAGE_TRANSFER_DST_BIT`
+		 * to be moved, and must be untracked before it is destroyed.
+		 * @param buffer The buffer to track.
+		 */
+		void track(class Buffer *buffer);
+
+		/**
+		 * @brief Stops a buffer from being moved.
+		 * @param buffer The buffer to untrack.
+		 */
+		void untrack(class Buffer *buffer);
+
+		/**
+		 * @brief Adds a function to call whenever a buffer is moved.
+		 * @param listener The function to call.
+		 */
+		void addListener(Listener listener);
+
+		/**
+		 * @brief Records the moves of the current frame, before anything in
+		 * the frame uses the tracked buffers. Nothing may be uploading into
+		 * the tracked buffers, and the GPU must not write them in the frame.
+		 * @param commandBuffer A command buffer of the current frame.
+		 * @returns The number of buffers moved.
+		 */
+		u32 record(VkCommandBuffer commandBuffer);
+
+		/**
+		 * @returns Total bytes moved.
+		 */
+		const u64 getMovedBytes() const {
+			return m_moved_bytes;
+		}
+
+		/**
+		 * @returns Total number of buffers moved.
+		 */
+		const u64 getMoveCount() const {
+			return m_move_count;
+		}
+
+	};
+
+} // namespace carbon
+
+#endif // RES_DEFRAGMENTER_HPP
@@ -0,0 +1,328 @@
+// file      : carbon/resources/image.cpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#include "image.hpp"
+
+#include "carbon/common/logger.hpp"
+#include "carbon/core/deletion_queue.hpp"
+#include "carbon/core/host_allocator.hpp"
+#include "carbon/core/logical_device.hpp"
+#include "carbon/core/physical_device.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace carbon {
+
+	/**
+	 * @brief Stages that sample images once they are ready.
+	 */
+	static constexpr VkPipelineStageFlags SHADER_STAGES =
+		VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+
+	/**
+	 * @param format The format of the image.
+	 * @returns The aspects of an image with the given format.
+	 */
+	static VkImageAspectFlags getAspectMask(VkFormat format) {
+		switch (format) {
+			case VK_FORMAT_D16_UNORM:
+			case VK_FORMAT_X8_D24_UNORM_PACK32:
+			case VK_FORMAT_D32_SFLOAT:
+				return VK_IMAGE_ASPECT_DEPTH_BIT;
+			case VK_FORMAT_D16_UNORM_S8_UINT:
+			case VK_FORMAT_D24_UNORM_S8_UINT:
+			case VK_FORMAT_D32_SFLOAT_S8_UINT:
+				return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+			default:
+				return VK_IMAGE_ASPECT_COLOR_BIT;
+		}
+	}
+
+
+	/**
+	 * @brief Features that filling mip levels with blits needs.
+	 */
+	static constexpr VkFormatFeatureFlags BLIT_FEATURES = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT;
+
+
+	/**
+	 * @param device The logical device the image is on.
+	 * @param format The format of the image.
+	 * @returns The features of the format for optimally tiled images.
+	 */
+	static VkFormatFeatureFlags getFormatFeatures(const LogicalDevice *device, VkFormat format) {
+		VkFormatProperties properties;
+		vkGetPhysicalDeviceFormatProperties(device->getPhysicalDevice()->getHandle(), format, &properties);
+
+		return properties.optimalTilingFeatures;
+	}
+
+
+	/**
+	 * @param layout The layout of an image.
+	 * @returns The accesses made to an image while it is in the layout.
+	 */
+	static VkAccessFlags getLayoutAccess(VkImageLayout layout) {
+		switch (layout) {
+			case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+				return VK_ACCESS_TRANSFER_WRITE_BIT;
+			case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+				return VK_ACCESS_TRANSFER_READ_BIT;
+			case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+				return VK_ACCESS_SHADER_READ_BIT;
+			case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+				return VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+			case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+				return VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+			case VK_IMAGE_LAYOUT_GENERAL:
+				return VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+			default:
+				return 0;
+		}
+	}
+
+
+	Image::Image(const LogicalDevice *device, const VkExtent2D &extent, VkFormat format, VkImageUsageFlags usage, u32 mipLevels)
+		: Image(device)
+	{
+		// create with given parameters
+		create(extent, format, usage, mipLevels);
+	}
+
+
+	Image::Image(const LogicalDevice *device)
+		: m_device(device)
+		, m_image(VK_NULL_HANDLE)
+		, m_view(VK_NULL_HANDLE)
+		, m_format(VK_FORMAT_UNDEFINED)
+		, m_extent{ 0, 0 }
+		, m_mip_levels(0)
+		, m_usage(0)
+		, m_aspect(0)
+		, m_layout(VK_IMAGE_LAYOUT_UNDEFINED)
+	{
+		assert(m_device && "Logical device must not be null.");
+	}
+
+
+	Image::~Image() {
+		// ensure image has not already been destroyed
+		if (m_image != VK_NULL_HANDLE) {
+			destroy();
+		}
+	}
+
+
+	void Image::destroy() {
+		DeletionQueue &deletionQueue = m_device->getDeletionQueue();
+
+		// frames in flight may still sample the image, so it goes once they are done
+		if (m_view != VK_NULL_HANDLE) {
+			deletionQueue.push(VK_OBJECT_TYPE_IMAGE_VIEW, m_view);
+		}
+
+		if (m_image != VK_NULL_HANDLE) {
+			deletionQueue.push(VK_OBJECT_TYPE_IMAGE, m_image, m_allocation);
+		} else if (m_allocation.isValid()) {
+			deletionQueue.push(m_allocation);
+		}
+
+		m_image = VK_NULL_HANDLE;
+		m_view = VK_NULL_HANDLE;
+		m_allocation = {};
+		m_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	}
+
+
+	void Image::create(const VkExtent2D &extent, VkFormat format, VkImageUsageFlags usage, u32 mipLevels) {
+		assert(extent.width > 0 && extent.height > 0 && "Image must not be empty.");
+
+		// release whatever the image held before
+		destroy();
+
+		m_extent = extent;
+		m_format = format;
+		m_usage = usage;
+		m_aspect = getAspectMask(format);
+		m_mip_levels = mipLevels == 0 ? getMaxMipLevels(extent) : std::min(mipLevels, getMaxMipLevels(extent));
+
+		// the rest of the chain is only ever filled by blits, so formats that cannot be blitted keep the first level
+		if (m_mip_levels > 1 && (getFormatFeatures(m_device, m_format) & BLIT_FEATURES) != BLIT_FEATURES) {
+			CARBON_LOG_WARN(carbon::log::To::File, fmt::format("Format {} cannot be blitted, so the image has no mip chain.", static_cast<int>(m_format)));
+			m_mip_levels = 1;
+		}
+
+		VkDevice dev = m_device->getHandle();
+
+		VkImageCreateInfo createInfo;
+		initStruct(createInfo, VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO);
+
+		createInfo.imageType = VK_IMAGE_TYPE_2D;
+		createInfo.format = m_format;
+		createInfo.extent = { m_extent.width, m_extent.height, 1 };
+		createInfo.mipLevels = m_mip_levels;
+		createInfo.arrayLayers = 1;
+		createInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		createInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		createInfo.usage = m_usage;
+		createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		createInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		if (vkCreateImage(dev, &createInfo, HostAllocator::get(VK_OBJECT_TYPE_IMAGE), &m_image) != VK_SUCCESS) {
+			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to create image.");
+		}
+
+		VkMemoryRequirements memReqs;
+		vkGetImageMemoryRequirements(dev, m_image, &memReqs);
+
+		// optimal images are kept apart from buffers in the blocks they share
+		m_allocation = m_device->getMemoryAllocator().allocate(memReqs, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, false);
+
+		if (!m_allocation.isValid()) {
+			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to allocate image memory.");
+		}
+
+		vkBindImageMemory(dev, m_image, m_allocation.memory, m_allocation.offset);
+
+		VkImageViewCreateInfo viewInfo;
+		initStruct(viewInfo, VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO);
+
+		viewInfo.image = m_image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = m_format;
+
+		viewInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+		viewInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+		viewInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+		viewInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+
+		// views of depth-stencil images may only have one aspect
+		viewInfo.subresourceRange.aspectMask = (m_aspect & VK_IMAGE_ASPECT_DEPTH_BIT) ? static_cast<VkImageAspectFlags>(VK_IMAGE_ASPECT_DEPTH_BIT) : m_aspect;
+		viewInfo.subresourceRange.baseMipLevel = 0;
+		viewInfo.subresourceRange.levelCount = m_mip_levels;
+		viewInfo.subresourceRange.baseArrayLayer = 0;
+		viewInfo.subresourceRange.layerCount = 1;
+
+		if (vkCreateImageView(dev, &viewInfo, HostAllocator::get(VK_OBJECT_TYPE_IMAGE_VIEW), &m_view) != VK_SUCCESS) {
+			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to create image view.");
+		}
+
+		m_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	}
+
+
+	void Image::transition(VkCommandBuffer commandBuffer, VkImageLayout layout, VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage) {
+		VkImageMemoryBarrier barrier;
+		initStruct(barrier, VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER);
+
+		barrier.srcAccessMask = getLayoutAccess(m_layout);
+		barrier.dstAccessMask = getLayoutAccess(layout);
+		barrier.oldLayout = m_layout;
+		barrier.newLayout = layout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = m_image;
+		barrier.subresourceRange = { m_aspect, 0, m_mip_levels, 0, 1 };
+
+		vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+		m_layout = layout;
+	}
+
+
+	void Image::generateMipmaps(VkCommandBuffer commandBuffer) {
+		assert(m_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && "Image must be a transfer destination to generate mipmaps.");
+
+		if (m_mip_levels == 1) {
+			transition(commandBuffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, SHADER_STAGES);
+			return;
+		}
+
+		assert((m_usage & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) && "Image must be created as a transfer source to generate mipmaps.");
+
+		const VkFormatFeatureFlags features = getFormatFeatures(m_device, m_format);
+		assert((features & BLIT_FEATURES) == BLIT_FEATURES && "Format must support blits to generate mipmaps.");
+
+		// linear filtering is optional, so fall back to nearest for formats without it
+		const VkFilter filter = (features & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+
+		VkImageMemoryBarrier barrier;
+		initStruct(barrier, VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER);
+
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = m_image;
+		barrier.subresourceRange = { m_aspect, 0, 1, 0, 1 };
+
+		i32 width = static_cast<i32>(m_extent.width);
+		i32 height = static_cast<i32>(m_extent.height);
+
+		for (u32 level = 1; level < m_mip_levels; level++) {
+			// the level above has been written, so it can be read from
+			barrier.subresourceRange.baseMipLevel = level - 1;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+			const i32 nextWidth = std::max(width / 2, 1);
+			const i32 nextHeight = std::max(height / 2, 1);
+
+			VkImageBlit blit{};
+			blit.srcSubresource = { m_aspect, level - 1, 0, 1 };
+			blit.srcOffsets[1] = { width, height, 1 };
+			blit.dstSubresource = { m_aspect, level, 0, 1 };
+			blit.dstOffsets[1] = { nextWidth, nextHeight, 1 };
+
+			vkCmdBlitImage(
+				commandBuffer,
+				m_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				m_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				1, &blit,
+				filter
+			);
+
+			// nothing else reads the level above, so it is ready for the shaders
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+			barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, SHADER_STAGES, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+			width = nextWidth;
+			height = nextHeight;
+		}
+
+		// the last level is only ever written
+		barrier.subresourceRange.baseMipLevel = m_mip_levels - 1;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, SHADER_STAGES, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		m_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	}
+
+
+	u32 Image::getMaxMipLevels(const VkExtent2D &extent) {
+		u32 size = std::max(extent.width, extent.height);
+		u32 levels{ 1 };
+
+		while (size > 1) {
+			size >>= 1;
+			levels++;
+		}
+
+		return levels;
+	}
+
+} // namespace carbon
@@ -0,0 +1,243 @@
+// file      : carbon/resources/image.hpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#pragma once
+
+#ifndef RES_IMAGE_HPP
+#define RES_IMAGE_HPP
+
+#include "carbon/backend.hpp"
+#include "carbon/core/memory_allocator.hpp"
+
+namespace carbon {
+
+	// forward-declare classes that would result in circular dependency
+	class LogicalDevice;
+
+	/**
+	 * @brief A wrapper for a 2D Vulkan image with a view over every mip
+	 * level. The layout the image is left in by the commands recorded so far
+	 * is tracked, so transitions only need the layout to move to. Textures
+	 * are filled through `UploadManager::upload()`, which generates the rest
+	 * of the mip chain on the GPU.
+	 */
+	class Image {
+
+	private:
+
+		/**
+		 * @brief The logical device to use in the image.
+		 */
+		const class LogicalDevice *m_device;
+
+		/**
+		 * @brief Handle on the underlying image object.
+		 */
+		VkImage m_image;
+
+		/**
+		 * @brief View over every mip level of the image.
+		 */
+		VkImageView m_view;
+
+		/**
+		 * @brief The range of device memory the image is bound to.
+		 */
+		MemoryAllocation m_allocation;
+
+		/**
+		 * @brief Format of the texels.
+		 */
+		VkFormat m_format;
+
+		/**
+		 * @brief Size of the first mip level (in texels).
+		 */
+		VkExtent2D m_extent;
+
+		/**
+		 * @brief Number of mip levels.
+		 */
+		u32 m_mip_levels;
+
+		/**
+		 * @brief The use of the image.
+		 */
+		VkImageUsageFlags m_usage;
+
+		/**
+		 * @brief Aspects of the image, which follow from its format.
+		 */
+		VkImageAspectFlags m_aspect;
+
+		/**
+		 * @brief Layout of every mip level once the commands recorded so far have run.
+		 */
+		VkImageLayout m_layout;
+
+	public:
+
+		/**
+		 * @brief Initializes the image with the given parameters.
+		 * @param device The logical device to use for the image.
+		 * @param extent Size of the first mip level (in texels).
+		 * @param format Format of the texels.
+		 * @param usage The bits representing how the image will be used.
+		 * @param mipLevels [Optional] Number of mip levels, where 0 gives the full
+		 * chain. Formats that cannot be blitted only get the first level.
+		 */
+		Image(
+			const class LogicalDevice *device,
+			const VkExtent2D &extent,
+			VkFormat format,
+			VkImageUsageFlags usage,
+			u32 mipLevels = 1
+		);
+
+		/**
+		 * @brief Initializes the image to 0.
+		 * @param device The logical device to use for the image.
+		 */
+		explicit Image(const class LogicalDevice *device);
+
+		Image(const Image&) = delete;
+
+		Image& operator=(const Image&) = delete;
+
+		/**
+		 * @brief Destructor for the image.
+		 */
+		~Image();
+
+		/**
+		 * @brief Destroys the image and its view, freeing its memory once no
+		 * frame in flight can be using it.
+		 */
+		void destroy();
+
+		/**
+		 * @brief Creates the image with the given parameters, destroying whatever it held before.
+		 * @param extent Size of the first mip level (in texels).
+		 * @param format Format of the texels.
+		 * @param usage The bits representing how the image will be used.
+		 * @param mipLevels [Optional] Number of mip levels, where 0 gives the full
+		 * chain. Formats that cannot be blitted only get the first level.
+		 */
+		void create(const VkExtent2D &extent, VkFormat format, VkImageUsageFlags usage, u32 mipLevels = 1);
+
+		/**
+		 * @brief Records a barrier that moves every mip level from the tracked layout to another.
+		 * @param commandBuffer The command buffer to record into.
+		 * @param layout The layout to move to.
+		 * @param srcStage Stages that must finish with the image first.
+		 * @param dstStage Stages that wait for the transition.
+		 */
+		void transition(VkCommandBuffer commandBuffer, VkImageLayout layout, VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage);
+
+		/**
+		 * @brief Records blits that fill every mip level from the one above it,
+		 * leaving the whole image in `VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL`.
+		 * The first mip level must hold the texels and every level must be in
+		 * `VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL`. Blits need a graphics queue.
+		 * @param commandBuffer A command buffer on the graphics queue.
+		 */
+		void generateMipmaps(VkCommandBuffer commandBuffer);
+
+		/**
+		 * @brief Sets the tracked layout, for transitions recorded elsewhere.
+		 * @param layout Layout of every mip level once the recorded commands have run.
+		 */
+		void setLayout(VkImageLayout layout) {
+			m_layout = layout;
+		}
+
+		/**
+		 * @param extent Size of the first mip level (in texels).
+		 * @returns The number of mip levels in a full chain down to 1x1.
+		 */
+		static u32 getMaxMipLevels(const VkExtent2D &extent);
+
+		/**
+		 * @returns The logical device that the image uses.
+		 */
+		const class LogicalDevice* getLogicalDevice() const {
+			return m_device;
+		}
+
+		/**
+		 * @returns The handle of the image.
+		 */
+		const VkImage& getHandle() const {
+			return m_image;
+		}
+
+		/**
+		 * @returns The view over every mip level of the image.
+		 */
+		const VkImageView& getView() const {
+			return m_view;
+		}
+
+		/**
+		 * @returns The range of device memory the image is bound to.
+		 */
+		const MemoryAllocation& getAllocation() const {
+			return m_allocation;
+		}
+
+		/**
+		 * @returns The format of the texels.
+		 */
+		const VkFormat& getFormat() const {
+			return m_format;
+		}
+
+		/**
+		 * @returns The size of the first mip level (in texels).
+		 */
+		const VkExtent2D& getExtent() const {
+			return m_extent;
+		}
+
+		/**
+		 * @returns The number of mip levels.
+		 */
+		const u32 getMipLevels() const {
+			return m_mip_levels;
+		}
+
+		/**
+		 * @returns The use of the image.
+		 */
+		const VkImageUsageFlags& getUsage() const {
+			return m_usage;
+		}
+
+		/**
+		 * @returns The aspects of the image.
+		 */
+		const VkImageAspectFlags& getAspect() const {
+			return m_aspect;
+		}
+
+		/**
+		 * @returns The layout of every mip level once the commands recorded so far have run.
+		 */
+		const VkImageLayout& getLayout() const {
+			return m_layout;
+		}
+
+		/**
+		 * @param sampler The sampler to read the image with.
+		 * @returns The information needed to bind the image for reading in shaders.
+		 */
+		VkDescriptorImageInfo getDescriptor(VkSampler sampler) const {
+			return { sampler, m_view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+		}
+
+	};
+
+} // namespace carbon
+
+#endif // RES_IMAGE_HPP
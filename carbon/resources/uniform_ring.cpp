@@ -0,0 +1,101 @@
+// file      : carbon/resources/uniform_ring.cpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#include "uniform_ring.hpp"
+
+#include "buffer.hpp"
+#include "carbon/common/logger.hpp"
+#include "carbon/core/logical_device.hpp"
+#include "carbon/core/physical_device.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace carbon {
+
+	UniformRing::UniformRing(LogicalDevice *logiDevice, VkDeviceSize frameSize)
+		: m_logical_device(logiDevice)
+	{
+		assert(m_logical_device && "Logical device must not be null.");
+
+		const VkPhysicalDeviceLimits &limits = m_logical_device->getPhysicalDevice()->getProperties().limits;
+
+		// the spec guarantees the alignment is a power of two and the range is at least 16 KiB
+		m_alignment = std::max<VkDeviceSize>(limits.minUniformBufferOffsetAlignment, 1);
+		assert(config::MAX_UBO_SIZE <= limits.maxUniformBufferRange && "MAX_UBO_SIZE is larger than the device allows.");
+
+		m_frame_size = (frameSize + m_alignment - 1) & ~(m_alignment - 1);
+
+		// the descriptor covers MAX_UBO_SIZE from any offset, so leave room past the last region
+		const VkDeviceSize size = m_frame_size * config::MAX_FRAMES_IN_FLIGHT + config::MAX_UBO_SIZE;
+
+		m_buffer = new Buffer(
+			m_logical_device,
+			size,
+			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+		);
+
+		// stays mapped for as long as the ring exists
+		if (!m_buffer->mapMemory()) {
+			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to map uniform ring.");
+		}
+
+		m_mapped = static_cast<u8*>(m_buffer->getMappedMemory());
+	}
+
+
+	UniformRing::~UniformRing() {
+		destroy();
+	}
+
+
+	void UniformRing::destroy() {
+		// destroying the buffer unmaps it
+		delete m_buffer;
+		m_buffer = nullptr;
+		m_mapped = nullptr;
+	}
+
+
+	void UniformRing::beginFrame(u32 frameIdx) {
+		assert(frameIdx < config::MAX_FRAMES_IN_FLIGHT && "Frame index out of range.");
+
+		m_peak = std::max(m_peak, std::min(m_head.load(), m_frame_size));
+		m_frame_base = m_frame_size * frameIdx;
+		m_head.store(0);
+	}
+
+
+	UniformAllocation UniformRing::allocate(u32 size) {
+		assert(size > 0 && size <= config::MAX_UBO_SIZE && "Uniform allocation must be between 1 byte and MAX_UBO_SIZE.");
+
+		// rounding every size up keeps every offset aligned without a compare-and-swap loop
+		const VkDeviceSize aligned = (static_cast<VkDeviceSize>(size) + m_alignment - 1) & ~(m_alignment - 1);
+		const VkDeviceSize offset = m_head.fetch_add(aligned, std::memory_order_relaxed);
+
+		if (offset + aligned > m_frame_size) {
+			// only the allocation that crossed the end reports it
+			if (offset <= m_frame_size) {
+				CARBON_LOG_ERROR(carbon::log::To::File, fmt::format("Uniform ring is full ({} bytes per frame).", m_frame_size));
+			}
+
+			return {};
+		}
+
+		const VkDeviceSize bufferOffset = m_frame_base + offset;
+		return { m_mapped + bufferOffset, static_cast<u32>(bufferOffset), size };
+	}
+
+
+	VkBuffer UniformRing::getHandle() const {
+		return m_buffer->getHandle();
+	}
+
+
+	VkDescriptorBufferInfo UniformRing::getDescriptor() const {
+		return { m_buffer->getHandle(), 0, config::MAX_UBO_SIZE };
+	}
+
+} // namespace carbon
@@ -0,0 +1,185 @@
+// file      : carbon/resources/uniform_ring.hpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#pragma once
+
+#ifndef RES_UNIFORM_RING_HPP
+#define RES_UNIFORM_RING_HPP
+
+#include "carbon/backend.hpp"
+#include "carbon/engine/config.hpp"
+
+#include <atomic>
+#include <cstring>
+
+namespace carbon {
+
+	// forward-declare classes that would result in circular dependency
+	class LogicalDevice;
+	class Buffer;
+
+	/**
+	 * @brief A range of the uniform ring that can be written to until the
+	 * frame in flight comes round again.
+	 */
+	struct UniformAllocation {
+		/**
+		 * @brief Where to write the data, or `nullptr` if the ring was full.
+		 */
+		void *data{ nullptr };
+
+		/**
+		 * @brief Dynamic offset to bind the range with.
+		 */
+		u32 offset{ 0 };
+
+		/**
+		 * @brief Size (in bytes) of the range.
+		 */
+		u32 size{ 0 };
+	};
+
+	/**
+	 * @brief One persistently mapped uniform buffer, split into a region per
+	 * frame in flight. Per-draw constants are written by bumping a pointer
+	 * through the region of the current frame and bound with a dynamic
+	 * offset, so no buffers or descriptor sets are created per draw. The
+	 * whole ring is bound through a single `VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC`
+	 * descriptor with a range of `config::MAX_UBO_SIZE`. Allocating is
+	 * lock-free, so any thread may allocate.
+	 */
+	class UniformRing {
+
+	private:
+
+		/**
+		 * @brief The logical device the buffer is created on.
+		 */
+		const class LogicalDevice *m_logical_device;
+
+		/**
+		 * @brief The buffer holding the regions of every frame.
+		 */
+		class Buffer *m_buffer{ nullptr };
+
+		/**
+		 * @brief Start of the mapped buffer.
+		 */
+		u8 *m_mapped{ nullptr };
+
+		/**
+		 * @brief Size (in bytes) of the region of each frame.
+		 */
+		VkDeviceSize m_frame_size;
+
+		/**
+		 * @brief Every allocation is rounded up to this, so every offset stays aligned.
+		 */
+		VkDeviceSize m_alignment;
+
+		/**
+		 * @brief Offset of the region of the current frame.
+		 */
+		VkDeviceSize m_frame_base{ 0 };
+
+		/**
+		 * @brief Bytes handed out so far from the region of the current frame.
+		 */
+		std::atomic<VkDeviceSize> m_head{ 0 };
+
+		/**
+		 * @brief Most bytes that any frame has used.
+		 */
+		VkDeviceSize m_peak{ 0 };
+
+	public:
+
+		/**
+		 * @brief Creates and maps the ring.
+		 * @param logiDevice The logical device to use.
+		 * @param frameSize [Optional] Size (in bytes) of the region of each frame in flight.
+		 */
+		explicit UniformRing(class LogicalDevice *logiDevice, VkDeviceSize frameSize = config::UNIFORM_RING_SIZE);
+
+		UniformRing(const UniformRing&) = delete;
+
+		UniformRing& operator=(const UniformRing&) = delete;
+
+		/**
+		 * @brief Destructor for the uniform ring.
+		 */
+		~UniformRing();
+
+		/**
+		 * @brief Unmaps and destroys the buffer.
+		 */
+		void destroy();
+
+		/**
+		 * @brief Moves on to the region of the given frame in flight and starts
+		 * it from the beginning. The GPU must have finished with the frame.
+		 * @param frameIdx The index of the frame in flight.
+		 */
+		void beginFrame(u32 frameIdx);
+
+		/**
+		 * @brief Hands out a range of the region of the current frame.
+		 * @param size Size (in bytes) of the range, at most `config::MAX_UBO_SIZE`.
+		 * @returns The range, with `data` set to `nullptr` if the region is full.
+		 */
+		UniformAllocation allocate(u32 size);
+
+		/**
+		 * @brief Copies the value into a new range of the region of the current frame.
+		 * @param value The value to copy.
+		 * @returns The range the value was written to.
+		 */
+		template<class T>
+		UniformAllocation write(const T &value) {
+			static_assert(sizeof(T) <= config::MAX_UBO_SIZE, "Uniform data is larger than MAX_UBO_SIZE.");
+			UniformAllocation alloc = allocate(static_cast<u32>(sizeof(T)));
+
+			if (alloc.data != nullptr) {
+				std::memcpy(alloc.data, &value, sizeof(T));
+			}
+
+			return alloc;
+		}
+
+		/**
+		 * @returns The handle on the underlying buffer.
+		 */
+		VkBuffer getHandle() const;
+
+		/**
+		 * @returns The buffer info to write into a dynamic uniform buffer descriptor.
+		 */
+		VkDescriptorBufferInfo getDescriptor() const;
+
+		/**
+		 * @returns Size (in bytes) of the region of each frame in flight.
+		 */
+		const VkDeviceSize getFrameSize() const {
+			return m_frame_size;
+		}
+
+		/**
+		 * @returns The alignment of every range.
+		 */
+		const VkDeviceSize getAlignment() const {
+			return m_alignment;
+		}
+
+		/**
+		 * @returns Most bytes that any frame has used.
+		 */
+		const VkDeviceSize getPeakUsage() const {
+			return m_peak;
+		}
+
+	};
+
+} // namespace carbon
+
+#endif // RES_UNIFORM_RING_HPP
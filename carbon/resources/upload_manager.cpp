@@ -0,0 +1,520 @@
+// file      : carbon/resources/upload_manager.cpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#include "upload_manager.hpp"
+
+#include "buffer.hpp"
+#include "image.hpp"
+#include "carbon/common/logger.hpp"
+#include "carbon/core/command_pool.hpp"
+#include "carbon/core/host_allocator.hpp"
+#include "carbon/core/logical_device.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace carbon {
+
+	/**
+	 * @param usage How the buffer is used.
+	 * @returns The accesses that may read the buffer after it is uploaded.
+	 */
+	static VkAccessFlags getConsumerAccess(VkBufferUsageFlags usage) {
+		VkAccessFlags access{ 0 };
+
+		if (usage & VK_BUFFER_USAGE_VERTEX_BUFFER_BIT) {
+			access |= VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+		}
+
+		if (usage & VK_BUFFER_USAGE_INDEX_BUFFER_BIT) {
+			access |= VK_ACCESS_INDEX_READ_BIT;
+		}
+
+		if (usage & VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT) {
+			access |= VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+		}
+
+		if (usage & (VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_UNIFORM_TEXEL_BUFFER_BIT)) {
+			access |= VK_ACCESS_UNIFORM_READ_BIT;
+		}
+
+		if (usage & (VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_TEXEL_BUFFER_BIT)) {
+			access |= VK_ACCESS_SHADER_READ_BIT;
+		}
+
+		if (usage & VK_BUFFER_USAGE_TRANSFER_SRC_BIT) {
+			access |= VK_ACCESS_TRANSFER_READ_BIT;
+		}
+
+		return access;
+	}
+
+
+	void UploadManager::openBatch() {
+		if (m_open.commandBuffer != VK_NULL_HANDLE) {
+			return;
+		}
+
+		// a thread waiting without the lock may hold the fence of any completed batch
+		if (!m_free.empty() && m_fence_waiters == 0) {
+			m_open = m_free.back();
+			m_free.pop_back();
+
+			vkResetFences(m_logical_device->getHandle(), 1, &m_open.fence);
+		} else {
+			m_open.commandBuffer = m_command_pool->requestBuffer();
+
+			VkFenceCreateInfo fenceInfo;
+			initStruct(fenceInfo, VK_STRUCTURE_TYPE_FENCE_CREATE_INFO);
+
+			if (vkCreateFence(m_logical_device->getHandle(), &fenceInfo, HostAllocator::get(VK_OBJECT_TYPE_FENCE), &m_open.fence) != VK_SUCCESS) {
+				CARBON_LOG_FATAL(carbon::log::To::File, "Failed to create upload fence.");
+			}
+		}
+
+		m_open.id = m_next_id++;
+
+		// the pool allows single command buffers to be reset, which beginning one does
+		VkCommandBufferBeginInfo beginInfo;
+		initStruct(beginInfo, VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO);
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		if (vkBeginCommandBuffer(m_open.commandBuffer, &beginInfo) != VK_SUCCESS) {
+			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to begin recording upload commands.");
+		}
+	}
+
+
+	void UploadManager::submitBatch() {
+		if (m_open.commandBuffer == VK_NULL_HANDLE) {
+			return;
+		}
+
+		// hand every buffer and image in the batch over to the graphics family in one barrier
+		if (!m_releases.empty() || !m_image_releases.empty()) {
+			vkCmdPipelineBarrier(
+				m_open.commandBuffer,
+				VK_PIPELINE_STAGE_TRANSFER_BIT,
+				VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+				0,
+				0, nullptr,
+				to_u32(m_releases.size()), m_releases.data(),
+				to_u32(m_image_releases.size()), m_image_releases.data()
+			);
+
+			m_releases.clear();
+			m_image_releases.clear();
+		}
+
+		m_pending_acquires.insert(m_pending_acquires.end(), m_acquires.begin(), m_acquires.end());
+		m_pending_image_acquires.insert(m_pending_image_acquires.end(), m_image_acquires.begin(), m_image_acquires.end());
+		m_pending_images.insert(m_pending_images.end(), m_images.begin(), m_images.end());
+		m_acquires.clear();
+		m_image_acquires.clear();
+		m_images.clear();
+
+		if (vkEndCommandBuffer(m_open.commandBuffer) != VK_SUCCESS) {
+			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to record upload commands.");
+		}
+
+		VkSemaphore semaphore{ VK_NULL_HANDLE };
+
+		if (!m_free_semaphores.empty()) {
+			semaphore = m_free_semaphores.back();
+			m_free_semaphores.pop_back();
+		} else {
+			VkSemaphoreCreateInfo semaphoreInfo;
+			initStruct(semaphoreInfo, VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO);
+
+			if (vkCreateSemaphore(m_logical_device->getHandle(), &semaphoreInfo, HostAllocator::get(VK_OBJECT_TYPE_SEMAPHORE), &semaphore) != VK_SUCCESS) {
+				CARBON_LOG_FATAL(carbon::log::To::File, "Failed to create upload semaphore.");
+			}
+		}
+
+		VkSubmitInfo submitInfo;
+		initStruct(submitInfo, VK_STRUCTURE_TYPE_SUBMIT_INFO);
+
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &m_open.commandBuffer;
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &semaphore;
+
+		if (vkQueueSubmit(m_logical_device->getTransferQueue(), 1, &submitInfo, m_open.fence) != VK_SUCCESS) {
+			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to submit uploads.");
+		}
+
+		m_open.ringEnd = m_head;
+		m_in_flight.push_back(m_open);
+		m_pending_semaphores.push_back(semaphore);
+
+		m_open = {};
+	}
+
+
+	void UploadManager::retireBatches() {
+		VkDevice device = m_logical_device->getHandle();
+
+		while (!m_in_flight.empty()) {
+			Batch &batch = m_in_flight.front();
+
+			if (vkGetFenceStatus(device, batch.fence) != VK_SUCCESS) {
+				break;
+			}
+
+			// batches complete in the order they were submitted, so the ring frees from the tail
+			m_tail = batch.ringEnd;
+			m_completed_id = batch.id;
+
+			m_free.push_back(batch);
+			m_in_flight.pop_front();
+		}
+	}
+
+
+	void UploadManager::waitForOldest(std::unique_lock<std::mutex> &lock) {
+		if (m_in_flight.empty()) {
+			return;
+		}
+
+		// the fence is not reset while anyone waits, so it stays valid once the lock is released
+		const VkFence fence = m_in_flight.front().fence;
+		m_fence_waiters++;
+
+		lock.unlock();
+		vkWaitForFences(m_logical_device->getHandle(), 1, &fence, VK_TRUE, u64_max);
+		lock.lock();
+
+		m_fence_waiters--;
+		retireBatches();
+	}
+
+
+	VkDeviceSize UploadManager::reserve(std::unique_lock<std::mutex> &lock, VkDeviceSize size) {
+		assert(size <= m_capacity && "Staging space is larger than the ring.");
+
+		for (;;) {
+			// an empty ring starts over from the beginning, so anything up to its size fits
+			if (m_head == m_tail) {
+				m_head = m_tail = (m_head + m_capacity - 1) / m_capacity * m_capacity;
+			}
+
+			u64 start = (m_head + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+			const u64 pos = start % m_capacity;
+
+			// copies need contiguous space, so skip what is left at the end
+			if (pos + size > m_capacity) {
+				start += m_capacity - pos;
+			}
+
+			if (start + size - m_tail <= m_capacity) {
+				m_head = start + size;
+				return start % m_capacity;
+			}
+
+			// full, so send what is staged and wait for the oldest copies to finish
+			submitBatch();
+			waitForOldest(lock);
+		}
+	}
+
+
+	UploadManager::UploadManager(LogicalDevice *logiDevice, VkDeviceSize capacity)
+		: m_logical_device(logiDevice)
+	{
+		assert(m_logical_device && "Logical device must not be null.");
+
+		m_transfer_ownership = m_logical_device->getTransferFamily() != m_logical_device->getGraphicsFamily();
+
+		m_command_pool = new CommandPool(
+			logiDevice,
+			m_logical_device->getTransferFamily(),
+			VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT
+		);
+
+		m_capacity = (capacity + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+
+		m_staging = new Buffer(
+			m_logical_device,
+			m_capacity,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+		);
+
+		// stays mapped for as long as the ring exists
+		if (!m_staging->mapMemory()) {
+			CARBON_LOG_FATAL(carbon::log::To::File, "Failed to map staging ring.");
+		}
+
+		m_mapped = static_cast<u8*>(m_staging->getMappedMemory());
+	}
+
+
+	UploadManager::~UploadManager() {
+		destroy();
+	}
+
+
+	void UploadManager::destroy() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (m_command_pool == nullptr) {
+			return;
+		}
+
+		VkDevice device = m_logical_device->getHandle();
+
+		// copies still in flight read from the ring
+		for (const auto &batch : m_in_flight) {
+			vkWaitForFences(device, 1, &batch.fence, VK_TRUE, u64_max);
+			m_free.push_back(batch);
+		}
+
+		if (m_open.fence != VK_NULL_HANDLE) {
+			m_free.push_back(m_open);
+		}
+
+		for (const auto &batch : m_free) {
+			vkDestroyFence(device, batch.fence, HostAllocator::get(VK_OBJECT_TYPE_FENCE));
+		}
+
+		for (auto &semaphores : m_frame_semaphores) {
+			m_free_semaphores.insert(m_free_semaphores.end(), semaphores.begin(), semaphores.end());
+			semaphores.clear();
+		}
+
+		m_free_semaphores.insert(m_free_semaphores.end(), m_pending_semaphores.begin(), m_pending_semaphores.end());
+
+		for (const auto semaphore : m_free_semaphores) {
+			vkDestroySemaphore(device, semaphore, HostAllocator::get(VK_OBJECT_TYPE_SEMAPHORE));
+		}
+
+		m_in_flight.clear();
+		m_free.clear();
+		m_open = {};
+		m_pending_semaphores.clear();
+		m_free_semaphores.clear();
+		m_releases.clear();
+		m_acquires.clear();
+		m_pending_acquires.clear();
+		m_frame_acquires.clear();
+		m_image_releases.clear();
+		m_image_acquires.clear();
+		m_pending_image_acquires.clear();
+		m_frame_image_acquires.clear();
+		m_images.clear();
+		m_pending_images.clear();
+		m_frame_images.clear();
+
+		// destroying the pool frees the command buffers of every batch
+		delete m_command_pool;
+		m_command_pool = nullptr;
+
+		delete m_staging;
+		m_staging = nullptr;
+		m_mapped = nullptr;
+	}
+
+
+	u64 UploadManager::upload(Buffer *dest, const void *data, VkDeviceSize size, VkDeviceSize offset) {
+		assert(dest && data && "Upload source and destination must not be null.");
+		assert((dest->getUsage() & VK_BUFFER_USAGE_TRANSFER_DST_BIT) && "Buffer must be created as a transfer destination.");
+		assert(offset + size <= dest->getSize() && "Upload is out of range.");
+
+		const VkAccessFlags access = getConsumerAccess(dest->getUsage());
+		const u8 *bytes = static_cast<const u8*>(data);
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		u64 id{ 0 };
+
+		while (size > 0) {
+			const VkDeviceSize chunk = std::min(size, m_capacity);
+
+			// reserving may submit the open batch, so only open one after
+			const VkDeviceSize staged = reserve(lock, chunk);
+			openBatch();
+
+			std::memcpy(m_mapped + staged, bytes, static_cast<size_t>(chunk));
+			dest->copyFrom(m_open.commandBuffer, m_staging, chunk, staged, offset);
+
+			if (m_transfer_ownership) {
+				VkBufferMemoryBarrier barrier;
+				initStruct(barrier, VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER);
+
+				barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+				barrier.dstAccessMask = 0;
+				barrier.srcQueueFamilyIndex = m_logical_device->getTransferFamily();
+				barrier.dstQueueFamilyIndex = m_logical_device->getGraphicsFamily();
+				barrier.buffer = dest->getHandle();
+				barrier.offset = offset;
+				barrier.size = chunk;
+				m_releases.push_back(barrier);
+
+				// the semaphore makes the writes available, so the acquire only adds the reads
+				barrier.srcAccessMask = 0;
+				barrier.dstAccessMask = access;
+				m_acquires.push_back(barrier);
+			}
+
+			id = m_open.id;
+			bytes += chunk;
+			offset += chunk;
+			size -= chunk;
+		}
+
+		return id;
+	}
+
+
+	u64 UploadManager::upload(Image *dest, const void *data, VkDeviceSize size) {
+		assert(dest && data && "Upload source and destination must not be null.");
+		assert((dest->getUsage() & VK_IMAGE_USAGE_TRANSFER_DST_BIT) && "Image must be created as a transfer destination.");
+
+		const VkExtent2D extent = dest->getExtent();
+		assert(size > 0 && size % extent.height == 0 && "Image data must be whole rows of texels.");
+
+		const VkDeviceSize rowSize = size / extent.height;
+		assert(rowSize <= m_capacity && "A row of the image is larger than the ring.");
+
+		const u32 rowsPerChunk = to_u32(std::min<VkDeviceSize>(m_capacity / rowSize, extent.height));
+		const u8 *bytes = static_cast<const u8*>(data);
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		u64 id{ 0 };
+
+		for (u32 row = 0; row < extent.height; row += rowsPerChunk) {
+			const u32 rows = std::min(rowsPerChunk, extent.height - row);
+			const VkDeviceSize chunk = rows * rowSize;
+
+			// reserving may submit the open batch, so only open one after
+			const VkDeviceSize staged = reserve(lock, chunk);
+			openBatch();
+
+			// every level is written before it is read, so whatever the image held is discarded
+			if (row == 0) {
+				dest->setLayout(VK_IMAGE_LAYOUT_UNDEFINED);
+				dest->transition(m_open.commandBuffer, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+			}
+
+			std::memcpy(m_mapped + staged, bytes, static_cast<size_t>(chunk));
+
+			VkBufferImageCopy region{};
+			region.bufferOffset = staged;
+			region.imageSubresource = { dest->getAspect(), 0, 0, 1 };
+			region.imageOffset = { 0, static_cast<i32>(row), 0 };
+			region.imageExtent = { extent.width, rows, 1 };
+
+			vkCmdCopyBufferToImage(m_open.commandBuffer, m_staging->getHandle(), dest->getHandle(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+			id = m_open.id;
+			bytes += chunk;
+		}
+
+		// batches run in order on the transfer queue, so releasing after the last copy covers them all
+		if (m_transfer_ownership) {
+			VkImageMemoryBarrier barrier;
+			initStruct(barrier, VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER);
+
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = 0;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.srcQueueFamilyIndex = m_logical_device->getTransferFamily();
+			barrier.dstQueueFamilyIndex = m_logical_device->getGraphicsFamily();
+			barrier.image = dest->getHandle();
+			barrier.subresourceRange = { dest->getAspect(), 0, dest->getMipLevels(), 0, 1 };
+			m_image_releases.push_back(barrier);
+
+			// the mip chain is generated with blits, which read and write the image
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+			m_image_acquires.push_back(barrier);
+		}
+
+		m_images.push_back(dest);
+		return id;
+	}
+
+
+	u64 UploadManager::submit() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		submitBatch();
+		return m_next_id - 1;
+	}
+
+
+	void UploadManager::beginFrame(u32 frameIdx) {
+		assert(frameIdx < config::MAX_FRAMES_IN_FLIGHT && "Frame index out of range.");
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		// the frame has completed, so nothing waits on its semaphores any more
+		std::vector<VkSemaphore> &semaphores = m_frame_semaphores[frameIdx];
+		m_free_semaphores.insert(m_free_semaphores.end(), semaphores.begin(), semaphores.end());
+		semaphores.clear();
+
+		submitBatch();
+		retireBatches();
+
+		// swapping keeps the capacity of both lists, so steady frames do not allocate
+		semaphores.swap(m_pending_semaphores);
+		m_frame_acquires.swap(m_pending_acquires);
+		m_frame_image_acquires.swap(m_pending_image_acquires);
+		m_frame_images.swap(m_pending_images);
+		m_pending_acquires.clear();
+		m_pending_image_acquires.clear();
+		m_pending_images.clear();
+
+		m_frame = frameIdx;
+	}
+
+
+	void UploadManager::recordAcquire(VkCommandBuffer commandBuffer) {
+		// the semaphores are waited on at the consumer stages, which the acquires chain after
+		if (!m_frame_acquires.empty() || !m_frame_image_acquires.empty()) {
+			vkCmdPipelineBarrier(
+				commandBuffer,
+				CONSUMER_STAGES,
+				CONSUMER_STAGES,
+				0,
+				0, nullptr,
+				to_u32(m_frame_acquires.size()), m_frame_acquires.data(),
+				to_u32(m_frame_image_acquires.size()), m_frame_image_acquires.data()
+			);
+
+			m_frame_acquires.clear();
+			m_frame_image_acquires.clear();
+		}
+
+		// blits need the graphics queue, so the mip chains are filled here rather than on the transfer queue
+		for (Image *image : m_frame_images) {
+			image->generateMipmaps(commandBuffer);
+		}
+
+		m_frame_images.clear();
+	}
+
+
+	bool UploadManager::isComplete(u64 id) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		retireBatches();
+		return id <= m_completed_id;
+	}
+
+
+	void UploadManager::wait(u64 id) {
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		if (m_open.commandBuffer != VK_NULL_HANDLE && id >= m_open.id) {
+			submitBatch();
+		}
+
+		while (m_completed_id < id && !m_in_flight.empty()) {
+			waitForOldest(lock);
+		}
+	}
+
+} // namespace carbon
@@ -0,0 +1,374 @@
+// file      : carbon/resources/upload_manager.hpp
+// copyright : Copyright (c) 2020-present, Kyle Chapman
+// license   : GPL-3.0; see accompanying LICENSE file
+
+#pragma once
+
+#ifndef RES_UPLOAD_MANAGER_HPP
+#define RES_UPLOAD_MANAGER_HPP
+
+#include "carbon/backend.hpp"
+#include "carbon/engine/config.hpp"
+
+#include <array>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace carbon {
+
+	// forward-declare classes that would result in circular dependency
+	class LogicalDevice;
+	class CommandPool;
+	class Buffer;
+	class Image;
+
+	/**
+	 * @brief Streams data into device-local buffers and images through a ring of
+	 * host-visible staging memory. Copies are recorded into one command
+	 * buffer and sent to the transfer queue as a single submission, either
+	 * when a frame begins or when the ring fills up, so the graphics queue
+	 * never waits on a copy it does not use. Each submission signals a
+	 * semaphore that the next frame waits on, and when the transfer queue is
+	 * of another family the buffers are released to the graphics family and
+	 * acquired at the start of that frame. Images are finished at the start
+	 * of that frame as well, since the blits that fill their mip chains need
+	 * the graphics queue. Any thread may upload, but if the
+	 * device has no queue besides the graphics queue (see
+	 * `LogicalDevice::hasTransferQueue()`), uploads that submit must come
+	 * from the thread that draws. An upload that finds the ring full waits
+	 * for earlier copies to finish without holding the lock that
+	 * `beginFrame()` takes, so streaming on a loader thread never holds up
+	 * the thread that draws.
+	 */
+	class UploadManager {
+
+	public:
+
+		/**
+		 * @brief Stages that may read uploaded data, which the graphics queue
+		 * waits at for the upload semaphores.
+		 */
+		static constexpr VkPipelineStageFlags CONSUMER_STAGES =
+			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT |
+			VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+			VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+			VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+	private:
+
+		/**
+		 * @brief Alignment of the staging space of each copy, which keeps
+		 * offsets valid for copies into images as well.
+		 */
+		static constexpr VkDeviceSize STAGING_ALIGNMENT = 16;
+
+		/**
+		 * @brief Copies submitted together, and what to wait on for them.
+		 */
+		struct Batch {
+			VkCommandBuffer commandBuffer{ VK_NULL_HANDLE };
+			VkFence fence{ VK_NULL_HANDLE };
+			u64 id{ 0 };
+
+			/**
+			 * @brief Position of the ring head once the batch was staged, up to
+			 * which the ring is free again when the batch completes.
+			 */
+			u64 ringEnd{ 0 };
+		};
+
+		/**
+		 * @brief The logical device that the uploads are made on.
+		 */
+		const class LogicalDevice *m_logical_device;
+
+		/**
+		 * @brief Pool of the command buffers of each batch, on the transfer family.
+		 */
+		class CommandPool *m_command_pool{ nullptr };
+
+		/**
+		 * @brief Host-visible buffer that data is staged in.
+		 */
+		class Buffer *m_staging{ nullptr };
+
+		/**
+		 * @brief Start of the mapped staging buffer.
+		 */
+		u8 *m_mapped{ nullptr };
+
+		/**
+		 * @brief Size (in bytes) of the staging buffer.
+		 */
+		VkDeviceSize m_capacity;
+
+		/**
+		 * @brief Total bytes ever staged, so `m_head % m_capacity` is where the next upload goes.
+		 */
+		u64 m_head{ 0 };
+
+		/**
+		 * @brief Total bytes ever freed, so the ring holds `m_head - m_tail` bytes.
+		 */
+		u64 m_tail{ 0 };
+
+		/**
+		 * @brief `true` if the transfer and graphics families differ, so the
+		 * buffers must change ownership.
+		 */
+		bool m_transfer_ownership;
+
+		/**
+		 * @brief Guards everything that uploads touch.
+		 */
+		std::mutex m_mutex;
+
+		/**
+		 * @brief The batch copies are being recorded into.
+		 */
+		Batch m_open;
+
+		/**
+		 * @brief Batches submitted to the transfer queue, oldest first.
+		 */
+		std::deque<Batch> m_in_flight;
+
+		/**
+		 * @brief Command buffers and fences of completed batches, ready to reuse.
+		 */
+		std::vector<Batch> m_free;
+
+		/**
+		 * @brief Number of threads waiting on a fence with the lock released.
+		 * Completed batches are not reused while any are, since reusing a
+		 * batch resets its fence.
+		 */
+		u32 m_fence_waiters{ 0 };
+
+		/**
+		 * @brief Id of the next batch.
+		 */
+		u64 m_next_id{ 1 };
+
+		/**
+		 * @brief Every batch up to and including this id has completed.
+		 */
+		u64 m_completed_id{ 0 };
+
+		/**
+		 * @brief Releases to the graphics family, recorded when the open batch is submitted.
+		 */
+		std::vector<VkBufferMemoryBarrier> m_releases;
+
+		/**
+		 * @brief Acquires matching the releases of the open batch.
+		 */
+		std::vector<VkBufferMemoryBarrier> m_acquires;
+
+		/**
+		 * @brief Acquires of submitted batches that no frame has recorded yet.
+		 */
+		std::vector<VkBufferMemoryBarrier> m_pending_acquires;
+
+		/**
+		 * @brief Acquires for the current frame to record.
+		 */
+		std::vector<VkBufferMemoryBarrier> m_frame_acquires;
+
+		/**
+		 * @brief Releases of images to the graphics family, recorded when the open batch is submitted.
+		 */
+		std::vector<VkImageMemoryBarrier> m_image_releases;
+
+		/**
+		 * @brief Acquires matching the image releases of the open batch.
+		 */
+		std::vector<VkImageMemoryBarrier> m_image_acquires;
+
+		/**
+		 * @brief Image acquires of submitted batches that no frame has recorded yet.
+		 */
+		std::vector<VkImageMemoryBarrier> m_pending_image_acquires;
+
+		/**
+		 * @brief Image acquires for the current frame to record.
+		 */
+		std::vector<VkImageMemoryBarrier> m_frame_image_acquires;
+
+		/**
+		 * @brief Images fully copied into by the open batch, whose mip chains are still to be generated.
+		 */
+		std::vector<class Image*> m_images;
+
+		/**
+		 * @brief Images of submitted batches that no frame has finished yet.
+		 */
+		std::vector<class Image*> m_pending_images;
+
+		/**
+		 * @brief Images for the current frame to finish.
+		 */
+		std::vector<class Image*> m_frame_images;
+
+		/**
+		 * @brief Semaphores of submitted batches that no frame has waited on yet.
+		 */
+		std::vector<VkSemaphore> m_pending_semaphores;
+
+		/**
+		 * @brief Semaphores waited on by each frame in flight, reused once the frame completes.
+		 */
+		std::array<std::vector<VkSemaphore>, config::MAX_FRAMES_IN_FLIGHT> m_frame_semaphores;
+
+		/**
+		 * @brief Semaphores that are not waited on or signalled by anything.
+		 */
+		std::vector<VkSemaphore> m_free_semaphores;
+
+		/**
+		 * @brief The current frame in flight.
+		 */
+		u32 m_frame{ 0 };
+
+		/**
+		 * @brief Starts recording a new batch if none is open.
+		 */
+		void openBatch();
+
+		/**
+		 * @brief Submits the open batch, if it has any copies.
+		 */
+		void submitBatch();
+
+		/**
+		 * @brief Frees the ring space of every batch that has completed.
+		 */
+		void retireBatches();
+
+		/**
+		 * @brief Waits for the oldest submitted batch to complete with the lock
+		 * released, so frames can still begin in the meantime, then retires it.
+		 * @param lock The held lock on `m_mutex`, which is held again on return.
+		 */
+		void waitForOldest(std::unique_lock<std::mutex> &lock);
+
+		/**
+		 * @brief Reserves contiguous space in the ring, submitting and waiting
+		 * on earlier batches until there is room. The lock is released while
+		 * waiting, so other uploads may be recorded in the meantime.
+		 * @param lock The held lock on `m_mutex`.
+		 * @param size Size (in bytes) of the space, at most the size of the ring.
+		 * @returns Offset of the space in the staging buffer.
+		 */
+		VkDeviceSize reserve(std::unique_lock<std::mutex> &lock, VkDeviceSize size);
+
+	public:
+
+		/**
+		 * @brief Creates and maps the staging ring.
+		 * @param logiDevice The logical device to use.
+		 * @param capacity [Optional] Size (in bytes) of the staging ring.
+		 */
+		explicit UploadManager(class LogicalDevice *logiDevice, VkDeviceSize capacity = config::STAGING_RING_SIZE);
+
+		UploadManager(const UploadManager&) = delete;
+
+		UploadManager& operator=(const UploadManager&) = delete;
+
+		/**
+		 * @brief Destructor for the upload manager.
+		 */
+		~UploadManager();
+
+		/**
+		 * @brief Waits for every submitted upload and destroys the ring.
+		 */
+		void destroy();
+
+		/**
+		 * @brief Copies data into a buffer. Data larger than the ring is split
+		 * into several copies. The buffer must not be used until the upload
+		 * has been submitted and a frame has waited on it.
+		 * @param dest The buffer to copy into, created with `VK_BUFFER_USAGE_TRANSFER_DST_BIT`.
+		 * @param data The data to copy.
+		 * @param size Size (in bytes) of the data.
+		 * @param offset [Optional] Offset into the buffer.
+		 * @returns The id of the batch the last copy went into, to pass to `isComplete()` or `wait()`.
+		 */
+		u64 upload(class Buffer *dest, const void *data, VkDeviceSize size, VkDeviceSize offset = 0);
+
+		/**
+		 * @brief Copies texels into the first mip level of an image, whose
+		 * other levels are generated from it on the GPU at the start of the
+		 * frame that waits on the upload, leaving the image in
+		 * `VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL`. Data larger than the ring
+		 * is split into several copies of whole rows. If the ring fills up, the
+		 * calling thread waits for earlier copies to finish, but frames carry
+		 * on in the meantime. The image must not be in use, and must live until
+		 * a frame has recorded `recordAcquire()` after the upload.
+		 * @param dest The image to copy into, created with `VK_IMAGE_USAGE_TRANSFER_DST_BIT`
+		 * (and `VK_IMAGE_USAGE_TRANSFER_SRC_BIT` if it has more than one mip level).
+		 * @param data The tightly packed texels of the first mip level.
+		 * @param size Size (in bytes) of the data.
+		 * @returns The id of the batch the last copy went into, to pass to `isComplete()` or `wait()`.
+		 */
+		u64 upload(class Image *dest, const void *data, VkDeviceSize size);
+
+		/**
+		 * @brief Submits the copies recorded so far to the transfer queue.
+		 * @returns The id of the last batch submitted.
+		 */
+		u64 submit();
+
+		/**
+		 * @brief Moves on to the given frame in flight. Submits any recorded
+		 * copies, reuses the semaphores the frame waited on last time and
+		 * hands every submission that no frame has waited on to this frame.
+		 * The GPU must have finished with the frame.
+		 * @param frameIdx The index of the frame in flight.
+		 */
+		void beginFrame(u32 frameIdx);
+
+		/**
+		 * @brief Records the acquires of the buffers and images uploaded for
+		 * the current frame and generates the mip chains of the images, before
+		 * anything reads them. Does nothing if nothing was uploaded.
+		 * @param commandBuffer A command buffer of the current frame on the graphics queue.
+		 */
+		void recordAcquire(VkCommandBuffer commandBuffer);
+
+		/**
+		 * @returns The semaphores that the graphics submission of the current
+		 * frame must wait on at `CONSUMER_STAGES`.
+		 */
+		const std::vector<VkSemaphore>& getWaitSemaphores() const {
+			return m_frame_semaphores[m_frame];
+		}
+
+		/**
+		 * @param id The id of a batch returned by `upload()` or `submit()`.
+		 * @returns `true` if the batch has completed on the GPU, `false` otherwise.
+		 */
+		bool isComplete(u64 id);
+
+		/**
+		 * @brief Submits the batch if needed and waits for it to complete.
+		 * @param id The id of a batch returned by `upload()` or `submit()`.
+		 */
+		void wait(u64 id);
+
+		/**
+		 * @returns Size (in bytes) of the staging ring.
+		 */
+		const VkDeviceSize getCapacity() const {
+			return m_capacity;
+		}
+
+	};
+
+} // namespace carbon
+
+#endif // RES_UPLOAD_MANAGER_HPP
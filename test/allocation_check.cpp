@@ -0,0 +1,50 @@
+#include "carbon/carbon.hpp"
+
+// runs the engine headless and fails if any frame after the warm-up allocates from the heap
+int main() {
+
+	// frames that may allocate while pools and caches fill up, then frames that must not
+	constexpr carbon::u32 warmupFrames = 60;
+	constexpr carbon::u32 checkedFrames = 240;
+
+	carbon::window::Props properties;
+	properties.title = "Allocation Check";
+	properties.version = carbon::utils::version{ 1, 1, 0 };
+	properties.width = 640;
+	properties.height = 360;
+
+	carbon::Engine engine(properties, carbon::engine::Mode::Headless);
+	carbon::Logger logger = engine.getLogger();
+
+	if (!carbon::AllocationTracker::isEnabled()) {
+		logger.log(carbon::log::To::Console, carbon::log::State::Error, "Allocation check must be built with CARBON_TRACK_ALLOCATIONS.");
+		return 1;
+	}
+
+	carbon::AllocationTracker::setWarmupFrames(warmupFrames);
+
+	// empty draws still go through the parallel recording every frame
+	engine.setRecordDraws(256, [](VkCommandBuffer, carbon::u32, carbon::u32) {});
+
+	for (carbon::u32 i = 0; i < warmupFrames + checkedFrames && engine.isRunning(); i++) {
+		engine.update();
+	}
+
+	engine.stop();
+
+	const carbon::u64 violations = carbon::AllocationTracker::getViolationCount();
+
+	if (violations > 0) {
+		logger.log(carbon::log::To::Console, carbon::log::State::Error, fmt::format(
+			"{} heap allocations in {} of {} steady frames (see the log for where they came from).",
+			violations,
+			carbon::AllocationTracker::getViolatingFrameCount(),
+			checkedFrames
+		));
+
+		return 1;
+	}
+
+	logger.log(carbon::log::To::Console, carbon::log::State::Info, fmt::format("No heap allocations in {} steady frames.", checkedFrames));
+	return 0;
+}
@@ -27,6 +27,20 @@ int main() {
 	logger.log(carbon::log::To::File, carbon::log::State::Info, fmt::format("  Initialization -> {:.2f} ms", elapsed));
 	logger.log(carbon::log::To::File, carbon::log::State::Info, fmt::format("  Validation     -> {}", engine.isValidationEnabled() ? "Enabled" : "Disabled"));
 
+	const carbon::engine::StartupTimes &startup = engine.getStartupTimes();
+
+	logger.log(carbon::log::To::File, carbon::log::State::Info, "Startup Statistics:");
+	logger.log(carbon::log::To::File, carbon::log::State::Info, fmt::format("  Job system      -> {:.2f} ms", startup.jobSystem));
+	logger.log(carbon::log::To::File, carbon::log::State::Info, fmt::format("  Window          -> {:.2f} ms", startup.window));
+	logger.log(carbon::log::To::File, carbon::log::State::Info, fmt::format("  Instance        -> {:.2f} ms", startup.instance));
+	logger.log(carbon::log::To::File, carbon::log::State::Info, fmt::format("  Physical device -> {:.2f} ms", startup.physicalDevice));
+	logger.log(carbon::log::To::File, carbon::log::State::Info, fmt::format("  Logical device  -> {:.2f} ms", startup.device));
+	logger.log(carbon::log::To::File, carbon::log::State::Info, fmt::format("  Swapchain       -> {:.2f} ms", startup.presentation));
+	logger.log(carbon::log::To::File, carbon::log::State::Info, fmt::format("  Frame resources -> {:.2f} ms", startup.frameResources));
+	logger.log(carbon::log::To::File, carbon::log::State::Info, fmt::format("  Pipeline cache  -> {:.2f} ms", startup.pipelineCache));
+	logger.log(carbon::log::To::File, carbon::log::State::Info, fmt::format("  Shader cache    -> {:.2f} ms", startup.shaderCache));
+	logger.log(carbon::log::To::File, carbon::log::State::Info, fmt::format("  Total           -> {:.2f} ms", startup.total));
+
 	logger.log(carbon::log::To::File, carbon::log::State::Info, "Window Statistics:");
 	logger.log(carbon::log::To::File, carbon::log::State::Info, fmt::format("  Initial position -> {}", carbon::utils::showVector(engine.getWindow().getPosition())));
 	logger.log(carbon::log::To::File, carbon::log::State::Info, fmt::format("  Initial size     -> {}", carbon::utils::showVector(engine.getWindow().getSize())));
@@ -37,5 +51,9 @@ int main() {
 		engine.update();
 	}
 
+	logger.log(carbon::log::To::File, carbon::log::State::Info, "Frame Statistics:");
+	logger.log(carbon::log::To::File, carbon::log::State::Info, fmt::format("  Frames rendered    -> {}", engine.getFrameCount()));
+	logger.log(carbon::log::To::File, carbon::log::State::Info, fmt::format("  Average fence wait -> {:.3f} ms", engine.getAverageFenceWaitTime()));
+
 	return 0;
 }